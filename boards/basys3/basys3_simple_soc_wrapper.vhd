@@ -90,6 +90,18 @@ architecture rtl of basys3_simple_soc_wrapper is
     signal i_spi_mosi : std_logic;
     signal i_spi_csn  : std_logic;
 
+    -- SD card on the native bus (wb_sd_host, 4 bit) rather than SPI (wb_spi). The firmware must
+    -- be built to match, with SD_BUS_DEFAULT in mmc_device.h. Leave this off until tb_wb_sd_host
+    -- has passed in GHDL, wb_sd_host has not been simulated yet
+    constant C_SD_NATIVE : boolean := false;
+    signal i_sd_clk    : std_logic;
+    signal i_sd_cmd_o  : std_logic;
+    signal i_sd_cmd_oe : std_logic;
+    signal i_sd_cmd_i  : std_logic;
+    signal i_sd_dat_o  : std_logic_vector(3 downto 0);
+    signal i_sd_dat_oe : std_logic_vector(3 downto 0);
+    signal i_sd_dat_i  : std_logic_vector(3 downto 0);
+
 --    constant C_MEM_CTRL_CLK_FREQ_KHZ : integer := 65_000;   -- max for SPI_READ command (no wait states)
     constant C_MEM_CTRL_CLK_FREQ_KHZ : integer := 50_000;
     component clk_wiz_0 is
@@ -179,10 +191,26 @@ begin
     JC(1) <= i2c_sda;
 
     -- SD Card
-    SD_CLK <= i_spi_sck;
-    SD_CMD <= i_spi_mosi;
-    i_spi_miso <= SD_D0;
-    SD_D3 <= i_spi_csn;
+    gen_sd_spi : if not C_SD_NATIVE generate
+        SD_CLK <= i_spi_sck;
+        SD_CMD <= i_spi_mosi;
+        i_spi_miso <= SD_D0;
+        SD_D3 <= i_spi_csn;
+        i_sd_cmd_i <= '1';
+        i_sd_dat_i <= "1111";
+    end generate;
+
+    gen_sd_native : if C_SD_NATIVE generate
+        SD_CLK <= i_sd_clk;
+        SD_CMD <= i_sd_cmd_o when i_sd_cmd_oe = '1' else 'Z';
+        SD_D0  <= i_sd_dat_o(0) when i_sd_dat_oe(0) = '1' else 'Z';
+        SD_D1  <= i_sd_dat_o(1) when i_sd_dat_oe(1) = '1' else 'Z';
+        SD_D2  <= i_sd_dat_o(2) when i_sd_dat_oe(2) = '1' else 'Z';
+        SD_D3  <= i_sd_dat_o(3) when i_sd_dat_oe(3) = '1' else 'Z';
+        i_sd_cmd_i <= SD_CMD;
+        i_sd_dat_i <= SD_D3 & SD_D2 & SD_D1 & SD_D0;
+        i_spi_miso <= '1';
+    end generate;
     
     
      soc_inst : entity work.basys3_soc
@@ -191,7 +219,8 @@ begin
              G_MEM_INIT_FILE  => G_MEM_INIT_FILE,
              G_BOOT_INIT_FILE => G_BOOT_INIT_FILE,
              G_SOC_FREQ       => 25_000_000,
-             G_MEM_CTRL_CLK_FREQ_KHZ => C_MEM_CTRL_CLK_FREQ_KHZ
+             G_MEM_CTRL_CLK_FREQ_KHZ => C_MEM_CTRL_CLK_FREQ_KHZ,
+             G_INCLUDE_SD_HOST => C_SD_NATIVE
          )
          port map(
              clk          => clk25,
@@ -210,6 +239,13 @@ begin
              spi_miso_in  => i_spi_miso,
              spi_mosi_out => i_spi_mosi,
              spi_csn_out  => i_spi_csn,
+             sd_clk_out    => i_sd_clk,
+             sd_cmd_out    => i_sd_cmd_o,
+             sd_cmd_oe_out => i_sd_cmd_oe,
+             sd_cmd_in     => i_sd_cmd_i,
+             sd_dat_out    => i_sd_dat_o,
+             sd_dat_oe_out => i_sd_dat_oe,
+             sd_dat_in     => i_sd_dat_i,
              psram_clk    => PSRAM_QSPI_SCK,
              psram_cs_n   => PSRAM_QSPI_CSN,
              psram_sio    => PSRAM_QSPI_SIO,
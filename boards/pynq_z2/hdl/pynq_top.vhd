@@ -39,7 +39,13 @@ entity pynq_top is
 
         -- UART (to Raspi connector)
         uart_tx_out : out std_logic; -- Pin 5 (W19)
-        uart_rx_in  : in std_logic   -- Pin 3 (W18)
+        uart_rx_in  : in std_logic;  -- Pin 3 (W18)
+
+        -- SD card (SPI mode) on Pmod JA, Digilent Pmod MicroSD pinout
+        sd_cs_n_out : out std_logic; -- JA1 (Y18)
+        sd_mosi_out : out std_logic; -- JA2 (Y19)
+        sd_miso_in  : in std_logic;  -- JA3 (Y16)
+        sd_sck_out  : out std_logic  -- JA4 (Y17)
 
     );
 end entity;
@@ -66,11 +72,17 @@ architecture rtl of pynq_top is
     signal S_AXI_HP1_MOSI : t_axi_mosi := AXI_MOSI_ZERO;
     signal S_AXI_HP1_MISO : t_axi_miso := AXI_MISO_ZERO;
 
-    signal pixelclk : std_logic;
+    signal soc_clk  : std_logic; -- 25MHz
+    signal pixelclk : std_logic; -- video timing dependent
     signal dma_clk  : std_logic;
     signal dvi_clk  : std_logic;
     signal dvi_clkn : std_logic;
 
+    signal dvi_clk_125   : std_logic;
+    signal dvi_clkn_125  : std_logic;
+    signal timing_sel    : std_logic_vector(1 downto 0);
+    signal video_locked  : std_logic;
+
     signal red_pixel   : std_logic_vector(7 downto 0);
     signal green_pixel : std_logic_vector(7 downto 0);
     signal blue_pixel  : std_logic_vector(7 downto 0);
@@ -97,9 +109,36 @@ architecture rtl of pynq_top is
     signal comb_pixel   : t_pixel := (red => x"00", green => x"00", blue => x"00"); -- combined pixel
 
     -- VDMA control and status
-    signal buffer0_start                 : std_logic_vector(31 downto 0) := x"1000_0000";
-    signal buffer1_start                 : std_logic_vector(31 downto 0) := x"1020_0000";
-    signal buffer_sel_dma_clk            : std_logic                     := '0';
+    signal blitter_wb_mosi               : t_wb_mosi;
+    signal blitter_wb_miso               : t_wb_miso;
+    signal blitter_axi_mosi              : t_axi_mosi;
+    signal blitter_axi_miso              : t_axi_miso;
+    signal ext_mem_axi_mosi              : t_axi_mosi;
+    signal ext_mem_axi_miso              : t_axi_miso;
+    signal vdma_ctrl_wb_mosi             : t_wb_mosi;
+    signal vdma_ctrl_wb_miso             : t_wb_miso;
+    signal vdma_frame_irq                : std_logic;
+    signal buffer0_start                 : std_logic_vector(31 downto 0);
+    signal buffer1_start                 : std_logic_vector(31 downto 0);
+    signal buffer_sel_dma_clk            : std_logic;
+    signal active_buffer_dma_clk         : std_logic;
+    signal pixel_format_dma_clk          : std_logic_vector(1 downto 0);
+    signal palette_select_dma_clk        : std_logic;
+    signal timing_sel_dma_clk            : std_logic_vector(1 downto 0);
+    signal palette_addr                  : std_logic_vector(8 downto 0);
+    signal palette_stb                   : std_logic;
+    signal palette_we                    : std_logic;
+    signal palette_wdat                  : std_logic_vector(23 downto 0);
+    signal palette_rdat                  : std_logic_vector(23 downto 0);
+    signal palette_ack                   : std_logic;
+    signal dma_max_burst_dma_clk         : std_logic_vector(4 downto 0);
+    signal dma_queue_limit_dma_clk       : std_logic_vector(4 downto 0);
+    signal fifo_high_watermark_dma_clk   : std_logic_vector(15 downto 0);
+    signal fifo_low_watermark_dma_clk    : std_logic_vector(15 downto 0);
+    signal stat_frame_underflows_dma_clk : std_logic_vector(31 downto 0);
+    signal stat_fifo_min_level_dma_clk   : std_logic_vector(15 downto 0);
+    signal stat_max_outstanding_dma_clk  : std_logic_vector(7 downto 0);
+    signal stat_max_latency_dma_clk      : std_logic_vector(15 downto 0);
     signal start_of_frame_dma_clk        : std_logic;
     signal pixel_underflow_count_dma_clk : std_logic_vector(31 downto 0);
 
@@ -116,16 +155,7 @@ architecture rtl of pynq_top is
             clk_in100 : in std_logic
         );
     end component;
-    
-    component vio_0
-        port (
-            clk : in std_logic;
-            probe_out0 : out std_logic_vector(0 downto 0);
-            probe_out1 : out std_logic_vector(31 downto 0);
-            probe_out2 : out std_logic_vector(31 downto 0)
-        );
-    end component;
-        
+
     attribute mark_debug                                  : boolean;
     attribute mark_debug of locked                        : signal is true;
     attribute mark_debug of reset                         : signal is true;
@@ -140,27 +170,34 @@ begin
 
     reset  <= (not locked) or btn(3) or (not FCLK_RESET0_N);
     resetn <= not reset;
-    
-    vio : vio_0
-    port map (
-            clk => dma_clk,
-            probe_out0(0) => buffer_sel_dma_clk,
-            probe_out1 => buffer0_start,
-            probe_out2 => buffer1_start
-    );
 
     pll : clk_wiz_0
     port map(
         clk_out1       => open,     -- 100MHz
-        pixelclk_out   => pixelclk, -- 25MHz
-        axi_hp_clk_out => dma_clk,  -- 200MHz
-        dvi_clk_out    => dvi_clk,  -- 125MHz
-        dvi_clkn_out   => dvi_clkn, -- 125MHz, 180deg phase shift
+        pixelclk_out   => soc_clk,      -- 25MHz
+        axi_hp_clk_out => dma_clk,      -- 200MHz
+        dvi_clk_out    => dvi_clk_125,  -- 125MHz
+        dvi_clkn_out   => dvi_clkn_125, -- 125MHz, 180deg phase shift
         locked         => locked,
         reset          => '0',
         clk_in100      => FCLK_CLK0_100
 
     );
+    -- 640x480 runs from the SoC clock, 1280x720 from a second MMCM
+    video_clk_gen_inst : entity work.video_clk_gen
+        port map(
+            clk_in100      => FCLK_CLK0_100,
+            reset          => not FCLK_RESET0_N,
+            pixelclk_25_in => soc_clk,
+            dvi_clk_in     => dvi_clk_125,
+            dvi_clkn_in    => dvi_clkn_125,
+            timing_sel_in  => timing_sel,
+            pixelclk_out   => pixelclk,
+            dvi_clk_out    => dvi_clk,
+            dvi_clkn_out   => dvi_clkn,
+            locked_out     => video_locked
+        );
+
     gen_hamsterworks : if G_DVI = "hamsterworks" generate
         dvid_inst : entity work.dvid
             port map(
@@ -196,13 +233,14 @@ begin
 
     axi3_vdma_inst : entity work.axi3_vdma
         generic map(
+            G_TIMING_PRESETS   => C_VIDEO_PRESETS,
             G_PIXEL_FIFO_DEPTH => 512,
             G_ILA              => true
         )
         port map(
             dma_clk_in                        => dma_clk,
             pixelclk_in                       => pixelclk,
-            pixelclk_reset_in                 => reset,
+            pixelclk_reset_in                 => reset or not video_locked,
             dma_reset_in                      => reset,
             dma_axi_hp_mosi_out               => S_AXI_HP0_MOSI,
             dma_axi_hp_miso_in                => S_AXI_HP0_MISO,
@@ -214,28 +252,72 @@ begin
             buffer1_start_in                  => buffer1_start,
             pixel_underflow_count_dma_clk_out => pixel_underflow_count_dma_clk,
             start_of_frame_dma_clk_out        => start_of_frame_dma_clk,
-            buffer_sel_dma_clk_in             => buffer_sel_dma_clk
+            buffer_sel_dma_clk_in             => buffer_sel_dma_clk,
+            active_buffer_dma_clk_out         => active_buffer_dma_clk,
+            pixel_format_dma_clk_in           => pixel_format_dma_clk,
+            timing_sel_dma_clk_in             => timing_sel_dma_clk,
+            palette_select_dma_clk_in         => palette_select_dma_clk,
+            palette_clk_in                    => soc_clk,
+            palette_addr_in                   => palette_addr,
+            palette_stb_in                    => palette_stb,
+            palette_we_in                     => palette_we,
+            palette_wdat_in                   => palette_wdat,
+            palette_rdat_out                  => palette_rdat,
+            palette_ack_out                   => palette_ack,
+            dma_max_burst_dma_clk_in          => dma_max_burst_dma_clk,
+            dma_queue_limit_dma_clk_in        => dma_queue_limit_dma_clk,
+            fifo_high_watermark_dma_clk_in    => fifo_high_watermark_dma_clk,
+            fifo_low_watermark_dma_clk_in     => fifo_low_watermark_dma_clk,
+            stat_frame_underflows_dma_clk_out => stat_frame_underflows_dma_clk,
+            stat_fifo_min_level_dma_clk_out   => stat_fifo_min_level_dma_clk,
+            stat_max_outstanding_dma_clk_out  => stat_max_outstanding_dma_clk,
+            stat_max_latency_dma_clk_out      => stat_max_latency_dma_clk
         );
 
-    -- remove to prevent flickering until we are writing to the framebuffer
-    --    buffer_flip : process(dma_clk) is
-    --    begin
-    --        if rising_edge(dma_clk) then
-    --            if start_of_frame_dma_clk = '1' then
-    --                buffer_sel_dma_clk <= not buffer_sel_dma_clk;
-    --            end if;
-    --        end if;
-    --    end process;
+    -- CPU controlled double buffering, flips are applied at the next VSYNC
+    wb_vdma_ctrl_inst : entity work.wb_vdma_ctrl
+        generic map(G_PIXEL_FIFO_DEPTH => 512)
+        port map(
+            wb_clk                           => soc_clk,
+            wb_reset                         => reset,
+            wb_mosi_in                       => vdma_ctrl_wb_mosi,
+            wb_miso_out                      => vdma_ctrl_wb_miso,
+            frame_irq_out                    => vdma_frame_irq, -- no interrupt controller yet, polled via GPIO_BTN[31]
+            dma_clk                          => dma_clk,
+            buffer0_start_out                => buffer0_start,
+            buffer1_start_out                => buffer1_start,
+            buffer_sel_dma_clk_out           => buffer_sel_dma_clk,
+            start_of_frame_dma_clk_in        => start_of_frame_dma_clk,
+            active_buffer_dma_clk_in         => active_buffer_dma_clk,
+            pixel_format_dma_clk_out         => pixel_format_dma_clk,
+            palette_select_dma_clk_out       => palette_select_dma_clk,
+            timing_sel_dma_clk_out           => timing_sel_dma_clk,
+            timing_sel_out                   => timing_sel,
+            palette_addr_out                 => palette_addr,
+            palette_stb_out                  => palette_stb,
+            palette_we_out                   => palette_we,
+            palette_wdat_out                 => palette_wdat,
+            palette_rdat_in                  => palette_rdat,
+            palette_ack_in                   => palette_ack,
+            dma_max_burst_dma_clk_out        => dma_max_burst_dma_clk,
+            dma_queue_limit_dma_clk_out      => dma_queue_limit_dma_clk,
+            fifo_high_watermark_dma_clk_out  => fifo_high_watermark_dma_clk,
+            fifo_low_watermark_dma_clk_out   => fifo_low_watermark_dma_clk,
+            stat_frame_underflows_dma_clk_in => stat_frame_underflows_dma_clk,
+            stat_fifo_min_level_dma_clk_in   => stat_fifo_min_level_dma_clk,
+            stat_max_outstanding_dma_clk_in  => stat_max_outstanding_dma_clk,
+            stat_max_latency_dma_clk_in      => stat_max_latency_dma_clk
+        );
 
     comb_pixel <= func_combine_pixel_or(bitmap_pixel, txt_pixel);
 
     ps_block_custom_wrapper_inst : entity work.ps_block_custom_wrapper
         generic map(G_S_AXI_HP0_DEBUG => false) -- use ILAs inside block diagram instead
         port map(
-            M_AXI_GP0_ACLK_IN => pixelclk,
-            S_AXI_GP0_ACLK_IN => pixelclk,
+            M_AXI_GP0_ACLK_IN => soc_clk,
+            S_AXI_GP0_ACLK_IN => soc_clk,
             S_AXI_HP0_ACLK_IN => dma_clk,
-            S_AXI_HP1_ACLK_IN => pixelclk,
+            S_AXI_HP1_ACLK_IN => soc_clk,
             DDR               => DDR,
             FCLK_CLK0_100     => FCLK_CLK0_100,
             FCLK_RESET0_N     => FCLK_RESET0_N, -- reset out
@@ -261,7 +343,7 @@ begin
     -- connect the FPCA SoC to the Zynq PS peripheral registers
     wb_to_axi3_shim_inst : entity work.wb_to_axi3_shim
         port map(
-            wb_clk       => pixelclk,
+            wb_clk       => soc_clk,
             wb_reset     => reset,
             wb_mosi_in   => zynq_ps_peripherals_wb_mosi,
             wb_miso_out  => zynq_ps_peripherals_wb_miso,
@@ -272,12 +354,40 @@ begin
     -- connect the FPCA SoC to the Zynq DDR3. This could use a cache at some point
     wb_to_axi3_shim_inst2 : entity work.wb_to_axi3_shim
         port map(
-            wb_clk       => pixelclk,
+            wb_clk       => soc_clk,
             wb_reset     => reset,
             wb_mosi_in   => ext_mem_wb_mosi,
             wb_miso_out  => ext_mem_wb_miso,
-            axi_mosi_out => S_AXI_HP1_MOSI,
-            axi_miso_in  => S_AXI_HP1_MISO
+            axi_mosi_out => ext_mem_axi_mosi,
+            axi_miso_in  => ext_mem_axi_miso
+        );
+
+    -- 2D blitter for framebuffer fills, copies and text
+    axi3_blitter_inst : entity work.axi3_blitter
+        generic map(
+            G_FONT_FILE => "../../../tools/font_rom8x16.txt" -- from toolchain
+        )
+        port map(
+            clk          => soc_clk,
+            reset        => reset,
+            wb_mosi_in   => blitter_wb_mosi,
+            wb_miso_out  => blitter_wb_miso,
+            axi_mosi_out => blitter_axi_mosi,
+            axi_miso_in  => blitter_axi_miso,
+            busy_out     => open
+        );
+
+    -- CPU accesses get priority over the blitter on HP1
+    axi3_mux_2to1_inst : entity work.axi3_mux_2to1
+        port map(
+            axi_clk         => soc_clk,
+            axi_reset       => reset,
+            m0_axi_mosi_in  => ext_mem_axi_mosi,
+            m0_axi_miso_out => ext_mem_axi_miso,
+            m1_axi_mosi_in  => blitter_axi_mosi,
+            m1_axi_miso_out => blitter_axi_miso,
+            axi_mosi_out    => S_AXI_HP1_MOSI,
+            axi_miso_in     => S_AXI_HP1_MISO
         );
 
     -- FPCA RISC-V SoC and peripherals
@@ -290,10 +400,10 @@ begin
             G_INCLUDE_JTAG_DEBUG => false -- connect AXI JTAG to the wishbone bus
         )
         port map(
-            clk          => pixelclk,
+            clk          => soc_clk,
             reset        => reset,
             gpio_led_out => gpio_led,
-            gpio_btn_in  => x"0000_000" & btn(3 downto 0),
+            gpio_btn_in  => vdma_frame_irq & b"000" & x"00_0000" & btn(3 downto 0),
             gpio_sw_in   => x"0000_000" & b"00" & sw(1 downto 0),
             -- sseg_ca_out              => sseg_ca_out,
             -- sseg_an_out              => sseg_an_out,
@@ -301,8 +411,16 @@ begin
             uart_rx_in                      => uart_rx_in,
             i2c_scl_out                     => open,
             i2c_sda_out                     => open,
+            sd_spi_sck_out                  => sd_sck_out,
+            sd_spi_cs_n_out                 => sd_cs_n_out,
+            sd_spi_mosi_out                 => sd_mosi_out,
+            sd_spi_miso_in                  => sd_miso_in,
             text_display_wb_mosi_out        => text_display_wb_mosi,
             text_display_wb_miso_in         => text_display_wb_miso,
+            vdma_ctrl_wb_mosi_out           => vdma_ctrl_wb_mosi,
+            vdma_ctrl_wb_miso_in            => vdma_ctrl_wb_miso,
+            blitter_wb_mosi_out             => blitter_wb_mosi,
+            blitter_wb_miso_in              => blitter_wb_miso,
             ext_mem_wb_mosi_out             => ext_mem_wb_mosi,
             ext_mem_wb_miso_in              => ext_mem_wb_miso,
             zynq_ps_peripherals_wb_mosi_out => zynq_ps_peripherals_wb_mosi,
@@ -0,0 +1,73 @@
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+
+library UNISIM;
+use UNISIM.vcomponents.all;
+
+--! Pixel and 5x DVI serialiser clocks for the C_VIDEO_PRESETS timings in graphics_pkg
+--!
+--! Preset 0 (640x480) uses the 25MHz/125MHz clocks from clk_wiz_0. Preset 1 (1280x720) gets
+--! 74.25MHz/371.25MHz from a dedicated MMCM. The outputs are switched glitch-free with
+--! BUFGMUX_CTRLs, so both sets of clocks must be running.
+entity video_clk_gen is
+    port (
+        clk_in100 : in std_logic;
+        reset     : in std_logic;
+
+        -- 640x480
+        pixelclk_25_in : in std_logic;
+        dvi_clk_in     : in std_logic;
+        dvi_clkn_in    : in std_logic;
+
+        timing_sel_in : in std_logic_vector(1 downto 0); --! async, from wb_vdma_ctrl
+
+        pixelclk_out : out std_logic;
+        dvi_clk_out  : out std_logic;
+        dvi_clkn_out : out std_logic;
+        locked_out   : out std_logic
+    );
+end entity;
+
+architecture rtl of video_clk_gen is
+    signal clkfb         : std_logic;
+    signal pixelclk_720p : std_logic;
+    signal dvi_clk_720p  : std_logic;
+    signal dvi_clkn_720p : std_logic;
+begin
+
+    -- VCO = 100MHz * 37.125 / 5 = 742.5MHz
+    mmcm_720p : MMCME2_BASE
+    generic map(
+        BANDWIDTH          => "OPTIMIZED",
+        CLKIN1_PERIOD      => 10.0,
+        DIVCLK_DIVIDE      => 5,
+        CLKFBOUT_MULT_F    => 37.125,
+        CLKOUT0_DIVIDE_F   => 10.0, -- 74.25MHz
+        CLKOUT1_DIVIDE     => 2,    -- 371.25MHz
+        CLKOUT2_DIVIDE     => 2,    -- 371.25MHz, 180deg phase shift
+        CLKOUT2_PHASE      => 180.0,
+        STARTUP_WAIT       => false
+    )
+    port map(
+        CLKIN1   => clk_in100,
+        CLKFBIN  => clkfb,
+        CLKFBOUT => clkfb,
+        CLKOUT0  => pixelclk_720p,
+        CLKOUT1  => dvi_clk_720p,
+        CLKOUT2  => dvi_clkn_720p,
+        LOCKED   => locked_out,
+        PWRDWN   => '0',
+        RST      => reset
+    );
+
+    bufgmux_pixelclk : BUFGMUX_CTRL
+    port map(O => pixelclk_out, I0 => pixelclk_25_in, I1 => pixelclk_720p, S => timing_sel_in(0));
+
+    bufgmux_dvi_clk : BUFGMUX_CTRL
+    port map(O => dvi_clk_out, I0 => dvi_clk_in, I1 => dvi_clk_720p, S => timing_sel_in(0));
+
+    bufgmux_dvi_clkn : BUFGMUX_CTRL
+    port map(O => dvi_clkn_out, I0 => dvi_clkn_in, I1 => dvi_clkn_720p, S => timing_sel_in(0));
+
+end architecture;
@@ -45,6 +45,10 @@ architecture bench of pynq_top_tb is
     signal sw                : std_logic_vector(1 downto 0);
     signal uart_tx_out       : std_logic;
     signal uart_rx_in        : std_logic;
+    signal sd_cs_n_out       : std_logic;
+    signal sd_mosi_out       : std_logic;
+    signal sd_miso_in        : std_logic := '1'; -- no card
+    signal sd_sck_out        : std_logic;
 
 begin
 
@@ -74,7 +78,11 @@ begin
             btn               => btn,
             sw                => sw,
             uart_tx_out       => uart_tx_out,
-            uart_rx_in        => uart_rx_in
+            uart_rx_in        => uart_rx_in,
+            sd_cs_n_out       => sd_cs_n_out,
+            sd_mosi_out       => sd_mosi_out,
+            sd_miso_in        => sd_miso_in,
+            sd_sck_out        => sd_sck_out
         );
 
     reset_process : process
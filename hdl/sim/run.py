@@ -14,8 +14,11 @@ from vunit import VUnit, VUnitCLI
 import os
 from glob import glob
 import resource
+import subprocess
 import sys
 
+from sim_perf import add_perf_args, apply_perf_defaults, make_post_run
+
 def add_some_files_to_vunit(vunit_obj, dir, exclude_patterns, library):
     """Adds a list of all VHDL files in a directory structure to Vunit, excluding those in EXCLUDE"""
     print("===================================================")
@@ -42,6 +45,42 @@ def add_some_files_to_vunit(vunit_obj, dir, exclude_patterns, library):
 
 
 
+def add_icache_configs(vunit_obj):
+    """Runs tb_icache for a few generic settings, with the hit/miss counters that
+    tools/icache_explorer.py predicts for the data/icache_trace.txt replay"""
+    sys.path.insert(0, str(Path(__file__).resolve().parents[2] / "tools"))
+    from icache_explorer import ICacheModel, read_trace
+
+    addrs, rvc = read_trace(Path(__file__).parent / "data" / "icache_trace.txt", ro_mem=True)
+    tb = vunit_obj.library("lib").test_bench("tb_icache")
+    for num_blocks, block_size, set_size, rv32c_opt in [(16, 32, 2, True), (16, 32, 1, True), (8, 16, 1, False), (32, 32, 4, True)]:
+        model = ICacheModel(num_blocks, block_size, set_size, rv32c_opt).run(addrs, rvc)
+        generics = dict(G_NUM_BLOCKS=num_blocks, G_BLOCK_SIZE=block_size, G_SET_SIZE=set_size, G_RV32C_OPT=rv32c_opt)
+        # which way the LFSR evicts depends on the exact clock, so only check when it never had to
+        if model.random_replacements == 0:
+            generics.update(G_EXPECT_HITS=model.hit_count, G_EXPECT_OFLOWS=model.oflow_count, G_EXPECT_MISSES=model.miss_count)
+        tb.add_config(name=f"{num_blocks}x{block_size}B_{set_size}way" + ("" if rv32c_opt else "_no_rvc"), generics=generics)
+
+
+def build_sd_card_model(output_path):
+    """Builds the SD card model from the hosted firmware build (software/src/hosted) as
+    libsd_card_model.so, which sim_sd_card.vhd calls through VHPIDIRECT, and puts it on the
+    LD_LIBRARY_PATH the simulations inherit"""
+    sw_dir = Path(__file__).resolve().parents[2] / "software" / "src"
+    lib_dir = Path(output_path).resolve()
+    lib_dir.mkdir(parents=True, exist_ok=True)
+    cmd = ["gcc", "-shared", "-fPIC", "-O2", "-Wno-int-to-pointer-cast",
+           f"-I{sw_dir}", f"-I{sw_dir / 'hosted'}", f"-I{sw_dir / 'lib' / 'sdcard'}",
+           "-o", str(lib_dir / "libsd_card_model.so"),
+           str(Path(__file__).parent / "tb_helpers" / "sim_sd_card_vhpi.c"),
+           str(sw_dir / "hosted" / "sd_card_model.c")]
+    try:
+        subprocess.run(cmd, check=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print(f"Could not build libsd_card_model.so, tb_wb_spi_sd_card will fail: {e}")
+    os.environ["LD_LIBRARY_PATH"] = os.pathsep.join(filter(None, [str(lib_dir), os.environ.get("LD_LIBRARY_PATH")]))
+
+
 def main():
     # increase stack size to prevent GHDL crashing
     resource.setrlimit(resource.RLIMIT_STACK, (resource.RLIM_INFINITY, resource.RLIM_INFINITY))
@@ -49,11 +88,16 @@ def main():
 
     ### Automatically Set VUnit Command Line Args
     cli=VUnitCLI()
-    cli.parser.add_argument('--skip-wave', help="Skip saving waveforms for each simulation (to speed up sim)")
+    cli.parser.add_argument('--skip-wave', action="store_true", help="Skip saving waveforms for each simulation (to speed up sim)")
+    cli.parser.add_argument('--wave', action="store_true", help="Save waveforms even in CI")
+    add_perf_args(cli)
     args=cli.parse_args()
     # print(f"{args=}")
-    if not args.skip_wave:
+    # waves are slow to write, so CI (which sets $CI) never dumps them unless asked to
+    in_ci = os.environ.get("CI", "") not in ("", "0", "false")
+    if args.wave or not (args.skip_wave or in_ci):
         args.viewer_fmt = "ghw"     # Always dump GTKWave files
+    apply_perf_defaults(args)
     # print(f"{args=}")
 
 
@@ -147,7 +191,10 @@ def main():
     # /usr/local/bin/ghdl:error: declaration of a too large object (144 > --max-stack-alloc=128 KB)
     VU.set_sim_option("ghdl.sim_flags", ["--max-stack-alloc=256", "--ieee-asserts=disable"]) # value is in KB
 
-    VU.main()
+    add_icache_configs(VU)
+    build_sd_card_model(args.output_path)
+
+    VU.main(post_run=make_post_run(args))
 
 
 if __name__ == "__main__":
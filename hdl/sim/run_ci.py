@@ -2,7 +2,10 @@
 from pathlib import Path
 import resource
 from glob import glob
-from vunit import VUnit
+from vunit import VUnit, VUnitCLI
+
+from sim_perf import add_perf_args, apply_perf_defaults, make_post_run
+from run import add_icache_configs, build_sd_card_model
 
 def add_some_files_to_vunit(vunit_obj, dir, exclude_patterns, library):
     """Adds a list of all VHDL files in a directory structure to Vunit, excluding those in EXCLUDE"""
@@ -32,7 +35,12 @@ def main():
     # increase stack size to prevent GHDL crashing
     # resource.setrlimit(resource.RLIMIT_STACK, (resource.RLIM_INFINITY, resource.RLIM_INFINITY))
     
-    VU = VUnit.from_argv()
+    # no waves, all cores, compiled libraries kept in vunit_out (cached by the workflow)
+    cli = VUnitCLI()
+    add_perf_args(cli)
+    args = cli.parse_args()
+    apply_perf_defaults(args)
+    VU = VUnit.from_args(args=args)
 
     VU.add_vhdl_builtins()
     VU.add_verification_components()
@@ -57,13 +65,9 @@ def main():
 
     VU.add_library("lib")
     
-    # Ignore the "no-ci" testbench folder
-    # see if we really limit the testbench list that prevents "Error Code 143" in the CI
-
+    # Same testbenches as run.py, except the "no-ci" folder
     VU.add_source_files(sim_tb_dir / "riscv-gen2/**/*.vhd", "lib")
-    VU.add_source_files(sim_tb_dir / "tb_vunit.vhd", "lib")
-
-    # VU.add_source_files(sim_tb_dir / "*.vhd", "lib")  
+    VU.add_source_files(sim_tb_dir / "*.vhd", "lib")
 
 
 
@@ -92,7 +96,11 @@ def main():
     # /usr/local/bin/ghdl:error: declaration of a too large object (144 > --max-stack-alloc=128 KB)
     VU.set_sim_option("ghdl.sim_flags", ["--max-stack-alloc=256", "--ieee-asserts=disable"]) # value is in KB
 
-    VU.main()
+    # the same extra configurations and C models run.py sets up
+    add_icache_configs(VU)
+    build_sd_card_model(args.output_path)
+
+    VU.main(post_run=make_post_run(args))
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
@@ -0,0 +1,118 @@
+"""Shared speed-ups and per-test timing for run.py and run_ci.py
+
+- shard tests across all cores unless -p is given
+- keep a fixed VUnit output path so compiled libraries are reused between runs. VUnit only
+  recompiles a file when its content hash (or a dependency's) changes, so caching the output
+  folder (see .github/workflows/simulate.yml) skips the XPM/unisim/source compile entirely
+- write wall-clock and simulated time for every test to JSON, and compare against a baseline
+"""
+
+import json
+import os
+import re
+import sys
+from pathlib import Path
+
+SIM_DIR = Path(__file__).resolve().parent
+DEFAULT_OUTPUT_PATH = SIM_DIR / "vunit_out"
+DEFAULT_TIMING_JSON = DEFAULT_OUTPUT_PATH / "test_timing.json"
+DEFAULT_BASELINE_JSON = SIM_DIR / "timing_baseline.json"
+
+# time units GHDL and VUnit print, in fs
+TIME_UNITS = {"fs": 1, "ps": 10**3, "ns": 10**6, "us": 10**9, "ms": 10**12, "sec": 10**15, "s": 10**15}
+
+# GHDL: "simulation stopped @1234ns" / "simulation finished @1234ns"
+GHDL_END_RE = re.compile(r"simulation (?:stopped|finished)\D*@(\d+)(fs|ps|ns|us|ms|sec|s)\b")
+# VUnit log lines: "       1000000 fs - default - INFO - ..."
+VUNIT_LOG_RE = re.compile(r"^\s*(\d+) (fs|ps|ns|us|ms|sec) - ", re.MULTILINE)
+
+
+def add_perf_args(cli):
+    """Add the timing options to a VUnitCLI"""
+    cli.parser.add_argument("--timing-json", default=str(DEFAULT_TIMING_JSON),
+                            help="Where to write per-test wall-clock and simulated time")
+    cli.parser.add_argument("--timing-baseline", default=str(DEFAULT_BASELINE_JSON),
+                            help="Timing JSON to compare against, slowdowns are reported")
+    cli.parser.add_argument("--update-baseline", action="store_true",
+                            help="Overwrite the baseline with this run's timing")
+    cli.parser.add_argument("--slowdown-threshold", type=float, default=1.5,
+                            help="Flag tests whose wall-clock time grew by more than this factor")
+    cli.parser.add_argument("--fail-on-slowdown", action="store_true",
+                            help="Exit with an error if any test is flagged as slower")
+
+
+def apply_perf_defaults(args, argv=None):
+    """Parallel and cached by default, unless overridden on the command line"""
+    argv = sys.argv[1:] if argv is None else argv
+    if not any(a == "-p" or a.startswith("--num-threads") or (a.startswith("-p") and a[2:].isdigit()) for a in argv):
+        args.num_threads = os.cpu_count() or 1
+    if not any(a.startswith("-o") or a.startswith("--output-path") for a in argv):
+        args.output_path = str(DEFAULT_OUTPUT_PATH)
+    print(f"Running with {args.num_threads} threads, output (and compile cache) in {args.output_path}")
+
+
+def _sim_time_fs(output_file):
+    """Simulated time a test reached, from its output.txt"""
+    try:
+        text = Path(output_file).read_text(errors="replace")
+    except OSError:
+        return None
+    match = GHDL_END_RE.findall(text)
+    if not match:
+        match = VUNIT_LOG_RE.findall(text)
+    if not match:
+        return None
+    value, unit = match[-1]
+    return int(value) * TIME_UNITS[unit]
+
+
+def _compare(timing, baseline, threshold):
+    slower = []
+    for name, entry in timing.items():
+        base = baseline.get(name)
+        if base is None or not base.get("wall_s"):
+            continue
+        ratio = entry["wall_s"] / base["wall_s"]
+        # ignore tiny tests where noise dominates
+        if ratio > threshold and entry["wall_s"] - base["wall_s"] > 0.5:
+            slower.append((name, base["wall_s"], entry["wall_s"], ratio))
+    return slower
+
+
+def make_post_run(args):
+    """Returns a VUnit post_run callback that records and checks test timing"""
+
+    def post_run(results):
+        report = results.get_report()
+        timing = {}
+        for name, test in report.tests.items():
+            timing[name] = {
+                "status": test.status.name,
+                "wall_s": round(test.time, 3),
+                "sim_fs": _sim_time_fs(Path(test.path) / "output.txt"),
+            }
+        json_path = Path(args.timing_json)
+        json_path.parent.mkdir(parents=True, exist_ok=True)
+        json_path.write_text(json.dumps(timing, indent=2, sort_keys=True))
+        total = sum(t["wall_s"] for t in timing.values())
+        print(f"Wrote timing for {len(timing)} tests ({total:.1f}s total) to {json_path}")
+
+        baseline_path = Path(args.timing_baseline)
+        if args.update_baseline:
+            baseline_path.write_text(json.dumps(timing, indent=2, sort_keys=True))
+            print(f"Updated baseline {baseline_path}")
+            return
+        if not baseline_path.exists():
+            print(f"No timing baseline at {baseline_path}, run with --update-baseline to create one")
+            return
+
+        slower = _compare(timing, json.loads(baseline_path.read_text()), args.slowdown_threshold)
+        for name, base, now, ratio in sorted(slower, key=lambda s: -s[3]):
+            print(f"SLOWDOWN {name}: {base:.2f}s -> {now:.2f}s (x{ratio:.2f})")
+        if not slower:
+            print(f"No tests slower than x{args.slowdown_threshold} against {baseline_path}")
+        elif args.fail_on_slowdown:
+            print(f"{len(slower)} tests slower than the baseline")
+            sys.exit(1)
+
+    return post_run
@@ -0,0 +1,231 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.axi_pkg.all;
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+use work.sim_wb_procedures_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+context vunit_lib.com_context;
+context vunit_lib.vc_context;
+
+entity tb_axi3_blitter is
+    generic (
+        runner_cfg     : string;
+        G_PROJECT_ROOT : string := "C:/Users/joehi/Documents/fpga/fpca/"
+    );
+end;
+
+architecture bench of tb_axi3_blitter is
+    signal mem : memory_t; -- get from vunit_axi_slave
+
+    constant MEM_WORDS : integer := 2 ** 14;
+    constant STRIDE    : integer := 256; -- 64 pixels per line keeps the memory model small
+
+    -- Clock period
+    constant clk_period : time := 10 ns;
+
+    -- Ports
+    signal clk      : std_logic;
+    signal reset    : std_logic := '1';
+    signal wb_mosi  : t_wb_mosi := C_WB_MOSI_INIT;
+    signal wb_miso  : t_wb_miso;
+    signal axi_mosi : t_axi_mosi;
+    signal axi_miso : t_axi_miso;
+    signal busy     : std_logic;
+
+    -- register offsets
+    constant REG_DST        : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant REG_SRC        : std_logic_vector(31 downto 0) := x"0000_0004";
+    constant REG_SIZE       : std_logic_vector(31 downto 0) := x"0000_0008";
+    constant REG_STRIDE     : std_logic_vector(31 downto 0) := x"0000_000C";
+    constant REG_FG         : std_logic_vector(31 downto 0) := x"0000_0010";
+    constant REG_BG         : std_logic_vector(31 downto 0) := x"0000_0014";
+    constant REG_CMD        : std_logic_vector(31 downto 0) := x"0000_0018";
+    constant REG_STATUS     : std_logic_vector(31 downto 0) := x"0000_001C";
+    constant REG_DONE_COUNT : std_logic_vector(31 downto 0) := x"0000_0020";
+
+    constant OP_FILL  : integer := 0;
+    constant OP_COPY  : integer := 1;
+    constant OP_GLYPH : integer := 2;
+    constant OP_RGB24 : integer := 3;
+    constant CMD_FLIP : integer := 4;
+
+    function pixel_addr(x, y : integer) return integer is
+    begin
+        return y * STRIDE + x * 4;
+    end function;
+
+begin
+
+    axi3_blitter_inst : entity work.axi3_blitter
+        generic map(
+            G_QUEUE_DEPTH => 4,
+            G_FONT_FILE   => G_PROJECT_ROOT & "tools/font_rom8x16.txt"
+        )
+        port map(
+            clk          => clk,
+            reset        => reset,
+            wb_mosi_in   => wb_mosi,
+            wb_miso_out  => wb_miso,
+            axi_mosi_out => axi_mosi,
+            axi_miso_in  => axi_miso,
+            busy_out     => busy
+        );
+
+    vunit_axi_slave_inst : entity work.vunit_axi_slave
+        generic map(G_NAME => "DDR3", G_BASE_ADDR => x"0000_0000", G_BYTES => MEM_WORDS * 4, G_DEBUG_PRINT => false)
+        port map(
+            axi_clk        => clk,
+            axi_mosi       => axi_mosi,
+            axi_miso       => axi_miso,
+            memory_ref_out => mem
+        );
+
+    main : process
+        procedure blit (op, dst, src, w, h : integer; fg, bg : std_logic_vector(31 downto 0) := x"0000_0000") is
+        begin
+            sim_wb_write(clk, wb_mosi, wb_miso, REG_DST, uint2slv(dst));
+            sim_wb_write(clk, wb_mosi, wb_miso, REG_SRC, uint2slv(src));
+            sim_wb_write(clk, wb_mosi, wb_miso, REG_SIZE, uint2slv(h, 16) & uint2slv(w, 16));
+            sim_wb_write(clk, wb_mosi, wb_miso, REG_FG, fg);
+            sim_wb_write(clk, wb_mosi, wb_miso, REG_BG, bg);
+            sim_wb_write(clk, wb_mosi, wb_miso, REG_CMD, uint2slv(op));
+        end procedure;
+
+        procedure wait_idle is
+        begin
+            wait until rising_edge(clk);
+            if busy = '1' then
+                wait until busy = '0';
+            end if;
+            sim_wb_check(clk, wb_mosi, wb_miso, REG_STATUS, x"0000_0000"); -- not busy, no errors
+        end procedure;
+
+        procedure check_pixel (x, y : integer; exp : std_logic_vector(31 downto 0); msg : string := "") is
+        begin
+            check_equal(read_word(mem, pixel_addr(x, y), 4), exp, msg & " pixel (" & to_string(x) & ", " & to_string(y) & ")");
+        end procedure;
+
+        variable exp : std_logic_vector(31 downto 0);
+
+        -- packed BGR source lines for RGB24, at an odd address and stride
+        constant RGB_SRC    : integer := 16#0F81#;
+        constant RGB_STRIDE : integer := 3 * 37 + 2;
+    begin
+        test_runner_setup(runner, runner_cfg);
+        show(get_logger(default_checker), display_handler, pass);
+
+        wait for 10 * clk_period;
+        wait until rising_edge(clk);
+        for i in 0 to MEM_WORDS - 1 loop
+            write_word(mem, i * 4, x"0000_0000");
+        end loop;
+        reset <= '0';
+        wait for 5 * clk_period;
+        sim_wb_write(clk, wb_mosi, wb_miso, REG_STRIDE, uint2slv(STRIDE, 16) & uint2slv(STRIDE, 16));
+
+        while test_suite loop
+            if run("fill") then
+                -- unaligned start, so the first burst is short
+                blit(OP_FILL, pixel_addr(3, 2), 0, 37, 5, x"00FF_0000");
+                wait_idle;
+                for y in 1 to 7 loop
+                    for x in 0 to 45 loop
+                        if x >= 3 and x < 3 + 37 and y >= 2 and y < 2 + 5 then
+                            check_pixel(x, y, x"00FF_0000", "fill");
+                        else
+                            check_pixel(x, y, x"0000_0000", "outside fill");
+                        end if;
+                    end loop;
+                end loop;
+                sim_wb_check(clk, wb_mosi, wb_miso, REG_DONE_COUNT, uint2slv(1));
+
+            elsif run("copy_overlapping") then
+                for y in 0 to 11 loop
+                    for x in 0 to 19 loop
+                        write_word(mem, pixel_addr(x, y), uint2slv(y * 256 + x));
+                    end loop;
+                end loop;
+                -- scroll down by 4 lines, needs to copy bottom to top
+                blit(OP_COPY, pixel_addr(0, 4), pixel_addr(0, 0), 20, 8);
+                wait_idle;
+                for y in 4 to 11 loop
+                    for x in 0 to 19 loop
+                        check_pixel(x, y, uint2slv((y - 4) * 256 + x), "scroll down");
+                    end loop;
+                end loop;
+                -- and back up again
+                blit(OP_COPY, pixel_addr(0, 0), pixel_addr(0, 4), 20, 8);
+                wait_idle;
+                for y in 0 to 7 loop
+                    for x in 0 to 19 loop
+                        check_pixel(x, y, uint2slv(y * 256 + x), "scroll up");
+                    end loop;
+                end loop;
+
+            elsif run("glyph") then
+                -- 'A', row 7 is 11111110
+                blit(OP_GLYPH, pixel_addr(8, 16), 16#41#, 0, 0, x"00FF_FFFF", x"0000_00FF");
+                wait_idle;
+                for x in 0 to 7 loop
+                    check_pixel(8 + x, 16, x"0000_00FF", "glyph row 0");
+                    exp := x"00FF_FFFF" when x < 7 else x"0000_00FF";
+                    check_pixel(8 + x, 16 + 7, exp, "glyph row 7");
+                end loop;
+                check_pixel(16, 16 + 7, x"0000_0000", "right of glyph");
+                check_pixel(8, 32, x"0000_0000", "below glyph");
+
+            elsif run("rgb24_flip") then
+                -- the second line's reads cross the 4KB boundary at 0x1000
+                for y in 0 to 2 loop
+                    for x in 0 to 36 loop
+                        write_byte(mem, RGB_SRC + y * RGB_STRIDE + 3 * x, x);          -- B
+                        write_byte(mem, RGB_SRC + y * RGB_STRIDE + 3 * x + 1, y);      -- G
+                        write_byte(mem, RGB_SRC + y * RGB_STRIDE + 3 * x + 2, 16#A5#); -- R
+                    end loop;
+                end loop;
+                sim_wb_write(clk, wb_mosi, wb_miso, REG_STRIDE, uint2slv(RGB_STRIDE, 16) & uint2slv(STRIDE, 16));
+                -- bottom up, like a BMP
+                blit(OP_RGB24 + CMD_FLIP, pixel_addr(5, 20), RGB_SRC, 37, 3);
+                wait_idle;
+                for y in 0 to 2 loop
+                    for x in 0 to 36 loop
+                        check_pixel(5 + x, 22 - y, x"00A5" & uint2slv(y, 8) & uint2slv(x, 8), "rgb24");
+                    end loop;
+                    check_pixel(4, 22 - y, x"0000_0000", "left of image");
+                    check_pixel(42, 22 - y, x"0000_0000", "right of image");
+                end loop;
+                check_pixel(5, 19, x"0000_0000", "above image");
+                check_pixel(5, 23, x"0000_0000", "below image");
+
+            elsif run("queue") then
+                -- more commands than the queue holds, CMD writes stall until there is room
+                for i in 0 to 7 loop
+                    blit(OP_FILL, pixel_addr(0, i), 0, 64, 1, uint2slv(i + 1));
+                end loop;
+                wait_idle;
+                sim_wb_check(clk, wb_mosi, wb_miso, REG_DONE_COUNT, uint2slv(8));
+                for i in 0 to 7 loop
+                    check_pixel(0, i, uint2slv(i + 1), "first pixel");
+                    check_pixel(63, i, uint2slv(i + 1), "last pixel");
+                end loop;
+            end if;
+        end loop;
+        test_runner_cleanup(runner);
+    end process main;
+
+    test_runner_watchdog(runner, 1 ms);
+
+    clk_process : process
+    begin
+        clk <= '1';
+        wait for clk_period/2;
+        clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
@@ -11,7 +11,10 @@ context vunit_lib.com_context;
 context vunit_lib.vc_context;
 
 entity axi3_vdma_tb is
-    generic (runner_cfg : string);
+    generic (
+        runner_cfg     : string;
+        G_PROJECT_ROOT : string := "C:/Users/joehi/Documents/fpga/fpca/"
+    );
 end;
 
 architecture bench of axi3_vdma_tb is
@@ -21,20 +24,10 @@ architecture bench of axi3_vdma_tb is
     -- constant MEM_WORDS : integer := 2**18;  -- a single 256 KB buffer
 
     -- Clock period
-    constant pixelclk_period : time := 40 ns;    -- 25MHz
-    constant dma_clk_period  : time := 6.666 ns; -- 150MHz
+    signal pixelclk_period  : time := 40 ns;       -- 25MHz, 13.468 ns (74.25MHz) for 720p
+    constant dma_clk_period : time := 6.666 ns;    -- 150MHz
     -- Generics
-    constant G_END_ACTIVE_X     : integer   := 640;
-    constant G_FRONT_PORCH_X    : integer   := 16;
-    constant G_SYNC_PULSE_X     : integer   := 96;
-    constant G_BACK_PORCH_X     : integer   := 48;
-    constant G_END_ACTIVE_Y     : integer   := 480;
-    constant G_FRONT_PORCH_Y    : integer   := 10;
-    constant G_SYNC_PULSE_Y     : integer   := 2;
-    constant G_BACK_PORCH_Y     : integer   := 33;
-    constant G_ACTIVE_HS        : std_logic := '0';
-    constant G_ACTIVE_VS        : std_logic := '0';
-    constant G_PIXEL_FIFO_DEPTH : integer   := 512;
+    constant G_PIXEL_FIFO_DEPTH : integer := 512;
 
     -- Ports
     signal dma_clk_in                        : std_logic;
@@ -52,23 +45,35 @@ architecture bench of axi3_vdma_tb is
     signal pixel_underflow_count_dma_clk_out : std_logic_vector(31 downto 0);
     signal start_of_frame_dma_clk_out        : std_logic;
     signal buffer_sel_dma_clk_in             : std_logic;
+    signal active_buffer_dma_clk_out         : std_logic;
+    signal timing_sel                        : std_logic_vector(1 downto 0) := "00";
+    signal dma_queue_limit                   : std_logic_vector(4 downto 0) := "00001";
+
+    -- output geometry, measured from the last complete line/frame
+    signal line_pixels  : integer := 0;
+    signal frame_lines  : integer := 0;
+    signal line_clocks  : integer := 0; -- hsync period
+    signal pixel_count  : integer := 0;
+    signal line_count   : integer := 0;
+    signal clock_count  : integer := 0;
+    signal vga_blank_d1 : std_logic := '1';
+    signal vga_hsync_d1 : std_logic := '0';
+    signal vga_pixel_d1 : t_pixel;
+    -- every row of the 720p frame starts red and ends green, count the rows that don't
+    constant C_ROW_FIRST    : t_pixel := (red => x"FF", green => x"00", blue => x"00");
+    constant C_ROW_LAST     : t_pixel := (red => x"00", green => x"FF", blue => x"00");
+    signal row_edge_errors  : integer := 0;
+    signal stat_frame_underflows_dma_clk_out : std_logic_vector(31 downto 0);
+    signal stat_max_outstanding_dma_clk_out  : std_logic_vector(7 downto 0);
+    signal stat_max_latency_dma_clk_out      : std_logic_vector(15 downto 0);
 
 begin
-    test_runner_watchdog(runner, 35 ms);
+    test_runner_watchdog(runner, 40 ms);
 
     -- DUT
     axi3_vdma_inst : entity work.axi3_vdma
         generic map(
-            G_END_ACTIVE_X     => G_END_ACTIVE_X,
-            G_FRONT_PORCH_X    => G_FRONT_PORCH_X,
-            G_SYNC_PULSE_X     => G_SYNC_PULSE_X,
-            G_BACK_PORCH_X     => G_BACK_PORCH_X,
-            G_END_ACTIVE_Y     => G_END_ACTIVE_Y,
-            G_FRONT_PORCH_Y    => G_FRONT_PORCH_Y,
-            G_SYNC_PULSE_Y     => G_SYNC_PULSE_Y,
-            G_BACK_PORCH_Y     => G_BACK_PORCH_Y,
-            G_ACTIVE_HS        => G_ACTIVE_HS,
-            G_ACTIVE_VS        => G_ACTIVE_VS,
+            G_TIMING_PRESETS   => C_VIDEO_PRESETS,
             G_PIXEL_FIFO_DEPTH => G_PIXEL_FIFO_DEPTH
         )
         port map(
@@ -86,7 +91,13 @@ begin
             buffer1_start_in                  => buffer1_start,
             pixel_underflow_count_dma_clk_out => pixel_underflow_count_dma_clk_out,
             start_of_frame_dma_clk_out        => start_of_frame_dma_clk_out,
-            buffer_sel_dma_clk_in             => buffer_sel_dma_clk_in
+            buffer_sel_dma_clk_in             => buffer_sel_dma_clk_in,
+            active_buffer_dma_clk_out         => active_buffer_dma_clk_out,
+            timing_sel_dma_clk_in             => timing_sel,
+            dma_queue_limit_dma_clk_in        => dma_queue_limit,
+            stat_frame_underflows_dma_clk_out => stat_frame_underflows_dma_clk_out,
+            stat_max_outstanding_dma_clk_out  => stat_max_outstanding_dma_clk_out,
+            stat_max_latency_dma_clk_out      => stat_max_latency_dma_clk_out
         );
 
     vunit_axi_slave_inst : entity work.vunit_axi_slave
@@ -129,15 +140,105 @@ begin
                 -- wait for 100 * dma_clk_period;
                 wait until start_of_frame_dma_clk_out = '1';
                 info("started frame 0 output");
+                wait until rising_edge(dma_clk_in);
+                check_equal(active_buffer_dma_clk_out, '0', "buffer 0 latched at VSYNC");
                 wait until start_of_frame_dma_clk_out = '1';
+                wait until rising_edge(dma_clk_in);
+                info("frame 0: max latency " & to_string(slv2uint(stat_max_latency_dma_clk_out)) & " cycles");
+                check_equal(stat_frame_underflows_dma_clk_out, uint2slv(0), "no pixels dropped in frame 0");
+                check_equal(stat_max_outstanding_dma_clk_out, uint2slv(1, 8), "default queue limit of 1 burst");
                 -- info("started frame 1 output");
                 -- wait until start_of_frame_dma_clk_out = '1';
                 wait for 100 * dma_clk_period;
                 test_runner_cleanup(runner);
+
+            elsif run("720p_frame") then
+                -- the DMA latches the new timing at the first VSYNC, and the counters switch at the
+                -- end of it, so frame 0 is 1280x720. On hardware the pixel clock is switched first
+                timing_sel      <= "01";
+                dma_queue_limit <= "00100"; -- 4 bursts in flight to keep up with 297MB/s in the active area
+                pixelclk_period <= 13.468 ns;
+                buffer0_start   <= x"0000_0000"; -- 8KB line stride, 6MB per frame
+                buffer1_start   <= x"0080_0000";
+                for y in 0 to 719 loop
+                    write_integer(mem, address => y * 8192, word => 16#00FF_0000#);            -- first pixel
+                    write_integer(mem, address => y * 8192 + 1279 * 4, word => 16#0000_FF00#); -- last pixel
+                end loop;
+                buffer_sel_dma_clk_in <= '0';
+
+                dma_reset_in      <= '1';
+                pixelclk_reset_in <= '1';
+                wait for 10 * pixelclk_period;
+                wait until rising_edge(dma_clk_in);
+                dma_reset_in <= '0';
+                wait until rising_edge(pixelclk_in);
+                pixelclk_reset_in <= '0';
+                wait until start_of_frame_dma_clk_out = '1';
+                info("started 720p frame 0 output");
+                wait until start_of_frame_dma_clk_out = '1';
+                wait until rising_edge(dma_clk_in);
+                info("frame 0: max latency " & to_string(slv2uint(stat_max_latency_dma_clk_out)) & " cycles");
+                check_equal(stat_frame_underflows_dma_clk_out, uint2slv(0), "no pixels dropped in frame 0");
+                wait for 10 * pixelclk_period; -- let the monitor see the VSYNC
+                check_equal(vga_vsync_out, '1', "720p VSYNC is active high");
+                check_equal(line_pixels, 1280, "active pixels per line");
+                check_equal(frame_lines, 720, "active lines per frame");
+                check_equal(line_clocks, 1650, "pixel clocks per line");
+                check_equal(row_edge_errors, 0, "first and last pixel of every row shown");
+                wait for 100 * dma_clk_period;
+                test_runner_cleanup(runner);
             end if;
         end loop;
     end process main;
 
+    geometry_monitor : process (pixelclk_in)
+    begin
+        if rising_edge(pixelclk_in) then
+            vga_blank_d1 <= vga_blank_out;
+            vga_hsync_d1 <= vga_hsync_out;
+            vga_pixel_d1 <= vga_pixel_out;
+            clock_count  <= clock_count + 1;
+            if vga_blank_out = '0' then
+                pixel_count <= pixel_count + 1;
+            end if;
+            if vga_blank_out = '0' and vga_blank_d1 = '1' and vga_pixel_out /= C_ROW_FIRST then
+                row_edge_errors <= row_edge_errors + 1;
+            end if;
+            if vga_blank_out = '1' and vga_blank_d1 = '0' and vga_pixel_d1 /= C_ROW_LAST then
+                row_edge_errors <= row_edge_errors + 1;
+            end if;
+            if vga_blank_out = '1' and vga_blank_d1 = '0' then -- end of an active line
+                line_pixels <= pixel_count;
+                pixel_count <= 0;
+                line_count  <= line_count + 1;
+            end if;
+            if vga_hsync_out /= vga_hsync_d1 and vga_hsync_out = C_VIDEO_PRESETS(slv2uint(timing_sel)).active_hs then
+                line_clocks <= clock_count;
+                clock_count <= 1;
+            end if;
+            if line_count /= 0 and vga_blank_out = '1' and vga_vsync_out = C_VIDEO_PRESETS(slv2uint(timing_sel)).active_vs then
+                frame_lines <= line_count;
+                line_count  <= 0;
+            end if;
+        end if;
+    end process;
+
+    -- convert with tools/vga_log_to_bmp.py
+    sim_vga_log_inst : entity work.sim_vga_log
+        generic map(
+            G_PROJECT_ROOT => G_PROJECT_ROOT,
+            G_LOG_NAME     => "tools/sim_vga_log_vdma.bin"
+        )
+        port map(
+            pixelclk => pixelclk_in,
+            red      => vga_pixel_out.red,
+            green    => vga_pixel_out.green,
+            blue     => vga_pixel_out.blue,
+            blank    => vga_blank_out,
+            hsync    => vga_hsync_out,
+            vsync    => vga_vsync_out
+        );
+
     pixelclk_process : process
     begin
         pixelclk_in <= '1';
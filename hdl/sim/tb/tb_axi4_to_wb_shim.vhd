@@ -0,0 +1,235 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+use work.wb_pkg.all;
+use work.axi_pkg.all;
+use work.joe_common_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+entity tb_axi4_to_wb_shim is
+    generic (runner_cfg : string);
+end;
+
+architecture bench of tb_axi4_to_wb_shim is
+    constant clk_period : time := 10 ns;
+
+    signal clk   : std_logic := '0';
+    signal reset : std_logic := '1';
+
+    signal axi_mosi : t_axi4_mosi := AXI4_MOSI_ZERO;
+    signal axi_miso : t_axi4_miso;
+
+    -- between the shim and the stall/error injection
+    signal wb_mosi : t_wb_mosi;
+    signal wb_miso : t_wb_miso;
+    -- between the stall/error injection and the BRAM
+    signal mem_mosi : t_wb_mosi;
+    signal mem_miso : t_wb_miso;
+
+    signal random_stall : std_logic := '0';
+    signal stall_enable : boolean   := false;
+    signal force_err    : std_logic := '0';
+    signal rready_throttle : boolean := false;
+    signal wvalid_throttle : boolean := false;
+
+begin
+
+    clk <= not clk after clk_period / 2;
+
+    axi4_to_wb_shim_inst : entity work.axi4_to_wb_shim
+        generic map(
+            G_READ_FIFO_DEPTH => 4 -- small, so RREADY backpressure has to hold off requests
+        )
+        port map(
+            clk          => clk,
+            reset        => reset,
+            axi_mosi_in  => axi_mosi,
+            axi_miso_out => axi_miso,
+            wb_mosi_out  => wb_mosi,
+            wb_miso_in   => wb_miso
+        );
+
+    -- randomly stall the shim, and turn ACKs into ERRs on request
+    stall_proc : process (clk) is
+        variable seed1, seed2 : positive := 7;
+        variable r : real;
+    begin
+        if rising_edge(clk) then
+            uniform(seed1, seed2, r);
+            random_stall <= '1' when stall_enable and r < 0.3 else '0';
+        end if;
+    end process;
+
+    inject_proc : process (all) is
+    begin
+        mem_mosi     <= wb_mosi;
+        mem_mosi.stb <= wb_mosi.stb and not random_stall;
+        wb_miso       <= mem_miso;
+        wb_miso.stall <= mem_miso.stall or random_stall;
+        wb_miso.ack   <= mem_miso.ack and not force_err;
+        wb_miso.err   <= mem_miso.ack and force_err;
+    end process;
+
+    wb_sp_bram_inst : entity work.wb_sp_bram
+        generic map(
+            G_MEM_DEPTH_WORDS => 1024
+        )
+        port map(
+            wb_clk      => clk,
+            wb_reset    => reset,
+            wb_mosi_in  => mem_mosi,
+            wb_miso_out => mem_miso
+        );
+
+    main : process
+        variable seed1, seed2 : positive := 3;
+
+        impure function coin(p : real) return boolean is
+            variable r : real;
+        begin
+            uniform(seed1, seed2, r);
+            return r < p;
+        end function;
+
+        procedure axi_write(addr : std_logic_vector(31 downto 0); data : t_slv32_arr; burst : std_logic_vector(1 downto 0);
+                            resp : out std_logic_vector(1 downto 0); strb : std_logic_vector(3 downto 0) := x"F") is
+        begin
+            axi_mosi.awaddr  <= addr;
+            axi_mosi.awlen   <= uint2slv(data'length - 1, 8);
+            axi_mosi.awsize  <= b"010";
+            axi_mosi.awburst <= burst;
+            axi_mosi.awvalid <= '1';
+            wait until rising_edge(clk) and axi_miso.awready = '1';
+            axi_mosi.awvalid <= '0';
+            for i in data'range loop
+                while wvalid_throttle and coin(0.3) loop
+                    axi_mosi.wvalid <= '0';
+                    wait until rising_edge(clk);
+                end loop;
+                axi_mosi.wdata  <= data(i);
+                axi_mosi.wstrb  <= strb;
+                axi_mosi.wlast  <= '1' when i = data'high else '0';
+                axi_mosi.wvalid <= '1';
+                wait until rising_edge(clk) and axi_miso.wready = '1';
+            end loop;
+            axi_mosi.wvalid <= '0';
+            axi_mosi.bready <= '1';
+            wait until rising_edge(clk) and axi_miso.bvalid = '1';
+            resp := axi_miso.bresp;
+            axi_mosi.bready <= '0';
+        end procedure;
+
+        procedure axi_read(addr : std_logic_vector(31 downto 0); data : out t_slv32_arr; burst : std_logic_vector(1 downto 0);
+                           resp : out std_logic_vector(1 downto 0)) is
+        begin
+            axi_mosi.araddr  <= addr;
+            axi_mosi.arlen   <= uint2slv(data'length - 1, 8);
+            axi_mosi.arsize  <= b"010";
+            axi_mosi.arburst <= burst;
+            axi_mosi.arvalid <= '1';
+            wait until rising_edge(clk) and axi_miso.arready = '1';
+            axi_mosi.arvalid <= '0';
+            resp := b"00";
+            for i in data'range loop
+                while rready_throttle and coin(0.5) loop
+                    axi_mosi.rready <= '0';
+                    wait until rising_edge(clk);
+                end loop;
+                axi_mosi.rready <= '1';
+                wait until rising_edge(clk) and axi_miso.rvalid = '1';
+                data(i) := axi_miso.rdata;
+                if axi_miso.rresp /= b"00" then
+                    resp := axi_miso.rresp;
+                end if;
+                check_equal(axi_miso.rlast, i = data'high, "RLAST on beat " & to_string(i));
+            end loop;
+            axi_mosi.rready <= '0';
+        end procedure;
+
+        procedure write_read_back(addr : natural; len : positive) is
+            variable wdata : t_slv32_arr(0 to len - 1);
+            variable rdata : t_slv32_arr(0 to len - 1);
+            variable resp  : std_logic_vector(1 downto 0);
+        begin
+            for i in wdata'range loop
+                wdata(i) := std_logic_vector(to_unsigned(addr + 4 * i, 16)) & std_logic_vector(to_unsigned(len * 7 + i, 16));
+            end loop;
+            axi_write(uint2slv(addr), wdata, AXI_BURST_INCR, resp);
+            check_equal(resp, std_logic_vector'(b"00"), "BRESP");
+            axi_read(uint2slv(addr), rdata, AXI_BURST_INCR, resp);
+            check_equal(resp, std_logic_vector'(b"00"), "RRESP");
+            for i in rdata'range loop
+                check_equal(rdata(i), wdata(i), "beat " & to_string(i));
+            end loop;
+        end procedure;
+
+        variable data1 : t_slv32_arr(0 to 0);
+        variable data4 : t_slv32_arr(0 to 3);
+        variable resp  : std_logic_vector(1 downto 0);
+        variable start : time;
+    begin
+        test_runner_setup(runner, runner_cfg);
+        show(get_logger(default_checker), display_handler, pass);
+
+        wait for 5 * clk_period;
+        reset <= '0';
+        wait until rising_edge(clk);
+
+        while test_suite loop
+            if run("single") then
+                write_read_back(16#40#, 1);
+
+            elsif run("burst_256") then
+                start := now;
+                write_read_back(0, 256);
+                -- 256 writes and 256 reads, each at close to one word per clock
+                info("256 word write + read back took " & to_string((now - start) / clk_period) & " clocks");
+                check((now - start) / clk_period < 2 * 256 + 64, "bursts should run at about one word per clock");
+
+            elsif run("burst_backpressure") then
+                stall_enable    <= true;
+                rready_throttle <= true;
+                wvalid_throttle <= true;
+                write_read_back(16#100#, 256);
+                write_read_back(16#804#, 17);
+                write_read_back(16#C00#, 1);
+
+            elsif run("fixed_burst") then
+                -- FIXED bursts keep hitting the same address, the last write wins
+                data4 := (x"1111_1111", x"2222_2222", x"3333_3333", x"4444_4444");
+                axi_write(x"0000_0020", data4, AXI_BURST_FIXED, resp);
+                axi_read(x"0000_0020", data1, AXI_BURST_INCR, resp);
+                check_equal(data1(0), std_logic_vector'(x"4444_4444"));
+                axi_read(x"0000_0020", data4, AXI_BURST_FIXED, resp);
+                for i in data4'range loop
+                    check_equal(data4(i), std_logic_vector'(x"4444_4444"));
+                end loop;
+
+            elsif run("byte_strobes") then
+                data1(0) := x"AABB_CCDD";
+                axi_write(x"0000_0030", data1, AXI_BURST_INCR, resp);
+                data1(0) := x"1122_3344";
+                axi_write(x"0000_0030", data1, AXI_BURST_INCR, resp, strb => b"0101");
+                axi_read(x"0000_0030", data1, AXI_BURST_INCR, resp);
+                check_equal(data1(0), std_logic_vector'(x"AA22_CC44"));
+
+            elsif run("slverr") then
+                force_err <= '1';
+                axi_write(x"0000_0000", data4, AXI_BURST_INCR, resp);
+                check_equal(resp, std_logic_vector'(b"10"), "BRESP");
+                axi_read(x"0000_0000", data4, AXI_BURST_INCR, resp);
+                check_equal(resp, std_logic_vector'(b"10"), "RRESP");
+                force_err <= '0';
+                write_read_back(0, 4); -- and it recovers
+            end if;
+        end loop;
+        test_runner_cleanup(runner);
+    end process main;
+
+    test_runner_watchdog(runner, 200 us);
+
+end;
@@ -32,6 +32,9 @@ architecture bench of tb_basys3_soc is
     signal sseg_an_out  : std_logic_vector(3 downto 0);
     signal uart_tx      : std_logic;
 
+    -- log every retired instruction, profile with tools/cpu_trace_profile.py
+    constant CPU_TRACE : boolean := true;
+
 
 begin
     -- DUT
@@ -85,6 +88,22 @@ begin
 
         );
 
+    gen_cpu_trace : if CPU_TRACE generate
+        sim_cpu_trace_inst : entity work.sim_cpu_trace
+            generic map(
+                G_PROJECT_ROOT => G_PROJECT_ROOT,
+                G_LOG_NAME     => "tools/sim_cpu_trace.bin"
+            )
+            port map(
+                clk               => clk,
+                trace_valid_in    => <<signal .tb_basys3_soc.simple_soc_inst.cpu_top_inst.trace_valid_out : std_logic>>,
+                trace_pc_in       => <<signal .tb_basys3_soc.simple_soc_inst.cpu_top_inst.trace_pc_out : std_logic_vector(31 downto 0)>>,
+                trace_instr_in    => <<signal .tb_basys3_soc.simple_soc_inst.cpu_top_inst.trace_instr_out : std_logic_vector(31 downto 0)>>,
+                trace_mem_addr_in => <<signal .tb_basys3_soc.simple_soc_inst.cpu_top_inst.trace_mem_addr_out : std_logic_vector(31 downto 0)>>,
+                trace_cycle_in    => <<signal .tb_basys3_soc.simple_soc_inst.cpu_top_inst.trace_cycle_out : std_logic_vector(63 downto 0)>>
+            );
+    end generate;
+
     main : process
     begin
         test_runner_setup(runner, runner_cfg);
@@ -28,10 +28,17 @@ architecture bench of tb_boot is
     signal sseg_an_out  : std_logic_vector(3 downto 0);
     signal uart_tx      : std_logic;
 
+    -- log every retired instruction, profile with tools/cpu_trace_profile.py
+    constant CPU_TRACE : boolean := true;
+
     signal text_display_wb_mosi        : t_wb_mosi;
     signal text_display_wb_miso        : t_wb_miso;
     signal zynq_ps_peripherals_wb_mosi : t_wb_mosi;
     signal zynq_ps_peripherals_wb_miso : t_wb_miso;
+    signal vdma_ctrl_wb_mosi : t_wb_mosi;
+    signal vdma_ctrl_wb_miso : t_wb_miso;
+    signal blitter_wb_mosi : t_wb_mosi;
+    signal blitter_wb_miso : t_wb_miso;
     signal ext_mem_wb_mosi : t_wb_mosi;
     signal ext_mem_wb_miso : t_wb_miso;
 
@@ -55,12 +62,31 @@ begin
             i2c_sda_out                     => open,
             text_display_wb_mosi_out        => text_display_wb_mosi,
             text_display_wb_miso_in         => text_display_wb_miso,
+            vdma_ctrl_wb_mosi_out           => vdma_ctrl_wb_mosi,
+            vdma_ctrl_wb_miso_in            => vdma_ctrl_wb_miso,
+            blitter_wb_mosi_out             => blitter_wb_mosi,
+            blitter_wb_miso_in              => blitter_wb_miso,
             zynq_ps_peripherals_wb_mosi_out => zynq_ps_peripherals_wb_mosi,
             zynq_ps_peripherals_wb_miso_in  => zynq_ps_peripherals_wb_miso,
             ext_mem_wb_mosi_out => ext_mem_wb_mosi,
             ext_mem_wb_miso_in  => ext_mem_wb_miso
         );
 
+    gen_cpu_trace : if CPU_TRACE generate
+        sim_cpu_trace_inst : entity work.sim_cpu_trace
+            generic map(
+                G_LOG_NAME => "sim_cpu_trace_boot.bin"
+            )
+            port map(
+                clk               => clk,
+                trace_valid_in    => <<signal .tb_boot.simple_soc_inst.cpu_top_inst.trace_valid_out : std_logic>>,
+                trace_pc_in       => <<signal .tb_boot.simple_soc_inst.cpu_top_inst.trace_pc_out : std_logic_vector(31 downto 0)>>,
+                trace_instr_in    => <<signal .tb_boot.simple_soc_inst.cpu_top_inst.trace_instr_out : std_logic_vector(31 downto 0)>>,
+                trace_mem_addr_in => <<signal .tb_boot.simple_soc_inst.cpu_top_inst.trace_mem_addr_out : std_logic_vector(31 downto 0)>>,
+                trace_cycle_in    => <<signal .tb_boot.simple_soc_inst.cpu_top_inst.trace_cycle_out : std_logic_vector(63 downto 0)>>
+            );
+    end generate;
+
     main : process
     begin
         test_runner_setup(runner, runner_cfg);
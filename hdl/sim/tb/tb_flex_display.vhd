@@ -91,7 +91,7 @@ begin
     sim_vga_log_inst : entity work.sim_vga_log
         generic map(
             G_PROJECT_ROOT => G_PROJECT_ROOT,
-            G_LOG_NAME     => "tools/sim_vga_log.txt"
+            G_LOG_NAME     => "tools/sim_vga_log.bin"
         )
         port map(
             pixelclk => pixelclk,
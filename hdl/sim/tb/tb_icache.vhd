@@ -1,6 +1,7 @@
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
+use std.textio.all;
 
 use work.wb_pkg.all;
 use work.joe_common_pkg.all;
@@ -9,14 +10,21 @@ library vunit_lib;
 context vunit_lib.vunit_context;
 
 entity tb_icache is
-    generic (runner_cfg : string);
+    generic (
+        runner_cfg : string;
+        G_NUM_BLOCKS : integer := 16;
+        G_BLOCK_SIZE : integer := 32; -- bytes
+        G_SET_SIZE : integer := 2; -- 1=direct mapped 2+ = set associativity
+        G_RV32C_OPT : boolean := true;
+        -- counters expected after replaying the trace (from tools/icache_explorer.py), -1 to not check
+        G_EXPECT_HITS : integer := -1;
+        G_EXPECT_OFLOWS : integer := -1;
+        G_EXPECT_MISSES : integer := -1
+    );
 end entity tb_icache;
 
 architecture RTL of tb_icache is
-	constant G_NUM_BLOCKS : integer := 16;
-	constant G_BLOCK_SIZE : integer := 32; -- bytes
-	constant G_SET_SIZE : integer := 2; -- 1=direct mapped 2+ = set associativity
-	constant G_RV32C_OPT : boolean := true;
+    constant TRACE_FILE : string := tb_path(runner_cfg) & "../data/icache_trace.txt";
     signal clk : std_logic := '0';
 	signal rst : std_logic := '1';
 	signal in_addr : std_logic_vector(31 downto 0);
@@ -27,6 +35,10 @@ architecture RTL of tb_icache is
 	signal wb_mosi : t_wb_mosi;
 	signal wb_miso : t_wb_miso;
 	signal out_addr_ready : std_logic;
+
+	signal hit_count : unsigned(63 downto 0);
+	signal oflow_count : unsigned(63 downto 0);
+	signal miss_count : unsigned(63 downto 0);
 	
     
 begin
@@ -35,6 +47,10 @@ begin
     rst <= '0' after 100 ns;
 
     stim_proc : process is
+        file trace : text;
+        variable l : line;
+        variable v_trace_addr : std_logic_vector(31 downto 0);
+
         procedure read_instr(addr : integer) is            
             variable v_addr : std_logic_vector(31 downto 0) := uint2slv(addr);
             variable v_addr_next : std_logic_vector(31 downto 0) := uint2slv(addr+2); -- byte addressed, 16-bit aligned
@@ -76,58 +92,86 @@ begin
         info("G_SET_SIZE   = " & to_string(G_SET_SIZE));
         
         
-        wait for 150 ns;
-        msg("=== Test basic 32-bit aligned cache misses, hits and block replacement ===");
-        read_instr(0);
-        read_instr(4);
-        read_instr(8);
-        read_instr(12);
-        read_instr(40);
-        read_instr(1024);
-        read_instr(2060);
-
-        msg("=== Test 16-bit aligned ===");
-        read_instr(2062);
-        read_instr(28);
-        read_instr(30);
-        read_instr(32);
-
-        msg("=== Test 16-bit aligned with both halves misses ===");
-        read_instr(1024+32+30);
-
-        msg("=== Test cache invalidate ===");
-        for i in 0 to 100 loop
-            read_instr(2*i);
-        end loop;
-        msg("INVALIDATE");
-        in_invalidate <= (others => '1');
-        wait until rising_edge(clk);
-        in_invalidate <= (others => '0');
-        for i in 0 to 100 loop
-            read_instr(2*i);
-        end loop;
-
-        msg("=== Test cache disable by holding INVALIDATE high ===");
-        in_invalidate <= (others => '1');
-        for i in 0 to 100 loop
-            read_instr(2*i);
-        end loop;
-        in_invalidate <= (others => '0');
+        while test_suite loop
+            if run("basic") then
+                wait for 150 ns;
+                msg("=== Test basic 32-bit aligned cache misses, hits and block replacement ===");
+                read_instr(0);
+                read_instr(4);
+                read_instr(8);
+                read_instr(12);
+                read_instr(40);
+                read_instr(1024);
+                read_instr(2060);
+
+                msg("=== Test 16-bit aligned ===");
+                read_instr(2062);
+                read_instr(28);
+                read_instr(30);
+                read_instr(32);
+
+                msg("=== Test 16-bit aligned with both halves misses ===");
+                read_instr(1024+32+30);
+
+                msg("=== Test cache invalidate ===");
+                for i in 0 to 100 loop
+                    read_instr(2*i);
+                end loop;
+                msg("INVALIDATE");
+                in_invalidate <= (others => '1');
+                wait until rising_edge(clk);
+                in_invalidate <= (others => '0');
+                for i in 0 to 100 loop
+                    read_instr(2*i);
+                end loop;
+
+                msg("=== Test cache disable by holding INVALIDATE high ===");
+                in_invalidate <= (others => '1');
+                for i in 0 to 100 loop
+                    read_instr(2*i);
+                end loop;
+                in_invalidate <= (others => '0');
         
-        msg("=== Test back-to-back requests with backpressure ====");
-        wait until rising_edge(clk);
-        in_addr_valid <= '1';
-        in_addr <= x"0000_0000";
-        wait until rising_edge(clk) and out_addr_ready = '1';
-        in_addr <= x"0000_0002";
-        wait until rising_edge(clk) and out_addr_ready = '1';
-        in_addr <= x"0000_0004";
-        wait until rising_edge(clk) and out_addr_ready = '1';
-        in_addr <= x"0000_0006";
-        wait until rising_edge(clk) and out_addr_ready = '1';
-        in_addr <= x"0000_0008";
-        wait until rising_edge(clk) and out_addr_ready = '1';
-        in_addr_valid <= '0';
+                msg("=== Test back-to-back requests with backpressure ====");
+                wait until rising_edge(clk);
+                in_addr_valid <= '1';
+                in_addr <= x"0000_0000";
+                wait until rising_edge(clk) and out_addr_ready = '1';
+                in_addr <= x"0000_0002";
+                wait until rising_edge(clk) and out_addr_ready = '1';
+                in_addr <= x"0000_0004";
+                wait until rising_edge(clk) and out_addr_ready = '1';
+                in_addr <= x"0000_0006";
+                wait until rising_edge(clk) and out_addr_ready = '1';
+                in_addr <= x"0000_0008";
+                wait until rising_edge(clk) and out_addr_ready = '1';
+                in_addr_valid <= '0';
+            elsif run("trace_replay") then
+                -- replay a fetch trace and check the hit/miss counters against the model
+                in_invalidate <= (others => '0');
+                wait for 150 ns;
+                file_open(trace, TRACE_FILE, read_mode);
+                while not endfile(trace) loop
+                    readline(trace, l);
+                    hread(l, v_trace_addr);
+                    read_instr(slv2uint(v_trace_addr));
+                end loop;
+                file_close(trace);
+                wait until rising_edge(clk);
+                info("hit_count   = " & to_string(to_integer(hit_count)));
+                info("oflow_count = " & to_string(to_integer(oflow_count)));
+                info("miss_count  = " & to_string(to_integer(miss_count)));
+                if G_EXPECT_HITS >= 0 then
+                    check_equal(to_integer(hit_count), G_EXPECT_HITS, "hit_count");
+                end if;
+                if G_EXPECT_OFLOWS >= 0 then
+                    check_equal(to_integer(oflow_count), G_EXPECT_OFLOWS, "oflow_count");
+                end if;
+                if G_EXPECT_MISSES >= 0 then
+                    check_equal(to_integer(miss_count), G_EXPECT_MISSES, "miss_count");
+                end if;
+            end if;
+        end loop;
         msg("All tests done");
         wait for 100 ns;
         test_runner_cleanup(runner);
@@ -157,6 +201,11 @@ dut_icache : entity work.icache
     );
 
 
+-- the DUT's performance counters, for the trace_replay test
+hit_count   <= <<signal .tb_icache.dut_icache.hit_count : unsigned(63 downto 0)>>;
+oflow_count <= <<signal .tb_icache.dut_icache.oflow_count : unsigned(63 downto 0)>>;
+miss_count  <= <<signal .tb_icache.dut_icache.miss_count : unsigned(63 downto 0)>>;
+
 ro_mem_inst : entity work.sim_wb_ro_mem
     port map(
         clk     => clk,
@@ -0,0 +1,196 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+use work.sim_wb_procedures_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+entity tb_wb_crc is
+    generic (
+        runner_cfg : string
+    );
+end;
+
+architecture bench of tb_wb_crc is
+    -- Clock period
+    constant clk_period : time := 10 ns;
+
+    -- Ports
+    signal clk            : std_logic;
+    signal reset          : std_logic := '1';
+    signal wb_mosi        : t_wb_mosi := C_WB_MOSI_INIT;
+    signal wb_miso        : t_wb_miso;
+    signal snoop_tx_byte  : std_logic_vector(7 downto 0) := x"00";
+    signal snoop_rx_byte  : std_logic_vector(7 downto 0) := x"00";
+    signal snoop_valid    : std_logic := '0';
+
+    -- register offsets
+    constant REG_DATA    : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant REG_CTRL    : std_logic_vector(31 downto 0) := x"0000_0004";
+    constant REG_POLY    : std_logic_vector(31 downto 0) := x"0000_0008";
+    constant REG_INIT    : std_logic_vector(31 downto 0) := x"0000_000C";
+    constant REG_XOR_OUT : std_logic_vector(31 downto 0) := x"0000_0010";
+    constant REG_RESULT  : std_logic_vector(31 downto 0) := x"0000_0014";
+    constant REG_COUNT   : std_logic_vector(31 downto 0) := x"0000_0018";
+
+    constant CTRL_REFLECT_IN  : std_logic_vector(31 downto 0) := x"0000_0100";
+    constant CTRL_REFLECT_OUT : std_logic_vector(31 downto 0) := x"0000_0200";
+    constant CTRL_SNOOP_RX    : std_logic_vector(31 downto 0) := x"0000_1000";
+    constant CTRL_SNOOP_TX    : std_logic_vector(31 downto 0) := x"0000_2000";
+
+    -- the standard CRC check string
+    constant CHECK_STR : string := "123456789";
+
+begin
+
+    wb_crc_inst : entity work.wb_crc
+        port map(
+            wb_clk           => clk,
+            wb_reset         => reset,
+            wb_mosi_in       => wb_mosi,
+            wb_miso_out      => wb_miso,
+            snoop_tx_byte_in => snoop_tx_byte,
+            snoop_rx_byte_in => snoop_rx_byte,
+            snoop_valid_in   => snoop_valid
+        );
+
+    main : process
+        procedure reg_write (reg, data : std_logic_vector(31 downto 0); sel : std_logic_vector(3 downto 0) := x"F") is
+        begin
+            sim_wb_write(clk, wb_mosi, wb_miso, reg, data, sel);
+        end procedure;
+
+        procedure reg_check (reg, exp : std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_check(clk, wb_mosi, wb_miso, reg, exp);
+        end procedure;
+
+        procedure setup (width : integer; poly, init, xor_out, ctrl : std_logic_vector(31 downto 0)) is
+        begin
+            reg_write(REG_CTRL, ctrl or uint2slv(width));
+            reg_write(REG_POLY, poly);
+            reg_write(REG_XOR_OUT, xor_out);
+            reg_write(REG_INIT, init); -- restarts with the new width
+        end procedure;
+
+        -- one byte per write, in the lane a byte store to that address would use
+        procedure write_bytes (s : string) is
+            variable b : std_logic_vector(7 downto 0);
+        begin
+            for i in s'range loop
+                b := uint2slv(character'pos(s(i)), 8);
+                reg_write(REG_DATA, b & b & b & b, uint2slv(2 ** ((i - 1) mod 4), 4));
+            end loop;
+        end procedure;
+
+        -- packed little endian, as the CPU would load them from a buffer
+        procedure write_words (s : string) is
+            variable w   : std_logic_vector(31 downto 0);
+            variable sel : std_logic_vector(3 downto 0);
+            variable j   : integer;
+        begin
+            j := s'low;
+            while j <= s'high loop
+                w   := (others => '0');
+                sel := (others => '0');
+                for k in 0 to 3 loop
+                    if j + k <= s'high then
+                        w(8 * k + 7 downto 8 * k) := uint2slv(character'pos(s(j + k)), 8);
+                        sel(k)                    := '1';
+                    end if;
+                end loop;
+                reg_write(REG_DATA, w, sel);
+                j := j + 4;
+            end loop;
+        end procedure;
+
+        procedure snoop (b : std_logic_vector(7 downto 0); rx : boolean) is
+        begin
+            wait until rising_edge(clk);
+            if rx then
+                snoop_rx_byte <= b;
+                snoop_tx_byte <= x"FF";
+            else
+                snoop_tx_byte <= b;
+                snoop_rx_byte <= x"FF";
+            end if;
+            snoop_valid <= '1';
+            wait until rising_edge(clk);
+            snoop_valid <= '0';
+            for i in 1 to 15 loop -- at most one byte every 16 clocks from the SPI controller
+                wait until rising_edge(clk);
+            end loop;
+        end procedure;
+
+    begin
+        test_runner_setup(runner, runner_cfg);
+
+        wait for 10 * clk_period;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait for 5 * clk_period;
+
+        while test_suite loop
+            if run("crc7") then
+                -- SD card command CRC
+                setup(7, x"0000_0009", x"0000_0000", x"0000_0000", x"0000_0000");
+                write_bytes(CHECK_STR);
+                reg_check(REG_RESULT, x"0000_0075");
+                reg_check(REG_COUNT, uint2slv(9));
+
+            elsif run("crc16_xmodem") then
+                -- SD card data CRC
+                setup(16, x"0000_1021", x"0000_0000", x"0000_0000", x"0000_0000");
+                write_words(CHECK_STR);
+                reg_check(REG_RESULT, x"0000_31C3");
+                reg_check(REG_DATA, x"0000_31C3");
+
+            elsif run("crc32") then
+                setup(32, x"04C1_1DB7", x"FFFF_FFFF", x"FFFF_FFFF", CTRL_REFLECT_IN or CTRL_REFLECT_OUT);
+                write_words(CHECK_STR);
+                reg_check(REG_RESULT, x"CBF4_3926");
+                -- restart and do it again a byte at a time
+                reg_write(REG_RESULT, x"0000_0000");
+                reg_check(REG_COUNT, uint2slv(0));
+                write_bytes(CHECK_STR);
+                reg_check(REG_RESULT, x"CBF4_3926");
+
+            elsif run("snoop") then
+                setup(16, x"0000_1021", x"0000_0000", x"0000_0000", CTRL_SNOOP_RX);
+                for i in CHECK_STR'range loop
+                    snoop(uint2slv(character'pos(CHECK_STR(i)), 8), true);
+                end loop;
+                reg_check(REG_RESULT, x"0000_31C3");
+                -- feeding the received CRC through leaves a zero residue
+                snoop(x"31", true);
+                snoop(x"C3", true);
+                reg_check(REG_RESULT, x"0000_0000");
+                reg_check(REG_COUNT, uint2slv(11));
+
+                -- TX side, eg. CMD0 with its CRC7 of 0x4A
+                setup(7, x"0000_0009", x"0000_0000", x"0000_0000", CTRL_SNOOP_TX);
+                snoop(x"40", false);
+                for i in 1 to 4 loop
+                    snoop(x"00", false);
+                end loop;
+                reg_check(REG_RESULT, x"0000_004A");
+            end if;
+        end loop;
+        test_runner_cleanup(runner);
+    end process main;
+
+    test_runner_watchdog(runner, 1 ms);
+
+    clk_process : process
+    begin
+        clk <= '1';
+        wait for clk_period/2;
+        clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
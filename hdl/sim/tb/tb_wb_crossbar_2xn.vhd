@@ -0,0 +1,242 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.joe_common_pkg.all;
+use work.wb_pkg.all;
+use work.sim_wb_procedures_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+entity tb_wb_crossbar_2xn is
+    generic (runner_cfg : string);
+end;
+
+architecture bench of tb_wb_crossbar_2xn is
+
+    -- Clock period
+    constant clk_period : time := 10 ns;
+    -- Generics
+    constant G_NUM_SLAVES : integer := 3;
+
+    -- Slave 0: dual-port BRAM, slaves 1 and 2: single port BRAMs, 3+ unmapped
+    constant C_DUAL_PORT_SLAVES : std_logic_vector(15 downto 0) := x"0001";
+    -- gen_wb_ic style map, slave 2 only decodes 4KB at 0x2000_0000
+    constant C_ADR_MASK  : t_slv32_arr(0 to G_NUM_SLAVES - 1) := (x"F000_0000", x"F000_0000", x"FFFF_F000");
+    constant C_ADR_MATCH : t_slv32_arr(0 to G_NUM_SLAVES - 1) := (x"0000_0000", x"1000_0000", x"2000_0000");
+
+    -- Ports
+    signal wb_clk                : std_logic;
+    signal wb_reset              : std_logic := '1';
+    signal wb_master_mosi_arr    : t_wb_mosi_arr(1 downto 0) := (others => C_WB_MOSI_INIT);
+    signal wb_master_miso_arr    : t_wb_miso_arr(1 downto 0);
+    signal wb_slave_mosi_arr     : t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
+    signal wb_slave_miso_arr     : t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0) := (others => C_WB_MISO_INIT);
+    signal wb_slave_b_mosi_arr   : t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
+    signal wb_slave_b_miso_arr   : t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0) := (others => C_WB_MISO_INIT);
+
+    -- master 1 is driven from its own process so it can run concurrently with master 0
+    signal m1_start : std_logic := '0';
+    signal m1_done  : std_logic := '0';
+    signal m1_slave : integer   := 0;
+
+    function calc_addr(slv, reg : integer) return std_logic_vector is
+    begin
+        return uint2slv(slv * 16#1000_0000# + reg * 4);
+    end function;
+
+begin
+
+    wb_crossbar_2xn_inst : entity work.wb_crossbar_2xn
+        generic map(
+            G_NUM_SLAVES       => G_NUM_SLAVES,
+            G_DUAL_PORT_SLAVES => C_DUAL_PORT_SLAVES,
+            G_ARBITER          => "priority",
+            G_ADR_MASK         => C_ADR_MASK,
+            G_ADR_MATCH        => C_ADR_MATCH
+        )
+        port map(
+            wb_clk                  => wb_clk,
+            wb_reset                => wb_reset,
+            wb_master_mosi_arr_in   => wb_master_mosi_arr,
+            wb_master_miso_arr_out  => wb_master_miso_arr,
+            wb_slave_mosi_arr_out   => wb_slave_mosi_arr,
+            wb_slave_miso_arr_in    => wb_slave_miso_arr,
+            wb_slave_b_mosi_arr_out => wb_slave_b_mosi_arr,
+            wb_slave_b_miso_arr_in  => wb_slave_b_miso_arr
+        );
+
+    wb_dp_bram_inst : entity work.wb_dp_bram
+        generic map(
+            G_MEM_DEPTH_WORDS => 64,
+            G_INIT_FILE       => ""
+        )
+        port map(
+            wb_clk        => wb_clk,
+            wb_reset      => wb_reset,
+            wb_a_mosi_in  => wb_slave_mosi_arr(0),
+            wb_a_miso_out => wb_slave_miso_arr(0),
+            wb_b_mosi_in  => wb_slave_b_mosi_arr(0),
+            wb_b_miso_out => wb_slave_b_miso_arr(0)
+        );
+
+    gen_sp_slaves : for i in 1 to G_NUM_SLAVES - 1 generate
+        u_slave : entity work.wb_sp_bram
+            generic map(
+                G_MEM_DEPTH_WORDS => 64,
+                G_INIT_FILE       => ""
+            )
+            port map(
+                wb_clk      => wb_clk,
+                wb_reset    => wb_reset,
+                wb_mosi_in  => wb_slave_mosi_arr(i),
+                wb_miso_out => wb_slave_miso_arr(i)
+            );
+    end generate;
+
+    --! Master 1: writes then reads back words 32..47 of slave m1_slave
+    m1_proc : process
+    begin
+        wait until m1_start = '1';
+        for i in 32 to 47 loop
+            sim_wb_write(wb_clk, wb_master_mosi_arr(1), wb_master_miso_arr(1), calc_addr(m1_slave, i), uint2slv(16#1100# + i));
+        end loop;
+        for i in 32 to 47 loop
+            sim_wb_check(wb_clk, wb_master_mosi_arr(1), wb_master_miso_arr(1), calc_addr(m1_slave, i), uint2slv(16#1100# + i));
+        end loop;
+        m1_done <= '1';
+        wait until m1_start = '0';
+        m1_done <= '0';
+    end process;
+
+    main : process
+        variable start_time : time;
+        variable m0_time    : time;
+        variable m1_time    : time;
+
+        procedure m0_sequence (slv : integer) is
+        begin
+            for i in 0 to 15 loop
+                sim_wb_write(wb_clk, wb_master_mosi_arr(0), wb_master_miso_arr(0), calc_addr(slv, i), uint2slv(16#0100# + i));
+            end loop;
+            for i in 0 to 15 loop
+                sim_wb_check(wb_clk, wb_master_mosi_arr(0), wb_master_miso_arr(0), calc_addr(slv, i), uint2slv(16#0100# + i));
+            end loop;
+        end procedure;
+
+        procedure run_both (m0_slv, m1_slv : integer) is
+        begin
+            m1_slave <= m1_slv;
+            wait until rising_edge(wb_clk);
+            start_time := now;
+            m1_start   <= '1';
+            m0_sequence(m0_slv);
+            m0_time := now - start_time;
+            if m1_done = '0' then
+                wait until m1_done = '1';
+            end if;
+            m1_time  := now - start_time;
+            m1_start <= '0';
+            info("Master 0: " & to_string(m0_time / clk_period) & " cycles, Master 1: " & to_string(m1_time / clk_period) & " cycles");
+        end procedure;
+
+        variable solo_time : time;
+
+        -- single read by master 0, returns whether it got ERR
+        procedure m0_read_err (adr : std_logic_vector(31 downto 0); err : out std_logic) is
+        begin
+            wb_master_mosi_arr(0).cyc <= '1';
+            wb_master_mosi_arr(0).stb <= '1';
+            wb_master_mosi_arr(0).adr <= adr;
+            wait until rising_edge(wb_clk) and wb_master_miso_arr(0).stall = '0';
+            wb_master_mosi_arr(0).stb <= '0';
+            wait until rising_edge(wb_clk) and (wb_master_miso_arr(0).err = '1' or wb_master_miso_arr(0).ack = '1');
+            err := wb_master_miso_arr(0).err;
+            wb_master_mosi_arr(0) <= C_WB_MOSI_INIT;
+            wait until rising_edge(wb_clk);
+        end procedure;
+
+        variable err : std_logic;
+    begin
+        test_runner_setup(runner, runner_cfg);
+        wait for 5 * clk_period;
+        wait until rising_edge(wb_clk);
+        wb_reset <= '0';
+        wait for 5 * clk_period;
+
+        while test_suite loop
+            if run("different_slaves_in_parallel") then
+                -- baseline, master 0 on its own
+                wait until rising_edge(wb_clk);
+                start_time := now;
+                m0_sequence(1);
+                solo_time := now - start_time;
+
+                run_both(1, 2);
+                check(m0_time <= solo_time + clk_period, "Master 0 not slowed down by master 1 on a different slave");
+                check(m1_time <= solo_time + 2 * clk_period, "Master 1 not slowed down by master 0 on a different slave");
+                test_runner_cleanup(runner);
+
+            elsif run("shared_slave_contention") then
+                run_both(1, 1);
+                -- both masters' data checked by the sequences, make sure nothing was overwritten
+                for i in 0 to 15 loop
+                    sim_wb_check(wb_clk, wb_master_mosi_arr(0), wb_master_miso_arr(0), calc_addr(1, i), uint2slv(16#0100# + i));
+                    sim_wb_check(wb_clk, wb_master_mosi_arr(0), wb_master_miso_arr(0), calc_addr(1, 32 + i), uint2slv(16#1100# + 32 + i));
+                end loop;
+                test_runner_cleanup(runner);
+
+            elsif run("dual_port_slave") then
+                wait until rising_edge(wb_clk);
+                start_time := now;
+                m0_sequence(0);
+                solo_time := now - start_time;
+
+                run_both(0, 0);
+                check(m0_time <= solo_time + clk_period, "Master 0 not slowed down by master 1 on the dual-port slave");
+                check(m1_time <= solo_time + 2 * clk_period, "Master 1 not slowed down by master 0 on the dual-port slave");
+                -- data written through port B visible on port A
+                sim_wb_check(wb_clk, wb_master_mosi_arr(0), wb_master_miso_arr(0), calc_addr(0, 40), uint2slv(16#1100# + 40));
+                test_runner_cleanup(runner);
+
+            elsif run("unmapped_slave") then
+                wb_master_mosi_arr(0).cyc <= '1';
+                wb_master_mosi_arr(0).stb <= '1';
+                wb_master_mosi_arr(0).adr <= calc_addr(5, 0);
+                wait until rising_edge(wb_clk) and wb_master_miso_arr(0).stall = '0';
+                wb_master_mosi_arr(0).stb <= '0';
+                wait until rising_edge(wb_clk) and (wb_master_miso_arr(0).err = '1' or wb_master_miso_arr(0).ack = '1');
+                check_equal(wb_master_miso_arr(0).err, '1', "Unmapped access returns ERR");
+                wb_master_mosi_arr(0) <= C_WB_MOSI_INIT;
+                -- and the crossbar still works afterwards
+                wait until rising_edge(wb_clk);
+                m0_sequence(2);
+                test_runner_cleanup(runner);
+
+            elsif run("address_map") then
+                -- slave 2 only decodes its 4KB, the rest of its adr[31:28] slot is unmapped
+                m0_read_err(x"2000_0FFC", err);
+                check_equal(err, '0', "inside the 4KB region");
+                m0_read_err(x"2000_1000", err);
+                check_equal(err, '1', "past the 4KB region");
+                m0_read_err(x"2800_0000", err);
+                check_equal(err, '1', "elsewhere in the slot");
+                m0_read_err(x"1FFF_FFFC", err);
+                check_equal(err, '0', "slave 1 keeps its 256MB");
+                test_runner_cleanup(runner);
+            end if;
+        end loop;
+    end process main;
+
+    test_runner_watchdog(runner, 50 us);
+
+    clk_process : process
+    begin
+        wb_clk <= '1';
+        wait for clk_period/2;
+        wb_clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
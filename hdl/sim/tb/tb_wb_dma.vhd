@@ -0,0 +1,268 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+use work.sim_wb_procedures_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+entity tb_wb_dma is
+    generic (
+        runner_cfg : string
+    );
+end;
+
+architecture bench of tb_wb_dma is
+    -- Clock period
+    constant clk_period : time := 10 ns;
+
+    constant MEM_WORDS  : integer := 1024;
+    constant NUM_SLAVES : integer := 2; -- 0x2000_0000 and up are unmapped
+
+    constant RAM_A : integer := 16#0000_0000#;
+    constant RAM_B : integer := 16#1000_0000#;
+
+    -- Ports
+    signal clk      : std_logic;
+    signal reset    : std_logic := '1';
+    signal reg_mosi : t_wb_mosi := C_WB_MOSI_INIT;
+    signal reg_miso : t_wb_miso;
+    signal dma_mosi : t_wb_mosi;
+    signal dma_miso : t_wb_miso;
+    signal busy     : std_logic;
+    signal irq      : std_logic;
+
+    -- testbench access to the memories, shares the bus with the DMA
+    signal tb_mosi  : t_wb_mosi := C_WB_MOSI_INIT;
+    signal tb_miso  : t_wb_miso;
+    signal sel_mosi : t_wb_mosi;
+    signal sel_miso : t_wb_miso;
+
+    signal slave_mosi_arr : t_wb_mosi_arr(NUM_SLAVES - 1 downto 0);
+    signal slave_miso_arr : t_wb_miso_arr(NUM_SLAVES - 1 downto 0);
+
+    -- register offsets
+    constant REG_SRC        : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant REG_DST        : std_logic_vector(31 downto 0) := x"0000_0004";
+    constant REG_LEN        : std_logic_vector(31 downto 0) := x"0000_0008";
+    constant REG_ROWS       : std_logic_vector(31 downto 0) := x"0000_000C";
+    constant REG_STRIDE     : std_logic_vector(31 downto 0) := x"0000_0010";
+    constant REG_FILL       : std_logic_vector(31 downto 0) := x"0000_0014";
+    constant REG_NEXT       : std_logic_vector(31 downto 0) := x"0000_0018";
+    constant REG_CTRL       : std_logic_vector(31 downto 0) := x"0000_001C";
+    constant REG_STATUS     : std_logic_vector(31 downto 0) := x"0000_0020";
+    constant REG_DESC_ADDR  : std_logic_vector(31 downto 0) := x"0000_0024";
+    constant REG_DONE_COUNT : std_logic_vector(31 downto 0) := x"0000_0028";
+
+    constant CTRL_FILL  : std_logic_vector(31 downto 0) := x"0000_0001";
+    constant CTRL_IRQ   : std_logic_vector(31 downto 0) := x"0000_0002";
+    constant CTRL_START : std_logic_vector(31 downto 0) := x"8000_0000";
+
+begin
+
+    wb_dma_inst : entity work.wb_dma
+        generic map(
+            G_BURST_WORDS => 16
+        )
+        port map(
+            wb_clk        => clk,
+            wb_reset      => reset,
+            wb_mosi_in    => reg_mosi,
+            wb_miso_out   => reg_miso,
+            wb_mosi_out   => dma_mosi,
+            wb_miso_in    => dma_miso,
+            busy_out      => busy,
+            interrupt_out => irq
+        );
+
+    wb_arbiter_inst : entity work.wb_arbiter
+        generic map(
+            G_ARBITER => "priority"
+        )
+        port map(
+            wb_clk                 => clk,
+            wb_reset               => reset,
+            wb_master_0_mosi_in    => tb_mosi,
+            wb_master_0_miso_out   => tb_miso,
+            wb_master_1_mosi_in    => dma_mosi,
+            wb_master_1_miso_out   => dma_miso,
+            wb_master_sel_mosi_out => sel_mosi,
+            wb_master_sel_miso_in  => sel_miso
+        );
+
+    wb_interconnect_inst : entity work.wb_interconnect
+        generic map(
+            G_NUM_SLAVES => NUM_SLAVES
+        )
+        port map(
+            wb_clk                => clk,
+            wb_reset              => reset,
+            wb_master_mosi_in     => sel_mosi,
+            wb_master_miso_out    => sel_miso,
+            wb_slave_mosi_arr_out => slave_mosi_arr,
+            wb_slave_miso_arr_in  => slave_miso_arr
+        );
+
+    gen_ram : for i in 0 to NUM_SLAVES - 1 generate
+        wb_sp_bram_inst : entity work.wb_sp_bram
+            generic map(
+                G_MEM_DEPTH_WORDS => MEM_WORDS
+            )
+            port map(
+                wb_clk      => clk,
+                wb_reset    => reset,
+                wb_mosi_in  => slave_mosi_arr(i),
+                wb_miso_out => slave_miso_arr(i)
+            );
+    end generate;
+
+    main : process
+        procedure mem_write (addr : integer; data : std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_write(clk, tb_mosi, tb_miso, uint2slv(addr), data);
+        end procedure;
+
+        procedure mem_check (addr : integer; exp : std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_check(clk, tb_mosi, tb_miso, uint2slv(addr), exp);
+        end procedure;
+
+        procedure reg_write (reg, data : std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_write(clk, reg_mosi, reg_miso, reg, data);
+        end procedure;
+
+        procedure reg_check (reg, exp : std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_check(clk, reg_mosi, reg_miso, reg, exp);
+        end procedure;
+
+        procedure transfer (src, dst, len, rows, src_stride, dst_stride : integer; fill, ctrl : std_logic_vector(31 downto 0)) is
+        begin
+            reg_write(REG_SRC, uint2slv(src));
+            reg_write(REG_DST, uint2slv(dst));
+            reg_write(REG_LEN, uint2slv(len));
+            reg_write(REG_ROWS, uint2slv(rows));
+            reg_write(REG_STRIDE, uint2slv(src_stride, 16) & uint2slv(dst_stride, 16));
+            reg_write(REG_FILL, fill);
+            reg_write(REG_NEXT, x"0000_0000");
+            reg_write(REG_CTRL, ctrl or CTRL_START);
+        end procedure;
+
+        procedure wait_idle is
+        begin
+            wait until rising_edge(clk);
+            if busy = '1' then
+                wait until busy = '0';
+            end if;
+            wait until rising_edge(clk);
+        end procedure;
+
+        variable exp : std_logic_vector(31 downto 0);
+    begin
+        test_runner_setup(runner, runner_cfg);
+
+        wait for 10 * clk_period;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait for 5 * clk_period;
+
+        while test_suite loop
+            if run("copy") then
+                -- 40 words, two full bursts and a short one
+                for i in 0 to 39 loop
+                    mem_write(RAM_A + i * 4, uint2slv(16#0ADE_0000# + i));
+                end loop;
+                transfer(RAM_A, RAM_B + 16#100#, 160, 1, 0, 0, x"0000_0000", x"0000_0000");
+                wait_idle;
+                reg_check(REG_STATUS, x"0000_0000");
+                reg_check(REG_DONE_COUNT, uint2slv(1));
+                check_equal(irq, '0', "no interrupt requested");
+                mem_check(RAM_B + 16#FC#, x"0000_0000");
+                for i in 0 to 39 loop
+                    mem_check(RAM_B + 16#100# + i * 4, uint2slv(16#0ADE_0000# + i));
+                end loop;
+                mem_check(RAM_B + 16#100# + 40 * 4, x"0000_0000");
+
+            elsif run("fill_2d") then
+                -- 3 rows of 5 words, 64 byte stride
+                transfer(0, RAM_B + 8, 20, 3, 0, 64, x"A5A5_0001", CTRL_FILL or CTRL_IRQ);
+                wait_idle;
+                reg_check(REG_STATUS, x"0000_0002");
+                check_equal(irq, '1', "interrupt on completion");
+                for y in 0 to 3 loop
+                    for x in 0 to 7 loop
+                        exp := x"A5A5_0001" when x >= 2 and x < 2 + 5 and y < 3 else x"0000_0000";
+                        mem_check(RAM_B + y * 64 + x * 4, exp);
+                    end loop;
+                end loop;
+                reg_write(REG_STATUS, x"0000_0002"); -- W1C
+                reg_check(REG_STATUS, x"0000_0000");
+                check_equal(irq, '0', "interrupt cleared");
+
+            elsif run("chain") then
+                for i in 0 to 3 loop
+                    mem_write(RAM_A + i * 4, uint2slv(16#1000# + i));
+                end loop;
+                -- descriptor 0 at 0x200: copy 4 words from RAM A to RAM B
+                mem_write(RAM_A + 16#200#, uint2slv(RAM_A));
+                mem_write(RAM_A + 16#204#, uint2slv(RAM_B));
+                mem_write(RAM_A + 16#208#, uint2slv(16));
+                mem_write(RAM_A + 16#20C#, uint2slv(1));
+                mem_write(RAM_A + 16#210#, x"0000_0000");
+                mem_write(RAM_A + 16#214#, x"0000_0000");
+                mem_write(RAM_A + 16#218#, uint2slv(RAM_A + 16#220#));
+                mem_write(RAM_A + 16#21C#, x"0000_0000");
+                -- descriptor 1 at 0x220: fill 2 words, end of chain
+                mem_write(RAM_A + 16#220#, x"0000_0000");
+                mem_write(RAM_A + 16#224#, uint2slv(RAM_B + 16#40#));
+                mem_write(RAM_A + 16#228#, uint2slv(8));
+                mem_write(RAM_A + 16#22C#, uint2slv(1));
+                mem_write(RAM_A + 16#230#, x"0000_0000");
+                mem_write(RAM_A + 16#234#, x"1234_5678");
+                mem_write(RAM_A + 16#238#, x"0000_0000");
+                mem_write(RAM_A + 16#23C#, CTRL_FILL or CTRL_IRQ);
+
+                reg_write(REG_DESC_ADDR, uint2slv(RAM_A + 16#200#));
+                wait_idle;
+                reg_check(REG_STATUS, x"0000_0002");
+                reg_check(REG_DONE_COUNT, uint2slv(2));
+                reg_check(REG_DESC_ADDR, uint2slv(RAM_A + 16#220#));
+                for i in 0 to 3 loop
+                    mem_check(RAM_B + i * 4, uint2slv(16#1000# + i));
+                end loop;
+                mem_check(RAM_B + 16#40#, x"1234_5678");
+                mem_check(RAM_B + 16#44#, x"1234_5678");
+                mem_check(RAM_B + 16#48#, x"0000_0000");
+
+            elsif run("bus_error") then
+                transfer(RAM_A, 16#2000_0000#, 64, 1, 0, 0, x"0000_0000", x"0000_0000");
+                wait_idle;
+                reg_check(REG_STATUS, x"0000_0006"); -- ERR and IRQ
+                reg_check(REG_DONE_COUNT, uint2slv(0));
+                reg_write(REG_STATUS, x"0000_0006");
+                reg_check(REG_STATUS, x"0000_0000");
+                -- still usable afterwards
+                transfer(0, RAM_B, 4, 1, 0, 0, x"0000_00AA", CTRL_FILL);
+                wait_idle;
+                reg_check(REG_STATUS, x"0000_0000");
+                mem_check(RAM_B, x"0000_00AA");
+            end if;
+        end loop;
+        test_runner_cleanup(runner);
+    end process main;
+
+    test_runner_watchdog(runner, 1 ms);
+
+    clk_process : process
+    begin
+        clk <= '1';
+        wait for clk_period/2;
+        clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
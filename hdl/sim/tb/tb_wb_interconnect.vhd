@@ -38,6 +38,16 @@ architecture bench of tb_wb_interconnect is
     constant bus_handle    : bus_master_t := new_bus(data_length => 32,
     address_length => 32, logger => master_logger);
     constant strobe_high_probability : real := 0.5; -- what does this do?
+
+    -- Pipelined Interconnect (driven directly from the main process, VUnit's master is not pipelined)
+    constant G_PIPE_SLAVES     : integer := 2;
+    signal pipe_master_mosi    : t_wb_mosi := C_WB_MOSI_INIT;
+    signal pipe_master_miso    : t_wb_miso;
+    signal pipe_slave_mosi_arr : t_wb_mosi_arr(G_PIPE_SLAVES - 1 downto 0);
+    signal pipe_slave_miso_arr : t_wb_miso_arr(G_PIPE_SLAVES - 1 downto 0);
+    -- gen_wb_ic style map: slave 0 has a 256MB slot, slave 1 only 4KB at 0x1000_0000
+    constant C_PIPE_ADR_MASK  : t_slv32_arr(0 to G_PIPE_SLAVES - 1) := (x"F000_0000", x"FFFF_F000");
+    constant C_PIPE_ADR_MATCH : t_slv32_arr(0 to G_PIPE_SLAVES - 1) := (x"0000_0000", x"1000_0000");
 begin
     -- DUT
     wb_interconnect_inst : entity work.wb_interconnect
@@ -86,6 +96,38 @@ gen_slaves : for i in 0 to G_NUM_SLAVES-1 generate
 end generate;
 
 
+    -- DUT 2
+    wb_pipelined_interconnect_inst : entity work.wb_pipelined_interconnect
+        generic map(
+            G_NUM_SLAVES      => G_PIPE_SLAVES,
+            G_MAX_OUTSTANDING => 4,
+            G_REGISTER_DECODE => true,
+            G_ADR_MASK        => C_PIPE_ADR_MASK,
+            G_ADR_MATCH       => C_PIPE_ADR_MATCH
+        )
+        port map(
+            wb_clk                => wb_clk,
+            wb_reset              => wb_reset,
+            wb_master_mosi_in     => pipe_master_mosi,
+            wb_master_miso_out    => pipe_master_miso,
+            wb_slave_mosi_arr_out => pipe_slave_mosi_arr,
+            wb_slave_miso_arr_in  => pipe_slave_miso_arr
+        );
+
+    gen_pipe_slaves : for i in 0 to G_PIPE_SLAVES - 1 generate
+        u_slave : entity work.wb_sp_bram
+            generic map(
+                G_MEM_DEPTH_WORDS => 64,
+                G_INIT_FILE       => ""
+            )
+            port map(
+                wb_clk      => wb_clk,
+                wb_reset    => wb_reset,
+                wb_mosi_in  => pipe_slave_mosi_arr(i),
+                wb_miso_out => pipe_slave_miso_arr(i)
+            );
+    end generate;
+
     main : process
         variable tmp_wdata  : std_logic_vector(wb_master_mosi.wdat'range);
         variable tmp_rdata  : std_logic_vector(wb_master_miso.rdat'range);
@@ -104,6 +146,57 @@ end generate;
         begin
             return std_logic_vector(get_slv_offset(slv) + to_unsigned(reg * 4, 32));
         end function;
+
+        constant C_BURST_LEN : integer := 32;
+        variable adrs        : t_slv32_arr(0 to C_BURST_LEN - 1);
+        variable wdats       : t_slv32_arr(0 to C_BURST_LEN - 1);
+        variable rdats       : t_slv32_arr(0 to C_BURST_LEN - 1);
+        variable cycles      : integer;
+        variable errs        : integer;
+
+        --! Keeps STB high and issues a new request every cycle it isn't stalled.
+        --! Returns the number of clock cycles from the first STB to the last ACK/ERR
+        procedure pipe_burst (
+            constant count  : in integer;
+            constant we     : in std_logic;
+            variable cycles : out integer;
+            variable errs   : out integer
+        ) is
+            variable issued   : integer := 0;
+            variable received : integer := 0;
+            variable t        : integer := 0;
+        begin
+            errs := 0;
+            wait until rising_edge(wb_clk);
+            pipe_master_mosi.cyc  <= '1';
+            pipe_master_mosi.stb  <= '1';
+            pipe_master_mosi.we   <= we;
+            pipe_master_mosi.sel  <= x"F";
+            pipe_master_mosi.adr  <= adrs(0);
+            pipe_master_mosi.wdat <= wdats(0);
+            while received < count loop
+                wait until rising_edge(wb_clk);
+                t := t + 1;
+                if pipe_master_miso.ack = '1' then
+                    rdats(received) := pipe_master_miso.rdat;
+                    received        := received + 1;
+                elsif pipe_master_miso.err = '1' then
+                    errs     := errs + 1;
+                    received := received + 1;
+                end if;
+                if pipe_master_mosi.stb = '1' and pipe_master_miso.stall = '0' then
+                    issued := issued + 1;
+                    if issued = count then
+                        pipe_master_mosi.stb <= '0';
+                    else
+                        pipe_master_mosi.adr  <= adrs(issued);
+                        pipe_master_mosi.wdat <= wdats(issued);
+                    end if;
+                end if;
+            end loop;
+            pipe_master_mosi <= C_WB_MOSI_INIT;
+            cycles := t;
+        end procedure;
     begin
         test_runner_setup(runner, runner_cfg);
 
@@ -214,6 +307,72 @@ end generate;
 
                 wait for 10 * clk_period;
                 test_runner_cleanup(runner);
+
+            elsif run("Pipelined Latency") then
+                adrs(0)  := calc_addr(0, 3);
+                wdats(0) := x"1234_5678";
+                pipe_burst(1, '1', cycles, errs);
+                pipe_burst(1, '0', cycles, errs);
+                check_equal(tb_checker, rdats(0), wdats(0), "Pipelined read data");
+                info(tb_logger, "Single read latency: " & to_string(cycles) & " cycles");
+                -- register slice + BRAM wait state + ACK sampled by the master
+                check_equal(tb_checker, cycles, 3, "Single read latency");
+                test_runner_cleanup(runner);
+
+            elsif run("Pipelined Throughput") then
+                for i in 0 to C_BURST_LEN - 1 loop
+                    adrs(i)  := calc_addr(1, i);
+                    wdats(i) := uint2slv(i * 16 + 1);
+                end loop;
+                pipe_burst(C_BURST_LEN, '1', cycles, errs);
+                info(tb_logger, to_string(C_BURST_LEN) & " word burst write: " & to_string(cycles) & " cycles");
+                check(tb_checker, cycles <= C_BURST_LEN + 2, "One ACK per cycle during write burst");
+
+                pipe_burst(C_BURST_LEN, '0', cycles, errs);
+                info(tb_logger, to_string(C_BURST_LEN) & " word burst read: " & to_string(cycles) & " cycles");
+                check(tb_checker, cycles <= C_BURST_LEN + 2, "One ACK per cycle during read burst");
+                for i in 0 to C_BURST_LEN - 1 loop
+                    check_equal(tb_checker, rdats(i), wdats(i), "Burst read data " & to_string(i));
+                end loop;
+                test_runner_cleanup(runner);
+
+            elsif run("Pipelined Slave Switching") then
+                -- alternate between slaves, responses must still come back in order
+                for i in 0 to C_BURST_LEN - 1 loop
+                    adrs(i)  := calc_addr(i mod 2, i);
+                    wdats(i) := x"5A00_0000" or uint2slv(i);
+                end loop;
+                pipe_burst(C_BURST_LEN, '1', cycles, errs);
+                pipe_burst(C_BURST_LEN, '0', cycles, errs);
+                info(tb_logger, "Alternating slave read burst: " & to_string(cycles) & " cycles");
+                for i in 0 to C_BURST_LEN - 1 loop
+                    check_equal(tb_checker, rdats(i), wdats(i), "Alternating read data " & to_string(i));
+                end loop;
+
+                -- unmapped slave in the middle of a burst
+                for i in 0 to 7 loop
+                    adrs(i) := calc_addr(0, i);
+                end loop;
+                adrs(4) := calc_addr(G_PIPE_SLAVES, 0);
+                pipe_burst(8, '0', cycles, errs);
+                check_equal(tb_checker, errs, 1, "Unmapped access returns ERR");
+                test_runner_cleanup(runner);
+
+            elsif run("Pipelined Address Map") then
+                -- slave 1 only decodes its 4KB, the rest of its adr[31:28] slot is unmapped
+                adrs(0)  := x"1000_0FFC";
+                wdats(0) := x"CAFE_0001";
+                pipe_burst(1, '1', cycles, errs);
+                check_equal(tb_checker, errs, 0, "Write inside the 4KB region");
+                adrs(0) := x"1000_1000";
+                adrs(1) := x"1800_0000";
+                adrs(2) := x"0FFF_FFFC";
+                pipe_burst(3, '0', cycles, errs);
+                check_equal(tb_checker, errs, 2, "Outside the 4KB region returns ERR");
+                adrs(0) := x"1000_0FFC";
+                pipe_burst(1, '0', cycles, errs);
+                check_equal(tb_checker, rdats(0), wdats(0), "Read back inside the 4KB region");
+                test_runner_cleanup(runner);
             end if;
         end loop;
     end process main;
@@ -0,0 +1,195 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.joe_common_pkg.all;
+use work.wb_pkg.all;
+use work.sim_wb_procedures_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+entity tb_wb_psram_arbiter is
+    generic (runner_cfg : string);
+end;
+
+architecture bench of tb_wb_psram_arbiter is
+
+    -- Clock period
+    constant clk_period : time := 10 ns;
+    -- Generics
+    constant G_NUM_PORTS : integer := 2;
+
+    -- Register Map
+    constant CTRL_REG          : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant WINDOW_REG        : std_logic_vector(31 downto 0) := x"0000_0004";
+    constant PORT0_CFG_REG     : std_logic_vector(31 downto 0) := x"0000_0040";
+    constant PORT0_BW_REG      : std_logic_vector(31 downto 0) := x"0000_0048";
+    constant PORT1_CFG_REG     : std_logic_vector(31 downto 0) := x"0000_0050";
+    constant PORT1_QOS_REG     : std_logic_vector(31 downto 0) := x"0000_0054";
+    constant PORT1_BW_REG      : std_logic_vector(31 downto 0) := x"0000_0058";
+    constant PORT1_WAIT_REG    : std_logic_vector(31 downto 0) := x"0000_005C";
+
+    -- Ports
+    signal wb_clk        : std_logic;
+    signal wb_reset      : std_logic := '1';
+    signal port_mosi_arr : t_wb_mosi_arr(G_NUM_PORTS - 1 downto 0) := (others => C_WB_MOSI_INIT);
+    signal port_miso_arr : t_wb_miso_arr(G_NUM_PORTS - 1 downto 0);
+    signal mem_mosi      : t_wb_mosi;
+    signal mem_miso      : t_wb_miso;
+    signal cfg_mosi      : t_wb_mosi := C_WB_MOSI_INIT;
+    signal cfg_miso      : t_wb_miso;
+
+    -- streaming master control
+    signal stream_start : std_logic := '0';
+    signal stream_done  : std_logic := '0';
+    constant STREAM_WORDS : integer := 64;
+
+begin
+
+    wb_psram_arbiter_inst : entity work.wb_psram_arbiter
+        generic map(
+            G_NUM_PORTS       => G_NUM_PORTS,
+            G_MAX_OUTSTANDING => 4,
+            G_DEFAULT_BURST   => 4
+        )
+        port map(
+            wb_clk               => wb_clk,
+            wb_reset             => wb_reset,
+            wb_port_mosi_arr_in  => port_mosi_arr,
+            wb_port_miso_arr_out => port_miso_arr,
+            wb_psram_mosi_out    => mem_mosi,
+            wb_psram_miso_in     => mem_miso,
+            wb_cfg_mosi_in       => cfg_mosi,
+            wb_cfg_miso_out      => cfg_miso
+        );
+
+    -- stand-in for the PSRAM controller (same in-order pipelined Wishbone behaviour, just faster)
+    wb_sp_bram_inst : entity work.wb_sp_bram
+        generic map(
+            G_MEM_DEPTH_WORDS => 256,
+            G_INIT_FILE       => ""
+        )
+        port map(
+            wb_clk      => wb_clk,
+            wb_reset    => wb_reset,
+            wb_mosi_in  => mem_mosi,
+            wb_miso_out => mem_miso
+        );
+
+    --! Port 1: pipelined streaming reader (like a pixel DMA), keeps STB high for the whole burst
+    stream_proc : process
+        variable issued   : integer;
+        variable received : integer;
+    begin
+        port_mosi_arr(1) <= C_WB_MOSI_INIT;
+        wait until stream_start = '1';
+        wait until rising_edge(wb_clk);
+        issued   := 0;
+        received := 0;
+        port_mosi_arr(1).cyc <= '1';
+        port_mosi_arr(1).stb <= '1';
+        port_mosi_arr(1).we  <= '0';
+        port_mosi_arr(1).sel <= x"F";
+        port_mosi_arr(1).adr <= uint2slv(128 * 4);
+        while received < STREAM_WORDS loop
+            wait until rising_edge(wb_clk);
+            if port_miso_arr(1).ack = '1' then
+                received := received + 1;
+            end if;
+            if port_mosi_arr(1).stb = '1' and port_miso_arr(1).stall = '0' then
+                issued := issued + 1;
+                if issued = STREAM_WORDS then
+                    port_mosi_arr(1).stb <= '0';
+                else
+                    port_mosi_arr(1).adr <= uint2slv((128 + (issued mod 64)) * 4);
+                end if;
+            end if;
+        end loop;
+        port_mosi_arr(1) <= C_WB_MOSI_INIT;
+        stream_done <= '1';
+        wait;
+    end process;
+
+    main : process
+        variable rdata : std_logic_vector(31 downto 0);
+    begin
+        test_runner_setup(runner, runner_cfg);
+        wait for 5 * clk_period;
+        wait until rising_edge(wb_clk);
+        wb_reset <= '0';
+        wait for 5 * clk_period;
+
+        while test_suite loop
+            if run("single_port_access") then
+                for i in 0 to 7 loop
+                    sim_wb_write(wb_clk, port_mosi_arr(0), port_miso_arr(0), uint2slv(i * 4), uint2slv(i + 100));
+                end loop;
+                for i in 0 to 7 loop
+                    sim_wb_check(wb_clk, port_mosi_arr(0), port_miso_arr(0), uint2slv(i * 4), uint2slv(i + 100));
+                end loop;
+                sim_wb_check(wb_clk, cfg_mosi, cfg_miso, PORT0_BW_REG, uint2slv(16));
+                test_runner_cleanup(runner);
+
+            elsif run("cpu_not_starved_by_stream") then
+                -- give the stream port priority and a bandwidth guarantee, but short bursts
+                sim_wb_write(wb_clk, cfg_mosi, cfg_miso, PORT1_CFG_REG, x"0000_0403"); -- burst 4, priority 3
+                sim_wb_write(wb_clk, cfg_mosi, cfg_miso, PORT1_QOS_REG, uint2slv(32));
+                sim_wb_write(wb_clk, cfg_mosi, cfg_miso, WINDOW_REG, uint2slv(128));
+                sim_wb_write(wb_clk, cfg_mosi, cfg_miso, CTRL_REG, x"0000_0001");  -- clear counters
+
+                stream_start <= '1';
+                -- CPU accesses interleave with the stream
+                for i in 0 to 7 loop
+                    sim_wb_write(wb_clk, port_mosi_arr(0), port_miso_arr(0), uint2slv(i * 4), uint2slv(i + 200));
+                end loop;
+                for i in 0 to 7 loop
+                    sim_wb_check(wb_clk, port_mosi_arr(0), port_miso_arr(0), uint2slv(i * 4), uint2slv(i + 200));
+                end loop;
+                if stream_done = '0' then
+                    wait until stream_done = '1';
+                end if;
+
+                sim_wb_check(wb_clk, cfg_mosi, cfg_miso, PORT0_BW_REG, uint2slv(16));
+                sim_wb_check(wb_clk, cfg_mosi, cfg_miso, PORT1_BW_REG, uint2slv(STREAM_WORDS));
+                sim_wb_read(wb_clk, cfg_mosi, cfg_miso, PORT1_WAIT_REG, rdata);
+                info("Stream port wait cycles: " & to_string(slv2uint(rdata)));
+                check(slv2uint(rdata) > 0, "Stream port was stalled while the CPU used the PSRAM");
+                test_runner_cleanup(runner);
+
+            elsif run("grant_parked_on_last_owner") then
+                -- the first access wins the grant, which then stays with port 0 while nobody else asks
+                sim_wb_write(wb_clk, port_mosi_arr(0), port_miso_arr(0), uint2slv(0), x"1234_5678");
+                wait for 4 * clk_period;
+                wait until rising_edge(wb_clk);
+                port_mosi_arr(0).cyc <= '1';
+                port_mosi_arr(0).stb <= '1';
+                port_mosi_arr(0).we  <= '0';
+                port_mosi_arr(0).sel <= x"F";
+                port_mosi_arr(0).adr <= uint2slv(0);
+                wait for 1 ns;
+                check_equal(port_miso_arr(0).stall, '0', "New bus cycle accepted without an arbitration cycle");
+                wait until rising_edge(wb_clk);
+                port_mosi_arr(0).stb <= '0';
+                loop
+                    wait until rising_edge(wb_clk);
+                    exit when port_miso_arr(0).ack = '1';
+                end loop;
+                check_equal(port_miso_arr(0).rdat, std_logic_vector'(x"1234_5678"), "Read back");
+                port_mosi_arr(0) <= C_WB_MOSI_INIT;
+                test_runner_cleanup(runner);
+            end if;
+        end loop;
+    end process main;
+
+    test_runner_watchdog(runner, 50 us);
+
+    clk_process : process
+    begin
+        wb_clk <= '1';
+        wait for clk_period/2;
+        wb_clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
@@ -0,0 +1,568 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+use work.sim_wb_procedures_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+-- wb_sd_host against sim_sd_card_native, going through the card initialisation the driver does,
+-- then reads and writes over 1 and 4 bit buses by PIO and DMA
+entity tb_wb_sd_host is
+    generic (
+        runner_cfg : string
+    );
+end;
+
+architecture bench of tb_wb_sd_host is
+    constant clk_period : time := 40 ns; -- 25MHz, as on the Basys3
+
+    constant MEM_WORDS : integer := 2048;
+
+    signal clk      : std_logic;
+    signal reset    : std_logic := '1';
+    signal reg_mosi : t_wb_mosi := C_WB_MOSI_INIT;
+    signal reg_miso : t_wb_miso;
+    signal dma_mosi : t_wb_mosi;
+    signal dma_miso : t_wb_miso;
+
+    -- testbench access to the memory, shares the bus with the DMA
+    signal tb_mosi  : t_wb_mosi := C_WB_MOSI_INIT;
+    signal tb_miso  : t_wb_miso;
+    signal sel_mosi : t_wb_mosi;
+    signal sel_miso : t_wb_miso;
+
+    -- SD bus, pulled up
+    signal sd_clk     : std_logic;
+    signal sd_cmd     : std_logic;
+    signal sd_dat     : std_logic_vector(3 downto 0);
+    signal cmd_out    : std_logic;
+    signal cmd_oe     : std_logic;
+    signal dat_out    : std_logic_vector(3 downto 0);
+    signal dat_oe     : std_logic_vector(3 downto 0);
+    signal corrupt    : std_logic := '0';
+    signal blocks_rd  : integer;
+    signal blocks_wr  : integer;
+
+    -- DUT internals, to line a DMA_WORDS write up with the end of a transfer
+    signal dut_dat_done : std_logic;
+    signal dut_dma_kick : std_logic;
+    signal last_done    : time := 0 ns; -- edge the last data transfer ended on
+    signal last_kick    : time := 0 ns; -- edge the DMA was last kicked on
+
+    -- register offsets
+    constant REG_ARG          : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant REG_CMD          : std_logic_vector(31 downto 0) := x"0000_0004";
+    constant REG_STATUS       : std_logic_vector(31 downto 0) := x"0000_0008";
+    constant REG_RESP0        : std_logic_vector(31 downto 0) := x"0000_000C";
+    constant REG_RESP3        : std_logic_vector(31 downto 0) := x"0000_0018";
+    constant REG_CLK          : std_logic_vector(31 downto 0) := x"0000_001C";
+    constant REG_CTRL         : std_logic_vector(31 downto 0) := x"0000_0020";
+    constant REG_BLOCK_COUNT  : std_logic_vector(31 downto 0) := x"0000_0024";
+    constant REG_BLOCK_LEN    : std_logic_vector(31 downto 0) := x"0000_0028";
+    constant REG_DMA_ADDR     : std_logic_vector(31 downto 0) := x"0000_002C";
+    constant REG_DATA_TIMEOUT : std_logic_vector(31 downto 0) := x"0000_0030";
+    constant REG_FIFO         : std_logic_vector(31 downto 0) := x"0000_0034";
+    constant REG_FIFO_COUNT   : std_logic_vector(31 downto 0) := x"0000_0038";
+    constant REG_DMA_WORDS    : std_logic_vector(31 downto 0) := x"0000_003C";
+
+    constant RESP_R1    : integer := 16#100#;
+    constant RESP_R3    : integer := 16#200#;
+    constant RESP_R2    : integer := 16#300#;
+    constant CMD_BUSY   : integer := 16#400#;
+    constant CMD_DATA   : integer := 16#800#;
+    constant CMD_WRITE  : integer := 16#1000#;
+
+    constant CTRL_WIDE  : integer := 1;
+    constant CTRL_DMA   : integer := 2;
+    constant CTRL_ABORT : integer := -2**31;
+    constant CLK_EN     : integer := 16#1_0000#;
+
+    constant ST_CMD_ERRORS : std_logic_vector(31 downto 0) := x"0000_0700";
+    constant ST_DATA_CRC   : std_logic_vector(31 downto 0) := x"0000_1000";
+
+    constant RCA : integer := 16#1234#;
+
+    -- a word of the card's initial contents
+    function pattern(block_num, word : integer) return std_logic_vector is
+        variable w : std_logic_vector(31 downto 0);
+        variable a : integer;
+    begin
+        for k in 0 to 3 loop
+            a                          := block_num * 512 + word * 4 + k;
+            w(k * 8 + 7 downto k * 8) := uint2slv((a * 7 + a / 512) mod 256, 8);
+        end loop;
+        return w;
+    end function;
+
+begin
+
+    wb_sd_host_inst : entity work.wb_sd_host
+        port map(
+            wb_clk        => clk,
+            wb_reset      => reset,
+            wb_mosi_in    => reg_mosi,
+            wb_miso_out   => reg_miso,
+            wb_mosi_out   => dma_mosi,
+            wb_miso_in    => dma_miso,
+            sd_clk_out    => sd_clk,
+            sd_cmd_out    => cmd_out,
+            sd_cmd_oe_out => cmd_oe,
+            sd_cmd_in     => sd_cmd,
+            sd_dat_out    => dat_out,
+            sd_dat_oe_out => dat_oe,
+            sd_dat_in     => sd_dat
+        );
+
+    sd_cmd <= cmd_out when cmd_oe = '1' else 'Z';
+    sd_cmd <= 'H';
+    gen_dat : for i in 0 to 3 generate
+        sd_dat(i) <= dat_out(i) when dat_oe(i) = '1' else 'Z';
+    end generate;
+    sd_dat <= "HHHH";
+
+    sim_sd_card_native_inst : entity work.sim_sd_card_native
+        port map(
+            clk_in             => sd_clk,
+            cmd_io             => sd_cmd,
+            dat_io             => sd_dat,
+            corrupt_crc_in     => corrupt,
+            blocks_read_out    => blocks_rd,
+            blocks_written_out => blocks_wr
+        );
+
+    wb_arbiter_inst : entity work.wb_arbiter
+        generic map(
+            G_ARBITER => "priority"
+        )
+        port map(
+            wb_clk                 => clk,
+            wb_reset               => reset,
+            wb_master_0_mosi_in    => tb_mosi,
+            wb_master_0_miso_out   => tb_miso,
+            wb_master_1_mosi_in    => dma_mosi,
+            wb_master_1_miso_out   => dma_miso,
+            wb_master_sel_mosi_out => sel_mosi,
+            wb_master_sel_miso_in  => sel_miso
+        );
+
+    wb_sp_bram_inst : entity work.wb_sp_bram
+        generic map(
+            G_MEM_DEPTH_WORDS => MEM_WORDS
+        )
+        port map(
+            wb_clk      => clk,
+            wb_reset    => reset,
+            wb_mosi_in  => sel_mosi,
+            wb_miso_out => sel_miso
+        );
+
+    dut_dat_done <= <<signal .tb_wb_sd_host.wb_sd_host_inst.dat_done : std_logic>>;
+    dut_dma_kick <= <<signal .tb_wb_sd_host.wb_sd_host_inst.dma_kick : std_logic>>;
+
+    dut_watch : process (clk)
+    begin
+        if rising_edge(clk) then
+            if dut_dat_done = '1' then
+                last_done <= now;
+            end if;
+            if dut_dma_kick = '1' then
+                last_kick <= now;
+            end if;
+        end if;
+    end process;
+
+    main : process
+        -- single access, without the logging of sim_wb_procedures_pkg as the polling does thousands
+        procedure reg_access (adr : std_logic_vector(31 downto 0); we : std_logic; wdat : std_logic_vector(31 downto 0);
+            rdat : out std_logic_vector(31 downto 0)) is
+        begin
+            reg_mosi      <= C_WB_MOSI_INIT;
+            reg_mosi.cyc  <= '1';
+            reg_mosi.stb  <= '1';
+            reg_mosi.we   <= we;
+            reg_mosi.adr  <= adr;
+            reg_mosi.wdat <= wdat;
+            reg_mosi.sel  <= x"F";
+            wait until rising_edge(clk) and reg_miso.stall = '0';
+            reg_mosi.stb <= '0';
+            if reg_miso.ack = '0' then
+                wait until rising_edge(clk) and reg_miso.ack = '1';
+            end if;
+            rdat := reg_miso.rdat;
+            reg_mosi.cyc <= '0';
+        end procedure;
+
+        procedure reg_write (reg : std_logic_vector(31 downto 0); data : integer) is
+            variable dummy : std_logic_vector(31 downto 0);
+        begin
+            reg_access(reg, '1', uint2slv(data), dummy);
+        end procedure;
+
+        procedure reg_read (reg : std_logic_vector(31 downto 0); data : out std_logic_vector(31 downto 0)) is
+        begin
+            reg_access(reg, '0', x"0000_0000", data);
+        end procedure;
+
+        procedure reg_check (reg, exp : std_logic_vector(31 downto 0); msg : string := "") is
+            variable data : std_logic_vector(31 downto 0);
+        begin
+            reg_read(reg, data);
+            check_equal(data, exp, msg);
+        end procedure;
+
+        procedure mem_write (addr : integer; data : std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_write(clk, tb_mosi, tb_miso, uint2slv(addr), data);
+        end procedure;
+
+        procedure mem_read (addr : integer; data : out std_logic_vector(31 downto 0)) is
+        begin
+            sim_wb_read(clk, tb_mosi, tb_miso, uint2slv(addr), data);
+        end procedure;
+
+        -- send a command and wait for it (and its busy, for R1b) to finish
+        procedure send_cmd (index, arg, flags : integer) is
+            variable status : std_logic_vector(31 downto 0);
+        begin
+            reg_write(REG_ARG, arg);
+            reg_write(REG_CMD, index + flags);
+            loop
+                reg_read(REG_STATUS, status);
+                exit when status(0) = '0';
+            end loop;
+        end procedure;
+
+        -- and check that it went through
+        procedure cmd_ok (index, arg, flags : integer) is
+            variable status : std_logic_vector(31 downto 0);
+        begin
+            send_cmd(index, arg, flags);
+            reg_read(REG_STATUS, status);
+            check_equal(status and ST_CMD_ERRORS, x"0000_0000", "CMD" & integer'image(index) & " errors");
+        end procedure;
+
+        procedure wait_data is
+            variable status : std_logic_vector(31 downto 0);
+        begin
+            loop
+                reg_read(REG_STATUS, status);
+                exit when status(1) = '0';
+            end loop;
+        end procedure;
+
+        procedure wait_dma is
+            variable status : std_logic_vector(31 downto 0);
+        begin
+            loop
+                reg_read(REG_STATUS, status);
+                exit when status(2) = '0';
+            end loop;
+        end procedure;
+
+        -- the initialisation mmc.c does, then up to full speed
+        procedure card_init (wide : boolean) is
+            variable data : std_logic_vector(31 downto 0);
+        begin
+            reg_write(REG_CLK, CLK_EN + 4); -- slow for identification
+            wait for 80 * 10 * clk_period; -- 74 clocks or more before the first command
+
+            send_cmd(0, 0, 0);
+            cmd_ok(8, 16#1AA#, RESP_R1);
+            reg_check(REG_RESP0, x"0000_01AA", "CMD8 echo");
+            loop
+                cmd_ok(55, 0, RESP_R1);
+                cmd_ok(41, 16#40FF_8000#, RESP_R3);
+                reg_read(REG_RESP0, data);
+                exit when data(31) = '1';
+            end loop;
+            check_equal(data(30), '1', "CCS (SDHC)");
+            cmd_ok(2, 0, RESP_R2);
+            reg_check(REG_RESP3, x"0353_4453", "CID");
+            cmd_ok(3, 0, RESP_R1);
+            reg_read(REG_RESP0, data);
+            check_equal(to_integer(unsigned(data(31 downto 16))), RCA, "RCA");
+            cmd_ok(7, RCA * 65536, RESP_R1 + CMD_BUSY);
+            if wide then
+                cmd_ok(55, RCA * 65536, RESP_R1);
+                cmd_ok(6, 2, RESP_R1);
+                reg_write(REG_CTRL, CTRL_WIDE);
+            end if;
+            reg_write(REG_CLK, CLK_EN + 0); -- wb_clk / 2
+        end procedure;
+
+        procedure read_blocks (lba, count, dma_addr, ctrl : integer) is
+        begin
+            reg_write(REG_CTRL, ctrl);
+            reg_write(REG_BLOCK_COUNT, count);
+            reg_write(REG_DMA_ADDR, dma_addr);
+            if count = 1 then
+                cmd_ok(17, lba, RESP_R1 + CMD_DATA);
+            else
+                cmd_ok(18, lba, RESP_R1 + CMD_DATA);
+            end if;
+            wait_data;
+            if count /= 1 then
+                cmd_ok(12, 0, RESP_R1 + CMD_BUSY);
+            end if;
+        end procedure;
+
+        procedure write_blocks (lba, count, dma_addr, ctrl : integer) is
+        begin
+            reg_write(REG_CTRL, ctrl);
+            reg_write(REG_BLOCK_COUNT, count);
+            reg_write(REG_DMA_ADDR, dma_addr);
+            if count = 1 then
+                cmd_ok(24, lba, RESP_R1 + CMD_DATA + CMD_WRITE);
+            else
+                cmd_ok(25, lba, RESP_R1 + CMD_DATA + CMD_WRITE);
+            end if;
+            wait_data;
+            if count /= 1 then
+                cmd_ok(12, 0, RESP_R1 + CMD_BUSY);
+            end if;
+        end procedure;
+
+        -- time to read `count` blocks by DMA, including the commands
+        procedure time_read (lba, count, ctrl : integer; t : out time) is
+            variable t0 : time;
+        begin
+            t0 := now;
+            read_blocks(lba, count, 0, ctrl);
+            t  := now - t0;
+        end procedure;
+
+        variable data   : std_logic_vector(31 downto 0);
+        variable t_1bit : time;
+        variable t_4bit : time;
+        variable t_cmd  : time;
+        variable t_done : time; -- CMD write to the end of the transfer
+        variable t_kick : time; -- DMA_WORDS write to the kick
+        variable lined_up : boolean;
+    begin
+        test_runner_setup(runner, runner_cfg);
+
+        wait for 10 * clk_period;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait for 5 * clk_period;
+
+        while test_suite loop
+            if run("init") then
+                card_init(true);
+                cmd_ok(13, RCA * 65536, RESP_R1);
+                reg_read(REG_RESP0, data);
+                check_equal(to_integer(unsigned(data(12 downto 9))), 4, "card in tran state");
+
+            elsif run("read_pio_1bit") then
+                card_init(false);
+                reg_write(REG_CTRL, 0);
+                reg_write(REG_BLOCK_COUNT, 1);
+                send_cmd(17, 5, RESP_R1 + CMD_DATA);
+                for i in 0 to 127 loop
+                    loop
+                        reg_read(REG_FIFO_COUNT, data);
+                        exit when unsigned(data) /= 0;
+                    end loop;
+                    reg_read(REG_FIFO, data);
+                    check_equal(data, pattern(5, i), "word " & integer'image(i));
+                end loop;
+                wait_data;
+                reg_check(REG_STATUS, x"0000_0000");
+                reg_check(REG_FIFO_COUNT, x"0000_0000");
+
+            elsif run("read_dma_4bit") then
+                card_init(true);
+                read_blocks(2, 6, 16#400#, CTRL_WIDE + CTRL_DMA);
+                reg_check(REG_STATUS, x"0000_0000");
+                reg_check(REG_BLOCK_COUNT, x"0000_0000", "no blocks left");
+                reg_check(REG_DMA_ADDR, uint2slv(16#400# + 6 * 512));
+                mem_read(16#3FC#, data);
+                check_equal(data, x"0000_0000", "nothing written before the buffer");
+                for b in 0 to 5 loop
+                    for i in 0 to 127 loop
+                        mem_read(16#400# + b * 512 + i * 4, data);
+                        check_equal(data, pattern(2 + b, i), "block " & integer'image(b) & " word " & integer'image(i));
+                    end loop;
+                end loop;
+
+            elsif run("write_read_back") then
+                card_init(true);
+                for i in 0 to 255 loop
+                    mem_write(i * 4, uint2slv(16#5D00_0000# + i * 16#1_0003#));
+                end loop;
+                write_blocks(9, 2, 0, CTRL_WIDE + CTRL_DMA);
+                reg_check(REG_STATUS, x"0000_0000");
+                check_equal(blocks_wr, 2, "blocks written");
+                read_blocks(9, 2, 16#1000#, CTRL_WIDE + CTRL_DMA);
+                for i in 0 to 255 loop
+                    mem_read(16#1000# + i * 4, data);
+                    check_equal(data, uint2slv(16#5D00_0000# + i * 16#1_0003#), "word " & integer'image(i));
+                end loop;
+                -- then a single block by PIO, read back over 1 bit
+                reg_write(REG_CTRL, CTRL_WIDE);
+                reg_write(REG_BLOCK_COUNT, 1);
+                send_cmd(24, 11, RESP_R1 + CMD_DATA + CMD_WRITE);
+                -- the block goes once it is all in the FIFO
+                for i in 0 to 127 loop
+                    reg_write(REG_FIFO, i);
+                end loop;
+                wait_data;
+                reg_check(REG_STATUS, x"0000_0000");
+                cmd_ok(55, RCA * 65536, RESP_R1);
+                cmd_ok(6, 0, RESP_R1);
+                read_blocks(11, 1, 16#1400#, CTRL_DMA);
+                for i in 0 to 127 loop
+                    mem_read(16#1400# + i * 4, data);
+                    check_equal(data, uint2slv(i), "word " & integer'image(i));
+                end loop;
+
+            elsif run("stream_dma_per_block") then
+                -- CMD18 left running, each block handed to the DMA when it is wanted, with gaps
+                -- long enough for the FIFO to fill and the SD clock to stop
+                card_init(true);
+                reg_write(REG_CTRL, CTRL_WIDE);
+                reg_write(REG_BLOCK_COUNT, 16#FFFF#);
+                cmd_ok(18, 20, RESP_R1 + CMD_DATA);
+                for b in 0 to 3 loop
+                    wait for 3000 * clk_period;
+                    reg_write(REG_DMA_ADDR, 16#800# + b * 512);
+                    reg_write(REG_DMA_WORDS, 128);
+                    loop
+                        reg_read(REG_STATUS, data);
+                        exit when data(2) = '0';
+                    end loop;
+                end loop;
+                wait for 3000 * clk_period;
+                check_equal(blocks_rd, 6, "two blocks ahead in the FIFO, then paused");
+                reg_check(REG_STATUS, x"0000_0002", "still streaming, no errors");
+                reg_write(REG_CTRL, CTRL_WIDE + CTRL_ABORT);
+                cmd_ok(12, 0, RESP_R1 + CMD_BUSY);
+                reg_check(REG_STATUS, x"0000_0000");
+                for b in 0 to 3 loop
+                    for i in 0 to 127 loop
+                        mem_read(16#800# + b * 512 + i * 4, data);
+                        check_equal(data, pattern(20 + b, i), "block " & integer'image(b) & " word " & integer'image(i));
+                    end loop;
+                end loop;
+
+            elsif run("dma_partial_bursts") then
+                -- DMA_WORDS that aren't a multiple of the 8 word burst end on a short burst
+                card_init(true);
+                mem_write(16#800# + 13 * 4, x"A5A5_A5A5");
+                reg_write(REG_CTRL, CTRL_WIDE);
+                reg_write(REG_BLOCK_COUNT, 1);
+                cmd_ok(17, 3, RESP_R1 + CMD_DATA);
+                wait_data;
+                reg_check(REG_FIFO_COUNT, uint2slv(128), "block in the FIFO");
+                reg_write(REG_DMA_ADDR, 16#800#);
+                reg_write(REG_DMA_WORDS, 13);
+                wait_dma;
+                reg_check(REG_DMA_ADDR, uint2slv(16#800# + 13 * 4), "DMA_ADDR after 8 + 5 words");
+                reg_check(REG_FIFO_COUNT, uint2slv(128 - 13));
+                mem_read(16#800# + 13 * 4, data);
+                check_equal(data, x"A5A5_A5A5", "nothing written past the 13th word");
+                reg_write(REG_DMA_WORDS, 115);
+                wait_dma;
+                reg_check(REG_STATUS, x"0000_0000");
+                reg_check(REG_DMA_ADDR, uint2slv(16#800# + 512));
+                reg_check(REG_FIFO_COUNT, x"0000_0000");
+                for i in 0 to 127 loop
+                    mem_read(16#800# + i * 4, data);
+                    check_equal(data, pattern(3, i), "word " & integer'image(i));
+                end loop;
+
+            elsif run("stop_beats_dma_kick") then
+                -- a DMA_WORDS write that takes effect in the same cycle as a data error ends the
+                -- transfer must not start the DMA. Time the write from a first read, then sweep it
+                -- a few cycles either side until the kick and the error land on the same edge
+                card_init(true);
+                corrupt <= '1';
+                reg_write(REG_CTRL, CTRL_WIDE);
+                reg_write(REG_BLOCK_COUNT, 1);
+                reg_write(REG_ARG, 0);
+                t_cmd := now;
+                reg_write(REG_CMD, 17 + RESP_R1 + CMD_DATA);
+                wait_data;
+                t_done := last_done - t_cmd;
+                t_cmd := now;
+                reg_write(REG_DMA_WORDS, 0); -- no words, just the kick
+                wait for 4 * clk_period;
+                t_kick := last_kick - t_cmd;
+                reg_write(REG_CTRL, CTRL_WIDE + CTRL_ABORT);
+                reg_write(REG_STATUS, 16#7F00#);
+
+                lined_up := false;
+                for j in -3 to 3 loop
+                    reg_write(REG_DMA_ADDR, 16#800#);
+                    t_cmd := now;
+                    reg_write(REG_CMD, 17 + RESP_R1 + CMD_DATA);
+                    wait for t_done - t_kick + j * clk_period - (now - t_cmd);
+                    reg_write(REG_DMA_WORDS, 128);
+                    wait for 100 * clk_period;
+                    if last_kick = last_done then
+                        lined_up := true;
+                        reg_check(REG_DMA_ADDR, x"0000_0800", "DMA not started by a kick on the error");
+                        reg_check(REG_STATUS, x"0000_1000", "DATA_CRC, DMA idle");
+                    end if;
+                    reg_write(REG_CTRL, CTRL_WIDE + CTRL_ABORT);
+                    wait_data;
+                    reg_write(REG_STATUS, 16#7F00#);
+                    reg_check(REG_STATUS, x"0000_0000");
+                end loop;
+                check(lined_up, "DMA_WORDS write lined up with the error");
+
+            elsif run("crc_error") then
+                card_init(true);
+                corrupt <= '1';
+                reg_write(REG_CTRL, CTRL_WIDE + CTRL_DMA);
+                reg_write(REG_BLOCK_COUNT, 4);
+                cmd_ok(18, 0, RESP_R1 + CMD_DATA);
+                wait_data;
+                reg_check(REG_STATUS, ST_DATA_CRC, "DATA_CRC and nothing else");
+                reg_check(REG_BLOCK_COUNT, uint2slv(3), "stopped after the first block");
+                cmd_ok(12, 0, RESP_R1 + CMD_BUSY);
+                reg_write(REG_STATUS, to_integer(unsigned(ST_DATA_CRC))); -- W1C
+                reg_check(REG_STATUS, x"0000_0000");
+                corrupt <= '0';
+                read_blocks(1, 1, 0, CTRL_WIDE + CTRL_DMA);
+                reg_check(REG_STATUS, x"0000_0000", "reads fine afterwards");
+
+            elsif run("cmd_timeout") then
+                card_init(false);
+                send_cmd(5, 0, RESP_R1); -- not supported, no response
+                reg_check(REG_STATUS, x"0000_0100", "CMD_TIMEOUT");
+                reg_write(REG_STATUS, 16#100#);
+                cmd_ok(13, RCA * 65536, RESP_R1);
+
+            elsif run("throughput") then
+                -- 1 bit moves data at the rate wb_spi does with the same SCK (one bit a clock);
+                -- 4 bit should be close to 4 times that
+                card_init(false);
+                time_read(0, 4, CTRL_DMA, t_1bit);
+                cmd_ok(55, RCA * 65536, RESP_R1);
+                cmd_ok(6, 2, RESP_R1);
+                time_read(0, 4, CTRL_WIDE + CTRL_DMA, t_4bit);
+                reg_check(REG_STATUS, x"0000_0000");
+                info("2KB in " & time'image(t_1bit) & " on 1 bit (" & integer'image(2_000_000 / (t_1bit / 1 us)) &
+                    "KB/s), " & time'image(t_4bit) & " on 4 bit (" & integer'image(2_000_000 / (t_4bit / 1 us)) & "KB/s)");
+                check(t_1bit > 3 * t_4bit, "4 bit bus at least 3x faster");
+            end if;
+        end loop;
+        test_runner_cleanup(runner);
+    end process main;
+
+    test_runner_watchdog(runner, 20 ms);
+
+    clk_process : process
+    begin
+        clk <= '1';
+        wait for clk_period/2;
+        clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
@@ -0,0 +1,398 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+use work.sim_sd_card_pkg.all;
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+
+-- wb_spi against the SD card model the hosted firmware build uses (through sim_sd_card), going
+-- through the same command sequences as mmc.c. Needs libsd_card_model.so, which run.py builds.
+entity tb_wb_spi_sd_card is
+    generic (
+        runner_cfg : string
+    );
+end;
+
+architecture bench of tb_wb_spi_sd_card is
+    constant clk_period : time := 10 ns;
+
+    signal clk     : std_logic;
+    signal reset   : std_logic := '1';
+    signal wb_mosi : t_wb_mosi := C_WB_MOSI_INIT;
+    signal wb_miso : t_wb_miso;
+    signal sck     : std_logic;
+    signal cs_n    : std_logic;
+    signal mosi    : std_logic;
+    signal miso    : std_logic;
+
+    -- register offsets
+    constant REG_DATA     : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant REG_CSN      : std_logic_vector(31 downto 0) := x"0000_0004";
+    constant REG_THROTTLE : std_logic_vector(31 downto 0) := x"0000_0008";
+
+    -- card latencies, short to keep the simulation quick
+    constant NAC_US        : integer := 4;
+    constant STREAM_NAC_US : integer := 1;
+    constant BUSY_US       : integer := 1;
+    constant WRITE_BUSY_US : integer := 8;
+    constant INIT_US       : integer := 20;
+
+    constant INIT_THROTTLE : integer := 4;
+
+    -- a byte of the model's default image
+    function pattern(addr : integer) return std_logic_vector is
+    begin
+        return uint2slv((addr * 7 + addr / 512) mod 256, 8);
+    end function;
+
+    function crc7(b : std_logic_vector(7 downto 0); crc : std_logic_vector(6 downto 0)) return std_logic_vector is
+        variable c : std_logic_vector(6 downto 0) := crc;
+        variable feedback : std_logic;
+    begin
+        for i in 7 downto 0 loop
+            feedback := c(6) xor b(i);
+            c        := c(5 downto 0) & '0';
+            if feedback = '1' then
+                c := c xor b"0001001";
+            end if;
+        end loop;
+        return c;
+    end function;
+
+    function crc16(b : std_logic_vector(7 downto 0); crc : std_logic_vector(15 downto 0)) return std_logic_vector is
+        variable c : std_logic_vector(15 downto 0) := crc;
+        variable feedback : std_logic;
+    begin
+        for i in 7 downto 0 loop
+            feedback := c(15) xor b(i);
+            c        := c(14 downto 0) & '0';
+            if feedback = '1' then
+                c := c xor x"1021";
+            end if;
+        end loop;
+        return c;
+    end function;
+
+begin
+
+    wb_spi_inst : entity work.wb_spi
+        generic map(
+            G_ILA => false
+        )
+        port map(
+            wb_clk         => clk,
+            wb_reset       => reset,
+            wb_mosi_in     => wb_mosi,
+            wb_miso_out    => wb_miso,
+            sck_out        => sck,
+            cs_n_out       => cs_n,
+            mosi_out       => mosi,
+            miso_in        => miso,
+            tx_byte_out    => open,
+            rx_byte_out    => open,
+            byte_valid_out => open
+        );
+
+    sim_sd_card_inst : entity work.sim_sd_card
+        port map(
+            sck_in   => sck,
+            cs_n_in  => cs_n,
+            mosi_in  => mosi,
+            miso_out => miso
+        );
+
+    main : process
+        -- single access, without the logging of sim_wb_procedures_pkg as there are thousands
+        procedure wb_access (adr : std_logic_vector(31 downto 0); we : std_logic; wdat : std_logic_vector(31 downto 0);
+            rdat : out std_logic_vector(31 downto 0)) is
+        begin
+            wb_mosi      <= C_WB_MOSI_INIT;
+            wb_mosi.cyc  <= '1';
+            wb_mosi.stb  <= '1';
+            wb_mosi.we   <= we;
+            wb_mosi.adr  <= adr;
+            wb_mosi.wdat <= wdat;
+            wb_mosi.sel  <= x"F";
+            wait until rising_edge(clk) and wb_miso.stall = '0';
+            wb_mosi.stb <= '0';
+            if wb_miso.ack = '0' then
+                wait until rising_edge(clk) and wb_miso.ack = '1';
+            end if;
+            rdat := wb_miso.rdat;
+            wb_mosi.cyc <= '0';
+        end procedure;
+
+        procedure reg_write (adr : std_logic_vector(31 downto 0); data : integer) is
+            variable dummy : std_logic_vector(31 downto 0);
+        begin
+            wb_access(adr, '1', uint2slv(data), dummy);
+        end procedure;
+
+        procedure spi_write (b : std_logic_vector(7 downto 0)) is
+            variable dummy : std_logic_vector(31 downto 0);
+        begin
+            wb_access(REG_DATA, '1', x"0000_00" & b, dummy);
+        end procedure;
+
+        procedure spi_read (b : out std_logic_vector(7 downto 0)) is
+            variable rdat : std_logic_vector(31 downto 0);
+        begin
+            wb_access(REG_DATA, '0', x"0000_0000", rdat);
+            b := rdat(7 downto 0);
+        end procedure;
+
+        -- as sd_spi_start() / sd_spi_stop()
+        procedure card_start is
+        begin
+            spi_write(x"FF");
+            reg_write(REG_CSN, 0);
+            spi_write(x"FF");
+        end procedure;
+
+        procedure card_stop is
+        begin
+            spi_write(x"FF");
+            reg_write(REG_CSN, 1);
+            spi_write(x"FF");
+        end procedure;
+
+        procedure command (index : integer; arg : std_logic_vector(31 downto 0)) is
+            variable b   : std_logic_vector(7 downto 0);
+            variable crc : std_logic_vector(6 downto 0) := (others => '0');
+        begin
+            for i in 0 to 4 loop
+                if i = 0 then
+                    b := uint2slv(16#40# + index, 8);
+                else
+                    b := arg(39 - 8 * i downto 32 - 8 * i);
+                end if;
+                crc := crc7(b, crc);
+                spi_write(b);
+            end loop;
+            spi_write(crc & '1');
+        end procedure;
+
+        -- poll for a response that is not 0xFF, and count the bytes it took
+        procedure response (b : out std_logic_vector(7 downto 0); polls : out integer; max_polls : integer := 8) is
+            variable r : std_logic_vector(7 downto 0);
+        begin
+            polls := 0;
+            loop
+                spi_read(r);
+                exit when r /= x"FF" or polls = max_polls;
+                polls := polls + 1;
+            end loop;
+            b := r;
+        end procedure;
+
+        procedure check_r1 (exp : std_logic_vector(7 downto 0); msg : string) is
+            variable r1    : std_logic_vector(7 downto 0);
+            variable polls : integer;
+        begin
+            response(r1, polls);
+            check_equal(r1, exp, msg);
+        end procedure;
+
+        procedure wait_not_busy is
+            variable b : std_logic_vector(7 downto 0);
+        begin
+            loop
+                spi_read(b);
+                exit when b /= x"00";
+            end loop;
+        end procedure;
+
+        -- read a data block after the command, check it against the image and return if its
+        -- CRC16 matched
+        procedure read_block (sector : integer; crc_ok : out boolean) is
+            variable token : std_logic_vector(7 downto 0);
+            variable b     : std_logic_vector(7 downto 0);
+            variable crc   : std_logic_vector(15 downto 0) := (others => '0');
+            variable polls : integer;
+        begin
+            response(token, polls, 10000);
+            check_equal(token, std_logic_vector'(x"FE"), "data token for sector " & to_string(sector));
+            for i in 0 to 511 loop
+                spi_read(b);
+                crc := crc16(b, crc);
+                if b /= uint2slv(sd_card_peek(sector * 512 + i), 8) then
+                    check_equal(b, uint2slv(sd_card_peek(sector * 512 + i), 8), "sector " & to_string(sector) & " byte " & to_string(i));
+                end if;
+            end loop;
+            for i in 0 to 1 loop
+                spi_read(b);
+                crc := crc16(b, crc);
+            end loop;
+            crc_ok := crc = x"0000";
+        end procedure;
+
+        procedure card_init is
+            constant R7    : std_logic_vector(31 downto 0) := x"0000_01AA";
+            variable r1    : std_logic_vector(7 downto 0);
+            variable b     : std_logic_vector(7 downto 0);
+            variable polls : integer;
+        begin
+            reg_write(REG_THROTTLE, INIT_THROTTLE);
+            card_stop;
+            for i in 1 to 10 loop
+                spi_write(x"FF");
+            end loop;
+
+            card_start;
+            command(0, x"0000_0000");
+            check_r1(x"01", "CMD0");
+            card_stop;
+
+            card_start;
+            command(8, R7);
+            check_r1(x"01", "CMD8");
+            for i in 0 to 3 loop
+                spi_read(b);
+                check_equal(b, R7(31 - 8 * i downto 24 - 8 * i), "CMD8 R7 byte " & to_string(i));
+            end loop;
+            card_stop;
+
+            -- idle until INIT_US after the first ACMD41
+            for i in 1 to 100 loop
+                card_start;
+                command(55, x"0000_0000");
+                response(r1, polls);
+                command(41, x"4000_0000");
+                response(r1, polls);
+                card_stop;
+                exit when r1 = x"00";
+            end loop;
+            check_equal(r1, std_logic_vector'(x"00"), "ACMD41 ready");
+
+            card_start;
+            command(58, x"0000_0000");
+            check_r1(x"00", "CMD58");
+            spi_read(b);
+            check_equal(b(7 downto 6), std_logic_vector'("11"), "OCR power up and CCS");
+            for i in 1 to 3 loop
+                spi_read(b);
+            end loop;
+            card_stop;
+            reg_write(REG_THROTTLE, 0);
+        end procedure;
+
+        variable crc_ok : boolean;
+        variable b      : std_logic_vector(7 downto 0);
+        variable crc    : std_logic_vector(15 downto 0);
+        variable polls  : integer;
+        variable stat   : integer;
+    begin
+        test_runner_setup(runner, runner_cfg);
+        sd_card_init(NAC_US, STREAM_NAC_US, BUSY_US, WRITE_BUSY_US, INIT_US);
+
+        wait for 10 * clk_period;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait for 5 * clk_period;
+        card_init;
+
+        while test_suite loop
+            if run("init") then
+                card_start;
+                command(13, x"0000_0000");
+                check_r1(x"00", "CMD13 after init");
+                card_stop;
+
+            elsif run("read_single") then
+                card_start;
+                command(17, uint2slv(3));
+                check_r1(x"00", "CMD17");
+                -- at 16 clocks a byte, Nac takes NAC_US * 1000 / 160 polls
+                stat := sd_card_stat(SD_STAT_NAC_BYTES);
+                read_block(3, crc_ok);
+                check(crc_ok, "CRC16");
+                check(sd_card_stat(SD_STAT_NAC_BYTES) - stat >= NAC_US * 1000 / (16 * 10 * 2),
+                    "Nac polling, " & to_string(sd_card_stat(SD_STAT_NAC_BYTES) - stat) & " bytes");
+                card_stop;
+                check_equal(sd_card_peek(3 * 512 + 100), to_integer(unsigned(pattern(3 * 512 + 100))), "image pattern");
+
+            elsif run("read_multi") then
+                card_start;
+                command(18, uint2slv(10));
+                check_r1(x"00", "CMD18");
+                for s in 10 to 13 loop
+                    read_block(s, crc_ok);
+                    check(crc_ok, "CRC16 of sector " & to_string(s));
+                end loop;
+                command(12, x"0000_0000");
+                spi_read(b); -- stuff byte
+                check_r1(x"00", "CMD12");
+                wait_not_busy;
+                card_stop;
+                -- the card carries on with the next block while CMD12 goes out
+                stat := sd_card_stat(SD_STAT_BLOCKS_READ);
+                check(stat = 4 or stat = 5, "blocks read " & to_string(stat));
+
+            elsif run("write_single") then
+                card_start;
+                command(24, uint2slv(20));
+                check_r1(x"00", "CMD24");
+                spi_write(x"FF");
+                spi_write(x"FE");
+                crc := (others => '0');
+                for i in 0 to 511 loop
+                    b   := uint2slv((255 - i) mod 256, 8);
+                    crc := crc16(b, crc);
+                    spi_write(b);
+                end loop;
+                spi_write(crc(15 downto 8));
+                spi_write(crc(7 downto 0));
+                spi_read(b);
+                check_equal(b(4 downto 0), std_logic_vector'("00101"), "data accepted");
+                wait_not_busy;
+                card_stop;
+                check_equal(sd_card_stat(SD_STAT_BLOCKS_WRITTEN), 1, "blocks written");
+
+                -- and read it back
+                card_start;
+                command(17, uint2slv(20));
+                check_r1(x"00", "CMD17");
+                read_block(20, crc_ok);
+                card_stop;
+                check_equal(sd_card_peek(20 * 512 + 5), 250, "written data");
+
+            elsif run("crc_error_injection") then
+                sd_card_inject(2, -1, 0);
+                for s in 0 to 3 loop
+                    card_start;
+                    command(17, uint2slv(s));
+                    check_r1(x"00", "CMD17");
+                    read_block(s, crc_ok);
+                    card_stop;
+                    check(crc_ok = (s mod 2 = 0), "CRC16 of sector " & to_string(s) & " corrupted on every 2nd block");
+                end loop;
+                check_equal(sd_card_stat(SD_STAT_CRC_ERRORS), 2, "CRC errors injected");
+
+            elsif run("read_error_token") then
+                sd_card_inject(0, 7, 0);
+                card_start;
+                command(17, uint2slv(7));
+                check_r1(x"00", "CMD17");
+                response(b, polls, 10000);
+                check_equal(b, std_logic_vector'(x"04"), "data error token (card ECC failed)");
+                card_stop;
+            end if;
+        end loop;
+        test_runner_cleanup(runner);
+    end process main;
+
+    test_runner_watchdog(runner, 5 ms);
+
+    clk_process : process
+    begin
+        clk <= '1';
+        wait for clk_period/2;
+        clk <= '0';
+        wait for clk_period/2;
+    end process clk_process;
+
+end;
@@ -20,6 +20,7 @@ architecture bench of wb_timer_tb is
     constant clk_period : time := 20 ns;
     -- Generics
     constant G_NUM_TIMERS : integer := 1;
+    constant G_NUM_CMP    : integer := 4;
 
     -- Ports
     signal wb_clk              : std_logic;
@@ -28,6 +29,7 @@ architecture bench of wb_timer_tb is
     signal wb_miso             : t_wb_miso;
     signal pwm_out             : std_logic;
     signal timer_interrupt_out : std_logic_vector(G_NUM_TIMERS - 1 downto 0);
+    signal cmp_interrupt_out   : std_logic_vector(G_NUM_CMP - 1 downto 0);
 
     constant tb_logger     : logger_t := get_logger("tb");
     constant master_logger : logger_t := get_logger("master");
@@ -40,7 +42,8 @@ begin
 
     wb_timer_inst : entity work.wb_timer
         generic map(
-            G_NUM_TIMERS => G_NUM_TIMERS
+            G_NUM_TIMERS => G_NUM_TIMERS,
+            G_NUM_CMP    => G_NUM_CMP
         )
         port map(
             wb_clk              => wb_clk,
@@ -48,7 +51,8 @@ begin
             wb_mosi_in          => wb_mosi,
             wb_miso_out         => wb_miso,
             pwm_out             => pwm_out,
-            timer_interrupt_out => timer_interrupt_out
+            timer_interrupt_out => timer_interrupt_out,
+            cmp_interrupt_out   => cmp_interrupt_out
         );
 
     vunit_wishbone_master_inst : entity vunit_lib.wishbone_master
@@ -85,8 +89,19 @@ begin
         constant CTRL_REG  : std_logic_vector(31 downto 0) := x"0000_0004";
         constant TOP_REG   : std_logic_vector(31 downto 0) := x"0000_0008";
         constant PWM_REG   : std_logic_vector(31 downto 0) := x"0000_000C";
+        constant CTRL_SET_REG    : std_logic_vector(31 downto 0) := x"0000_0010";
+        constant CTRL_CLR_REG    : std_logic_vector(31 downto 0) := x"0000_0014";
+        constant MTIME_LO_REG    : std_logic_vector(31 downto 0) := x"0000_0020";
+        constant MTIME_HI_REG    : std_logic_vector(31 downto 0) := x"0000_0024";
+        constant CMP_STATUS_REG  : std_logic_vector(31 downto 0) := x"0000_0028";
+        constant CMP_IEN_REG     : std_logic_vector(31 downto 0) := x"0000_002C";
+        constant CMP_IEN_SET_REG : std_logic_vector(31 downto 0) := x"0000_0030";
+        constant CMP_IEN_CLR_REG : std_logic_vector(31 downto 0) := x"0000_0034";
+        constant CMP1_LO_REG     : std_logic_vector(31 downto 0) := x"0000_0048";
+        constant CMP1_HI_REG     : std_logic_vector(31 downto 0) := x"0000_004C";
 
         variable rdata : std_logic_vector(31 downto 0);
+        variable rdata_hi : std_logic_vector(31 downto 0);
     begin
         test_runner_setup(runner, runner_cfg);
 
@@ -125,6 +140,61 @@ begin
                 check_equal(rdata, 150+10, "Counter check stopped counting (includes 5 cycles of fudge for wishbone accesses");
                 test_runner_cleanup(runner);
 
+            elsif run("set_clear_test") then
+                info("Enable interrupt and PWM with separate set writes");
+                write_bus(net, bus_handle, CTRL_SET_REG, x"0000_0002");
+                write_bus(net, bus_handle, CTRL_SET_REG, x"0000_0004");
+                read_bus(net, bus_handle, CTRL_REG, rdata);
+                check_equal(rdata, std_logic_vector'(x"0000_0006"), "set leaves other bits alone");
+                write_bus(net, bus_handle, CTRL_CLR_REG, x"0000_0002");
+                read_bus(net, bus_handle, CTRL_REG, rdata);
+                check_equal(rdata, std_logic_vector'(x"0000_0004"), "clear leaves other bits alone");
+                test_runner_cleanup(runner);
+
+            elsif run("mtime_test") then
+                info("mtime runs from reset");
+                read_bus(net, bus_handle, MTIME_LO_REG, rdata);
+                read_bus(net, bus_handle, MTIME_HI_REG, rdata_hi);
+                check(unsigned(rdata) > 0, "mtime counting");
+                check_equal(rdata_hi, std_logic_vector'(x"0000_0000"), "mtime upper half");
+
+                info("Load mtime just below a 32 bit wrap");
+                write_bus(net, bus_handle, MTIME_LO_REG, x"FFFF_FFF0");
+                write_bus(net, bus_handle, MTIME_HI_REG, x"0000_0007");
+                wait for 50 * clk_period;
+                read_bus(net, bus_handle, MTIME_LO_REG, rdata);
+                wait for 20 * clk_period; -- upper half must not change between the reads
+                read_bus(net, bus_handle, MTIME_HI_REG, rdata_hi);
+                check_equal(rdata_hi, std_logic_vector'(x"0000_0008"), "carry into the upper half");
+                check(unsigned(rdata) > 16#20# and unsigned(rdata) < 16#80#, "lower half wrapped");
+                test_runner_cleanup(runner);
+
+            elsif run("compare_test") then
+                info("Compare channel 1 fires 200 clocks from now");
+                read_bus(net, bus_handle, MTIME_LO_REG, rdata);
+                read_bus(net, bus_handle, MTIME_HI_REG, rdata_hi);
+                write_bus(net, bus_handle, CMP1_LO_REG, std_logic_vector(unsigned(rdata) + 200));
+                write_bus(net, bus_handle, CMP1_HI_REG, rdata_hi);
+                write_bus(net, bus_handle, CMP_IEN_SET_REG, x"0000_0002");
+                read_bus(net, bus_handle, CMP_STATUS_REG, rdata);
+                check_equal(rdata, std_logic_vector'(x"0000_0000"), "no channels fired yet");
+                check_equal(cmp_interrupt_out, std_logic_vector'("0000"), "no interrupts yet");
+                wait for 200 * clk_period;
+                read_bus(net, bus_handle, CMP_STATUS_REG, rdata);
+                check_equal(rdata, std_logic_vector'(x"0000_0002"), "channel 1 fired");
+                check_equal(cmp_interrupt_out, std_logic_vector'("0010"), "channel 1 interrupt");
+
+                info("Move the compare out of the way and clear the flag");
+                write_bus(net, bus_handle, CMP1_LO_REG, x"FFFF_FFFF");
+                write_bus(net, bus_handle, CMP1_HI_REG, x"FFFF_FFFF");
+                write_bus(net, bus_handle, CMP_STATUS_REG, x"0000_0002");
+                read_bus(net, bus_handle, CMP_STATUS_REG, rdata);
+                check_equal(rdata, std_logic_vector'(x"0000_0000"), "channel 1 cleared");
+                write_bus(net, bus_handle, CMP_IEN_CLR_REG, x"0000_0002");
+                read_bus(net, bus_handle, CMP_IEN_REG, rdata);
+                check_equal(rdata, std_logic_vector'(x"0000_0000"), "interrupt disabled");
+                test_runner_cleanup(runner);
+
             elsif run("test_0") then
                 info("Hello world test_0");
                 wait for 100 * clk_period;
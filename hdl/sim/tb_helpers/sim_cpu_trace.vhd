@@ -0,0 +1,79 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Logs every instruction retired by cpu_top (from its trace port) to a binary file,
+-- profile it with tools/cpu_trace_profile.py
+--
+-- File format (all integers little endian)
+--   header: "CPUTRC" u8 version (1) u8 reserved
+--   one 16 byte record per instruction:
+--     u32 pc, u32 instruction, u32 load/store address (0 if none),
+--     u32 clocks since the previous instruction retired (ie. what this one cost)
+entity sim_cpu_trace is
+    generic(
+        G_PROJECT_ROOT : string := "";
+        G_LOG_NAME : string := "sim_cpu_trace.bin"
+    );
+    port(
+        clk : in std_logic;
+
+        trace_valid_in    : in std_logic;
+        trace_pc_in       : in std_logic_vector(31 downto 0);
+        trace_instr_in    : in std_logic_vector(31 downto 0);
+        trace_mem_addr_in : in std_logic_vector(31 downto 0);
+        trace_cycle_in    : in std_logic_vector(63 downto 0)
+    );
+end entity sim_cpu_trace;
+
+architecture RTL of sim_cpu_trace is
+    constant LOG_FILE_NAME : string := G_PROJECT_ROOT & G_LOG_NAME;
+
+    type t_byte_file is file of character; -- one byte per character
+begin
+
+    log_process : process(clk) is
+        file logfile : t_byte_file open WRITE_MODE is LOG_FILE_NAME;
+        variable header_done : boolean := false;
+        variable last_cycle  : unsigned(63 downto 0) := (others => '0');
+        variable delta       : unsigned(63 downto 0);
+
+        procedure put_u32(v : std_logic_vector(31 downto 0)) is
+            variable u : unsigned(31 downto 0);
+        begin
+            u := to_01(unsigned(v));
+            for i in 0 to 3 loop
+                write(logfile, character'val(to_integer(u(8 * i + 7 downto 8 * i))));
+            end loop;
+        end procedure;
+
+        constant MAGIC : string := "CPUTRC";
+    begin
+        if rising_edge(clk) then
+            if not header_done then
+                for i in MAGIC'range loop
+                    write(logfile, MAGIC(i));
+                end loop;
+                write(logfile, character'val(1)); -- version
+                write(logfile, character'val(0));
+                header_done := true;
+            end if;
+
+            if trace_valid_in = '1' then
+                if to_01(unsigned(trace_cycle_in)) < last_cycle then
+                    last_cycle := (others => '0'); -- CPU was reset
+                end if;
+                delta := to_01(unsigned(trace_cycle_in)) - last_cycle;
+                if delta > x"0000_0000_FFFF_FFFF" then
+                    delta := x"0000_0000_FFFF_FFFF";
+                end if;
+                put_u32(trace_pc_in);
+                put_u32(trace_instr_in);
+                put_u32(trace_mem_addr_in);
+                put_u32(std_logic_vector(delta(31 downto 0)));
+                last_cycle := to_01(unsigned(trace_cycle_in));
+            end if;
+        end if;
+    end process;
+
+end architecture RTL;
@@ -0,0 +1,64 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.sim_sd_card_pkg.all;
+
+-- SD card on SPI (mode 0), backed by the C model through sim_sd_card_pkg
+--
+-- Bytes go to and from the model whole: the next MISO byte is fetched on the falling SCK edge
+-- that ends the previous byte (or when CSn falls), so its MSB is ready before the first rising
+-- edge, and the MOSI byte is handed over on its 8th rising edge. The model is told the
+-- simulation time with each, which is what its Nac and busy latencies are measured in.
+entity sim_sd_card is
+    port (
+        sck_in   : in std_logic;
+        cs_n_in  : in std_logic;
+        mosi_in  : in std_logic;
+        miso_out : out std_logic := '1'
+    );
+end entity;
+
+architecture behavioral of sim_sd_card is
+begin
+
+    process (sck_in, cs_n_in) is
+        variable count : integer range 0 to 8 := 0;
+        variable rx    : std_logic_vector(7 downto 0);
+        variable tx    : std_logic_vector(7 downto 0) := x"FF";
+
+        impure function now_ns return integer is
+        begin
+            return now / 1 ns;
+        end function;
+    begin
+        if cs_n_in'event and (cs_n_in = '0' or cs_n_in = '1') then
+            count := 0;
+            if cs_n_in = '0' then
+                sd_card_select(0);
+                tx       := std_logic_vector(to_unsigned(sd_card_output(now_ns), 8));
+                miso_out <= tx(7);
+            else
+                sd_card_select(1);
+                miso_out <= '1'; -- pulled up while the card is not driving it
+            end if;
+        elsif cs_n_in = '0' then
+            if rising_edge(sck_in) then
+                rx    := rx(6 downto 0) & mosi_in;
+                count := count + 1;
+                if count = 8 then
+                    sd_card_input(to_integer(unsigned(rx)), now_ns);
+                end if;
+            elsif falling_edge(sck_in) then
+                if count = 8 then
+                    count := 0;
+                    tx    := std_logic_vector(to_unsigned(sd_card_output(now_ns), 8));
+                else
+                    tx := tx(6 downto 0) & '1';
+                end if;
+                miso_out <= tx(7);
+            end if;
+        end if;
+    end process;
+
+end architecture;
@@ -0,0 +1,440 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- SD card on the native bus (CLK, CMD, DAT[3:0]), behavioural, for tb_wb_sd_host
+--
+-- An SDHC card (block addressed) of G_BLOCKS blocks, byte i of which starts out as
+-- (i * 7 + i / 512) mod 256. Like a real card it samples on the rising edge of CLK and drives
+-- on the falling edge, so stopping the clock pauses it.
+--
+-- Commands: CMD0, 2, 3, 6 (64 byte switch status), 7, 8, 12, 13, 16, 17, 18, 24, 25, 55 and
+-- ACMD6, 41. Commands with a bad CRC7 are ignored, as are unsupported ones. Write blocks with a
+-- bad CRC16 get a "101" CRC status and are not written.
+entity sim_sd_card_native is
+    generic (
+        G_BLOCKS      : integer := 64;
+        G_NAC_CLOCKS  : integer := 8;  -- from a read command, or the end of the last block, to the next block
+        G_BUSY_CLOCKS : integer := 16  -- after each write block and for R1b responses
+    );
+    port (
+        clk_in : in std_logic;
+        cmd_io : inout std_logic                    := 'Z';
+        dat_io : inout std_logic_vector(3 downto 0) := (others => 'Z');
+
+        corrupt_crc_in : in std_logic := '0'; -- send read blocks with a bad CRC16 on DAT0
+
+        blocks_read_out    : out integer := 0;
+        blocks_written_out : out integer := 0
+    );
+end entity;
+
+architecture behavioral of sim_sd_card_native is
+    constant RCA : std_logic_vector(15 downto 0) := x"1234";
+    constant CID : std_logic_vector(119 downto 0) := x"03_5344_5346504341_80_00002A01_014A"; -- before the CRC7
+
+    -- card states, as in the CURRENT_STATE field of the card status
+    constant ST_IDLE  : integer := 0;
+    constant ST_READY : integer := 1;
+    constant ST_IDENT : integer := 2;
+    constant ST_STBY  : integer := 3;
+    constant ST_TRAN  : integer := 4;
+    constant ST_DATA  : integer := 5;
+    constant ST_RCV   : integer := 6;
+    constant ST_PRG   : integer := 7;
+
+    type t_bytes is array (natural range <>) of std_logic_vector(7 downto 0);
+    type t_crc_arr is array (0 to 3) of std_logic_vector(15 downto 0);
+
+    function crc7(v : std_logic_vector) return std_logic_vector is
+        variable c : std_logic_vector(6 downto 0) := (others => '0');
+        variable f : std_logic;
+    begin
+        for i in v'range loop
+            f := c(6) xor v(i);
+            c := c(5 downto 0) & '0';
+            if f = '1' then
+                c := c xor "0001001";
+            end if;
+        end loop;
+        return c;
+    end function;
+
+    function crc16_bit(c : std_logic_vector(15 downto 0); b : std_logic) return std_logic_vector is
+        variable r : std_logic_vector(15 downto 0) := c(14 downto 0) & '0';
+    begin
+        if (c(15) xor b) = '1' then
+            r := r xor x"1021";
+        end if;
+        return r;
+    end function;
+
+    function init_mem return t_bytes is
+        variable m : t_bytes(0 to G_BLOCKS * 512 - 1);
+    begin
+        for i in m'range loop
+            m(i) := std_logic_vector(to_unsigned((i * 7 + i / 512) mod 256, 8));
+        end loop;
+        return m;
+    end function;
+
+    -- the bits a data clock carries on each line, MSB first: a nibble on DAT[3:0] or a bit on DAT0
+    function data_bits(buf : t_bytes; clk : integer; wide : boolean) return std_logic_vector is
+        variable b : std_logic_vector(7 downto 0);
+    begin
+        if wide then
+            b := buf(clk / 2);
+            if clk mod 2 = 0 then
+                return b(7 downto 4);
+            end if;
+            return b(3 downto 0);
+        end if;
+        b := buf(clk / 8);
+        return "ZZZ" & b(7 - clk mod 8);
+    end function;
+begin
+
+    process (clk_in) is
+        variable mem : t_bytes(0 to G_BLOCKS * 512 - 1) := init_mem;
+
+        variable state     : integer := ST_IDLE;
+        variable app_cmd   : boolean := false;
+        variable acmd41    : integer := 0;
+        variable wide      : boolean := false;
+        variable nlines    : integer := 1;
+        variable blocks_rd : integer := 0;
+        variable blocks_wr : integer := 0;
+
+        -- CMD line
+        variable rx      : std_logic_vector(47 downto 0);
+        variable rx_bits : integer := 0;
+        variable tx      : std_logic_vector(135 downto 0);
+        variable tx_len  : integer := 0; -- bits still to send
+        variable tx_wait : integer := 0; -- falls before the first
+        variable r1b     : integer := 0; -- busy clocks to signal once the response is out
+
+        -- read
+        variable rd_on    : boolean := false;
+        variable rd_multi : boolean;
+        variable rd_addr  : integer;
+        variable rd_len   : integer;
+        variable rd_wait  : integer;
+        variable rd_clk   : integer;
+        variable rd_buf   : t_bytes(0 to 511);
+        variable rd_crc   : t_crc_arr;
+        variable rd_clks  : integer;
+
+        -- write
+        variable wr_on     : boolean := false;
+        variable wr_multi  : boolean;
+        variable wr_addr   : integer;
+        variable wr_phase  : integer := 0; -- 0 start bit, 1 data, 2 CRC16, 3 end bit, 4 CRC status and busy
+        variable wr_clk    : integer;
+        variable wr_buf    : t_bytes(0 to 511);
+        variable wr_crc    : t_crc_arr;
+        variable wr_ok     : boolean;
+        variable wr_status : std_logic_vector(4 downto 0);
+
+        variable d     : std_logic_vector(3 downto 0);
+        variable bits  : std_logic_vector(3 downto 0);
+        variable index : integer;
+        variable arg   : std_logic_vector(31 downto 0);
+        variable frame : std_logic_vector(39 downto 0);
+
+        impure function card_status return std_logic_vector is
+            variable s : std_logic_vector(31 downto 0) := (others => '0');
+        begin
+            s(12 downto 9) := std_logic_vector(to_unsigned(state, 4));
+            s(8)           := '1'; -- READY_FOR_DATA
+            if app_cmd then
+                s(5) := '1';
+            end if;
+            return s;
+        end function;
+
+        procedure respond_48(idx : std_logic_vector(5 downto 0); payload : std_logic_vector(31 downto 0); with_crc : boolean) is
+        begin
+            frame := "00" & idx & payload;
+            if with_crc then
+                tx(135 downto 88) := frame & crc7(frame) & '1';
+            else
+                tx(135 downto 88) := frame & "1111111" & '1';
+            end if;
+            tx_len  := 48;
+            tx_wait := 1;
+        end procedure;
+
+        procedure start_read(addr, len : integer; multi : boolean) is
+        begin
+            rd_on    := true;
+            rd_addr  := addr;
+            rd_len   := len;
+            rd_multi := multi;
+            rd_wait  := G_NAC_CLOCKS;
+            rd_clk   := -1;
+        end procedure;
+    begin
+        if rising_edge(clk_in) then
+            -------------------------------------------------------------------
+            -- command in
+            -------------------------------------------------------------------
+            if tx_len = 0 then
+                if rx_bits /= 0 or to_x01(cmd_io) = '0' then
+                    rx      := rx(46 downto 0) & to_x01(cmd_io);
+                    rx_bits := rx_bits + 1;
+                end if;
+            end if;
+            if rx_bits = 48 then
+                rx_bits := 0;
+                index   := to_integer(unsigned(rx(45 downto 40)));
+                arg     := rx(39 downto 8);
+                if rx(46) /= '1' or crc7(rx(47 downto 8)) /= rx(7 downto 1) or rx(0) /= '1' then
+                    report "sim_sd_card_native: bad CRC7 on CMD" & integer'image(index) severity note;
+                elsif app_cmd and (index = 6 or index = 41) then
+                    app_cmd := false;
+                    if index = 6 then
+                        wide   := arg(1 downto 0) = "10";
+                        nlines := 4 when wide else 1;
+                        respond_48(rx(45 downto 40), card_status, true);
+                    else
+                        acmd41 := acmd41 + 1;
+                        -- busy for the first one, then ready (power up done) with CCS (SDHC)
+                        if acmd41 >= 2 then
+                            state := ST_READY;
+                            respond_48("111111", x"C0FF_8000", false);
+                        else
+                            respond_48("111111", x"40FF_8000", false);
+                        end if;
+                    end if;
+                else
+                    app_cmd := false;
+                    case index is
+                        when 0 =>
+                            state  := ST_IDLE;
+                            acmd41 := 0;
+                            wide   := false;
+                            nlines := 1;
+                            rd_on  := false;
+                            wr_on  := false;
+                        when 2 =>
+                            tx      := "00" & "111111" & CID & crc7(CID) & '1';
+                            tx_len  := 136;
+                            tx_wait := 1;
+                            state   := ST_IDENT;
+                        when 3 =>
+                            state := ST_STBY;
+                            respond_48(rx(45 downto 40), RCA & "000" & std_logic_vector(to_unsigned(state, 4)) & '1' & x"00", true);
+                        when 6 =>
+                            respond_48(rx(45 downto 40), card_status, true);
+                            -- switch status: group 1 supports default and high speed, and
+                            -- selects what was asked for
+                            rd_buf          := (others => x"00");
+                            rd_buf(0 to 1)  := (x"00", x"64");
+                            rd_buf(12 to 13) := (x"80", x"03");
+                            rd_buf(16)      := "0000" & arg(3 downto 0);
+                            start_read(0, 64, false);
+                        when 7 =>
+                            if arg(31 downto 16) = RCA then
+                                respond_48(rx(45 downto 40), card_status, true);
+                                state := ST_TRAN;
+                                r1b   := G_BUSY_CLOCKS;
+                            else
+                                state := ST_STBY;
+                            end if;
+                        when 8 =>
+                            respond_48(rx(45 downto 40), x"00000" & arg(11 downto 0), true);
+                        when 12 =>
+                            respond_48(rx(45 downto 40), card_status, true);
+                            rd_on := false;
+                            wr_on := false;
+                            state := ST_TRAN;
+                            r1b   := G_BUSY_CLOCKS;
+                        when 13 | 16 =>
+                            respond_48(rx(45 downto 40), card_status, true);
+                        when 17 | 18 =>
+                            respond_48(rx(45 downto 40), card_status, true);
+                            state := ST_DATA;
+                            start_read((to_integer(unsigned(arg(15 downto 0))) mod G_BLOCKS) * 512, 512, index = 18);
+                        when 24 | 25 =>
+                            respond_48(rx(45 downto 40), card_status, true);
+                            state    := ST_RCV;
+                            wr_on    := true;
+                            wr_multi := index = 25;
+                            wr_addr  := (to_integer(unsigned(arg(15 downto 0))) mod G_BLOCKS) * 512;
+                            wr_phase := 0;
+                        when 55 =>
+                            app_cmd := true;
+                            respond_48(rx(45 downto 40), card_status, true);
+                        when others =>
+                            report "sim_sd_card_native: CMD" & integer'image(index) & " not supported" severity note;
+                    end case;
+                end if;
+            end if;
+
+            -------------------------------------------------------------------
+            -- write data in
+            -------------------------------------------------------------------
+            if wr_on then
+                case wr_phase is
+                    when 0 =>
+                        if to_x01(dat_io(0)) = '0' then
+                            wr_crc   := (others => (others => '0'));
+                            wr_clk   := 0;
+                            wr_phase := 1;
+                        end if;
+                    when 1 =>
+                        bits := to_x01(dat_io);
+                        for i in 0 to 3 loop
+                            if i < nlines then
+                                wr_crc(i) := crc16_bit(wr_crc(i), bits(i));
+                            end if;
+                        end loop;
+                        if wide then
+                            if wr_clk mod 2 = 0 then
+                                wr_buf(wr_clk / 2)(7 downto 4) := bits;
+                            else
+                                wr_buf(wr_clk / 2)(3 downto 0) := bits;
+                            end if;
+                        else
+                            wr_buf(wr_clk / 8)(7 - wr_clk mod 8) := bits(0);
+                        end if;
+                        wr_clk := wr_clk + 1;
+                        if (wide and wr_clk = 1024) or (not wide and wr_clk = 4096) then
+                            wr_clk   := 0;
+                            wr_ok    := true;
+                            wr_phase := 2;
+                        end if;
+                    when 2 =>
+                        bits := to_x01(dat_io);
+                        for i in 0 to 3 loop
+                            if i < nlines then
+                                if bits(i) /= wr_crc(i)(15) then
+                                    wr_ok := false;
+                                end if;
+                                wr_crc(i) := wr_crc(i)(14 downto 0) & '0';
+                            end if;
+                        end loop;
+                        wr_clk := wr_clk + 1;
+                        if wr_clk = 16 then
+                            wr_phase := 3;
+                        end if;
+                    when 3 =>
+                        if to_x01(dat_io(0)) /= '1' then
+                            wr_ok := false;
+                        end if;
+                        if wr_ok then
+                            wr_status := "00101";
+                        else
+                            wr_status := "01011";
+                        end if;
+                        wr_clk    := 0;
+                        wr_phase  := 4;
+                    when others =>
+                        null;
+                end case;
+            end if;
+        end if;
+
+        if falling_edge(clk_in) then
+            d := "ZZZZ";
+
+            -------------------------------------------------------------------
+            -- response out
+            -------------------------------------------------------------------
+            if tx_len /= 0 then
+                if tx_wait /= 0 then
+                    tx_wait := tx_wait - 1;
+                    cmd_io  <= 'Z';
+                else
+                    cmd_io <= tx(135);
+                    tx     := tx(134 downto 0) & '1';
+                    tx_len := tx_len - 1;
+                end if;
+            else
+                cmd_io <= 'Z';
+                if r1b /= 0 then
+                    d(0) := '0';
+                    r1b  := r1b - 1;
+                end if;
+            end if;
+
+            -------------------------------------------------------------------
+            -- read data out
+            -------------------------------------------------------------------
+            if rd_on then
+                rd_clks := rd_len * 8 / nlines;
+                if rd_wait /= 0 then
+                    rd_wait := rd_wait - 1;
+                elsif rd_clk = -1 then
+                    if rd_len = 512 then
+                        rd_buf := mem(rd_addr to rd_addr + 511);
+                    end if;
+                    rd_crc := (others => (others => '0'));
+                    d      := "0000" when wide else "ZZZ0";
+                    rd_clk := 0;
+                elsif rd_clk < rd_clks then
+                    d := data_bits(rd_buf, rd_clk, wide);
+                    for i in 0 to 3 loop
+                        if i < nlines then
+                            rd_crc(i) := crc16_bit(rd_crc(i), d(i));
+                        end if;
+                    end loop;
+                    rd_clk := rd_clk + 1;
+                elsif rd_clk < rd_clks + 16 then
+                    for i in 0 to 3 loop
+                        if i < nlines then
+                            d(i)      := rd_crc(i)(15);
+                            rd_crc(i) := rd_crc(i)(14 downto 0) & '0';
+                        end if;
+                    end loop;
+                    if rd_clk = rd_clks and corrupt_crc_in = '1' then
+                        d(0) := not d(0);
+                    end if;
+                    rd_clk := rd_clk + 1;
+                elsif rd_clk = rd_clks + 16 then
+                    d      := "1111" when wide else "ZZZ1";
+                    rd_clk := rd_clk + 1;
+                else
+                    blocks_rd := blocks_rd + 1;
+                    rd_addr   := (rd_addr + 512) mod (G_BLOCKS * 512);
+                    rd_wait   := G_NAC_CLOCKS - 1;
+                    rd_clk    := -1;
+                    if not rd_multi then
+                        rd_on := false;
+                        state := ST_TRAN;
+                    end if;
+                end if;
+            end if;
+
+            -------------------------------------------------------------------
+            -- write CRC status and busy
+            -------------------------------------------------------------------
+            if wr_on and wr_phase = 4 then
+                -- one clock for the host to let go of the lines, the status, then busy
+                if wr_clk >= 1 and wr_clk <= 5 then
+                    d(0) := wr_status(5 - wr_clk);
+                elsif wr_clk > 5 and wr_clk <= 5 + G_BUSY_CLOCKS then
+                    d(0) := '0';
+                end if;
+                wr_clk := wr_clk + 1;
+                if wr_clk > 6 + G_BUSY_CLOCKS or (wr_clk > 6 and not wr_ok) then
+                    if wr_ok then
+                        mem(wr_addr to wr_addr + 511) := wr_buf;
+                        blocks_wr                     := blocks_wr + 1;
+                        wr_addr                       := (wr_addr + 512) mod (G_BLOCKS * 512);
+                    end if;
+                    wr_phase := 0;
+                    if not wr_multi or not wr_ok then
+                        wr_on := false;
+                        state := ST_TRAN;
+                    end if;
+                end if;
+            end if;
+
+            dat_io             <= d;
+            blocks_read_out    <= blocks_rd;
+            blocks_written_out <= blocks_wr;
+        end if;
+    end process;
+
+end architecture;
@@ -0,0 +1,82 @@
+-- Foreign (VHPIDIRECT) interface to the SD card model in software/src/hosted/sd_card_model.c,
+-- through tb_helpers/sim_sd_card_vhpi.c. run.py builds libsd_card_model.so and puts it on
+-- LD_LIBRARY_PATH, so only testbenches that call these need it.
+--
+-- GHDL needs a body for each foreign subprogram, but never runs it.
+package sim_sd_card_pkg is
+
+    -- (re)load the card image and set its latencies
+    procedure sd_card_init(nac_us, stream_nac_us, busy_us, write_busy_us, init_us : integer);
+    attribute foreign of sd_card_init : procedure is "VHPIDIRECT libsd_card_model.so sd_vhpi_init";
+
+    -- error injection, read_error_sector < 0 for none
+    procedure sd_card_inject(crc_error_every, read_error_sector, write_protect : integer);
+    attribute foreign of sd_card_inject : procedure is "VHPIDIRECT libsd_card_model.so sd_vhpi_inject";
+
+    procedure sd_card_select(cs_n : integer);
+    attribute foreign of sd_card_select : procedure is "VHPIDIRECT libsd_card_model.so sd_vhpi_select";
+
+    -- next byte to send on MISO, and the byte received on MOSI
+    impure function sd_card_output(now_ns : integer) return integer;
+    attribute foreign of sd_card_output : function is "VHPIDIRECT libsd_card_model.so sd_vhpi_output";
+
+    procedure sd_card_input(mosi, now_ns : integer);
+    attribute foreign of sd_card_input : procedure is "VHPIDIRECT libsd_card_model.so sd_vhpi_input";
+
+    -- byte of the image
+    impure function sd_card_peek(addr : integer) return integer;
+    attribute foreign of sd_card_peek : function is "VHPIDIRECT libsd_card_model.so sd_vhpi_peek";
+
+    -- statistics
+    constant SD_STAT_COMMANDS       : integer := 0;
+    constant SD_STAT_BLOCKS_READ    : integer := 1;
+    constant SD_STAT_BLOCKS_WRITTEN : integer := 2;
+    constant SD_STAT_CRC_ERRORS     : integer := 3;
+    constant SD_STAT_NAC_BYTES      : integer := 4;
+    constant SD_STAT_BUSY_BYTES     : integer := 5;
+    impure function sd_card_stat(which : integer) return integer;
+    attribute foreign of sd_card_stat : function is "VHPIDIRECT libsd_card_model.so sd_vhpi_stat";
+
+end package;
+
+package body sim_sd_card_pkg is
+
+    procedure sd_card_init(nac_us, stream_nac_us, busy_us, write_busy_us, init_us : integer) is
+    begin
+        assert false report "VHPIDIRECT sd_card_init" severity failure;
+    end procedure;
+
+    procedure sd_card_inject(crc_error_every, read_error_sector, write_protect : integer) is
+    begin
+        assert false report "VHPIDIRECT sd_card_inject" severity failure;
+    end procedure;
+
+    procedure sd_card_select(cs_n : integer) is
+    begin
+        assert false report "VHPIDIRECT sd_card_select" severity failure;
+    end procedure;
+
+    impure function sd_card_output(now_ns : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT sd_card_output" severity failure;
+        return 0;
+    end function;
+
+    procedure sd_card_input(mosi, now_ns : integer) is
+    begin
+        assert false report "VHPIDIRECT sd_card_input" severity failure;
+    end procedure;
+
+    impure function sd_card_peek(addr : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT sd_card_peek" severity failure;
+        return 0;
+    end function;
+
+    impure function sd_card_stat(which : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT sd_card_stat" severity failure;
+        return 0;
+    end function;
+
+end package body;
@@ -0,0 +1,73 @@
+/*
+ *  VHPIDIRECT bridge from sim_sd_card.vhd to the SD card model of the hosted firmware build
+ *  (software/src/hosted/sd_card_model.c), so the testbenches and `make hosted` share one card.
+
+    run.py builds this as libsd_card_model.so and adds its directory to LD_LIBRARY_PATH. The
+    image is the file in $SD_CARD_IMAGE if set, otherwise SD_VHPI_SECTORS of a fixed pattern.
+    All arguments are VHDL integers (int32), times are simulation time in ns.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sd_card_model.h"
+
+#define SD_VHPI_SECTORS 2048 // 1MB
+
+static struct sd_card card;
+
+void sd_vhpi_init(int32_t nac_us, int32_t stream_nac_us, int32_t busy_us, int32_t write_busy_us, int32_t init_us){
+    const char *path = getenv("SD_CARD_IMAGE");
+    if (card.image){
+        free(card.image);
+    }
+    if (!path || sd_card_load(&card, path)){
+        u8 *image = malloc(SD_VHPI_SECTORS * 512);
+        for (u32 i = 0; i < SD_VHPI_SECTORS * 512; i++){
+            image[i] = i * 7 + (i >> 9);
+        }
+        sd_card_init(&card, image, SD_VHPI_SECTORS);
+    }
+    card.nac_us = nac_us;
+    card.stream_nac_us = stream_nac_us;
+    card.busy_us = busy_us;
+    card.write_busy_us = write_busy_us;
+    card.init_us = init_us;
+}
+
+void sd_vhpi_inject(int32_t crc_error_every, int32_t read_error_sector, int32_t write_protect){
+    card.crc_error_every = crc_error_every;
+    card.read_error_sector = read_error_sector < 0 ? SD_MODEL_NO_SECTOR : (u32)read_error_sector;
+    card.write_protect = write_protect;
+}
+
+void sd_vhpi_select(int32_t cs_n){
+    sd_card_select(&card, cs_n);
+}
+
+int32_t sd_vhpi_output(int32_t now_ns){
+    card.now_ns = (u32)now_ns;
+    return sd_card_output(&card);
+}
+
+void sd_vhpi_input(int32_t mosi, int32_t now_ns){
+    card.now_ns = (u32)now_ns;
+    sd_card_input(&card, mosi);
+}
+
+// a byte of the image, to check reads and writes against
+int32_t sd_vhpi_peek(int32_t addr){
+    return (u32)addr < card.sectors * 512 ? card.image[addr] : -1;
+}
+
+// statistics, in the order of struct sd_card
+int32_t sd_vhpi_stat(int32_t which){
+    switch (which){
+    case 0: return card.commands;
+    case 1: return card.blocks_read;
+    case 2: return card.blocks_written;
+    case 3: return card.crc_errors_injected;
+    case 4: return card.nac_bytes;
+    case 5: return card.busy_bytes;
+    }
+    return -1;
+}
@@ -2,13 +2,22 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
-use std.textio.all;
-use ieee.std_logic_textio.all;
-
+-- Logs the visible pixels of a VGA style video stream to a compact binary file,
+-- convert with tools/vga_log_to_bmp.py
+--
+-- File format (all integers little endian)
+--   header: "VGALOG" u8 version (1) u8 flags ([0] RLE)
+--   records:
+--     'F'                            VSYNC, starts the next frame
+--     'L' u16 n, n * (R G B)         one line of raw pixels
+--     'R' u16 n, runs of (u8 len, R G B) covering n pixels
+--                                    one run length encoded line (G_RLE)
+-- Lines are written on each HSYNC, lines with no visible pixels are skipped.
 entity sim_vga_log is
     generic(
         G_PROJECT_ROOT : string := "";
-        G_LOG_NAME : string := "sim_vga_log.txt"
+        G_LOG_NAME : string := "sim_vga_log.bin";
+        G_RLE : boolean := true -- run length encode lines, much smaller for test patterns and text
     );
     port(
         pixelclk : in std_logic;
@@ -20,17 +29,21 @@ entity sim_vga_log is
         blank : in std_logic;
         hsync : in std_logic;
         vsync : in std_logic
-        
+
     );
 end entity sim_vga_log;
 
 architecture RTL of sim_vga_log is
     constant LOG_FILE_NAME : string := G_PROJECT_ROOT & G_LOG_NAME;
+    constant MAX_LINE : integer := 4096;
     signal hsync_d1 : std_logic:='0';
     signal vsync_d1 : std_logic:='0';
-    
+
     signal hsync_edge : std_logic;
     signal vsync_edge : std_logic;
+
+    type t_byte_file is file of character; -- one byte per character
+    type t_line_buf is array (0 to MAX_LINE - 1) of std_logic_vector(23 downto 0);
 begin
 
     -- this works for all sync polarities, as there will always be a rising edge
@@ -43,42 +56,100 @@ begin
     end process;
     hsync_edge <= hsync and not hsync_d1;
     vsync_edge <= vsync and not vsync_d1;
-    
+
 
     log_process : process(pixelclk) is
-        file logfile : text open WRITE_MODE is LOG_FILE_NAME;
-        variable log_ln : line;
+        file logfile : t_byte_file open WRITE_MODE is LOG_FILE_NAME;
+        variable header_done : boolean := false;
+        variable line_buf : t_line_buf;
+        variable line_len : natural := 0;
+
+        procedure put(b : integer) is
+        begin
+            write(logfile, character'val(b));
+        end procedure;
+
+        procedure put_u16(v : integer) is
+        begin
+            put(v mod 256);
+            put(v / 256);
+        end procedure;
 
-        procedure write_pixel(ln : inout line) is
+        procedure put_rgb(rgb : std_logic_vector(23 downto 0)) is
         begin
-            write(ln, to_hstring(red));
-            write(ln, string'(" "));
-            write(ln, to_hstring(green));
-            write(ln, string'(" "));
-            write(ln, to_hstring(blue));
-            write(ln, string'(", "));
+            put(to_integer(to_01(unsigned(rgb(23 downto 16)))));
+            put(to_integer(to_01(unsigned(rgb(15 downto 8)))));
+            put(to_integer(to_01(unsigned(rgb(7 downto 0)))));
         end procedure;
+
+        procedure flush_line is
+            variable i   : natural;
+            variable run : natural;
+        begin
+            if line_len = 0 then
+                return;
+            end if;
+            if G_RLE then
+                put(character'pos('R'));
+                put_u16(line_len);
+                i := 0;
+                while i < line_len loop
+                    run := 1;
+                    while i + run < line_len and run < 255 and line_buf(i + run) = line_buf(i) loop
+                        run := run + 1;
+                    end loop;
+                    put(run);
+                    put_rgb(line_buf(i));
+                    i := i + run;
+                end loop;
+            else
+                put(character'pos('L'));
+                put_u16(line_len);
+                for i in 0 to line_len - 1 loop
+                    put_rgb(line_buf(i));
+                end loop;
+            end if;
+            line_len := 0;
+        end procedure;
+
+        constant MAGIC : string := "VGALOG";
     begin
         if rising_edge(pixelclk) then
+            if not header_done then
+                for i in MAGIC'range loop
+                    put(character'pos(MAGIC(i)));
+                end loop;
+                put(1); -- version
+                if G_RLE then
+                    put(1);
+                else
+                    put(0);
+                end if;
+                header_done := true;
+            end if;
+
             if not blank then
-                write_pixel(log_ln);
+                if line_len < MAX_LINE then
+                    line_buf(line_len) := red & green & blue;
+                    line_len := line_len + 1;
+                end if;
             end if;
 
             if hsync_edge then
                 -- report "HSYNC";
-                writeline(logfile, log_ln);
+                flush_line;
             end if;
 
             if vsync_edge then
                 -- report "VSYNC";
-                write(log_ln, string'("VSYNC"));
-                writeline(logfile, log_ln);
+                flush_line;
+                put(character'pos('F'));
             end if;
-            
+
 
         end if;
     end process;
-    
+
 
 
 end architecture RTL;
@@ -43,7 +43,10 @@ entity cpu_control is
 
         -- Misc
         cpu_err_out    : out std_logic;
-        extern_halt_in : in std_logic := '0'
+        extern_halt_in : in std_logic := '0';
+
+        -- pulses for one cycle when an instruction completes, for tracing
+        instr_retire_out : out std_logic
     );
 end entity cpu_control;
 
@@ -75,12 +78,14 @@ begin
                 mem_req_out       <= '0';
                 write_reg_we_out  <= '0';
                 branch_en_reg_out <= '0';
+                instr_retire_out  <= '0';
             else
                 if extern_halt_in = '0' then -- If we are not halted (by an external debugger etc)
                     -- defaults
                     cpu_err_out      <= '0';
                     alu_en_out       <= '0';
                     write_reg_we_out <= '0';
+                    instr_retire_out <= '0';
                     case state is
                         when RESET_s =>
                             state <= INIT;
@@ -116,8 +121,9 @@ begin
                                     state            <= WRITEBACK;
                                     write_reg_we_out <= '1';
                                 else
-                                    state         <= FETCH;
-                                    fetch_req_out <= '1';
+                                    state            <= FETCH;
+                                    fetch_req_out    <= '1';
+                                    instr_retire_out <= '1';
                                 end if;
                             end if;
                             if alu_err_in = '1' then
@@ -137,8 +143,9 @@ begin
                                     state            <= WRITEBACK;
                                     write_reg_we_out <= '1';
                                 else
-                                    state         <= FETCH;
-                                    fetch_req_out <= '1';
+                                    state            <= FETCH;
+                                    fetch_req_out    <= '1';
+                                    instr_retire_out <= '1';
                                 end if;
                             end if;
                             if addr_align_err_in = '1' then
@@ -150,8 +157,9 @@ begin
                                 error_status <= MEM_ERR;
                             end if;
                         when WRITEBACK =>
-                            state         <= FETCH;
-                            fetch_req_out <= '1';
+                            state            <= FETCH;
+                            fetch_req_out    <= '1';
+                            instr_retire_out <= '1';
                         when ERROR =>
                             cpu_err_out   <= '1';
                             fetch_req_out <= '0';
@@ -24,7 +24,15 @@ entity cpu_top is
 
         -- Memory Wishbone Master
         mem_wb_mosi_out : out t_wb_mosi;
-        mem_wb_miso_in  : in t_wb_miso
+        mem_wb_miso_in  : in t_wb_miso;
+
+        -- Trace port (simulation/debug only, leave open to have it optimised away)
+        -- valid pulses for one cycle as each instruction retires
+        trace_valid_out    : out std_logic;
+        trace_pc_out       : out std_logic_vector(31 downto 0);
+        trace_instr_out    : out std_logic_vector(31 downto 0);
+        trace_mem_addr_out : out std_logic_vector(31 downto 0); -- load/store address, 0 if none
+        trace_cycle_out    : out std_logic_vector(63 downto 0)  -- clocks since reset
 
     );
 end entity cpu_top;
@@ -78,6 +86,9 @@ architecture rtl of cpu_top is
     signal mem_err        : std_logic;
     signal mem_done       : std_logic;
 
+    signal instr_retire : std_logic;
+    signal cycle_count  : unsigned(63 downto 0) := (others => '0');
+
     attribute mark_debug                   : boolean;
     attribute mark_debug of current_pc     : signal is true;
     attribute mark_debug of current_instr  : signal is true;
@@ -88,6 +99,25 @@ architecture rtl of cpu_top is
 
 begin
 
+    -- the PC, instruction and ALU result all still belong to the retiring instruction
+    -- in the cycle instr_retire is high, as the next fetch has only just been requested
+    trace_valid_out    <= instr_retire;
+    trace_pc_out       <= current_pc;
+    trace_instr_out    <= current_instr;
+    trace_mem_addr_out <= alu_output when uses_mem_access = '1' else (others => '0');
+    trace_cycle_out    <= std_logic_vector(cycle_count);
+
+    cycle_count_proc : process (clk) is
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                cycle_count <= (others => '0');
+            else
+                cycle_count <= cycle_count + 1;
+            end if;
+        end if;
+    end process;
+
     cpu_instr_fetch_inst : entity work.cpu_instr_fetch
         generic map(
             G_PC_RESET_ADDR => G_PC_RESET_ADDR
@@ -207,6 +237,7 @@ begin
             mem_done_in        => mem_done,
             write_reg_we_out   => write_reg_we,
             cpu_err_out        => cpu_err_out,
-            extern_halt_in     => extern_halt_in
+            extern_halt_in     => extern_halt_in,
+            instr_retire_out   => instr_retire
         );
 end architecture;
\ No newline at end of file
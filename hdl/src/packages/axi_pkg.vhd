@@ -141,6 +141,73 @@ package axi_pkg is
         wready  : std_logic;
     end record;
 
+    -- AXI4 with no IDs (eg. Xilinx JTAG-AXI master), bursts of up to 256 beats
+    type t_axi4_mosi is record
+        araddr  : std_logic_vector (31 downto 0);
+        arburst : std_logic_vector (1 downto 0);
+        arlen   : std_logic_vector (7 downto 0);
+        arprot  : std_logic_vector (2 downto 0);
+        arsize  : std_logic_vector (2 downto 0);
+        arvalid : std_logic;
+        awaddr  : std_logic_vector (31 downto 0);
+        awburst : std_logic_vector (1 downto 0);
+        awlen   : std_logic_vector (7 downto 0);
+        awprot  : std_logic_vector (2 downto 0);
+        awsize  : std_logic_vector (2 downto 0);
+        awvalid : std_logic;
+        bready  : std_logic;
+        rready  : std_logic;
+        wdata   : std_logic_vector (31 downto 0);
+        wlast   : std_logic;
+        wstrb   : std_logic_vector (3 downto 0);
+        wvalid  : std_logic;
+    end record;
+
+    constant AXI4_MOSI_ZERO : t_axi4_mosi := (
+        araddr  => (others => '0'),
+        arburst => (others => '0'),
+        arlen   => (others => '0'),
+        arprot  => (others => '0'),
+        arsize  => (others => '0'),
+        arvalid => '0',
+        awaddr  => (others => '0'),
+        awburst => (others => '0'),
+        awlen   => (others => '0'),
+        awprot  => (others => '0'),
+        awsize  => (others => '0'),
+        awvalid => '0',
+        bready  => '0',
+        rready  => '0',
+        wdata   => (others => '0'),
+        wlast   => '0',
+        wstrb   => (others => '0'),
+        wvalid  => '0'
+    );
+
+    type t_axi4_miso is record
+        arready : std_logic;
+        awready : std_logic;
+        bresp   : std_logic_vector (1 downto 0);
+        bvalid  : std_logic;
+        rdata   : std_logic_vector (31 downto 0);
+        rlast   : std_logic;
+        rresp   : std_logic_vector (1 downto 0);
+        rvalid  : std_logic;
+        wready  : std_logic;
+    end record;
+
+    constant AXI4_MISO_ZERO : t_axi4_miso := (
+        arready => '0',
+        awready => '0',
+        bresp   => (others => '0'),
+        bvalid  => '0',
+        rdata   => (others => '0'),
+        rlast   => '0',
+        rresp   => (others => '0'),
+        rvalid  => '0',
+        wready  => '0'
+    );
+
     type t_axi_stream32_mosi is record
         tdata  : std_logic_vector (31 downto 0);
         tvalid : std_logic;
@@ -27,6 +27,42 @@ package graphics_pkg is
     constant COLOUR_BITS_16_BPP : t_colour_depth := (RED=>5, GRN => 6, BLU => 5);
     constant COLOUR_BITS_24_BPP : t_colour_depth := (RED=>8, GRN => 8, BLU => 8);
 
+    -- axi3_vdma framebuffer pixel formats
+    constant C_VDMA_FORMAT_32BPP : std_logic_vector(1 downto 0) := "00"; -- xRGB 8-8-8-8
+    constant C_VDMA_FORMAT_16BPP : std_logic_vector(1 downto 0) := "01"; -- RGB 5-6-5
+    constant C_VDMA_FORMAT_8BPP  : std_logic_vector(1 downto 0) := "10"; -- 8 bit palette index
+
+    -- video timing, sizes in pixels/lines. Sync polarity: '1' for active high, '0' for active low
+    type t_video_timing is record
+        pixelclk_hz : natural; -- for reference, the pixel clock must be generated to match
+        active_x    : natural;
+        fporch_x    : natural;
+        sync_x      : natural;
+        bporch_x    : natural;
+        active_y    : natural;
+        fporch_y    : natural;
+        sync_y      : natural;
+        bporch_y    : natural;
+        active_hs   : std_logic;
+        active_vs   : std_logic;
+    end record;
+    type t_video_timing_arr is array (natural range <>) of t_video_timing;
+
+    constant C_VIDEO_640X480_60  : t_video_timing := (25_000_000, 640, 16, 96, 48, 480, 10, 2, 33, '0', '0');
+    constant C_VIDEO_800X600_60  : t_video_timing := (40_000_000, 800, 40, 128, 88, 600, 1, 4, 23, '1', '1');
+    constant C_VIDEO_1280X720_60 : t_video_timing := (74_250_000, 1280, 110, 40, 220, 720, 5, 5, 20, '1', '1');
+
+    -- runtime selectable modes for axi3_vdma, index with the TIMING field of wb_vdma_ctrl
+    constant C_VIDEO_PRESETS : t_video_timing_arr(0 to 1) := (C_VIDEO_640X480_60, C_VIDEO_1280X720_60);
+
+    function video_total_x(t : t_video_timing) return natural;
+    function video_total_y(t : t_video_timing) return natural;
+    function video_max_active_x(presets : t_video_timing_arr) return natural;
+    function video_max_total_x(presets : t_video_timing_arr) return natural;
+    function video_max_total_y(presets : t_video_timing_arr) return natural;
+    --! framebuffer line stride at 32bpp as a shift, the next power of 2 bytes above active_x * 4
+    function video_line_shift(t : t_video_timing) return natural;
+
     function func_combine_pixel_or(a : t_pixel; b : t_pixel) return t_pixel;
 
     function to_string(pixel : t_pixel) return string;
@@ -34,6 +70,52 @@ package graphics_pkg is
 end package;
 
 package body graphics_pkg is
+    function video_total_x(t : t_video_timing) return natural is
+    begin
+        return t.active_x + t.fporch_x + t.sync_x + t.bporch_x;
+    end function;
+
+    function video_total_y(t : t_video_timing) return natural is
+    begin
+        return t.active_y + t.fporch_y + t.sync_y + t.bporch_y;
+    end function;
+
+    function video_max_active_x(presets : t_video_timing_arr) return natural is
+        variable v_max : natural := 0;
+    begin
+        for i in presets'range loop
+            v_max := maximum(v_max, presets(i).active_x);
+        end loop;
+        return v_max;
+    end function;
+
+    function video_max_total_x(presets : t_video_timing_arr) return natural is
+        variable v_max : natural := 0;
+    begin
+        for i in presets'range loop
+            v_max := maximum(v_max, video_total_x(presets(i)));
+        end loop;
+        return v_max;
+    end function;
+
+    function video_max_total_y(presets : t_video_timing_arr) return natural is
+        variable v_max : natural := 0;
+    begin
+        for i in presets'range loop
+            v_max := maximum(v_max, video_total_y(presets(i)));
+        end loop;
+        return v_max;
+    end function;
+
+    function video_line_shift(t : t_video_timing) return natural is
+        variable v_shift : natural := 2;
+    begin
+        while 2 ** (v_shift - 2) < t.active_x loop
+            v_shift := v_shift + 1;
+        end loop;
+        return v_shift;
+    end function;
+
     function func_combine_pixel_or(a : t_pixel; b : t_pixel) return t_pixel is
         variable v_pixel : t_pixel;
     begin
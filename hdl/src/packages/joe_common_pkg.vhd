@@ -55,7 +55,7 @@ package joe_common_pkg is
     function s_sub(a, b : std_logic_vector) return std_logic_vector;
 
     --! Returns the Ceiling of Log2(a)
-    impure function clog2(a : positive) return positive;
+    impure function clog2(a : positive) return natural; -- clog2(1) = 0
     -- function clog2(a : positive) return positive;
 
     --! Initialises a 32bit wide RAM from the contents of a file
@@ -155,10 +155,10 @@ package body joe_common_pkg is
 
     --! Returns the Ceiling of Log2(a)
     -- function clog2(a : positive) return positive is
-    impure function clog2(a : positive) return positive is
+    impure function clog2(a : positive) return natural is
     begin
         report "clog2 called on " & to_string(a);
-        return positive(ceil(log2(real(a))));
+        return natural(ceil(log2(real(a))));
     end function;
 
     --! Sign/Zero Extends a std_logic_vector
@@ -0,0 +1,109 @@
+-- Generated by tools/gen_wb_ic/gen_address_map.py from basys3.json, do not edit
+library ieee;
+use ieee.std_logic_1164.all;
+
+use work.joe_common_pkg.all;
+
+--! Wishbone address map. Pass C_WB_ADR_MASK/C_WB_ADR_MATCH to wb_interconnect, a slave
+--! is selected when (adr and MASK) = MATCH. Only the bits set in each MASK are compared,
+--! unmapped indices never match
+package wb_addr_map_pkg is
+    constant C_WB_NUM_SLAVES : integer := 16;
+
+    -- mem: 0x00000000 to 0x0fffffff
+    constant C_WB_MEM_IDX  : integer := 0;
+    constant C_WB_MEM_BASE : std_logic_vector(31 downto 0) := x"0000_0000";
+    constant C_WB_MEM_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- gpio0: 0x10000000 to 0x1fffffff
+    constant C_WB_GPIO0_IDX  : integer := 1;
+    constant C_WB_GPIO0_BASE : std_logic_vector(31 downto 0) := x"1000_0000";
+    constant C_WB_GPIO0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- uart0: 0x20000000 to 0x2fffffff
+    constant C_WB_UART0_IDX  : integer := 2;
+    constant C_WB_UART0_BASE : std_logic_vector(31 downto 0) := x"2000_0000";
+    constant C_WB_UART0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- timer0: 0x30000000 to 0x3fffffff
+    constant C_WB_TIMER0_IDX  : integer := 3;
+    constant C_WB_TIMER0_BASE : std_logic_vector(31 downto 0) := x"3000_0000";
+    constant C_WB_TIMER0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- text_display0: 0x40000000 to 0x4fffffff
+    constant C_WB_TEXT_DISPLAY0_IDX  : integer := 4;
+    constant C_WB_TEXT_DISPLAY0_BASE : std_logic_vector(31 downto 0) := x"4000_0000";
+    constant C_WB_TEXT_DISPLAY0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- sd_spi: 0x50000000 to 0x5fffffff
+    constant C_WB_SD_SPI_IDX  : integer := 5;
+    constant C_WB_SD_SPI_BASE : std_logic_vector(31 downto 0) := x"5000_0000";
+    constant C_WB_SD_SPI_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- psram: 0x60000000 to 0x6fffffff
+    constant C_WB_PSRAM_IDX  : integer := 6;
+    constant C_WB_PSRAM_BASE : std_logic_vector(31 downto 0) := x"6000_0000";
+    constant C_WB_PSRAM_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- dma0: 0x80000000 to 0x8fffffff
+    constant C_WB_DMA0_IDX  : integer := 8;
+    constant C_WB_DMA0_BASE : std_logic_vector(31 downto 0) := x"8000_0000";
+    constant C_WB_DMA0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- crc0: 0x90000000 to 0x9fffffff
+    constant C_WB_CRC0_IDX  : integer := 9;
+    constant C_WB_CRC0_BASE : std_logic_vector(31 downto 0) := x"9000_0000";
+    constant C_WB_CRC0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- sd_host0: 0xa0000000 to 0xafffffff
+    constant C_WB_SD_HOST0_IDX  : integer := 10;
+    constant C_WB_SD_HOST0_BASE : std_logic_vector(31 downto 0) := x"A000_0000";
+    constant C_WB_SD_HOST0_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+    -- bootloader: 0xf0000000 to 0xffffffff
+    constant C_WB_BOOTLOADER_IDX  : integer := 15;
+    constant C_WB_BOOTLOADER_BASE : std_logic_vector(31 downto 0) := x"F000_0000";
+    constant C_WB_BOOTLOADER_MASK : std_logic_vector(31 downto 0) := x"F000_0000";
+
+    constant C_WB_ADR_MASK : t_slv32_arr(0 to C_WB_NUM_SLAVES - 1) := (
+        0 => x"F000_0000",
+        1 => x"F000_0000",
+        2 => x"F000_0000",
+        3 => x"F000_0000",
+        4 => x"F000_0000",
+        5 => x"F000_0000",
+        6 => x"F000_0000",
+        7 => x"0000_0000",
+        8 => x"F000_0000",
+        9 => x"F000_0000",
+        10 => x"F000_0000",
+        11 => x"0000_0000",
+        12 => x"0000_0000",
+        13 => x"0000_0000",
+        14 => x"0000_0000",
+        15 => x"F000_0000"
+    );
+    constant C_WB_ADR_MATCH : t_slv32_arr(0 to C_WB_NUM_SLAVES - 1) := (
+        0 => x"0000_0000",
+        1 => x"1000_0000",
+        2 => x"2000_0000",
+        3 => x"3000_0000",
+        4 => x"4000_0000",
+        5 => x"5000_0000",
+        6 => x"6000_0000",
+        7 => x"FFFF_FFFF",
+        8 => x"8000_0000",
+        9 => x"9000_0000",
+        10 => x"A000_0000",
+        11 => x"FFFF_FFFF",
+        12 => x"FFFF_FFFF",
+        13 => x"FFFF_FFFF",
+        14 => x"FFFF_FFFF",
+        15 => x"F000_0000"
+    );
+
+    --! returns the slave index, or C_WB_NUM_SLAVES if unmapped
+    function wb_decode (adr : std_logic_vector(31 downto 0)) return integer;
+end package wb_addr_map_pkg;
+
+package body wb_addr_map_pkg is
+    function wb_decode (adr : std_logic_vector(31 downto 0)) return integer is
+    begin
+        for i in 0 to C_WB_NUM_SLAVES - 1 loop
+            if (adr and C_WB_ADR_MASK(i)) = C_WB_ADR_MATCH(i) then
+                return i;
+            end if;
+        end loop;
+        return C_WB_NUM_SLAVES;
+    end function;
+end package body wb_addr_map_pkg;
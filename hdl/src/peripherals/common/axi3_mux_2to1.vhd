@@ -0,0 +1,145 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.axi_pkg.all;
+
+--! Shares one AXI3 slave port (eg. a Zynq HP port) between two AXI3 masters
+--!
+--! Read and write address channels are arbitrated separately, master 0 has priority.
+--! The master index is sent in ID bit 0 (both masters must use ID 0), so R and B
+--! responses are routed back by RID/BID and may return out of order between masters.
+--!
+--! The W channel follows the write address owner, which only changes once all its
+--! write bursts have been sent. Masters may present W data alongside (not before) AWVALID,
+--! and may have at most 31 bursts outstanding.
+entity axi3_mux_2to1 is
+    port (
+        axi_clk   : in std_logic;
+        axi_reset : in std_logic;
+
+        m0_axi_mosi_in  : in t_axi_mosi;
+        m0_axi_miso_out : out t_axi_miso;
+
+        m1_axi_mosi_in  : in t_axi_mosi;
+        m1_axi_miso_out : out t_axi_miso;
+
+        axi_mosi_out : out t_axi_mosi;
+        axi_miso_in  : in t_axi_miso
+    );
+end entity axi3_mux_2to1;
+
+architecture rtl of axi3_mux_2to1 is
+    signal ar_sel   : std_logic; -- '1' for master 1
+    signal ar_owner : std_logic := '0';
+    signal ar_busy  : std_logic := '0'; -- ARVALID waiting for ARREADY, don't switch
+
+    signal aw_sel     : std_logic;
+    signal aw_owner   : std_logic := '0';
+    signal aw_busy    : std_logic := '0';
+    signal w_pending  : integer range -1 to 31 := 0; -- AW accepted minus W bursts completed (-1 if W finished first)
+
+    signal ar_mosi : t_axi_mosi; -- master driving the AR channel
+    signal aw_mosi : t_axi_mosi; -- master driving the AW and W channels
+
+    signal aw_accept : std_logic;
+    signal w_done    : std_logic;
+begin
+
+    ar_sel <= ar_owner when ar_busy = '1' else
+              '0' when m0_axi_mosi_in.arvalid = '1' else
+              '1' when m1_axi_mosi_in.arvalid = '1' else
+              ar_owner;
+
+    -- only hand over the write channels once the owner has nothing left to send
+    aw_sel <= aw_owner when aw_busy = '1' or w_pending /= 0 else
+              '0' when m0_axi_mosi_in.awvalid = '1' else
+              '1' when m1_axi_mosi_in.awvalid = '1' else
+              aw_owner;
+
+    ar_mosi <= m1_axi_mosi_in when ar_sel = '1' else m0_axi_mosi_in;
+    aw_mosi <= m1_axi_mosi_in when aw_sel = '1' else m0_axi_mosi_in;
+
+    -- read address channel
+    axi_mosi_out.araddr  <= ar_mosi.araddr;
+    axi_mosi_out.arburst <= ar_mosi.arburst;
+    axi_mosi_out.arcache <= ar_mosi.arcache;
+    axi_mosi_out.arid    <= ar_mosi.arid(11 downto 1) & ar_sel;
+    axi_mosi_out.arlen   <= ar_mosi.arlen;
+    axi_mosi_out.arlock  <= ar_mosi.arlock;
+    axi_mosi_out.arprot  <= ar_mosi.arprot;
+    axi_mosi_out.arqos   <= ar_mosi.arqos;
+    axi_mosi_out.arsize  <= ar_mosi.arsize;
+    axi_mosi_out.arvalid <= ar_mosi.arvalid;
+
+    -- write address and data channels
+    axi_mosi_out.awaddr  <= aw_mosi.awaddr;
+    axi_mosi_out.awburst <= aw_mosi.awburst;
+    axi_mosi_out.awcache <= aw_mosi.awcache;
+    axi_mosi_out.awid    <= aw_mosi.awid(11 downto 1) & aw_sel;
+    axi_mosi_out.awlen   <= aw_mosi.awlen;
+    axi_mosi_out.awlock  <= aw_mosi.awlock;
+    axi_mosi_out.awprot  <= aw_mosi.awprot;
+    axi_mosi_out.awqos   <= aw_mosi.awqos;
+    axi_mosi_out.awsize  <= aw_mosi.awsize;
+    axi_mosi_out.awvalid <= aw_mosi.awvalid;
+    axi_mosi_out.wdata   <= aw_mosi.wdata;
+    axi_mosi_out.wid     <= aw_mosi.wid(11 downto 1) & aw_sel;
+    axi_mosi_out.wlast   <= aw_mosi.wlast;
+    axi_mosi_out.wstrb   <= aw_mosi.wstrb;
+    axi_mosi_out.wvalid  <= aw_mosi.wvalid;
+
+    -- responses, routed by ID
+    axi_mosi_out.rready <= m1_axi_mosi_in.rready when axi_miso_in.rid(0) = '1' else m0_axi_mosi_in.rready;
+    axi_mosi_out.bready <= m1_axi_mosi_in.bready when axi_miso_in.bid(0) = '1' else m0_axi_mosi_in.bready;
+
+    miso_proc : process (all)
+    begin
+        m0_axi_miso_out         <= axi_miso_in;
+        m0_axi_miso_out.arready <= axi_miso_in.arready and not ar_sel;
+        m0_axi_miso_out.awready <= axi_miso_in.awready and not aw_sel;
+        m0_axi_miso_out.wready  <= axi_miso_in.wready and not aw_sel;
+        m0_axi_miso_out.rvalid  <= axi_miso_in.rvalid and not axi_miso_in.rid(0);
+        m0_axi_miso_out.bvalid  <= axi_miso_in.bvalid and not axi_miso_in.bid(0);
+        m0_axi_miso_out.rid(0)  <= '0';
+        m0_axi_miso_out.bid(0)  <= '0';
+
+        m1_axi_miso_out         <= axi_miso_in;
+        m1_axi_miso_out.arready <= axi_miso_in.arready and ar_sel;
+        m1_axi_miso_out.awready <= axi_miso_in.awready and aw_sel;
+        m1_axi_miso_out.wready  <= axi_miso_in.wready and aw_sel;
+        m1_axi_miso_out.rvalid  <= axi_miso_in.rvalid and axi_miso_in.rid(0);
+        m1_axi_miso_out.bvalid  <= axi_miso_in.bvalid and axi_miso_in.bid(0);
+        m1_axi_miso_out.rid(0)  <= '0';
+        m1_axi_miso_out.bid(0)  <= '0';
+    end process;
+
+    aw_accept <= aw_mosi.awvalid and axi_miso_in.awready;
+    w_done    <= aw_mosi.wvalid and aw_mosi.wlast and axi_miso_in.wready;
+
+    arb_proc : process (axi_clk)
+    begin
+        if rising_edge(axi_clk) then
+            if axi_reset = '1' then
+                ar_owner  <= '0';
+                ar_busy   <= '0';
+                aw_owner  <= '0';
+                aw_busy   <= '0';
+                w_pending <= 0;
+            else
+                ar_owner <= ar_sel;
+                ar_busy  <= ar_mosi.arvalid and not axi_miso_in.arready;
+
+                aw_owner <= aw_sel;
+                aw_busy  <= aw_mosi.awvalid and not axi_miso_in.awready;
+
+                if aw_accept = '1' and w_done = '0' then
+                    w_pending <= w_pending + 1;
+                elsif aw_accept = '0' and w_done = '1' then
+                    w_pending <= w_pending - 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture;
@@ -22,7 +22,8 @@ entity axi_stream_xpm_fifo_wrapper is
         G_DATA_WIDTH        : integer := 32;    --! must be a whole number of bytes
         G_FULL_PACKET       : boolean := false; --! Packet Mode FIFO
         G_PROG_FULL_THRESH  : integer := 7;     --! Min = 5+2 (CDC), Max = FIFO_DEPTH-5
-        G_PROG_EMPTY_THRESH : integer := 5      --! Min = 5,         Max = FIFO_DEPTH-5
+        G_PROG_EMPTY_THRESH : integer := 5;     --! Min = 5,         Max = FIFO_DEPTH-5
+        G_COUNT_WIDTH       : integer := 1      --! log2(FIFO_DEPTH)+1 to enable the data count outputs
 
     );
     port (
@@ -41,7 +42,11 @@ entity axi_stream_xpm_fifo_wrapper is
         almost_empty : out std_logic;
         almost_full  : out std_logic;
         prog_empty   : out std_logic;
-        prog_full    : out std_logic
+        prog_full    : out std_logic;
+
+        -- fill level (optional), in words as seen from each side of the FIFO
+        wr_data_count : out std_logic_vector(G_COUNT_WIDTH - 1 downto 0); --! (input_clk)
+        rd_data_count : out std_logic_vector(G_COUNT_WIDTH - 1 downto 0)  --! (output_clk)
 
     );
 end entity axi_stream_xpm_fifo_wrapper;
@@ -76,6 +81,16 @@ architecture rtl of axi_stream_xpm_fifo_wrapper is
             return 0;
         end if;
     end function;
+
+    -- AXI-S default ("1000"), with added prog_full/empty and almost_full/empty, plus the data counts if wide enough
+    function get_adv_features_string(count_width : integer) return string is
+    begin
+        if count_width > 1 then
+            return "1E0E";
+        else
+            return "1A0A";
+        end if;
+    end function;
 begin
 input_clk_resetn <= not input_clk_reset;
 
@@ -90,15 +105,15 @@ input_clk_resetn <= not input_clk_reset;
         PACKET_FIFO         => get_bool_string(G_FULL_PACKET),           -- String
         PROG_EMPTY_THRESH   => G_PROG_EMPTY_THRESH,                      -- DECIMAL
         PROG_FULL_THRESH    => G_PROG_FULL_THRESH,                       -- DECIMAL
-        RD_DATA_COUNT_WIDTH => 1,                                        -- DECIMAL
+        RD_DATA_COUNT_WIDTH => G_COUNT_WIDTH,                            -- DECIMAL
         RELATED_CLOCKS      => get_bool_int(G_RELATED_CLOCKS),           -- DECIMAL
         SIM_ASSERT_CHK      => 0,                                        -- DECIMAL; 0=disable simulation messages, 1=enable simulation messages
         TDATA_WIDTH         => G_DATA_WIDTH,                             -- DECIMAL
         TDEST_WIDTH         => 1,                                        -- DECIMAL
         TID_WIDTH           => 1,                                        -- DECIMAL
         TUSER_WIDTH         => 1,                                        -- DECIMAL
-        USE_ADV_FEATURES    => "1A0A",                                   -- String (AXI-S default ("1000"), with added prog_full/empty and almost_full/empty)
-        WR_DATA_COUNT_WIDTH => 1                                         -- DECIMAL
+        USE_ADV_FEATURES    => get_adv_features_string(G_COUNT_WIDTH),   -- String
+        WR_DATA_COUNT_WIDTH => G_COUNT_WIDTH                             -- DECIMAL
     )
     port map(
 
@@ -130,10 +145,10 @@ input_clk_resetn <= not input_clk_reset;
         -- flags and counters
         almost_full_axis   => almost_full, -- 1-bit output: Almost Full: When asserted, this signal indicates that only one more write can be performed before the FIFO is full.
         prog_full_axis     => prog_full,   -- 1-bit output: Programmable Full: This signal is asserted when the number of words in the FIFO is greater than or equal to the programmable full threshold value. It is de-asserted when the number of words in the FIFO is less than the programmable full threshold value.
-        wr_data_count_axis => open,
+        wr_data_count_axis => wr_data_count,
         almost_empty_axis  => almost_empty, -- 1-bit output: Almost Empty : When asserted, this signal indicates that only one more read can be performed before the FIFO goes to empty.
         prog_empty_axis    => prog_empty,   -- 1-bit output: Programmable Empty- This signal is asserted when the number of words in the FIFO is less than or equal to the programmable empty threshold value. It is de-asserted when the number of words in the FIFO exceeds the programmable empty threshold value.
-        rd_data_count_axis => open,
+        rd_data_count_axis => rd_data_count,
 
         -- ECC
         dbiterr_axis       => open,
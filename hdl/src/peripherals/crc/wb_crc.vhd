@@ -0,0 +1,231 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! Programmable CRC engine (1 to 32 bit polynomials), eg. CRC7 and CRC16 for SD cards, CRC32 for images
+--!
+--! Data is fed either by writing to DATA, or by snooping the bytes sent/received by a wb_spi.
+--! A DATA write feeds the bytes enabled by SEL, lowest byte lane first, so writing words read from a
+--! buffer processes the bytes in memory order. One byte is processed per clock, and the Wishbone port
+--! stalls until a write has been processed so a following RESULT read is always up to date.
+--!
+--! The CRC is calculated MSB first with the polynomial aligned to the top of a 32 bit shift register,
+--! so any width works without changing the datapath. REFLECT_IN/OUT give the LSB first (reflected)
+--! variants such as CRC32 (zlib/Ethernet).
+entity wb_crc is
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        wb_mosi_in  : in t_wb_mosi;
+        wb_miso_out : out t_wb_miso;
+
+        -- from wb_spi, one pulse per byte transferred
+        snoop_tx_byte_in : in std_logic_vector(7 downto 0) := x"00";
+        snoop_rx_byte_in : in std_logic_vector(7 downto 0) := x"00";
+        snoop_valid_in   : in std_logic                    := '0'
+    );
+end entity wb_crc;
+
+architecture rtl of wb_crc is
+    -- Register Map
+    -- x00: DATA    (WO) bytes to add to the CRC (SEL selects bytes). Reads return RESULT
+    -- x04: CTRL    (RW)
+    -- [5:0]    WIDTH       CRC width in bits (1 to 32, 0 is treated as 32)
+    -- [8]      REFLECT_IN  process each byte LSB first
+    -- [9]      REFLECT_OUT reflect the CRC before XOR_OUT
+    -- [12]     SNOOP_RX    add bytes received by the SPI controller
+    -- [13]     SNOOP_TX    add bytes sent by the SPI controller
+    -- x08: POLY    (RW) polynomial, normal (MSB first) form without the x^WIDTH term
+    -- x0C: INIT    (RW) initial value, writing also restarts the CRC (so write it after CTRL)
+    -- x10: XOR_OUT (RW) XORed with the result
+    -- x14: RESULT  (RO) finished CRC. Any write restarts the CRC from INIT
+    -- x18: COUNT   (RO) bytes processed since the last restart
+
+    signal width       : unsigned(5 downto 0)          := to_unsigned(32, 6);
+    signal reflect_in  : std_logic                     := '0';
+    signal reflect_out : std_logic                     := '0';
+    signal snoop_rx    : std_logic                     := '0';
+    signal snoop_tx    : std_logic                     := '0';
+    signal poly        : std_logic_vector(31 downto 0) := (others => '0');
+    signal init        : std_logic_vector(31 downto 0) := (others => '0');
+    signal xor_out     : std_logic_vector(31 downto 0) := (others => '0');
+
+    -- top aligned versions of POLY and INIT
+    signal shift     : integer range 0 to 31 := 0;
+    signal poly_top  : std_logic_vector(31 downto 0) := (others => '0');
+    signal crc       : std_logic_vector(31 downto 0) := (others => '0'); -- top aligned
+    signal restart   : std_logic := '0';
+    signal count     : unsigned(31 downto 0) := (others => '0');
+    signal result    : std_logic_vector(31 downto 0);
+
+    -- bytes waiting to be processed
+    signal data_word    : std_logic_vector(31 downto 0) := (others => '0');
+    signal lanes        : std_logic_vector(3 downto 0) := (others => '0');
+    signal snoop_byte   : std_logic_vector(7 downto 0) := (others => '0');
+    signal snoop_pend   : std_logic := '0';
+    signal busy         : std_logic;
+    signal lane         : integer range 0 to 3;
+    signal crc_out      : std_logic_vector(31 downto 0);
+    signal mask         : std_logic_vector(31 downto 0);
+
+    function reverse(v : std_logic_vector) return std_logic_vector is
+        variable r : std_logic_vector(v'range);
+    begin
+        for i in v'range loop
+            r(v'high - i + v'low) := v(i);
+        end loop;
+        return r;
+    end function;
+
+    --! shift one byte MSB first through a top aligned CRC
+    function crc_byte(crc_in, poly_in : std_logic_vector(31 downto 0); byte : std_logic_vector(7 downto 0)) return std_logic_vector is
+        variable c  : std_logic_vector(31 downto 0) := crc_in;
+        variable fb : std_logic;
+    begin
+        for i in 7 downto 0 loop
+            fb := c(31) xor byte(i);
+            c  := c(30 downto 0) & '0';
+            if fb = '1' then
+                c := c xor poly_in;
+            end if;
+        end loop;
+        return c;
+    end function;
+
+    function lowest_set(v : std_logic_vector(3 downto 0)) return integer is
+    begin
+        for i in 0 to 3 loop
+            if v(i) = '1' then
+                return i;
+            end if;
+        end loop;
+        return 0;
+    end function;
+begin
+
+    busy              <= '1' when lanes /= "0000" or snoop_pend = '1' else '0';
+    wb_miso_out.stall <= busy;
+
+    shift    <= (32 - to_integer(width)) mod 32; -- WIDTH=0 treated as 32
+    poly_top <= std_logic_vector(shift_left(unsigned(poly), shift));
+    mask     <= std_logic_vector(shift_right(unsigned'(x"FFFF_FFFF"), shift));
+    crc_out  <= reverse(crc) when reflect_out = '1' else std_logic_vector(shift_right(unsigned(crc), shift));
+    result   <= (crc_out xor xor_out) and mask;
+    lane     <= lowest_set(lanes);
+
+    wb_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                wb_miso_out.ack <= '0';
+                wb_miso_out.err <= '0';
+                wb_miso_out.rty <= '0';
+                width           <= to_unsigned(32, 6);
+                reflect_in      <= '0';
+                reflect_out     <= '0';
+                snoop_rx        <= '0';
+                snoop_tx        <= '0';
+                restart         <= '1';
+                lanes           <= (others => '0');
+            else
+                -- defaults
+                wb_miso_out.ack  <= '0';
+                wb_miso_out.err  <= '0'; -- this slave does not generate ERR or RTY responses
+                wb_miso_out.rty  <= '0';
+                wb_miso_out.rdat <= x"DEADC0DE";
+                restart          <= '0';
+
+                -- crc_proc takes one byte per clock from DATA writes, lowest lane first
+                if lanes /= "0000" then
+                    lanes(lane) <= '0';
+                end if;
+
+                if wb_mosi_in.stb = '1' and busy = '0' then -- assume CYC asserted by master for STB to be high
+                    -- always ACK this cycle (sync operation with 1 wait state)
+                    wb_miso_out.ack <= '1';
+                    if wb_mosi_in.we = '1' then
+                        -- write logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" =>
+                                data_word <= wb_mosi_in.wdat;
+                                lanes     <= wb_mosi_in.sel;
+                            when x"04" =>
+                                width       <= unsigned(wb_mosi_in.wdat(5 downto 0));
+                                reflect_in  <= wb_mosi_in.wdat(8);
+                                reflect_out <= wb_mosi_in.wdat(9);
+                                snoop_rx    <= wb_mosi_in.wdat(12);
+                                snoop_tx    <= wb_mosi_in.wdat(13);
+                            when x"08" => poly <= wb_mosi_in.wdat;
+                            when x"0C" =>
+                                init    <= wb_mosi_in.wdat;
+                                restart <= '1';
+                            when x"10" => xor_out <= wb_mosi_in.wdat;
+                            when x"14" => restart <= '1';
+                            when others => null;
+                        end case;
+                    else
+                        -- read logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" | x"14" => wb_miso_out.rdat <= result;
+                            when x"04" =>
+                                wb_miso_out.rdat              <= (others => '0');
+                                wb_miso_out.rdat(5 downto 0)  <= std_logic_vector(width);
+                                wb_miso_out.rdat(8)           <= reflect_in;
+                                wb_miso_out.rdat(9)           <= reflect_out;
+                                wb_miso_out.rdat(12)          <= snoop_rx;
+                                wb_miso_out.rdat(13)          <= snoop_tx;
+                            when x"08"  => wb_miso_out.rdat <= poly;
+                            when x"0C"  => wb_miso_out.rdat <= init;
+                            when x"10"  => wb_miso_out.rdat <= xor_out;
+                            when x"18"  => wb_miso_out.rdat <= std_logic_vector(count);
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    crc_proc : process (wb_clk) is
+        variable byte : std_logic_vector(7 downto 0);
+        variable take : boolean;
+    begin
+        if rising_edge(wb_clk) then
+            take := false;
+            if lanes /= "0000" then
+                byte := data_word(8 * lane + 7 downto 8 * lane);
+                take := true;
+            elsif snoop_pend = '1' then
+                byte       := snoop_byte;
+                take       := true;
+                snoop_pend <= '0';
+            end if;
+
+            -- SPI bytes arrive at most every 16 clocks, so one byte of buffering is plenty
+            if snoop_valid_in = '1' and (snoop_rx = '1' or snoop_tx = '1') then
+                snoop_byte <= snoop_rx_byte_in when snoop_rx = '1' else snoop_tx_byte_in;
+                snoop_pend <= '1';
+            end if;
+
+            if restart = '1' then
+                crc   <= std_logic_vector(shift_left(unsigned(init), shift));
+                count <= (others => '0');
+            elsif take then
+                if reflect_in = '1' then
+                    byte := reverse(byte);
+                end if;
+                crc   <= crc_byte(crc, poly_top, byte);
+                count <= count + 1;
+            end if;
+
+            if wb_reset = '1' then
+                snoop_pend <= '0';
+            end if;
+        end if;
+    end process;
+
+end architecture;
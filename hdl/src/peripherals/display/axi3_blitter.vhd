@@ -0,0 +1,564 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.axi_pkg.all;
+use work.joe_common_pkg.all;
+
+--! 2D blitter for the 32bpp framebuffer, Wishbone programmed AXI3 master
+--!
+--! Operations:
+--! - FILL  : solid rectangle of FG_COLOUR at DST_ADDR
+--! - COPY  : rectangle from SRC_ADDR to DST_ADDR (eg. scrolling). When DST_ADDR > SRC_ADDR
+--!           lines are copied bottom to top so overlapping vertical scrolls work. Overlapping
+--!           copies within the same line (horizontal scrolling) are not supported
+--! - GLYPH : 8x16 character SRC_ADDR[7:0] from the font RAM, expanded to FG/BG_COLOUR
+--! - RGB24 : rectangle of packed 24bpp pixels (B, G, R bytes, as in BMP files) from SRC_ADDR,
+--!           expanded to 32bpp at DST_ADDR. SRC_ADDR and the source stride can be any byte
+--!           address, each burst of up to 16 pixels reads the 13 or fewer words under it
+--!
+--! CMD.FLIP writes the destination lines bottom to top while reading the source top to bottom,
+--! for bottom up images (BMP). It turns off COPY's overlap handling
+--!
+--! Set up the parameter registers then write CMD to push a command into the queue. Parameters are
+--! copied into the queue, so can be changed straight away for the next command. Writes to CMD stall
+--! while the queue is full. DONE_COUNT increments once each command's writes have been acknowledged.
+--!
+--! Each line is split into AXI3 INCR bursts of up to 16 words, aligned to 64 bytes so bursts never
+--! cross a 4KB boundary. Lines must not cross a 4KB boundary (not a problem with a 4KB line stride),
+--! apart from RGB24 source lines, whose reads are split at the boundary
+entity axi3_blitter is
+    generic (
+        G_QUEUE_DEPTH     : integer := 16;
+        G_MAX_OUTSTANDING : integer := 8; --! write bursts waiting for a response
+        G_FONT_FILE       : string  := "" --! 8x16 font, one binary row per line (tools/font_rom8x16.txt)
+    );
+    port (
+        clk   : in std_logic;
+        reset : in std_logic;
+
+        wb_mosi_in  : in t_wb_mosi;
+        wb_miso_out : out t_wb_miso;
+
+        axi_mosi_out : out t_axi_mosi;
+        axi_miso_in  : in t_axi_miso;
+
+        busy_out : out std_logic
+    );
+end entity axi3_blitter;
+
+architecture rtl of axi3_blitter is
+    -- Register Map
+    -- x00: DST_ADDR   (RW) top left pixel of the destination
+    -- x04: SRC_ADDR   (RW) COPY: top left pixel of the source, GLYPH: [7:0] character code
+    -- x08: SIZE       (RW) [15:0] width in pixels, [31:16] height in lines (ignored for GLYPH)
+    -- x0C: STRIDE     (RW) [15:0] destination line stride in bytes, [31:16] source line stride
+    -- x10: FG_COLOUR  (RW) FILL colour, GLYPH foreground
+    -- x14: BG_COLOUR  (RW) GLYPH background
+    -- x18: CMD        (WO) [1:0] operation (0: FILL, 1: COPY, 2: GLYPH, 3: RGB24), [2] FLIP,
+    --                       pushes a command
+    -- x1C: STATUS
+    -- [0]      BUSY        (RO) commands queued or in progress
+    -- [1]      QUEUE_FULL  (RO)
+    -- [2]      ERR         (R/W1C) an AXI transfer returned an error response
+    -- [15:8]   QUEUE_LEVEL (RO)
+    -- x20: DONE_COUNT (RO) number of commands completed
+
+    constant OP_FILL  : std_logic_vector(1 downto 0) := "00";
+    constant OP_COPY  : std_logic_vector(1 downto 0) := "01";
+    constant OP_GLYPH : std_logic_vector(1 downto 0) := "10";
+    constant OP_RGB24 : std_logic_vector(1 downto 0) := "11";
+
+    constant MAX_BURST   : integer := 16; -- AXI3
+    constant FONT_ADDR_W : integer := 12; -- 256 chars * 16 rows
+    constant CHAR_W      : integer := 8;
+    constant CHAR_H      : integer := 16;
+
+    type t_blit_cmd is record
+        op         : std_logic_vector(1 downto 0);
+        flip       : std_logic;
+        dst        : unsigned(31 downto 0);
+        src        : unsigned(31 downto 0);
+        width      : unsigned(15 downto 0);
+        height     : unsigned(15 downto 0);
+        dst_stride : unsigned(15 downto 0);
+        src_stride : unsigned(15 downto 0);
+        fg         : std_logic_vector(31 downto 0);
+        bg         : std_logic_vector(31 downto 0);
+    end record;
+    type t_blit_cmd_arr is array (0 to G_QUEUE_DEPTH - 1) of t_blit_cmd;
+
+    -- staging registers
+    signal stage : t_blit_cmd := (
+        op         => OP_FILL,
+        flip       => '0',
+        dst        => (others => '0'),
+        src        => (others => '0'),
+        width      => (others => '0'),
+        height     => (others => '0'),
+        dst_stride => x"1000",
+        src_stride => x"1000",
+        fg         => (others => '0'),
+        bg         => (others => '0')
+    );
+
+    -- command queue
+    signal queue       : t_blit_cmd_arr;
+    signal queue_wr    : integer range 0 to G_QUEUE_DEPTH - 1 := 0;
+    signal queue_rd    : integer range 0 to G_QUEUE_DEPTH - 1 := 0;
+    signal queue_level : integer range 0 to G_QUEUE_DEPTH := 0;
+    signal queue_full  : std_logic;
+    signal queue_push  : std_logic := '0';
+    signal queue_pop   : std_logic := '0';
+
+    signal err        : std_logic := '0';
+    signal err_clear  : std_logic := '0';
+    signal done_count : unsigned(31 downto 0) := (others => '0');
+
+    -- engine
+    type t_state is (IDLE, START, LINE_START, FONT_WAIT, CHUNK, READ, WRITE, WRITE_END, NEXT_LINE, WAIT_RESP);
+    signal state : t_state := IDLE;
+
+    signal cmd        : t_blit_cmd;
+    signal reverse    : std_logic := '0'; -- copy lines bottom to top
+    signal dst_up     : std_logic := '0'; -- write lines bottom to top
+    signal line_count : unsigned(15 downto 0) := (others => '0'); -- lines remaining
+    signal line_idx   : unsigned(15 downto 0) := (others => '0'); -- lines done
+    signal dst_line   : unsigned(31 downto 0) := (others => '0');
+    signal src_line   : unsigned(31 downto 0) := (others => '0');
+    signal dst_chunk  : unsigned(31 downto 0) := (others => '0');
+    signal src_chunk  : unsigned(31 downto 0) := (others => '0');
+    signal words_left : unsigned(15 downto 0) := (others => '0');
+    signal x_pos      : unsigned(15 downto 0) := (others => '0');
+
+    -- current burst
+    signal burst_dst : unsigned(31 downto 0) := (others => '0');
+    signal burst_x   : unsigned(15 downto 0) := (others => '0');
+    signal burst_len : unsigned(4 downto 0) := (others => '0'); -- 1 to 16
+    signal beat      : unsigned(4 downto 0) := (others => '0');
+    signal rbeat     : unsigned(4 downto 0) := (others => '0');
+    signal src_byte  : unsigned(1 downto 0) := (others => '0'); -- RGB24: first pixel's byte in line_buf(0)
+    signal rd_addr   : unsigned(31 downto 0) := (others => '0'); -- RGB24: second read burst
+    signal rd_rest   : unsigned(4 downto 0) := (others => '0');
+    signal rgb       : std_logic_vector(31 downto 0);
+
+    type t_line_buf is array (0 to MAX_BURST - 1) of std_logic_vector(31 downto 0);
+    signal line_buf : t_line_buf;
+
+    signal outstanding : integer range 0 to G_MAX_OUTSTANDING := 0;
+    signal aw_accept   : std_logic;
+    signal b_accept    : std_logic;
+
+    -- font RAM
+    signal font_addr : std_logic_vector(FONT_ADDR_W - 1 downto 0) := (others => '0');
+    signal font_row  : std_logic_vector(CHAR_W - 1 downto 0);
+    signal font_bit  : std_logic;
+
+    function min(a, b : unsigned) return unsigned is
+    begin
+        if a < b then
+            return a;
+        end if;
+        return b;
+    end function;
+
+begin
+
+    busy_out <= '0' when state = IDLE and queue_level = 0 else '1';
+
+    ---------------------------------------------------------------------------
+    -- Wishbone registers and command queue
+    ---------------------------------------------------------------------------
+    -- includes a push still in flight from the previous CMD write
+    queue_full <= '1' when queue_level = G_QUEUE_DEPTH or (queue_push = '1' and queue_level = G_QUEUE_DEPTH - 1) else '0';
+
+    -- hold off CMD writes until there is room in the queue
+    wb_miso_out.stall <= '1' when wb_mosi_in.stb = '1' and wb_mosi_in.we = '1' and wb_mosi_in.adr(7 downto 0) = x"18" and queue_full = '1' else '0';
+
+    wb_proc : process (clk) is
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                wb_miso_out.ack <= '0';
+                wb_miso_out.err <= '0';
+                wb_miso_out.rty <= '0';
+                queue_push      <= '0';
+                err_clear       <= '0';
+            else
+                -- defaults
+                wb_miso_out.ack  <= '0';
+                wb_miso_out.err  <= '0'; -- this slave does not generate ERR or RTY responses
+                wb_miso_out.rty  <= '0';
+                wb_miso_out.rdat <= x"DEADC0DE";
+                queue_push       <= '0';
+                err_clear        <= '0';
+
+                if wb_mosi_in.stb = '1' and wb_miso_out.stall = '0' then -- assume CYC asserted by master for STB to be high
+                    -- always ACK this cycle (sync operation with 1 wait state)
+                    wb_miso_out.ack <= '1';
+                    if wb_mosi_in.we = '1' then
+                        -- write logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => stage.dst <= unsigned(wb_mosi_in.wdat);
+                            when x"04" => stage.src <= unsigned(wb_mosi_in.wdat);
+                            when x"08" =>
+                            stage.width  <= unsigned(wb_mosi_in.wdat(15 downto 0));
+                            stage.height <= unsigned(wb_mosi_in.wdat(31 downto 16));
+                            when x"0C" =>
+                            stage.dst_stride <= unsigned(wb_mosi_in.wdat(15 downto 0));
+                            stage.src_stride <= unsigned(wb_mosi_in.wdat(31 downto 16));
+                            when x"10" => stage.fg <= wb_mosi_in.wdat;
+                            when x"14" => stage.bg <= wb_mosi_in.wdat;
+                            when x"18" =>
+                            stage.op   <= wb_mosi_in.wdat(1 downto 0);
+                            stage.flip <= wb_mosi_in.wdat(2);
+                            queue_push <= '1';
+                            when x"1C" => err_clear <= wb_mosi_in.wdat(2);
+                            when others => null;
+                        end case;
+                    else
+                        -- read logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => wb_miso_out.rdat <= std_logic_vector(stage.dst);
+                            when x"04" => wb_miso_out.rdat <= std_logic_vector(stage.src);
+                            when x"08" => wb_miso_out.rdat <= std_logic_vector(stage.height & stage.width);
+                            when x"0C" => wb_miso_out.rdat <= std_logic_vector(stage.src_stride & stage.dst_stride);
+                            when x"10" => wb_miso_out.rdat <= stage.fg;
+                            when x"14" => wb_miso_out.rdat <= stage.bg;
+                            when x"1C" =>
+                            wb_miso_out.rdat              <= (others => '0');
+                            wb_miso_out.rdat(0)           <= busy_out;
+                            wb_miso_out.rdat(1)           <= queue_full;
+                            wb_miso_out.rdat(2)           <= err;
+                            wb_miso_out.rdat(15 downto 8) <= uint2slv(queue_level, 8);
+                            when x"20"   => wb_miso_out.rdat <= std_logic_vector(done_count);
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+            end if; -- end clk'd
+        end if;
+    end process;
+
+    -- push one cycle after the CMD write so the staged op has been updated
+    queue_proc : process (clk) is
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                queue_wr    <= 0;
+                queue_rd    <= 0;
+                queue_level <= 0;
+            else
+                if queue_push = '1' then
+                    queue(queue_wr) <= stage;
+                    queue_wr        <= (queue_wr + 1) mod G_QUEUE_DEPTH;
+                end if;
+                if queue_pop = '1' then
+                    queue_rd <= (queue_rd + 1) mod G_QUEUE_DEPTH;
+                end if;
+                if queue_push = '1' and queue_pop = '0' then
+                    queue_level <= queue_level + 1;
+                elsif queue_push = '0' and queue_pop = '1' then
+                    queue_level <= queue_level - 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    ---------------------------------------------------------------------------
+    -- Font RAM (read only)
+    ---------------------------------------------------------------------------
+    font_ram : entity work.simple_dual_two_clocks
+        generic map(
+            ADDR_W           => FONT_ADDR_W,
+            DATA_W           => CHAR_W,
+            DEPTH            => 2 ** FONT_ADDR_W,
+            USE_INIT_FILE    => G_FONT_FILE /= "",
+            INIT_FILE_NAME   => G_FONT_FILE,
+            INIT_FILE_IS_HEX => false
+        )
+        port map(
+            clka  => clk,
+            clkb  => clk,
+            ena   => '0',
+            enb   => '1',
+            wea   => '0',
+            addra => (others => '0'),
+            addrb => font_addr,
+            dia   => (others => '0'),
+            dob   => font_row
+        );
+
+    -- bit 7 is the leftmost pixel
+    font_bit <= font_row(CHAR_W - 1 - to_integer(burst_x(2 downto 0) + beat(2 downto 0)));
+
+    -- RGB24: the 3 bytes of pixel `beat`, which may span 2 words of the line buffer
+    rgb_proc : process (all) is
+        variable k : integer range 0 to 63;
+        variable b : std_logic_vector(23 downto 0);
+    begin
+        for i in 0 to 2 loop
+            k                         := to_integer(src_byte) + 3 * to_integer(beat(3 downto 0)) + i;
+            b(8 * i + 7 downto 8 * i) := line_buf(k / 4 mod MAX_BURST)(8 * (k mod 4) + 7 downto 8 * (k mod 4));
+        end loop;
+        rgb <= x"00" & b;
+    end process;
+
+    ---------------------------------------------------------------------------
+    -- AXI3 master
+    ---------------------------------------------------------------------------
+    axi_mosi_out.wdata <= line_buf(to_integer(beat(3 downto 0))) when cmd.op = OP_COPY else
+                          rgb when cmd.op = OP_RGB24 else
+                          cmd.bg when cmd.op = OP_GLYPH and font_bit = '0' else
+                          cmd.fg;
+
+    axi_mosi_out.wlast  <= '1' when beat = burst_len - 1 else '0';
+    axi_mosi_out.rready <= '1' when state = READ else '0';
+    axi_mosi_out.bready <= '1';
+
+    aw_accept <= axi_mosi_out.awvalid and axi_miso_in.awready;
+    b_accept  <= axi_miso_in.bvalid;
+
+    blit_proc : process (clk) is
+        variable v_len   : unsigned(15 downto 0);
+        variable v_addr  : unsigned(31 downto 0);
+        variable v_words : unsigned(4 downto 0);
+        variable v_first : unsigned(10 downto 0);
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                state                <= IDLE;
+                queue_pop            <= '0';
+                axi_mosi_out.arvalid <= '0';
+                axi_mosi_out.awvalid <= '0';
+                axi_mosi_out.wvalid  <= '0';
+                outstanding          <= 0;
+                err                  <= '0';
+                done_count           <= (others => '0');
+            else
+                queue_pop <= '0';
+
+                -- write responses
+                if aw_accept = '1' and b_accept = '0' then
+                    outstanding <= outstanding + 1;
+                elsif aw_accept = '0' and b_accept = '1' then
+                    outstanding <= outstanding - 1;
+                end if;
+
+                if err_clear = '1' then
+                    err <= '0';
+                end if;
+                if (axi_miso_in.bvalid = '1' and axi_miso_in.bresp /= b"00") or
+                    (axi_miso_in.rvalid = '1' and axi_mosi_out.rready = '1' and axi_miso_in.rresp /= b"00") then
+                    err <= '1';
+                end if;
+
+                if axi_mosi_out.awvalid = '1' and axi_miso_in.awready = '1' then
+                    axi_mosi_out.awvalid <= '0';
+                end if;
+                if axi_mosi_out.arvalid = '1' and axi_miso_in.arready = '1' then
+                    axi_mosi_out.arvalid <= '0';
+                end if;
+
+                case state is
+                    ---------------------------------
+                    -- wait for a command
+                    ---------------------------------
+                    when IDLE =>
+                        if queue_level /= 0 then
+                            cmd       <= queue(queue_rd);
+                            queue_pop <= '1';
+                            if queue(queue_rd).op = OP_GLYPH then
+                                cmd.width  <= to_unsigned(CHAR_W, 16);
+                                cmd.height <= to_unsigned(CHAR_H, 16);
+                            end if;
+                            reverse <= '0';
+                            dst_up  <= queue(queue_rd).flip;
+                            if queue(queue_rd).op = OP_COPY and queue(queue_rd).flip = '0' and
+                                queue(queue_rd).dst > queue(queue_rd).src then
+                                reverse <= '1';
+                                dst_up  <= '1';
+                            end if;
+                            state <= START;
+                        end if;
+
+                    when START =>
+                        line_count <= cmd.height;
+                        line_idx   <= (others => '0');
+                        dst_line <= cmd.dst;
+                        src_line <= cmd.src;
+                        if dst_up = '1' then
+                            dst_line <= cmd.dst + resize((cmd.height - 1) * cmd.dst_stride, 32);
+                        end if;
+                        if reverse = '1' then
+                            src_line <= cmd.src + resize((cmd.height - 1) * cmd.src_stride, 32);
+                        end if;
+                        if cmd.width = 0 or cmd.height = 0 then
+                            state <= WAIT_RESP;
+                        else
+                            state <= LINE_START;
+                        end if;
+
+                    when LINE_START =>
+                        dst_chunk  <= dst_line;
+                        src_chunk  <= src_line;
+                        words_left <= cmd.width;
+                        x_pos      <= (others => '0');
+                        font_addr  <= std_logic_vector(cmd.src(7 downto 0)) & std_logic_vector(line_idx(3 downto 0));
+                        if cmd.op = OP_GLYPH then
+                            state <= FONT_WAIT;
+                        else
+                            state <= CHUNK;
+                        end if;
+
+                    when FONT_WAIT =>
+                        state <= CHUNK; -- font_row valid from CHUNK onwards
+
+                    ---------------------------------
+                    -- start the next burst of this line
+                    ---------------------------------
+                    when CHUNK =>
+                        -- stop bursts crossing a 64 byte boundary
+                        v_len := min(words_left, to_unsigned(MAX_BURST - to_integer(dst_chunk(5 downto 2)), 16));
+                        if cmd.op = OP_COPY then
+                            v_len := min(v_len, to_unsigned(MAX_BURST - to_integer(src_chunk(5 downto 2)), 16));
+                        end if;
+
+                        if outstanding < G_MAX_OUTSTANDING then
+                            burst_len  <= v_len(4 downto 0);
+                            burst_dst  <= dst_chunk;
+                            burst_x    <= x_pos;
+                            words_left <= words_left - v_len;
+                            x_pos      <= x_pos + v_len;
+                            dst_chunk  <= dst_chunk + shift_left(resize(v_len, 32), 2);
+                            src_chunk  <= src_chunk + shift_left(resize(v_len, 32), 2);
+                            beat       <= (others => '0');
+                            rbeat      <= (others => '0');
+
+                            if cmd.op = OP_RGB24 then
+                                -- the words holding 3 * v_len bytes, in two bursts if they cross 4KB
+                                v_addr    := src_chunk(31 downto 2) & "00";
+                                v_words   := resize(shift_right(resize(src_chunk(1 downto 0), 8) + 3 * v_len(7 downto 0) + 3, 2), 5);
+                                v_first   := to_unsigned(1024, 11) - v_addr(11 downto 2);
+                                if v_first < v_words then
+                                    v_words := v_first(4 downto 0);
+                                end if;
+                                src_byte  <= src_chunk(1 downto 0);
+                                src_chunk <= src_chunk + resize(3 * v_len, 32);
+                                rd_addr   <= v_addr + shift_left(resize(v_words, 32), 2);
+                                rd_rest   <= resize(shift_right(resize(src_chunk(1 downto 0), 8) + 3 * v_len(7 downto 0) + 3, 2), 5) - v_words;
+                                axi_mosi_out.araddr  <= std_logic_vector(v_addr);
+                                axi_mosi_out.arlen   <= std_logic_vector(resize(v_words - 1, 4));
+                                axi_mosi_out.arvalid <= '1';
+                                state                <= READ;
+                            elsif cmd.op = OP_COPY then
+                                axi_mosi_out.araddr  <= std_logic_vector(src_chunk);
+                                axi_mosi_out.arlen   <= std_logic_vector(resize(v_len - 1, 4));
+                                axi_mosi_out.arvalid <= '1';
+                                state                <= READ;
+                            else
+                                axi_mosi_out.awaddr  <= std_logic_vector(dst_chunk);
+                                axi_mosi_out.awlen   <= std_logic_vector(resize(v_len - 1, 4));
+                                axi_mosi_out.awvalid <= '1';
+                                axi_mosi_out.wvalid  <= '1';
+                                state                <= WRITE;
+                            end if;
+                        end if;
+
+                    ---------------------------------
+                    -- COPY: read the source burst into the line buffer
+                    ---------------------------------
+                    when READ =>
+                        if axi_miso_in.rvalid = '1' then
+                            line_buf(to_integer(rbeat(3 downto 0))) <= axi_miso_in.rdata;
+                            rbeat                                   <= rbeat + 1;
+                            if axi_miso_in.rlast = '1' and rd_rest /= 0 and cmd.op = OP_RGB24 then
+                                -- rest of the pixels, after the 4KB boundary
+                                axi_mosi_out.araddr  <= std_logic_vector(rd_addr);
+                                axi_mosi_out.arlen   <= std_logic_vector(resize(rd_rest - 1, 4));
+                                axi_mosi_out.arvalid <= '1';
+                                rd_rest              <= (others => '0');
+                            elsif axi_miso_in.rlast = '1' then
+                                axi_mosi_out.awaddr  <= std_logic_vector(burst_dst);
+                                axi_mosi_out.awlen   <= std_logic_vector(resize(burst_len - 1, 4));
+                                axi_mosi_out.awvalid <= '1';
+                                axi_mosi_out.wvalid  <= '1';
+                                state                <= WRITE;
+                            end if;
+                        end if;
+
+                    ---------------------------------
+                    -- send the burst's write data (AW sent alongside)
+                    ---------------------------------
+                    when WRITE =>
+                        if axi_mosi_out.wvalid = '1' and axi_miso_in.wready = '1' then
+                            beat <= beat + 1;
+                            if axi_mosi_out.wlast = '1' then
+                                axi_mosi_out.wvalid <= '0';
+                                state               <= WRITE_END;
+                            end if;
+                        end if;
+
+                    when WRITE_END =>
+                        if axi_mosi_out.awvalid = '0' then
+                            if words_left = 0 then
+                                state <= NEXT_LINE;
+                            else
+                                state <= CHUNK;
+                            end if;
+                        end if;
+
+                    when NEXT_LINE =>
+                        line_count <= line_count - 1;
+                        line_idx   <= line_idx + 1;
+                        if dst_up = '1' then
+                            dst_line <= dst_line - cmd.dst_stride;
+                        else
+                            dst_line <= dst_line + cmd.dst_stride;
+                        end if;
+                        if reverse = '1' then
+                            src_line <= src_line - cmd.src_stride;
+                        else
+                            src_line <= src_line + cmd.src_stride;
+                        end if;
+                        if line_count = 1 then
+                            state <= WAIT_RESP;
+                        else
+                            state <= LINE_START;
+                        end if;
+
+                    ---------------------------------
+                    -- all data written to memory before the next command can read it
+                    ---------------------------------
+                    when WAIT_RESP =>
+                        if outstanding = 0 and axi_mosi_out.awvalid = '0' then
+                            done_count <= done_count + 1;
+                            state      <= IDLE;
+                        end if;
+
+                    when others =>
+                        state <= IDLE;
+                end case;
+            end if;
+        end if;
+    end process;
+
+    -- fixed AXI3 parameters
+    axi_mosi_out.arburst <= AXI_BURST_INCR;
+    axi_mosi_out.arcache <= b"0010"; -- Non bufferable, non-cacheable, modifiable (so can upsize to 64b in Zynq DDR3 controller)
+    axi_mosi_out.arid    <= x"000";  -- ID = 0 (all transactions must be in order)
+    axi_mosi_out.arlock  <= b"00";   -- normal transaction
+    axi_mosi_out.arprot  <= b"000";  -- Unpriviledged, Secure, Data access
+    axi_mosi_out.arqos   <= x"0";    -- No QoS in use
+    axi_mosi_out.arsize  <= b"010";  -- 4 bytes per transfer
+    axi_mosi_out.awburst <= AXI_BURST_INCR;
+    axi_mosi_out.awcache <= b"0010";
+    axi_mosi_out.awid    <= x"000";
+    axi_mosi_out.awlock  <= b"00";
+    axi_mosi_out.awprot  <= b"000";
+    axi_mosi_out.awqos   <= x"0";
+    axi_mosi_out.awsize  <= b"010";
+    axi_mosi_out.wid     <= x"000";
+    axi_mosi_out.wstrb   <= x"F";
+end architecture;
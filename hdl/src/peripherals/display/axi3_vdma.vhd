@@ -13,7 +13,7 @@ use xpm.vcomponents.all;
 -- Reads  out a framebuffer from an AXI3 connected memory (ideally Zynq DDR3)
 --
 -- Generics:
--- VGA resolution parameters
+-- VGA timing presets, selected at runtime with timing_sel (see graphics_pkg)
 --
 -- Inputs:
 -- framebuffer start address (to support multiple buffering)
@@ -22,28 +22,21 @@ use xpm.vcomponents.all;
 -- Outputs:
 -- VGA RGB and sync signals
 --
--- 32 bits per pixel
+-- 32, 16 or 8 bits per pixel
 -- Note: uses Xilinx XPMs for CDC
 --
---  TODO:
---  There is a bug where the final pixel on each row is not displayed (black instead)
+-- Scan-out tuning: line reads are issued as bursts of up to dma_max_burst words with at most
+-- dma_queue_limit outstanding. Bursts stop when the pixel FIFO reaches the high watermark and
+-- restart once it has drained below the low watermark, so leave (queue_limit * burst) words of
+-- headroom above the high watermark for data already in flight.
+-- The stat_* outputs report the previous frame, and are updated at each start of frame.
 
 entity axi3_vdma is
     generic (
-        -- display parameters (default 640*480)
-        G_END_ACTIVE_X  : integer := 640;
-        G_FRONT_PORCH_X : integer := 16;
-        G_SYNC_PULSE_X  : integer := 96;
-        G_BACK_PORCH_X  : integer := 48;
-
-        G_END_ACTIVE_Y  : integer   := 480;
-        G_FRONT_PORCH_Y : integer   := 10;
-        G_SYNC_PULSE_Y  : integer   := 2;
-        G_BACK_PORCH_Y  : integer   := 33;
-        G_ACTIVE_HS     : std_logic := '0';
-        G_ACTIVE_VS     : std_logic := '0';
-
-        G_PIXEL_FIFO_DEPTH : integer := 512; --! Experiment to see how big this needs to be
+        -- display timings (default 640*480 only). The pixel clock must be switched to match
+        G_TIMING_PRESETS : t_video_timing_arr := (0 => C_VIDEO_640X480_60);
+
+        G_PIXEL_FIFO_DEPTH : integer := 512; --! in words. Size against stat_fifo_min_level with the expected DDR load
         G_ILA              : boolean := false
     );
     port (
@@ -71,24 +64,95 @@ entity axi3_vdma is
         -- frame_skip_count_out      : out std_logic_vector(31 downto 0);  --! count of when we have to display an old frame as the new one isn't ready yet
         pixel_underflow_count_dma_clk_out : out std_logic_vector(31 downto 0); --! (dma_clk) count of when our DMA is too slow/not enough buffering
         start_of_frame_dma_clk_out        : out std_logic;                     --! (dma_clk) to clear next_frame_ready/CPU interrupt
-        buffer_sel_dma_clk_in             : in std_logic                       --! (dma_clk) From CPU/GPU logic - choose which buffer to use next
+        buffer_sel_dma_clk_in             : in std_logic;                      --! (dma_clk) From CPU/GPU logic - choose which buffer to use next
+        active_buffer_dma_clk_out         : out std_logic := '0';              --! (dma_clk) buffer being scanned out, latched from buffer_sel at VSYNC
+
+        -- pixel format and timing (latched at VSYNC along with the buffer select)
+        pixel_format_dma_clk_in   : in std_logic_vector(1 downto 0) := C_VDMA_FORMAT_32BPP; --! (dma_clk)
+        timing_sel_dma_clk_in     : in std_logic_vector(1 downto 0) := "00";                --! (dma_clk) index into G_TIMING_PRESETS
+        palette_select_dma_clk_in : in std_logic                    := '0';                 --! (dma_clk) 8bpp: 0 for colour, 1 for greyscale palette
+
+        -- palette RAM access (flex_vga_palette), 0x000-0x0FF colour, 0x100-0x1FF greyscale
+        palette_clk_in   : in std_logic                     := '0';
+        palette_addr_in  : in std_logic_vector(8 downto 0)  := (others => '0');
+        palette_stb_in   : in std_logic                     := '0';
+        palette_we_in    : in std_logic                     := '0';
+        palette_wdat_in  : in std_logic_vector(23 downto 0) := x"00_00_00"; -- RGB 8-8-8 format
+        palette_rdat_out : out std_logic_vector(23 downto 0);
+        palette_ack_out  : out std_logic;
+
+        -- scan-out tuning (dma_clk, quasi-static)
+        dma_max_burst_dma_clk_in       : in std_logic_vector(4 downto 0)  := "10000";                              --! burst length, 1-16 words
+        dma_queue_limit_dma_clk_in     : in std_logic_vector(4 downto 0)  := "00001";                              --! max outstanding bursts, 1-16
+        fifo_high_watermark_dma_clk_in : in std_logic_vector(15 downto 0) := uint2slv(G_PIXEL_FIFO_DEPTH - 64, 16); --! stop issuing bursts at this FIFO level (words)
+        fifo_low_watermark_dma_clk_in  : in std_logic_vector(15 downto 0) := uint2slv(G_PIXEL_FIFO_DEPTH - 64, 16); --! resume once below this level
+
+        -- health counters for the previous frame (dma_clk, updated with start_of_frame)
+        stat_frame_underflows_dma_clk_out : out std_logic_vector(31 downto 0) := (others => '0'); --! pixels with no data in the active area
+        stat_fifo_min_level_dma_clk_out   : out std_logic_vector(15 downto 0) := (others => '0'); --! lowest pixel FIFO level (words) in the active area
+        stat_max_outstanding_dma_clk_out  : out std_logic_vector(7 downto 0)  := (others => '0'); --! most AXI read bursts in flight at once
+        stat_max_latency_dma_clk_out      : out std_logic_vector(15 downto 0) := (others => '0')  --! worst dma_clk cycles from AR accepted to first R beat
 
     );
 end entity axi3_vdma;
 
 architecture rtl of axi3_vdma is
-    constant G_END_FPORCH_X : integer := G_END_ACTIVE_X + G_FRONT_PORCH_X;
-    constant G_END_SYNC_X   : integer := G_END_FPORCH_X + G_SYNC_PULSE_X;
-    constant G_END_BPORCH_X : integer := G_END_SYNC_X + G_BACK_PORCH_X; -- 800
+    constant MAX_ACTIVE_X : natural := video_max_active_x(G_TIMING_PRESETS);
+    constant MAX_TOTAL_X  : natural := video_max_total_x(G_TIMING_PRESETS);
+    constant MAX_TOTAL_Y  : natural := video_max_total_y(G_TIMING_PRESETS);
+
+    -- counter end points for each preset, so nothing is added up at runtime
+    type t_timing_ends is record
+        end_active_x : natural;
+        end_fporch_x : natural;
+        end_sync_x   : natural;
+        end_bporch_x : natural; -- line length
+        end_active_y : natural;
+        end_fporch_y : natural;
+        end_sync_y   : natural;
+        end_bporch_y : natural; -- frame length
+        active_hs    : std_logic;
+        active_vs    : std_logic;
+        line_shift   : natural; -- 32bpp framebuffer line stride
+    end record;
+    type t_timing_ends_arr is array (natural range <>) of t_timing_ends;
+
+    function get_timing_ends(presets : t_video_timing_arr) return t_timing_ends_arr is
+        variable v_ends : t_timing_ends_arr(presets'range);
+    begin
+        for i in presets'range loop
+            v_ends(i).end_active_x := presets(i).active_x;
+            v_ends(i).end_fporch_x := presets(i).active_x + presets(i).fporch_x;
+            v_ends(i).end_sync_x   := v_ends(i).end_fporch_x + presets(i).sync_x;
+            v_ends(i).end_bporch_x := v_ends(i).end_sync_x + presets(i).bporch_x;
+            v_ends(i).end_active_y := presets(i).active_y;
+            v_ends(i).end_fporch_y := presets(i).active_y + presets(i).fporch_y;
+            v_ends(i).end_sync_y   := v_ends(i).end_fporch_y + presets(i).sync_y;
+            v_ends(i).end_bporch_y := v_ends(i).end_sync_y + presets(i).bporch_y;
+            v_ends(i).active_hs    := presets(i).active_hs;
+            v_ends(i).active_vs    := presets(i).active_vs;
+            v_ends(i).line_shift   := video_line_shift(presets(i));
+        end loop;
+        return v_ends;
+    end function;
+
+    constant PRESET_ENDS : t_timing_ends_arr(G_TIMING_PRESETS'range) := get_timing_ends(G_TIMING_PRESETS);
+
+    --! out of range selections fall back to the first preset
+    function clamp_preset(sel : std_logic_vector) return natural is
+    begin
+        if to_integer(unsigned(sel)) > G_TIMING_PRESETS'high then
+            return G_TIMING_PRESETS'low;
+        end if;
+        return to_integer(unsigned(sel));
+    end function;
 
-    constant G_END_FPORCH_Y : integer := G_END_ACTIVE_Y + G_FRONT_PORCH_Y;
-    constant G_END_SYNC_Y   : integer := G_END_FPORCH_Y + G_SYNC_PULSE_Y;
-    constant G_END_BPORCH_Y : integer := G_END_SYNC_Y + G_BACK_PORCH_Y; -- 525
+    -- pixelclk timing, switched at the end of the VSYNC pulse
+    signal pix_ends : t_timing_ends := PRESET_ENDS(G_TIMING_PRESETS'low);
 
-    signal h_count : integer range 0 to G_END_BPORCH_X := G_END_ACTIVE_X;
-    signal v_count : integer range 0 to G_END_BPORCH_Y := G_END_ACTIVE_Y;
+    signal h_count : integer range 0 to MAX_TOTAL_X := PRESET_ENDS(G_TIMING_PRESETS'low).end_active_x;
+    signal v_count : integer range 0 to MAX_TOTAL_Y := PRESET_ENDS(G_TIMING_PRESETS'low).end_active_y;
 
-    signal data_enable        : std_logic;
     signal dma_start          : std_logic;
     signal dma_done           : std_logic;
     signal dma_start_addr     : std_logic_vector(31 downto 0);
@@ -103,23 +167,61 @@ architecture rtl of axi3_vdma is
     signal pixel_axi_stream_miso : t_axi_stream32_miso;
     type t_state is (WAIT_FOR_FLUSH, WAIT_FOR_VSYNC, LINE_DMA_START, LINE_DMA_WAIT);
     signal state : t_state := WAIT_FOR_FLUSH;
-    -- framebuffer parameters (default 640x480)
-    -- needs to be power of 2 larger than G_END_ACTIVE_X so we can avoid multiplication for address calculation.
-    -- This uses about 2MB per frame for 640x480 @32bpp, which gives us loads of room in the Zynq DDR3
-    constant LINE_ADDR_SHIFT_AMOUNT : integer := clog2(G_END_ACTIVE_X) + 2;
+    -- framebuffer parameters
+    -- the line stride is a power of 2 larger than active_x so we can avoid multiplication for address calculation.
+    -- This uses about 2MB per frame for 640x480 @32bpp (8MB for 1280x720), which gives us loads of room in the Zynq DDR3
 
     -- for example, consider a line 640 pixels wide. We need clog2(640) = 10 bits to store this
     -- so the line offset becomes Y << (10 + 2)
     -- So line 0 has an offset of 0
     -- line 1 has an word offset of 1024 (byte 4096)
 
+    -- pixel format, latched at VSYNC
+    signal dma_format          : std_logic_vector(1 downto 0) := C_VDMA_FORMAT_32BPP;
+    signal dma_palette_select  : std_logic                    := '0';
+    signal dma_preset          : natural range G_TIMING_PRESETS'range := G_TIMING_PRESETS'low;
+    signal dma_line_words      : integer range 0 to MAX_ACTIVE_X;
+    signal dma_line_shift      : integer range 0 to 31;
+    signal pixel_format        : std_logic_vector(1 downto 0) := C_VDMA_FORMAT_32BPP;
+    signal pixel_palette_select : std_logic                   := '0';
+    signal dma_timing_sel      : std_logic_vector(1 downto 0) := "00";
+    signal cdc_to_pixelclk_arr : std_logic_vector(4 downto 0);
+    signal sub_pixel           : unsigned(1 downto 0) := (others => '0'); -- pixel within the current word
+    signal last_sub_pixel      : std_logic;
+    signal pixel_active        : std_logic;
+    signal pixel_byte          : std_logic_vector(7 downto 0);
+    signal pixel_565           : std_logic_vector(15 downto 0);
+    signal palette_pixel       : t_pixel;
+
+    -- scan-out tuning
+    constant FIFO_COUNT_W      : integer := clog2(G_PIXEL_FIFO_DEPTH) + 1;
+    signal pixel_fifo_wr_count : std_logic_vector(FIFO_COUNT_W - 1 downto 0); -- dma_clk
+    signal pixel_fifo_rd_count : std_logic_vector(FIFO_COUNT_W - 1 downto 0); -- pixelclk
+    signal dma_queue_limit_1_16 : integer range 1 to 16;
+    signal watermark_stall      : std_logic := '0';
+
+    -- health counters
+    type t_timestamp_arr is array (0 to 15) of unsigned(15 downto 0);
+    signal ar_timestamps       : t_timestamp_arr;                    -- AR accept times of the bursts in flight
+    signal ts_wr_ptr           : unsigned(3 downto 0) := (others => '0');
+    signal ts_rd_ptr           : unsigned(3 downto 0) := (others => '0');
+    signal dma_cycle_count     : unsigned(15 downto 0) := (others => '0');
+    signal r_first_beat        : std_logic             := '1';
+    signal mon_outstanding     : unsigned(7 downto 0)  := (others => '0');
+    signal mon_max_outstanding : unsigned(7 downto 0)  := (others => '0');
+    signal mon_max_latency     : unsigned(15 downto 0) := (others => '0');
+    signal frame_underflows    : unsigned(31 downto 0) := (others => '0'); -- pixelclk, current frame
+    signal fifo_min_level      : unsigned(FIFO_COUNT_W - 1 downto 0) := (others => '1');
+    -- pixelclk, previous frame. Latched at the end of the active area, well before the next VSYNC
+    signal last_frame_underflows : unsigned(31 downto 0)                := (others => '0');
+    signal last_fifo_min_level   : unsigned(FIFO_COUNT_W - 1 downto 0) := (others => '0');
+    signal cdc_stats_arr         : std_logic_vector(32 + FIFO_COUNT_W - 1 downto 0);
+
     signal dma_line_count               : unsigned(31 downto 0);
     signal dma_frame_addr_offset        : unsigned(31 downto 0);
     signal vga_hsync                    : std_logic;
     signal vga_vsync                    : std_logic;
     signal vga_vsync_dma_clk            : std_logic;
-    signal pixel_fifo_prog_full         : std_logic;
-    signal pixel_fifo_prog_full_dma_clk : std_logic;
     signal pixel_fifo_empty             : std_logic;
     signal pixel_fifo_empty_dma_clk     : std_logic; -- cdc so we know when the flush is completed
     -- status reporting
@@ -163,34 +265,42 @@ begin
     -- and also to generate the HSYNC, VSYNC and BLANK signals
     -- NOTE: these control signals are registered, so are asserted one cycle after the counter reaches that value
     sync_counters : process (pixelclk_in)
+        variable v_hsync : std_logic;
+        variable v_vsync : std_logic;
     begin
         if rising_edge(pixelclk_in) then
             if pixelclk_reset_in = '1' then
                 -- reset to the end of the active area to give DMA time to fill the FIFO
-                h_count     <= G_END_ACTIVE_X;
-                v_count     <= G_END_ACTIVE_Y;
-                data_enable <= '0';
+                pix_ends    <= PRESET_ENDS(G_TIMING_PRESETS'low);
+                h_count     <= PRESET_ENDS(G_TIMING_PRESETS'low).end_active_x;
+                v_count     <= PRESET_ENDS(G_TIMING_PRESETS'low).end_active_y;
             else
                 -- counters
-                -- h_count <= 0 when h_count >= G_END_BPORCH_X else h_count + 1;
-
-                if h_count >= G_END_BPORCH_X then
+                if h_count >= pix_ends.end_bporch_x - 1 then
                     h_count <= 0;
-                    v_count <= 0 when v_count >= G_END_BPORCH_Y else v_count + 1;
+                    if v_count = pix_ends.end_sync_y - 1 then
+                        -- apply the timing latched by the DMA at VSYNC from the back porch, so the
+                        -- next frame's active area is entirely in the new mode
+                        pix_ends <= PRESET_ENDS(clamp_preset(cdc_to_pixelclk_arr(4 downto 3)));
+                        v_count  <= PRESET_ENDS(clamp_preset(cdc_to_pixelclk_arr(4 downto 3))).end_sync_y;
+                    else
+                        v_count <= 0 when v_count >= pix_ends.end_bporch_y - 1 else v_count + 1;
+                    end if;
                 else
                     h_count <= h_count + 1;
                 end if;
 
-                --blanking signal
-                data_enable <= '1' when ((h_count < G_END_ACTIVE_X) and (v_count < G_END_ACTIVE_Y)) else '0';
-
-                --sync signals
-                vga_hsync <= G_ACTIVE_HS when ((h_count >= G_END_FPORCH_X) and (h_count < G_END_SYNC_X)) else not G_ACTIVE_HS;
-                vga_vsync <= G_ACTIVE_VS when ((v_count >= G_END_FPORCH_Y) and (v_count < G_END_SYNC_Y)) else not G_ACTIVE_VS;
-                -- register all these again to add an extra cycle of delay to match up with TREADY on the pixel fifo
-                vga_blank_out <= not data_enable;
-                vga_vsync_out <= vga_vsync;
-                vga_hsync_out <= vga_hsync;
+                --sync signals (active high until the output)
+                v_hsync := '1' when ((h_count >= pix_ends.end_fporch_x) and (h_count < pix_ends.end_sync_x)) else '0';
+                v_vsync := '1' when ((v_count >= pix_ends.end_fporch_y) and (v_count < pix_ends.end_sync_y)) else '0';
+                vga_hsync <= v_hsync;
+                vga_vsync <= v_vsync;
+                -- registered once, the same as vga_pixel_out (TREADY is combinational on h_count), so the
+                -- blanking lines up with the pixels. A second register here blanked the first pixel of
+                -- each row and showed the black after the last one instead
+                vga_blank_out <= not pixel_active;
+                vga_vsync_out <= v_vsync xnor pix_ends.active_vs;
+                vga_hsync_out <= v_hsync xnor pix_ends.active_hs;
             end if;
         end if;
     end process;
@@ -208,7 +318,8 @@ begin
             dma_start_addr_in     => dma_start_addr,
             dma_axi_burst_mode_in => AXI_BURST_INCR,
             dma_num_words_in      => dma_num_words(12 - 1 downto 0),
-            dma_queue_limit_in    => uint2slv(1),
+            dma_queue_limit_in    => uint2slv(dma_queue_limit_1_16),
+            dma_max_burst_in      => dma_max_burst_dma_clk_in,
             dma_stall_in          => dma_stall,
             dma_done_out          => dma_done,
             dma_axi_hp_mosi_out   => dma_axi_hp_mosi_out,
@@ -217,6 +328,16 @@ begin
             axi_stream_miso_in    => dma_axi_stream_miso
         );
 
+    -- smaller pixel formats pack more pixels into each word, and each line into fewer bytes
+    with dma_format select dma_line_words <=
+        PRESET_ENDS(dma_preset).end_active_x / 2 when C_VDMA_FORMAT_16BPP,
+        PRESET_ENDS(dma_preset).end_active_x / 4 when C_VDMA_FORMAT_8BPP,
+        PRESET_ENDS(dma_preset).end_active_x when others;
+    with dma_format select dma_line_shift <=
+        PRESET_ENDS(dma_preset).line_shift - 1 when C_VDMA_FORMAT_16BPP,
+        PRESET_ENDS(dma_preset).line_shift - 2 when C_VDMA_FORMAT_8BPP,
+        PRESET_ENDS(dma_preset).line_shift when others;
+
     dma_ctrl_proc : process (dma_clk_in)
         variable v_dma_line_addr_offset : unsigned(31 downto 0);
     begin
@@ -250,10 +371,15 @@ begin
                         ----------------------------------------------------------------
                         -- when we get a VSYNC, we can then get ready for the next frame
                         ----------------------------------------------------------------
-                        if vga_vsync_dma_clk = G_ACTIVE_VS then
+                        if vga_vsync_dma_clk = '1' then
                             start_of_frame_dma_clk_out <= '1';
                             dma_line_count             <= (others => '0');
                             dma_frame_addr_offset      <= unsigned(buffer1_start_in) when buffer_sel_dma_clk_in = '1' else unsigned(buffer0_start_in);
+                            active_buffer_dma_clk_out  <= buffer_sel_dma_clk_in;
+                            dma_format                 <= pixel_format_dma_clk_in;
+                            dma_palette_select         <= palette_select_dma_clk_in;
+                            dma_timing_sel             <= timing_sel_dma_clk_in;
+                            dma_preset                 <= clamp_preset(timing_sel_dma_clk_in);
                             state                      <= LINE_DMA_START;
                         end if;
 
@@ -263,21 +389,21 @@ begin
                         --------------------------------------------------------
                         if dma_done = '1' then
                             dma_start <= '1';
-                            v_dma_line_addr_offset := shift_left(dma_line_count, LINE_ADDR_SHIFT_AMOUNT);
+                            v_dma_line_addr_offset := shift_left(dma_line_count, dma_line_shift);
                             dma_start_addr <= std_logic_vector(dma_frame_addr_offset + v_dma_line_addr_offset);
-                            dma_num_words  <= uint2slv(G_END_ACTIVE_X); -- number of horizontal pixels
+                            dma_num_words  <= uint2slv(dma_line_words); -- 1, 2 or 4 pixels per word
                             state          <= LINE_DMA_WAIT;
                         end if;
 
                     when LINE_DMA_WAIT =>
                         --------------------------------------------------------
                         -- Wait for the line buffer transfer to complete
-                        -- (can be stalled by pixel_fifo_prog_full)
+                        -- (can be stalled by the pixel FIFO watermarks)
                         --------------------------------------------------------
                         dma_start <= '0';
                         if dma_done = '1' then
                             -- if we have finished reading out the current frame, wait until the next one is ready
-                            if dma_line_count = G_END_ACTIVE_Y - 1 then
+                            if dma_line_count = PRESET_ENDS(dma_preset).end_active_y - 1 then
                                 state <= WAIT_FOR_VSYNC;
                             else -- read out the next line
                                 dma_line_count <= dma_line_count + to_unsigned(1, dma_line_count'length);
@@ -292,8 +418,84 @@ begin
         end if;
     end process;
 
-    -- we will use the prog_full flag to stall the DMA transfer until we have room for another burst
-    dma_stall <= pixel_fifo_prog_full_dma_clk;
+    -- 0 would deadlock dma_axi3_read, and only 16 bursts fit in the latency monitor
+    dma_queue_limit_1_16 <= 1 when unsigned(dma_queue_limit_dma_clk_in) = 0 else
+                            16 when unsigned(dma_queue_limit_dma_clk_in) > 16 else
+                            slv2uint(dma_queue_limit_dma_clk_in);
+
+    -- stall the DMA transfer between the FIFO watermarks. The write side count lags reads
+    -- through the FIFO's CDC, so it can only overestimate the level
+    watermark_proc : process (dma_clk_in)
+    begin
+        if rising_edge(dma_clk_in) then
+            if unsigned(pixel_fifo_wr_count) >= unsigned(fifo_high_watermark_dma_clk_in) then
+                watermark_stall <= '1';
+            elsif unsigned(pixel_fifo_wr_count) < unsigned(fifo_low_watermark_dma_clk_in) then
+                watermark_stall <= '0';
+            end if;
+        end if;
+    end process;
+    dma_stall <= watermark_stall;
+
+    -- AXI read monitor: bursts in flight, and latency to the first beat of each burst (returned in order)
+    dma_monitor_proc : process (dma_clk_in)
+        variable v_ar_accept   : boolean;
+        variable v_r_last      : boolean;
+        variable v_outstanding : unsigned(7 downto 0);
+        variable v_latency     : unsigned(15 downto 0);
+    begin
+        if rising_edge(dma_clk_in) then
+            if dma_reset_in = '1' then
+                ts_wr_ptr           <= (others => '0');
+                ts_rd_ptr           <= (others => '0');
+                r_first_beat        <= '1';
+                mon_outstanding     <= (others => '0');
+                mon_max_outstanding <= (others => '0');
+                mon_max_latency     <= (others => '0');
+            else
+                dma_cycle_count <= dma_cycle_count + 1;
+                v_ar_accept     := dma_axi_hp_mosi_out.arvalid = '1' and dma_axi_hp_miso_in.arready = '1';
+                v_r_last        := dma_axi_hp_miso_in.rvalid = '1' and dma_axi_hp_mosi_out.rready = '1' and dma_axi_hp_miso_in.rlast = '1';
+                v_latency       := dma_cycle_count - ar_timestamps(to_integer(ts_rd_ptr));
+
+                if v_ar_accept then
+                    ar_timestamps(to_integer(ts_wr_ptr)) <= dma_cycle_count;
+                    ts_wr_ptr                            <= ts_wr_ptr + 1;
+                end if;
+
+                if dma_axi_hp_miso_in.rvalid = '1' and dma_axi_hp_mosi_out.rready = '1' then
+                    r_first_beat <= dma_axi_hp_miso_in.rlast;
+                    if r_first_beat = '1' then
+                        ts_rd_ptr <= ts_rd_ptr + 1;
+                        if v_latency > mon_max_latency then
+                            mon_max_latency <= v_latency;
+                        end if;
+                    end if;
+                end if;
+
+                v_outstanding := mon_outstanding;
+                if v_ar_accept and not v_r_last then
+                    v_outstanding := v_outstanding + 1;
+                elsif v_r_last and not v_ar_accept then
+                    v_outstanding := v_outstanding - 1;
+                end if;
+                mon_outstanding <= v_outstanding;
+                if v_outstanding > mon_max_outstanding then
+                    mon_max_outstanding <= v_outstanding;
+                end if;
+
+                -- report the previous frame and start again
+                if start_of_frame_dma_clk_out = '1' then
+                    stat_max_outstanding_dma_clk_out  <= std_logic_vector(mon_max_outstanding);
+                    stat_max_latency_dma_clk_out      <= std_logic_vector(mon_max_latency);
+                    stat_frame_underflows_dma_clk_out <= cdc_stats_arr(31 downto 0);
+                    stat_fifo_min_level_dma_clk_out   <= std_logic_vector(resize(unsigned(cdc_stats_arr(cdc_stats_arr'high downto 32)), 16));
+                    mon_max_outstanding               <= v_outstanding;
+                    mon_max_latency                   <= (others => '0');
+                end if;
+            end if;
+        end if;
+    end process;
 
     -- count the number of pixels accepted into the FIFO per frame
     process (dma_clk_in)
@@ -313,7 +515,7 @@ begin
     process (pixelclk_in)
     begin
         if rising_edge(pixelclk_in) then
-            if vga_vsync = G_ACTIVE_VS then
+            if vga_vsync = '1' then
                 pixel_pixel_count <= 0;
             else
                 if pixel_axi_stream_mosi.tvalid = '1' and pixel_axi_stream_miso.tready = '1' then
@@ -329,17 +531,26 @@ begin
 
     -- CDC back to the dma_clk domain (all bits must be independent)
 
-    pixel_fifo_empty_dma_clk     <= cdc_to_dma_clk_arr(2);
-    pixel_fifo_prog_full_dma_clk <= cdc_to_dma_clk_arr(1);
-    vga_vsync_dma_clk            <= cdc_to_dma_clk_arr(0);
+    pixel_fifo_empty_dma_clk <= cdc_to_dma_clk_arr(1);
+    vga_vsync_dma_clk        <= cdc_to_dma_clk_arr(0);
 
     xpm_cdc_to_dma_clk_inst : xpm_cdc_array_single
-    generic map(DEST_SYNC_FF => 2, WIDTH => 3)
+    generic map(DEST_SYNC_FF => 2, WIDTH => 2)
     port map(
-        dest_out => cdc_to_dma_clk_arr(2 downto 0),
+        dest_out => cdc_to_dma_clk_arr(1 downto 0),
         dest_clk => dma_clk_in,
         src_clk  => pixelclk_in,
-        src_in   => (pixel_fifo_empty, pixel_fifo_prog_full, vga_vsync)
+        src_in   => (pixel_fifo_empty, vga_vsync)
+    );
+
+    -- quasi-static, only sampled at the start of frame
+    xpm_cdc_stats_inst : xpm_cdc_array_single
+    generic map(DEST_SYNC_FF => 2, WIDTH => 32 + FIFO_COUNT_W)
+    port map(
+        dest_out => cdc_stats_arr,
+        dest_clk => dma_clk_in,
+        src_clk  => pixelclk_in,
+        src_in   => std_logic_vector(last_fifo_min_level) & std_logic_vector(last_frame_underflows)
     );
 
     pixel_fifo_empty <= not pixel_axi_stream_mosi.tvalid;
@@ -352,7 +563,7 @@ begin
             G_FIFO_DEPTH       => G_PIXEL_FIFO_DEPTH, -- experiment to find how small a FIFO we can get away with
             G_DATA_WIDTH       => 32,
             G_FULL_PACKET      => false,
-            G_PROG_FULL_THRESH => G_PIXEL_FIFO_DEPTH - 64 -- plenty of room for prog_full to CDC over and stop the issuing of more transactions
+            G_COUNT_WIDTH      => FIFO_COUNT_W
         )
         port map(
             input_clk                  => dma_clk_in,
@@ -362,7 +573,8 @@ begin
             input_axi_stream_miso_out  => dma_axi_stream_miso,
             output_axi_stream_mosi_out => pixel_axi_stream_mosi,
             output_axi_stream_miso_in  => pixel_axi_stream_miso,
-            prog_full                  => pixel_fifo_prog_full
+            wr_data_count              => pixel_fifo_wr_count,
+            rd_data_count              => pixel_fifo_rd_count
         );
 
     xpm_cdc_gray_to_dma_clk_inst : xpm_cdc_gray
@@ -381,24 +593,105 @@ begin
 
     );
 
+    -----------------------------------------------------------------
+    -- 4. Pixel format unpacking
+    -----------------------------------------------------------------
+    -- the format is latched at VSYNC in the dma_clk domain, and is stable again by the back porch
+    xpm_cdc_to_pixelclk_inst : xpm_cdc_array_single
+    generic map(DEST_SYNC_FF => 2, WIDTH => 5)
+    port map(
+        dest_out => cdc_to_pixelclk_arr,
+        dest_clk => pixelclk_in,
+        src_clk  => dma_clk_in,
+        src_in   => (dma_timing_sel(1), dma_timing_sel(0), dma_palette_select, dma_format(1), dma_format(0))
+    );
+
+    process (pixelclk_in)
+    begin
+        if rising_edge(pixelclk_in) then
+            if v_count = pix_ends.end_sync_y then
+                pixel_format         <= cdc_to_pixelclk_arr(1 downto 0);
+                pixel_palette_select <= cdc_to_pixelclk_arr(2);
+            end if;
+        end if;
+    end process;
+
+    -- pixels are packed little endian, so the leftmost pixel is in the LSBs
+    pixel_byte <= pixel_axi_stream_mosi.tdata(8 * to_integer(sub_pixel) + 7 downto 8 * to_integer(sub_pixel));
+    pixel_565  <= pixel_axi_stream_mosi.tdata(31 downto 16) when sub_pixel(0) = '1' else pixel_axi_stream_mosi.tdata(15 downto 0);
+
+    last_sub_pixel <= '1' when pixel_format = C_VDMA_FORMAT_32BPP else
+                      sub_pixel(0) when pixel_format = C_VDMA_FORMAT_16BPP else
+                      sub_pixel(1) and sub_pixel(0);
+
+    flex_vga_palette_inst : entity work.flex_vga_palette
+        generic map(MEM_ACCESS => true)
+        port map(
+            byte_in        => pixel_byte,
+            pixel_out      => palette_pixel,
+            palette_select => pixel_palette_select,
+            memclk         => palette_clk_in,
+            addr           => palette_addr_in,
+            stb            => palette_stb_in,
+            we             => palette_we_in,
+            wdat           => palette_wdat_in,
+            rdat           => palette_rdat_out,
+            ack            => palette_ack_out
+        );
+
+    -- ACK the FIFO word when its last pixel is displayed
+    pixel_active                 <= '1' when h_count < pix_ends.end_active_x and v_count < pix_ends.end_active_y else '0';
+    pixel_axi_stream_miso.tready <= pixel_active and last_sub_pixel;
+
+    -- per frame underflow count and lowest FIFO level over the active area
+    pixel_stats_proc : process (pixelclk_in)
+    begin
+        if rising_edge(pixelclk_in) then
+            if pixelclk_reset_in = '1' then
+                frame_underflows <= (others => '0');
+                fifo_min_level   <= (others => '1');
+            elsif v_count = pix_ends.end_active_y and h_count = 0 then
+                last_frame_underflows <= frame_underflows;
+                last_fifo_min_level   <= fifo_min_level;
+                frame_underflows      <= (others => '0');
+                fifo_min_level        <= (others => '1');
+            elsif pixel_active = '1' then
+                if pixel_axi_stream_mosi.tvalid = '0' then
+                    frame_underflows <= frame_underflows + 1;
+                end if;
+                if unsigned(pixel_fifo_rd_count) < fifo_min_level then
+                    fifo_min_level <= unsigned(pixel_fifo_rd_count);
+                end if;
+            end if;
+        end if;
+    end process;
+
     --! Note: everything here is registered
     pixel_readout_proc : process (pixelclk_in)
     begin
         if rising_edge(pixelclk_in) then
             if pixelclk_reset_in = '1' then
                 pixel_underflow_count <= (others => '0');
+                sub_pixel             <= (others => '0');
             else
                 -- if no new pixel is available, increase underflow count
 
                 -- while in the active display area
-                if ((h_count < G_END_ACTIVE_X) and (v_count < G_END_ACTIVE_Y)) then
-                    -- ACK current pixel from FIFO
-                    pixel_axi_stream_miso.tready <= '1';
-
+                if pixel_active = '1' then
                     if pixel_axi_stream_mosi.tvalid = '1' then
-                        vga_pixel_out.red   <= pixel_axi_stream_mosi.tdata(23 downto 16);
-                        vga_pixel_out.green <= pixel_axi_stream_mosi.tdata(15 downto 8);
-                        vga_pixel_out.blue  <= pixel_axi_stream_mosi.tdata(7 downto 0);
+                        sub_pixel <= (others => '0') when last_sub_pixel = '1' else sub_pixel + 1;
+                        case pixel_format is
+                            when C_VDMA_FORMAT_16BPP => -- RGB565, replicate MSBs into the LSBs
+                                vga_pixel_out.red   <= pixel_565(15 downto 11) & pixel_565(15 downto 13);
+                                vga_pixel_out.green <= pixel_565(10 downto 5) & pixel_565(10 downto 9);
+                                vga_pixel_out.blue  <= pixel_565(4 downto 0) & pixel_565(4 downto 2);
+                            when C_VDMA_FORMAT_8BPP =>
+                                vga_pixel_out <= palette_pixel;
+                            when others =>
+                                vga_pixel_out.red   <= pixel_axi_stream_mosi.tdata(23 downto 16);
+                                vga_pixel_out.green <= pixel_axi_stream_mosi.tdata(15 downto 8);
+                                vga_pixel_out.blue  <= pixel_axi_stream_mosi.tdata(7 downto 0);
+                        end case;
                     else -- if no pixel preset
                         pixel_underflow_count <= pixel_underflow_count + to_unsigned(1, pixel_underflow_count'length);
                         -- underflow colour is "deep pink" for debug
@@ -409,14 +702,13 @@ begin
                     end if;
 
                 else -- hold FIFO output and output black until we have finished the blanking period
-                    pixel_axi_stream_miso.tready <= '0';
-                    vga_pixel_out.red            <= x"00";
-                    vga_pixel_out.green          <= x"00";
-                    vga_pixel_out.blue           <= x"00";
+                    sub_pixel           <= (others => '0');
+                    vga_pixel_out.red   <= x"00";
+                    vga_pixel_out.green <= x"00";
+                    vga_pixel_out.blue  <= x"00";
                 end if;
             end if;
         end if;
     end process;
-   
 
 end architecture;
\ No newline at end of file
@@ -0,0 +1,309 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+use work.graphics_pkg.all;
+
+--! Wishbone control/status registers for axi3_vdma double buffering
+--!
+--! The CPU draws into the back buffer and requests a flip. axi3_vdma only samples the
+--! buffer select at VSYNC, so the flip always happens between frames (no tearing).
+--! FLIP_PENDING clears once the VDMA has latched the new front buffer, after which the old
+--! front buffer is free to draw into.
+--!
+--! Note: buffer addresses are only sampled by the VDMA at VSYNC, so are treated as
+--! quasi-static across the clock domain crossing. Only change the address of the back buffer.
+--!
+--! The health counters describe the previous frame. axi3_vdma updates them at the start of each
+--! frame, and they are captured here on the synchronised start of frame pulse, by which time they
+--! have been stable for several wb_clk cycles.
+entity wb_vdma_ctrl is
+    generic (
+        G_PIXEL_FIFO_DEPTH : integer := 512; --! match axi3_vdma, for the default watermarks
+        --! buffer addresses out of reset (as seen by the VDMA): the two 8MB framebuffers at the start of DDR
+        G_BUFFER0_RESET : std_logic_vector(31 downto 0) := x"1000_0000";
+        G_BUFFER1_RESET : std_logic_vector(31 downto 0) := x"1080_0000"
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        wb_mosi_in  : in t_wb_mosi;
+        wb_miso_out : out t_wb_miso;
+
+        frame_irq_out : out std_logic; --! (wb_clk) FRAME_DONE and IRQ_EN
+
+        -- to/from axi3_vdma
+        dma_clk                    : in std_logic;
+        buffer0_start_out          : out std_logic_vector(31 downto 0);
+        buffer1_start_out          : out std_logic_vector(31 downto 0);
+        buffer_sel_dma_clk_out     : out std_logic;
+        start_of_frame_dma_clk_in  : in std_logic;
+        active_buffer_dma_clk_in   : in std_logic;
+        pixel_format_dma_clk_out   : out std_logic_vector(1 downto 0);
+        palette_select_dma_clk_out : out std_logic;
+        timing_sel_dma_clk_out     : out std_logic_vector(1 downto 0);
+
+        timing_sel_out : out std_logic_vector(1 downto 0); --! (wb_clk) to switch the pixel clock
+
+        -- axi3_vdma palette RAM access (wb_clk)
+        palette_addr_out : out std_logic_vector(8 downto 0);
+        palette_stb_out  : out std_logic;
+        palette_we_out   : out std_logic;
+        palette_wdat_out : out std_logic_vector(23 downto 0);
+        palette_rdat_in  : in std_logic_vector(23 downto 0);
+        palette_ack_in   : in std_logic;
+
+        -- axi3_vdma scan-out tuning (dma_clk)
+        dma_max_burst_dma_clk_out       : out std_logic_vector(4 downto 0);
+        dma_queue_limit_dma_clk_out     : out std_logic_vector(4 downto 0);
+        fifo_high_watermark_dma_clk_out : out std_logic_vector(15 downto 0);
+        fifo_low_watermark_dma_clk_out  : out std_logic_vector(15 downto 0);
+
+        -- axi3_vdma health counters (dma_clk, stable except at the start of frame)
+        stat_frame_underflows_dma_clk_in : in std_logic_vector(31 downto 0) := (others => '0');
+        stat_fifo_min_level_dma_clk_in   : in std_logic_vector(15 downto 0) := (others => '0');
+        stat_max_outstanding_dma_clk_in  : in std_logic_vector(7 downto 0)  := (others => '0');
+        stat_max_latency_dma_clk_in      : in std_logic_vector(15 downto 0) := (others => '0')
+    );
+end entity wb_vdma_ctrl;
+
+architecture rtl of wb_vdma_ctrl is
+    -- Register Map
+    -- x00: BUFFER0_ADDR (RW) start address of buffer 0 (as seen by the VDMA)
+    -- x04: BUFFER1_ADDR (RW) start address of buffer 1
+    -- x08: CTRL
+    -- [0]      FLIP    (WO) write 1 to display the current back buffer from the next frame
+    -- [1]      IRQ_EN  (RW) enable the frame done interrupt
+    -- [5:4]    FORMAT  (RW) pixel format from the next frame (0: 32bpp xRGB, 1: 16bpp RGB565, 2: 8bpp indexed)
+    -- [6]      PALETTE (RW) 8bpp palette bank (0: colour, 1: greyscale)
+    -- [9:8]    TIMING  (RW) video timing preset from the next frame (index into axi3_vdma G_TIMING_PRESETS)
+    -- x0C: STATUS
+    -- [0]      FRONT        (RO) buffer currently being scanned out
+    -- [1]      FLIP_PENDING (RO) a flip has been requested but not yet latched at VSYNC
+    -- [2]      FRAME_DONE   (R/W1C) set at every VSYNC
+    -- x10: FRAME_COUNT (RO) number of frames started
+    -- x14: FRAME_UNDERFLOWS (RO) pixels shown without data (deep pink) in the previous frame
+    -- x18: UNDERFLOW_TOTAL  (RO) sum of FRAME_UNDERFLOWS since reset, write to clear
+    -- x1C: FIFO_MIN_LEVEL   (RO) lowest pixel FIFO level (words) during the previous frame
+    -- x20: AXI_STATS
+    -- [7:0]    MAX_OUTSTANDING (RO) most read bursts in flight during the previous frame
+    -- [31:16]  MAX_LATENCY     (RO) worst dma_clk cycles from read address accepted to first data
+    -- x24: WATERMARK
+    -- [15:0]   HIGH (RW) stop issuing bursts at this pixel FIFO level (words)
+    -- [31:16]  LOW  (RW) resume issuing bursts below this level
+    -- x28: BURST
+    -- [4:0]    LENGTH          (RW) words per read burst, 1-16
+    -- [12:8]   MAX_OUTSTANDING (RW) read bursts in flight, 1-16
+    -- x800-xFFF: PALETTE (RW) 2x256 palette entries, [23:0] RGB 8-8-8
+
+    signal buffer0_start : std_logic_vector(31 downto 0) := G_BUFFER0_RESET;
+    signal buffer1_start : std_logic_vector(31 downto 0) := G_BUFFER1_RESET;
+    signal buffer_sel    : std_logic := '0'; -- requested front buffer
+    signal irq_en        : std_logic := '0';
+    signal pixel_format  : std_logic_vector(1 downto 0) := C_VDMA_FORMAT_32BPP;
+    signal palette_sel   : std_logic := '0';
+    signal timing_sel    : std_logic_vector(1 downto 0) := "00";
+    signal reg_ack       : std_logic := '0';
+    signal reg_rdat      : std_logic_vector(31 downto 0);
+    signal frame_done    : std_logic := '0';
+    signal frame_count   : unsigned(31 downto 0) := (others => '0');
+
+    signal high_watermark   : std_logic_vector(15 downto 0) := uint2slv(G_PIXEL_FIFO_DEPTH - 64, 16);
+    signal low_watermark    : std_logic_vector(15 downto 0) := uint2slv(G_PIXEL_FIFO_DEPTH - 64, 16);
+    signal max_burst        : std_logic_vector(4 downto 0)  := "10000";
+    signal queue_limit      : std_logic_vector(4 downto 0)  := "00001";
+    signal frame_underflows : std_logic_vector(31 downto 0) := (others => '0');
+    signal underflow_total  : unsigned(31 downto 0)         := (others => '0');
+    signal fifo_min_level   : std_logic_vector(15 downto 0) := (others => '0');
+    signal max_outstanding  : std_logic_vector(7 downto 0)  := (others => '0');
+    signal max_latency      : std_logic_vector(15 downto 0) := (others => '0');
+
+    signal start_of_frame : std_logic;
+    signal active_buffer  : std_logic;
+    signal flip_pending   : std_logic;
+begin
+
+    buffer0_start_out <= buffer0_start;
+    buffer1_start_out <= buffer1_start;
+
+    flip_pending  <= buffer_sel xor active_buffer;
+    frame_irq_out <= frame_done and irq_en;
+
+    -- CDC
+    cdc_buffer_sel : entity work.cdc_single
+        port map(
+            src_clk  => wb_clk,
+            src_in   => buffer_sel,
+            dest_clk => dma_clk,
+            dest_out => buffer_sel_dma_clk_out
+        );
+
+    cdc_active_buffer : entity work.cdc_single
+        port map(
+            src_clk  => dma_clk,
+            src_in   => active_buffer_dma_clk_in,
+            dest_clk => wb_clk,
+            dest_out => active_buffer
+        );
+
+    -- quasi-static, only sampled by the VDMA at VSYNC
+    cdc_format : entity work.cdc_single_array
+        generic map(G_WIDTH => 5)
+        port map(
+            src_clk              => wb_clk,
+            src_in               => timing_sel & palette_sel & pixel_format,
+            dest_clk             => dma_clk,
+            dest_out(4 downto 3) => timing_sel_dma_clk_out,
+            dest_out(2)          => palette_select_dma_clk_out,
+            dest_out(1 downto 0) => pixel_format_dma_clk_out
+        );
+
+    timing_sel_out <= timing_sel;
+
+    -- quasi-static tuning, a torn update is still a valid setting for one cycle
+    cdc_tuning : entity work.cdc_single_array
+        generic map(G_WIDTH => 42)
+        port map(
+            src_clk                => wb_clk,
+            src_in                 => queue_limit & max_burst & low_watermark & high_watermark,
+            dest_clk               => dma_clk,
+            dest_out(41 downto 37) => dma_queue_limit_dma_clk_out,
+            dest_out(36 downto 32) => dma_max_burst_dma_clk_out,
+            dest_out(31 downto 16) => fifo_low_watermark_dma_clk_out,
+            dest_out(15 downto 0)  => fifo_high_watermark_dma_clk_out
+        );
+
+    cdc_start_of_frame : entity work.cdc_pulse
+        port map(
+            src_clk    => dma_clk,
+            src_pulse  => start_of_frame_dma_clk_in,
+            dest_clk   => wb_clk,
+            dest_pulse => start_of_frame
+        );
+
+    -- palette accesses are handled by flex_vga_palette (also 1 wait state)
+    palette_addr_out <= wb_mosi_in.adr(10 downto 2);
+    palette_stb_out  <= wb_mosi_in.stb and wb_mosi_in.adr(11);
+    palette_we_out   <= wb_mosi_in.we;
+    palette_wdat_out <= wb_mosi_in.wdat(23 downto 0);
+
+    wb_miso_out.ack  <= reg_ack or palette_ack_in;
+    wb_miso_out.rdat <= x"00" & palette_rdat_in when palette_ack_in = '1' else reg_rdat;
+
+    -- this slave can always respond to requests, so no stalling is required
+    wb_miso_out.stall <= '0';
+    -- wishbone slave logic
+    wb_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                reg_ack         <= '0';
+                wb_miso_out.err <= '0';
+                wb_miso_out.rty <= '0';
+
+                buffer0_start <= G_BUFFER0_RESET;
+                buffer1_start <= G_BUFFER1_RESET;
+                buffer_sel   <= '0';
+                irq_en       <= '0';
+                pixel_format <= C_VDMA_FORMAT_32BPP;
+                palette_sel  <= '0';
+                timing_sel   <= "00";
+                frame_done  <= '0';
+                frame_count <= (others => '0');
+
+                high_watermark  <= uint2slv(G_PIXEL_FIFO_DEPTH - 64, 16);
+                low_watermark   <= uint2slv(G_PIXEL_FIFO_DEPTH - 64, 16);
+                max_burst       <= "10000";
+                queue_limit     <= "00001";
+                underflow_total <= (others => '0');
+            else
+                -- defaults
+                reg_ack         <= '0';
+                wb_miso_out.err <= '0'; -- this slave does not generate ERR or RTY responses
+                wb_miso_out.rty <= '0';
+                reg_rdat        <= x"DEADC0DE";
+
+                if start_of_frame = '1' then
+                    frame_count <= frame_count + 1;
+
+                    -- health counters from the frame that just finished
+                    frame_underflows <= stat_frame_underflows_dma_clk_in;
+                    underflow_total  <= underflow_total + unsigned(stat_frame_underflows_dma_clk_in);
+                    fifo_min_level   <= stat_fifo_min_level_dma_clk_in;
+                    max_outstanding  <= stat_max_outstanding_dma_clk_in;
+                    max_latency      <= stat_max_latency_dma_clk_in;
+                end if;
+
+                if wb_mosi_in.stb = '1' and wb_miso_out.stall = '0' and wb_mosi_in.adr(11) = '0' then -- assume CYC asserted by master for STB to be high
+                    -- always ACK this cycle (sync operation with 1 wait state)
+                    reg_ack <= '1';
+                    if wb_mosi_in.we = '1' then
+                        -- write logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => buffer0_start <= wb_mosi_in.wdat;
+                            when x"04" => buffer1_start <= wb_mosi_in.wdat;
+                            when x"08" =>
+                            if wb_mosi_in.wdat(0) = '1' then
+                                buffer_sel <= not active_buffer;
+                            end if;
+                            irq_en       <= wb_mosi_in.wdat(1);
+                            pixel_format <= wb_mosi_in.wdat(5 downto 4);
+                            palette_sel  <= wb_mosi_in.wdat(6);
+                            timing_sel   <= wb_mosi_in.wdat(9 downto 8);
+                            when x"0C" =>
+                            if wb_mosi_in.wdat(2) = '1' then
+                                frame_done <= '0';
+                            end if;
+                            when x"18" => underflow_total <= (others => '0');
+                            when x"24" =>
+                            high_watermark <= wb_mosi_in.wdat(15 downto 0);
+                            low_watermark  <= wb_mosi_in.wdat(31 downto 16);
+                            when x"28" =>
+                            max_burst   <= wb_mosi_in.wdat(4 downto 0);
+                            queue_limit <= wb_mosi_in.wdat(12 downto 8);
+                            when others => null;
+                        end case;
+                    else
+                        -- read logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => reg_rdat <= buffer0_start;
+                            when x"04" => reg_rdat <= buffer1_start;
+                            when x"08" =>
+                            reg_rdat             <= (others => '0');
+                            reg_rdat(1)          <= irq_en;
+                            reg_rdat(5 downto 4) <= pixel_format;
+                            reg_rdat(6)          <= palette_sel;
+                            reg_rdat(9 downto 8) <= timing_sel;
+                            when x"0C" =>
+                            reg_rdat    <= (others => '0');
+                            reg_rdat(0) <= active_buffer;
+                            reg_rdat(1) <= flip_pending;
+                            reg_rdat(2) <= frame_done;
+                            when x"10"   => reg_rdat <= std_logic_vector(frame_count);
+                            when x"14"   => reg_rdat <= frame_underflows;
+                            when x"18"   => reg_rdat <= std_logic_vector(underflow_total);
+                            when x"1C"   => reg_rdat <= x"0000" & fifo_min_level;
+                            when x"20"   => reg_rdat <= max_latency & x"00" & max_outstanding;
+                            when x"24"   => reg_rdat <= low_watermark & high_watermark;
+                            when x"28"   =>
+                            reg_rdat              <= (others => '0');
+                            reg_rdat(4 downto 0)  <= max_burst;
+                            reg_rdat(12 downto 8) <= queue_limit;
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+
+                -- after the bus logic, so a new frame wins over a FRAME_DONE clear in the same cycle
+                if start_of_frame = '1' then
+                    frame_done <= '1';
+                end if;
+
+            end if; -- end clk'd
+        end if;
+    end process;
+
+end architecture;
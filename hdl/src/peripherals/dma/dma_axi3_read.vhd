@@ -22,6 +22,7 @@ entity dma_axi3_read is
         dma_axi_burst_mode_in : in std_logic_vector(1 downto 0) := AXI_BURST_INCR; -- AXI_BURST_FIXED for fifo mode
         dma_num_words_in      : in std_logic_vector(G_NUM_WORDS_W - 1 downto 0);   -- max 16 words per AXI3 transaction, split into multiple
         dma_queue_limit_in    : in std_logic_vector(31 downto 0);                  -- how many outstanding AXI3 transactions we can queue before auto-stalling
+        dma_max_burst_in      : in std_logic_vector(4 downto 0) := "10000";        -- longest burst to issue, 1-16 words (0 or >16 treated as 16)
 
         dma_stall_in : in std_logic; -- stall issuing of future transactions in a multi transaction dma transfer (rudimentary backpressure)
 
@@ -43,6 +44,7 @@ architecture rtl of dma_axi3_read is
 
     -- for AXI3, max 16 transfers per burst
     constant MAX_TRANSACTIONS : unsigned(G_NUM_WORDS_W - 1 downto 0) := to_unsigned(16, G_NUM_WORDS_W);
+    signal max_burst          : unsigned(G_NUM_WORDS_W - 1 downto 0);
 
     constant BYTES_PER_WORD : integer := 4;
 
@@ -91,6 +93,9 @@ begin
     dma_axi_hp_mosi_out.rready <= axi_stream_miso_in.tready;
     outstanding_cmds           <= num_cmd - num_rsp;
 
+    max_burst <= MAX_TRANSACTIONS when unsigned(dma_max_burst_in) = 0 or unsigned(dma_max_burst_in) > 16 else
+                 resize(unsigned(dma_max_burst_in), G_NUM_WORDS_W);
+
     dma_read : process (axi_clk)
         variable v_burst_size : unsigned(G_NUM_WORDS_W - 1 downto 0); -- intermediate value
         variable v_arlen : unsigned(G_NUM_WORDS_W - 1 downto 0); -- intermediate value
@@ -124,8 +129,8 @@ begin
                     when READ_SETUP =>
 
                     -- if more than can fit in one burst, use the max burst size
-                    if words_remaining > MAX_TRANSACTIONS then
-                        v_burst_size := MAX_TRANSACTIONS;
+                    if words_remaining > max_burst then
+                        v_burst_size := max_burst;
                     else -- else just finish with a partially full burst
                         v_burst_size := words_remaining;
                     end if;
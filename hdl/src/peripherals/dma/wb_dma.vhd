@@ -0,0 +1,471 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! General purpose memory to memory DMA, Wishbone programmed Wishbone master
+--!
+--! A transfer is described by a descriptor: ROWS rows of LEN bytes, each row starting STRIDE
+--! bytes after the previous one, either copied from SRC_ADDR or filled with FILL. When the
+--! descriptor completes and NEXT is non-zero, the next descriptor is fetched from memory at NEXT
+--! so a chain of transfers can run without the CPU.
+--!
+--! Start a single transfer by setting up the descriptor registers and writing CTRL with START set,
+--! or start a chain held in memory by writing its address to DESC_ADDR. A descriptor in memory is
+--! 8 words laid out the same as registers x00 to x1C.
+--!
+--! Each row is split into bursts of up to G_BURST_WORDS. A burst is read into a small buffer in
+--! one bus cycle (B4 pipelined), then written out in a second bus cycle, so the source and
+--! destination can be any slaves. CYC is dropped between bus cycles to let other masters in.
+--!
+--! Addresses and LEN must be word aligned ([1:0] are ignored), sub-word heads and tails are left
+--! to software. A bus error aborts the chain and sets ERR.
+entity wb_dma is
+    generic (
+        G_BURST_WORDS : integer := 16 --! buffer size, at least 8 (one descriptor)
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        -- register slave port
+        wb_mosi_in  : in t_wb_mosi;
+        wb_miso_out : out t_wb_miso;
+
+        -- memory master port
+        wb_mosi_out : out t_wb_mosi;
+        wb_miso_in  : in t_wb_miso;
+
+        busy_out      : out std_logic;
+        interrupt_out : out std_logic
+    );
+end entity wb_dma;
+
+architecture rtl of wb_dma is
+    -- Register Map
+    -- x00: SRC_ADDR   (RW) first source byte (ignored for FILL)
+    -- x04: DST_ADDR   (RW) first destination byte
+    -- x08: LEN        (RW) bytes per row
+    -- x0C: ROWS       (RW) [15:0] number of rows (0 is treated as 1)
+    -- x10: STRIDE     (RW) [15:0] destination row stride in bytes, [31:16] source row stride
+    -- x14: FILL       (RW) FILL mode data word
+    -- x18: NEXT       (RW) address of the next descriptor, 0 ends the chain
+    -- x1C: CTRL       (RW)
+    -- [0]      FILL        fill the destination with FILL instead of copying
+    -- [1]      IRQ         raise STATUS.IRQ when this descriptor completes
+    -- [31]     START       (WO) start the transfer described by x00 to x1C
+    -- x20: STATUS
+    -- [0]      BUSY        (RO)
+    -- [1]      IRQ         (R/W1C) drives interrupt_out
+    -- [2]      ERR         (R/W1C) a transfer returned an error response, chain aborted
+    -- x24: DESC_ADDR  (RW) write to fetch and start a descriptor chain, read for the current descriptor
+    -- x28: DONE_COUNT (RO) number of descriptors completed
+    --
+    -- Writes to x00 to x1C and DESC_ADDR are ignored while BUSY
+
+    constant DESC_WORDS : integer := 8;
+
+    type t_dma_desc is record
+        src        : unsigned(31 downto 0);
+        dst        : unsigned(31 downto 0);
+        len        : unsigned(31 downto 0);
+        rows       : unsigned(15 downto 0);
+        dst_stride : unsigned(15 downto 0);
+        src_stride : unsigned(15 downto 0);
+        fill       : std_logic_vector(31 downto 0);
+        next_desc  : unsigned(31 downto 0);
+        fill_mode  : std_logic;
+        irq        : std_logic;
+    end record;
+
+    constant C_DESC_INIT : t_dma_desc := (
+        src        => (others => '0'),
+        dst        => (others => '0'),
+        len        => (others => '0'),
+        rows       => (others => '0'),
+        dst_stride => (others => '0'),
+        src_stride => (others => '0'),
+        fill       => (others => '0'),
+        next_desc  => (others => '0'),
+        fill_mode  => '0',
+        irq        => '0'
+    );
+
+    type t_buf is array (0 to G_BURST_WORDS - 1) of std_logic_vector(31 downto 0);
+
+    --! unpack a descriptor read from memory, same layout as the register map
+    function buf_to_desc(buf : t_buf) return t_dma_desc is
+        variable desc : t_dma_desc;
+    begin
+        desc.src        := unsigned(buf(0));
+        desc.dst        := unsigned(buf(1));
+        desc.len        := unsigned(buf(2));
+        desc.rows       := unsigned(buf(3)(15 downto 0));
+        desc.dst_stride := unsigned(buf(4)(15 downto 0));
+        desc.src_stride := unsigned(buf(4)(31 downto 16));
+        desc.fill       := buf(5);
+        desc.next_desc  := unsigned(buf(6));
+        desc.fill_mode  := buf(7)(0);
+        desc.irq        := buf(7)(1);
+        return desc;
+    end function;
+
+    -- registers
+    signal regs       : t_dma_desc := C_DESC_INIT;
+    signal start      : std_logic  := '0';
+    signal start_desc : std_logic  := '0'; -- fetch the descriptor at start_addr rather than using regs
+    signal start_addr : unsigned(31 downto 0) := (others => '0');
+    signal irq_flag   : std_logic := '0';
+    signal err_flag   : std_logic := '0';
+    signal irq_clear  : std_logic := '0';
+    signal err_clear  : std_logic := '0';
+    signal busy       : std_logic;
+
+    -- engine
+    type t_state is (IDLE, FETCH, LOAD, INIT, CHUNK, READ, WRITE_START, WRITE, NEXT_CHUNK, DESC_DONE);
+    signal state : t_state := IDLE;
+
+    signal fetching   : std_logic := '0'; -- READ is fetching a descriptor
+
+    signal cur        : t_dma_desc := C_DESC_INIT;
+    signal desc_addr  : unsigned(31 downto 0) := (others => '0');
+    signal src_row    : unsigned(31 downto 0) := (others => '0');
+    signal dst_row    : unsigned(31 downto 0) := (others => '0');
+    signal src_ptr    : unsigned(31 downto 0) := (others => '0');
+    signal dst_ptr    : unsigned(31 downto 0) := (others => '0');
+    signal rows_left  : unsigned(15 downto 0) := (others => '0');
+    signal words_left : unsigned(29 downto 0) := (others => '0'); -- in the current row
+    signal done_count : unsigned(31 downto 0) := (others => '0');
+    signal irq_set    : std_logic := '0';
+    signal err_set    : std_logic := '0';
+
+    -- current burst
+    signal buf       : t_buf;
+    signal burst_len : integer range 0 to G_BURST_WORDS := 0;
+    signal req_count : integer range 0 to G_BURST_WORDS := 0;
+    signal ack_count : integer range 0 to G_BURST_WORDS := 0;
+
+    signal wb_cyc  : std_logic := '0';
+    signal wb_stb  : std_logic := '0';
+    signal wb_we   : std_logic := '0';
+    signal wb_adr  : unsigned(31 downto 0) := (others => '0');
+    signal wb_wdat : std_logic_vector(31 downto 0) := (others => '0');
+
+begin
+    assert G_BURST_WORDS >= DESC_WORDS report "wb_dma: G_BURST_WORDS must hold a descriptor" severity failure;
+
+    busy          <= '1' when state /= IDLE or start = '1' else '0';
+    busy_out      <= busy;
+    interrupt_out <= irq_flag;
+
+    -- this slave can always respond to requests, so no stalling is required
+    wb_miso_out.stall <= '0';
+
+    wb_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                wb_miso_out.ack <= '0';
+                wb_miso_out.err <= '0';
+                wb_miso_out.rty <= '0';
+                regs            <= C_DESC_INIT;
+                start           <= '0';
+                start_desc      <= '0';
+                irq_clear       <= '0';
+                err_clear       <= '0';
+            else
+                -- defaults
+                wb_miso_out.ack  <= '0';
+                wb_miso_out.err  <= '0'; -- this slave does not generate ERR or RTY responses
+                wb_miso_out.rty  <= '0';
+                wb_miso_out.rdat <= x"DEADC0DE";
+                irq_clear        <= '0';
+                err_clear        <= '0';
+
+                if state /= IDLE then
+                    start <= '0'; -- picked up by the engine
+                end if;
+
+                if wb_mosi_in.stb = '1' and wb_miso_out.stall = '0' then -- assume CYC asserted by master for STB to be high
+                    -- always ACK this cycle (sync operation with 1 wait state)
+                    wb_miso_out.ack <= '1';
+                    if wb_mosi_in.we = '1' then
+                        -- write logic
+                        if busy = '0' then
+                            case(wb_mosi_in.adr(7 downto 0)) is
+                                when x"00" => regs.src <= unsigned(wb_mosi_in.wdat);
+                                when x"04" => regs.dst <= unsigned(wb_mosi_in.wdat);
+                                when x"08" => regs.len <= unsigned(wb_mosi_in.wdat);
+                                when x"0C" => regs.rows <= unsigned(wb_mosi_in.wdat(15 downto 0));
+                                when x"10" =>
+                                    regs.dst_stride <= unsigned(wb_mosi_in.wdat(15 downto 0));
+                                    regs.src_stride <= unsigned(wb_mosi_in.wdat(31 downto 16));
+                                when x"14" => regs.fill <= wb_mosi_in.wdat;
+                                when x"18" => regs.next_desc <= unsigned(wb_mosi_in.wdat);
+                                when x"1C" =>
+                                    regs.fill_mode <= wb_mosi_in.wdat(0);
+                                    regs.irq       <= wb_mosi_in.wdat(1);
+                                    if wb_mosi_in.wdat(31) = '1' then
+                                        start      <= '1';
+                                        start_desc <= '0';
+                                    end if;
+                                when x"24" =>
+                                    start      <= '1';
+                                    start_desc <= '1';
+                                    start_addr <= unsigned(wb_mosi_in.wdat);
+                                when others => null;
+                            end case;
+                        end if;
+                        if wb_mosi_in.adr(7 downto 0) = x"20" then
+                            irq_clear <= wb_mosi_in.wdat(1);
+                            err_clear <= wb_mosi_in.wdat(2);
+                        end if;
+                    else
+                        -- read logic
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => wb_miso_out.rdat <= std_logic_vector(regs.src);
+                            when x"04" => wb_miso_out.rdat <= std_logic_vector(regs.dst);
+                            when x"08" => wb_miso_out.rdat <= std_logic_vector(regs.len);
+                            when x"0C" => wb_miso_out.rdat <= x"0000" & std_logic_vector(regs.rows);
+                            when x"10" => wb_miso_out.rdat <= std_logic_vector(regs.src_stride) & std_logic_vector(regs.dst_stride);
+                            when x"14" => wb_miso_out.rdat <= regs.fill;
+                            when x"18" => wb_miso_out.rdat <= std_logic_vector(regs.next_desc);
+                            when x"1C" =>
+                                wb_miso_out.rdat    <= (others => '0');
+                                wb_miso_out.rdat(0) <= regs.fill_mode;
+                                wb_miso_out.rdat(1) <= regs.irq;
+                            when x"20" =>
+                                wb_miso_out.rdat    <= (others => '0');
+                                wb_miso_out.rdat(0) <= busy;
+                                wb_miso_out.rdat(1) <= irq_flag;
+                                wb_miso_out.rdat(2) <= err_flag;
+                            when x"24"  => wb_miso_out.rdat <= std_logic_vector(desc_addr);
+                            when x"28"  => wb_miso_out.rdat <= std_logic_vector(done_count);
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- sticky status flags, set wins over clear
+    flag_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                irq_flag <= '0';
+                err_flag <= '0';
+            else
+                if irq_clear = '1' then
+                    irq_flag <= '0';
+                end if;
+                if err_clear = '1' then
+                    err_flag <= '0';
+                end if;
+                if irq_set = '1' then
+                    irq_flag <= '1';
+                end if;
+                if err_set = '1' then
+                    err_flag <= '1';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    wb_mosi_out.cyc  <= wb_cyc;
+    wb_mosi_out.stb  <= wb_stb;
+    wb_mosi_out.we   <= wb_we;
+    wb_mosi_out.adr  <= std_logic_vector(wb_adr(31 downto 2)) & "00";
+    wb_mosi_out.wdat <= wb_wdat;
+    wb_mosi_out.sel  <= x"F";
+    wb_mosi_out.lock <= '0';
+
+    engine_proc : process (wb_clk) is
+        variable req : integer range 0 to G_BURST_WORDS;
+    begin
+        if rising_edge(wb_clk) then
+            irq_set <= '0';
+            err_set <= '0';
+
+            if wb_reset = '1' then
+                state      <= IDLE;
+                wb_cyc     <= '0';
+                wb_stb     <= '0';
+                fetching   <= '0';
+                done_count <= (others => '0');
+            else
+                case state is
+                    when IDLE =>
+                        wb_cyc <= '0';
+                        wb_stb <= '0';
+                        if start = '1' then
+                            if start_desc = '1' then
+                                desc_addr <= start_addr;
+                                state     <= FETCH;
+                            else
+                                desc_addr <= (others => '0');
+                                cur       <= regs;
+                                fetching  <= '0';
+                                state     <= INIT;
+                            end if;
+                        end if;
+
+                    when FETCH =>
+                        -- read the descriptor into the burst buffer
+                        fetching  <= '1';
+                        burst_len <= DESC_WORDS;
+                        req_count <= 0;
+                        ack_count <= 0;
+                        wb_cyc    <= '1';
+                        wb_stb    <= '1';
+                        wb_we     <= '0';
+                        wb_adr    <= desc_addr;
+                        state     <= READ;
+
+                    when LOAD =>
+                        cur      <= buf_to_desc(buf);
+                        fetching <= '0';
+                        state    <= INIT;
+
+                    when INIT =>
+                        src_row    <= cur.src;
+                        dst_row    <= cur.dst;
+                        src_ptr    <= cur.src;
+                        dst_ptr    <= cur.dst;
+                        words_left <= cur.len(31 downto 2);
+                        if cur.rows = 0 then
+                            rows_left <= to_unsigned(1, rows_left'length);
+                        else
+                            rows_left <= cur.rows;
+                        end if;
+                        if cur.len(31 downto 2) = 0 then
+                            state <= DESC_DONE;
+                        else
+                            state <= CHUNK;
+                        end if;
+
+                    when CHUNK =>
+                        if words_left > G_BURST_WORDS then
+                            burst_len <= G_BURST_WORDS;
+                        else
+                            burst_len <= to_integer(words_left);
+                        end if;
+                        req_count <= 0;
+                        ack_count <= 0;
+                        wb_cyc    <= '1';
+                        wb_stb    <= '1';
+                        if cur.fill_mode = '1' then
+                            wb_we   <= '1';
+                            wb_adr  <= dst_ptr;
+                            wb_wdat <= cur.fill;
+                            state   <= WRITE;
+                        else
+                            wb_we  <= '0';
+                            wb_adr <= src_ptr;
+                            state  <= READ;
+                        end if;
+
+                    when READ =>
+                        if wb_stb = '1' and wb_miso_in.stall = '0' then
+                            req       := req_count + 1;
+                            req_count <= req;
+                            wb_adr    <= wb_adr + 4;
+                            if req = burst_len then
+                                wb_stb <= '0';
+                            end if;
+                        end if;
+                        if wb_miso_in.ack = '1' then
+                            buf(ack_count) <= wb_miso_in.rdat;
+                            ack_count      <= ack_count + 1;
+                            if ack_count = burst_len - 1 then
+                                -- drop CYC for a cycle between the read and write bus cycles
+                                wb_cyc <= '0';
+                                wb_stb <= '0';
+                                if fetching = '1' then
+                                    state <= LOAD;
+                                else
+                                    state <= WRITE_START;
+                                end if;
+                            end if;
+                        end if;
+                        if wb_miso_in.err = '1' then
+                            wb_cyc  <= '0';
+                            wb_stb  <= '0';
+                            err_set <= '1';
+                            irq_set <= '1';
+                            state   <= IDLE;
+                        end if;
+
+                    when WRITE_START =>
+                        req_count <= 0;
+                        ack_count <= 0;
+                        wb_cyc    <= '1';
+                        wb_stb    <= '1';
+                        wb_we     <= '1';
+                        wb_adr    <= dst_ptr;
+                        wb_wdat   <= buf(0);
+                        state     <= WRITE;
+
+                    when WRITE =>
+                        if wb_stb = '1' and wb_miso_in.stall = '0' then
+                            req       := req_count + 1;
+                            req_count <= req;
+                            wb_adr    <= wb_adr + 4;
+                            if req = burst_len then
+                                wb_stb <= '0';
+                            elsif cur.fill_mode = '0' then
+                                wb_wdat <= buf(req);
+                            end if;
+                        end if;
+                        if wb_miso_in.ack = '1' then
+                            ack_count <= ack_count + 1;
+                            if ack_count = burst_len - 1 then
+                                wb_cyc <= '0';
+                                wb_stb <= '0';
+                                state  <= NEXT_CHUNK;
+                            end if;
+                        end if;
+                        if wb_miso_in.err = '1' then
+                            wb_cyc  <= '0';
+                            wb_stb  <= '0';
+                            err_set <= '1';
+                            irq_set <= '1';
+                            state   <= IDLE;
+                        end if;
+
+                    when NEXT_CHUNK =>
+                        state <= CHUNK;
+                        if words_left = burst_len then -- end of row
+                            if rows_left = 1 then
+                                state <= DESC_DONE;
+                            end if;
+                            rows_left  <= rows_left - 1;
+                            words_left <= cur.len(31 downto 2);
+                            src_row    <= src_row + cur.src_stride;
+                            dst_row    <= dst_row + cur.dst_stride;
+                            src_ptr    <= src_row + cur.src_stride;
+                            dst_ptr    <= dst_row + cur.dst_stride;
+                        else
+                            words_left <= words_left - burst_len;
+                            src_ptr    <= src_ptr + to_unsigned(burst_len * 4, 32);
+                            dst_ptr    <= dst_ptr + to_unsigned(burst_len * 4, 32);
+                        end if;
+
+                    when DESC_DONE =>
+                        done_count <= done_count + 1;
+                        irq_set    <= cur.irq;
+                        if cur.next_desc /= 0 then
+                            desc_addr <= cur.next_desc;
+                            state     <= FETCH;
+                        else
+                            state <= IDLE;
+                        end if;
+                end case;
+            end if;
+        end if;
+    end process;
+
+end architecture;
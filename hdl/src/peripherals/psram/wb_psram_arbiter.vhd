@@ -0,0 +1,356 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! N:1 Wishbone arbiter to share the PSRAM controller between multiple masters (eg CPU and a pixel DMA)
+--!
+--! All ports are Wishbone B4 pipelined. The PSRAM controller returns responses in order, so we
+--! keep a small queue of which port issued each accepted transaction and route the ACKs back using that.
+--! This means we can switch ports without waiting for the previous port's responses to drain.
+--!
+--! Arbitration (re-evaluated whenever the current port drops CYC, leaves STB low while another port
+--! is waiting, or has had its burst length of transfers):
+--! 1. Ports that have not yet had their guaranteed number of transfers this QoS window ("urgent")
+--! 2. Highest priority port
+--! 3. Round robin between ports with the same priority
+--!
+--! When no other port is asking for the bus the grant stays parked on the last owner, so a master
+--! doing single (classic) accesses on its own has each one accepted in the cycle it raises STB,
+--! without an arbitration cycle first.
+--!
+--! A port holding LOCK is never pre-empted.
+--!
+--! Config/Status Register Map (wb_cfg port)
+--! x00: CTRL (W)       [0] clear all counters
+--! x04: QoS window length in wb_clk cycles (RW)
+--! Per port N at x40 + N*x10:
+--! x0: CFG (RW)        [1:0] priority (3=highest), [15:8] max transfers per grant (0 = 256)
+--! x4: QOS (RW)        [15:0] guaranteed transfers per QoS window (0 = best effort)
+--! x8: BW_COUNT (RO)   Transfers accepted from this port
+--! xC: WAIT_COUNT (RO) Cycles this port had STB high but was stalled
+entity wb_psram_arbiter is
+    generic (
+        G_NUM_PORTS       : integer := 2;  --! max 4
+        G_MAX_OUTSTANDING : integer := 16; --! must be >= depth of the PSRAM controller command FIFO
+        G_DEFAULT_BURST   : integer := 16;
+        G_DEFAULT_WINDOW  : integer := 1024
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        -- masters in (slave ports), port 0 wins ties at reset
+        wb_port_mosi_arr_in  : in t_wb_mosi_arr(G_NUM_PORTS - 1 downto 0);
+        wb_port_miso_arr_out : out t_wb_miso_arr(G_NUM_PORTS - 1 downto 0);
+
+        -- to wb_psram_aps6404_streaming
+        wb_psram_mosi_out : out t_wb_mosi;
+        wb_psram_miso_in  : in t_wb_miso;
+
+        -- config and status registers
+        wb_cfg_mosi_in  : in t_wb_mosi;
+        wb_cfg_miso_out : out t_wb_miso
+    );
+end entity wb_psram_arbiter;
+
+architecture rtl of wb_psram_arbiter is
+    constant C_MAX_PORTS : integer := 4;
+
+    type t_prio_arr is array (0 to G_NUM_PORTS - 1) of unsigned(1 downto 0);
+    type t_u8_arr is array (0 to G_NUM_PORTS - 1) of unsigned(7 downto 0);
+    type t_u16_arr is array (0 to G_NUM_PORTS - 1) of unsigned(15 downto 0);
+    type t_u32_arr is array (0 to G_NUM_PORTS - 1) of unsigned(31 downto 0);
+
+    -- config registers
+    signal port_priority   : t_prio_arr := (others => (others => '0'));
+    signal port_burst_len  : t_u8_arr   := (others => to_unsigned(G_DEFAULT_BURST mod 256, 8));
+    signal port_guaranteed : t_u16_arr  := (others => (others => '0'));
+    signal qos_window_len  : unsigned(31 downto 0) := to_unsigned(G_DEFAULT_WINDOW, 32);
+    signal clr_counters    : std_logic;
+
+    -- status counters
+    signal port_bw_count     : t_u32_arr := (others => (others => '0'));
+    signal port_wait_count   : t_u32_arr := (others => (others => '0'));
+    signal port_window_count : t_u16_arr := (others => (others => '0'));
+    signal window_timer      : unsigned(31 downto 0) := (others => '0');
+
+    -- arbitration
+    signal granted        : std_logic := '0';
+    signal grant          : integer range 0 to G_NUM_PORTS - 1 := 0;
+    signal last_grant     : integer range 0 to G_NUM_PORTS - 1 := G_NUM_PORTS - 1;
+    signal burst_count    : unsigned(8 downto 0) := (others => '0');
+    signal requests       : std_logic_vector(G_NUM_PORTS - 1 downto 0);
+    signal others_waiting : std_logic; -- a port other than the granted one has a request
+    signal accept         : std_logic;
+
+    -- in-order response routing
+    type t_port_id_arr is array (0 to G_MAX_OUTSTANDING - 1) of integer range 0 to G_NUM_PORTS - 1;
+    signal rsp_port_queue : t_port_id_arr := (others => 0);
+    signal rsp_wr_ptr     : integer range 0 to G_MAX_OUTSTANDING - 1 := 0;
+    signal rsp_rd_ptr     : integer range 0 to G_MAX_OUTSTANDING - 1 := 0;
+    signal rsp_count      : integer range 0 to G_MAX_OUTSTANDING := 0;
+    signal rsp_pop        : std_logic;
+    signal rsp_queue_full : std_logic;
+
+    function burst_limit(len : unsigned(7 downto 0)) return unsigned is
+    begin
+        if len = 0 then
+            return to_unsigned(256, 9);
+        end if;
+        return resize(len, 9);
+    end function;
+
+begin
+    assert G_NUM_PORTS <= C_MAX_PORTS report "wb_psram_arbiter supports a maximum of 4 ports" severity failure;
+
+    gen_requests : for i in 0 to G_NUM_PORTS - 1 generate
+        requests(i) <= wb_port_mosi_arr_in(i).cyc and wb_port_mosi_arr_in(i).stb;
+    end generate;
+
+    process (all)
+    begin
+        others_waiting <= '0';
+        for i in 0 to G_NUM_PORTS - 1 loop
+            if requests(i) = '1' and grant /= i then
+                others_waiting <= '1';
+            end if;
+        end loop;
+    end process;
+
+    rsp_queue_full <= '1' when rsp_count = G_MAX_OUTSTANDING else '0';
+    rsp_pop        <= '1' when rsp_count /= 0 and (wb_psram_miso_in.ack = '1' or wb_psram_miso_in.err = '1') else '0';
+
+    -- Wishbone Mux (MOSI)
+    process (all)
+    begin
+        wb_psram_mosi_out <= C_WB_MOSI_INIT;
+        if granted = '1' then
+            wb_psram_mosi_out     <= wb_port_mosi_arr_in(grant);
+            -- hold off new transfers if we can't track any more responses
+            wb_psram_mosi_out.stb <= wb_port_mosi_arr_in(grant).stb and not rsp_queue_full;
+        end if;
+        -- keep the bus cycle open while any port is still waiting for responses
+        if rsp_count /= 0 then
+            wb_psram_mosi_out.cyc <= '1';
+        end if;
+    end process;
+
+    accept <= granted and requests(grant) and (not wb_psram_miso_in.stall) and (not rsp_queue_full);
+
+    -- Wishbone Demux (MISO)
+    gen_miso : for i in 0 to G_NUM_PORTS - 1 generate
+        wb_port_miso_arr_out(i).rdat  <= wb_psram_miso_in.rdat;
+        wb_port_miso_arr_out(i).stall <= wb_psram_miso_in.stall or rsp_queue_full when granted = '1' and grant = i else '1';
+        wb_port_miso_arr_out(i).ack   <= wb_psram_miso_in.ack when rsp_count /= 0 and rsp_port_queue(rsp_rd_ptr) = i else '0';
+        wb_port_miso_arr_out(i).err   <= wb_psram_miso_in.err when rsp_count /= 0 and rsp_port_queue(rsp_rd_ptr) = i else '0';
+        wb_port_miso_arr_out(i).rty   <= '0';
+    end generate;
+
+    --! Track which port each in-flight transaction belongs to
+    rsp_queue_proc : process (wb_clk)
+        variable v_count : integer range 0 to G_MAX_OUTSTANDING;
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                rsp_wr_ptr <= 0;
+                rsp_rd_ptr <= 0;
+                rsp_count  <= 0;
+            else
+                v_count := rsp_count;
+                if accept = '1' then
+                    rsp_port_queue(rsp_wr_ptr) <= grant;
+                    rsp_wr_ptr                 <= 0 when rsp_wr_ptr = G_MAX_OUTSTANDING - 1 else rsp_wr_ptr + 1;
+                    v_count                    := v_count + 1;
+                end if;
+                if rsp_pop = '1' then
+                    rsp_rd_ptr <= 0 when rsp_rd_ptr = G_MAX_OUTSTANDING - 1 else rsp_rd_ptr + 1;
+                    v_count    := v_count - 1;
+                end if;
+                rsp_count <= v_count;
+            end if;
+        end if;
+    end process;
+
+    --! Choose which port gets the bus next
+    arb_proc : process (wb_clk)
+        variable v_release   : boolean;
+        variable v_found     : boolean;
+        variable v_best      : integer range 0 to G_NUM_PORTS - 1;
+        variable v_best_prio : integer range -1 to 7;
+        variable v_prio      : integer range 0 to 7;
+        variable v_idx       : integer range 0 to G_NUM_PORTS - 1;
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                granted     <= '0';
+                grant       <= 0;
+                last_grant  <= G_NUM_PORTS - 1;
+                burst_count <= (others => '0');
+            else
+                if accept = '1' then
+                    burst_count <= burst_count + 1;
+                end if;
+
+                -- release the bus when the master finishes its bus cycle, pauses while another port is waiting,
+                -- or uses up its burst
+                v_release := false;
+                if granted = '1' and wb_port_mosi_arr_in(grant).lock = '0' then
+                    if wb_port_mosi_arr_in(grant).cyc = '0' then
+                        v_release := true;
+                    elsif wb_port_mosi_arr_in(grant).stb = '0' and others_waiting = '1' then
+                        v_release := true;
+                    elsif accept = '1' and burst_count + 1 >= burst_limit(port_burst_len(grant)) then
+                        v_release := true;
+                    end if;
+                end if;
+                if granted = '1' and wb_port_mosi_arr_in(grant).cyc = '0' then
+                    v_release := true; -- LOCK is meaningless without CYC
+                end if;
+
+                if granted = '0' or v_release then
+                    -- pick the next port. Urgent (under-served QoS) ports get a priority boost above all others
+                    v_found     := false;
+                    v_best      := 0;
+                    v_best_prio := -1;
+                    for i in 1 to G_NUM_PORTS loop
+                        -- search starting from the port after the last one granted, for round robin on ties
+                        v_idx  := (last_grant + i) mod G_NUM_PORTS;
+                        v_prio := to_integer(port_priority(v_idx));
+                        if port_window_count(v_idx) < port_guaranteed(v_idx) then
+                            v_prio := v_prio + 4;
+                        end if;
+                        -- don't immediately re-grant a port that has just used up its burst if someone else is waiting
+                        if requests(v_idx) = '1' and v_prio > v_best_prio and not (v_release and v_idx = grant) then
+                            v_found     := true;
+                            v_best      := v_idx;
+                            v_best_prio := v_prio;
+                        end if;
+                    end loop;
+                    if not v_found and v_release and requests(grant) = '1' then
+                        -- nobody else wants the bus, so keep the current master on it
+                        v_found := true;
+                        v_best  := grant;
+                    end if;
+
+                    burst_count <= (others => '0');
+                    -- with no requests the grant stays parked on the current port
+                    if v_found then
+                        granted    <= '1';
+                        grant      <= v_best;
+                        last_grant <= v_best;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    --! Bandwidth, wait and QoS window counters
+    counter_proc : process (wb_clk)
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' or clr_counters = '1' then
+                port_bw_count     <= (others => (others => '0'));
+                port_wait_count   <= (others => (others => '0'));
+                port_window_count <= (others => (others => '0'));
+                window_timer      <= (others => '0');
+            else
+                for i in 0 to G_NUM_PORTS - 1 loop
+                    if accept = '1' and grant = i then
+                        port_bw_count(i) <= port_bw_count(i) + 1;
+                        if port_window_count(i) /= x"FFFF" then
+                            port_window_count(i) <= port_window_count(i) + 1;
+                        end if;
+                    elsif requests(i) = '1' then
+                        port_wait_count(i) <= port_wait_count(i) + 1;
+                    end if;
+                end loop;
+
+                if window_timer >= qos_window_len then
+                    window_timer      <= (others => '0');
+                    port_window_count <= (others => (others => '0'));
+                else
+                    window_timer <= window_timer + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- this slave can always respond to requests, so no stalling is required
+    wb_cfg_miso_out.stall <= '0';
+
+    --! config/status register access
+    wb_cfg_proc : process (wb_clk)
+        variable v_port : integer range 0 to C_MAX_PORTS - 1;
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                wb_cfg_miso_out.ack <= '0';
+                wb_cfg_miso_out.err <= '0';
+                wb_cfg_miso_out.rty <= '0';
+                clr_counters        <= '0';
+
+                port_priority   <= (others => (others => '0'));
+                port_burst_len  <= (others => to_unsigned(G_DEFAULT_BURST mod 256, 8));
+                port_guaranteed <= (others => (others => '0'));
+                qos_window_len  <= to_unsigned(G_DEFAULT_WINDOW, 32);
+            else
+                -- defaults
+                wb_cfg_miso_out.ack  <= '0';
+                wb_cfg_miso_out.err  <= '0'; -- this slave does not generate ERR or RTY responses
+                wb_cfg_miso_out.rty  <= '0';
+                wb_cfg_miso_out.rdat <= x"DEADC0DE";
+                clr_counters         <= '0';
+
+                if wb_cfg_mosi_in.stb = '1' then -- assume CYC asserted by master for STB to be high
+                    -- always ACK this cycle (sync operation with 1 wait state)
+                    wb_cfg_miso_out.ack <= '1';
+                    v_port              := slv2uint(wb_cfg_mosi_in.adr(5 downto 4));
+
+                    if wb_cfg_mosi_in.adr(7 downto 6) = b"00" then
+                        -- global registers
+                        case wb_cfg_mosi_in.adr(3 downto 0) is
+                            when x"0" =>
+                                if wb_cfg_mosi_in.we = '1' then
+                                    clr_counters <= wb_cfg_mosi_in.wdat(0);
+                                end if;
+                                wb_cfg_miso_out.rdat <= uint2slv(G_NUM_PORTS);
+                            when x"4" =>
+                                if wb_cfg_mosi_in.we = '1' then
+                                    qos_window_len <= unsigned(wb_cfg_mosi_in.wdat);
+                                end if;
+                                wb_cfg_miso_out.rdat <= std_logic_vector(qos_window_len);
+                            when others => null;
+                        end case;
+
+                    elsif wb_cfg_mosi_in.adr(7 downto 6) = b"01" and v_port < G_NUM_PORTS then
+                        -- per-port registers
+                        case wb_cfg_mosi_in.adr(3 downto 0) is
+                            when x"0" =>
+                                if wb_cfg_mosi_in.we = '1' then
+                                    port_priority(v_port)  <= unsigned(wb_cfg_mosi_in.wdat(1 downto 0));
+                                    port_burst_len(v_port) <= unsigned(wb_cfg_mosi_in.wdat(15 downto 8));
+                                end if;
+                                wb_cfg_miso_out.rdat              <= (others => '0');
+                                wb_cfg_miso_out.rdat(1 downto 0)  <= std_logic_vector(port_priority(v_port));
+                                wb_cfg_miso_out.rdat(15 downto 8) <= std_logic_vector(port_burst_len(v_port));
+                            when x"4" =>
+                                if wb_cfg_mosi_in.we = '1' then
+                                    port_guaranteed(v_port) <= unsigned(wb_cfg_mosi_in.wdat(15 downto 0));
+                                end if;
+                                wb_cfg_miso_out.rdat <= x"0000" & std_logic_vector(port_guaranteed(v_port));
+                            when x"8" =>
+                                wb_cfg_miso_out.rdat <= std_logic_vector(port_bw_count(v_port));
+                            when x"C" =>
+                                wb_cfg_miso_out.rdat <= std_logic_vector(port_wait_count(v_port));
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture;
@@ -0,0 +1,217 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+--! SD bus CMD line: sends a command with its CRC7 and receives the response
+--!
+--! Bits are driven on the falling edge of the SD clock and sampled on the rising edge, given as
+--! strobes by wb_sd_host's clock divider. After the response (or the command, if there is none)
+--! the line is left idle for 8 clocks (Nrc/Ncc) before the next command can go out, and for an
+--! R1b response DAT0 is then polled until the card stops signalling busy.
+entity sd_host_cmd is
+    port (
+        clk   : in std_logic;
+        reset : in std_logic;
+
+        -- cycle in which the SD clock rises/falls
+        sd_rise_in : in std_logic;
+        sd_fall_in : in std_logic;
+
+        start_in     : in std_logic;
+        index_in     : in std_logic_vector(5 downto 0);
+        arg_in       : in std_logic_vector(31 downto 0);
+        resp_type_in : in std_logic_vector(1 downto 0); -- see RESP_* in wb_sd_host
+        busy_in      : in std_logic;                    -- wait for DAT0 after the response (R1b)
+
+        busy_out      : out std_logic;
+        done_out      : out std_logic; -- one cycle, with the flags below
+        timeout_out   : out std_logic; -- no response within Ncr
+        crc_err_out   : out std_logic; -- bad CRC7 or end bit
+        index_err_out : out std_logic; -- response to a different command
+        resp_out      : out std_logic_vector(127 downto 0); -- [31:0] card status for 48 bit responses, CID/CSD for R2
+
+        cmd_out    : out std_logic;
+        cmd_oe_out : out std_logic;
+        cmd_in     : in std_logic;
+        dat0_in    : in std_logic
+    );
+end entity sd_host_cmd;
+
+architecture rtl of sd_host_cmd is
+    constant RESP_NONE   : std_logic_vector(1 downto 0) := "00";
+    constant RESP_48     : std_logic_vector(1 downto 0) := "01";
+    constant RESP_48_RAW : std_logic_vector(1 downto 0) := "10"; -- R3, no CRC7 or index
+    constant RESP_136    : std_logic_vector(1 downto 0) := "11";
+
+    constant NCR_MAX : integer := 64; -- clocks from the command end bit to the response start bit
+    constant GAP     : integer := 8;
+
+    type t_state is (IDLE, SEND, WAIT_RESP, RESP, WAIT_GAP, WAIT_BUSY, DONE);
+    signal state : t_state := IDLE;
+
+    signal tx_sr     : std_logic_vector(47 downto 0)  := (others => '1');
+    signal rx_sr     : std_logic_vector(135 downto 0) := (others => '0');
+    signal count     : integer range 0 to 135         := 0;
+    signal pos       : integer range 0 to 136         := 0; -- response bit being received
+    signal crc       : std_logic_vector(6 downto 0)   := (others => '0');
+    signal resp_type : std_logic_vector(1 downto 0)   := RESP_NONE;
+    signal busy_wait : std_logic                      := '0';
+    signal index     : std_logic_vector(5 downto 0)   := (others => '0');
+
+    --! shift one bit MSB first through the CRC7 (x^7 + x^3 + 1)
+    function crc7_bit(c : std_logic_vector(6 downto 0); b : std_logic) return std_logic_vector is
+        variable r : std_logic_vector(6 downto 0) := c(5 downto 0) & '0';
+    begin
+        if (c(6) xor b) = '1' then
+            r := r xor "0001001";
+        end if;
+        return r;
+    end function;
+
+    function crc7(v : std_logic_vector) return std_logic_vector is
+        variable c : std_logic_vector(6 downto 0) := (others => '0');
+    begin
+        for i in v'range loop
+            c := crc7_bit(c, v(i));
+        end loop;
+        return c;
+    end function;
+begin
+
+    -- until the flags have been seen, so that they are valid once busy_out clears
+    busy_out <= '0' when state = IDLE and done_out = '0' else '1';
+
+    cmd_proc : process (clk) is
+        variable frame    : std_logic_vector(39 downto 0);
+        variable rx       : std_logic_vector(135 downto 0);
+        variable last     : integer range 0 to 135;
+        variable crc_from : integer range 0 to 135;
+        variable crc_at   : integer range 0 to 135;
+    begin
+        if rising_edge(clk) then
+            done_out <= '0';
+            if reset = '1' then
+                state      <= IDLE;
+                cmd_out    <= '1';
+                cmd_oe_out <= '0';
+            else
+                -- response layout: 48 bit ones have a CRC7 over the first 40 bits, R2 over the
+                -- 120 bits of CID/CSD after the 8 bit header
+                if resp_type = RESP_136 then
+                    last     := 135;
+                    crc_from := 8;
+                    crc_at   := 128;
+                else
+                    last     := 47;
+                    crc_from := 0;
+                    crc_at   := 40;
+                end if;
+
+                case state is
+                    when IDLE =>
+                        if start_in = '1' then
+                            frame         := "01" & index_in & arg_in;
+                            tx_sr         <= frame & crc7(frame) & '1';
+                            count         <= 48;
+                            index         <= index_in;
+                            resp_type     <= resp_type_in;
+                            busy_wait     <= busy_in;
+                            timeout_out   <= '0';
+                            crc_err_out   <= '0';
+                            index_err_out <= '0';
+                            state         <= SEND;
+                        end if;
+
+                    when SEND =>
+                        if sd_fall_in = '1' then
+                            if count /= 0 then
+                                cmd_out    <= tx_sr(47);
+                                cmd_oe_out <= '1';
+                                tx_sr      <= tx_sr(46 downto 0) & '1';
+                                count      <= count - 1;
+                            else
+                                -- the end bit has been sampled, let the card have the line
+                                cmd_out    <= '1';
+                                cmd_oe_out <= '0';
+                                if resp_type = RESP_NONE then
+                                    count <= GAP;
+                                    state <= WAIT_GAP;
+                                else
+                                    count <= NCR_MAX;
+                                    state <= WAIT_RESP;
+                                end if;
+                            end if;
+                        end if;
+
+                    when WAIT_RESP =>
+                        if sd_rise_in = '1' then
+                            if cmd_in = '0' then
+                                crc   <= crc7_bit("0000000", '0');
+                                rx_sr <= (others => '0');
+                                pos   <= 1;
+                                state <= RESP;
+                            elsif count = 0 then
+                                timeout_out <= '1';
+                                state       <= DONE;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when RESP =>
+                        if sd_rise_in = '1' then
+                            rx    := rx_sr(134 downto 0) & cmd_in;
+                            rx_sr <= rx;
+                            pos   <= pos + 1;
+                            if pos >= crc_from and pos < crc_at then
+                                crc <= crc7_bit(crc, cmd_in);
+                            elsif pos < crc_at + 7 then
+                                if resp_type /= RESP_48_RAW and cmd_in /= crc(6) then
+                                    crc_err_out <= '1';
+                                end if;
+                                crc <= crc(5 downto 0) & '0';
+                            end if;
+                            if pos = last then
+                                if cmd_in = '0' then
+                                    crc_err_out <= '1'; -- end bit
+                                end if;
+                                if resp_type = RESP_136 then
+                                    resp_out <= rx(127 downto 0);
+                                else
+                                    resp_out <= (127 downto 32 => '0') & rx(39 downto 8);
+                                    if resp_type = RESP_48 and rx(45 downto 40) /= index then
+                                        index_err_out <= '1';
+                                    end if;
+                                end if;
+                                count <= GAP;
+                                state <= WAIT_GAP;
+                            end if;
+                        end if;
+
+                    when WAIT_GAP =>
+                        if sd_rise_in = '1' then
+                            if count = 1 then
+                                if busy_wait = '1' then
+                                    state <= WAIT_BUSY;
+                                else
+                                    state <= DONE;
+                                end if;
+                            end if;
+                            count <= count - 1;
+                        end if;
+
+                    when WAIT_BUSY =>
+                        -- no timeout, an erase can keep the card busy for seconds
+                        if sd_rise_in = '1' and dat0_in = '1' then
+                            state <= DONE;
+                        end if;
+
+                    when DONE =>
+                        done_out <= '1';
+                        state    <= IDLE;
+                end case;
+            end if;
+        end if;
+    end process;
+
+end architecture;
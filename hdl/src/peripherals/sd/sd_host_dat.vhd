@@ -0,0 +1,360 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+--! SD bus DAT lines: data blocks to and from the card, 1 or 4 bits wide
+--!
+--! Each line carries its own CRC16, checked on reads and generated on writes. Data words are in
+--! memory (little endian) order, the first byte of the block in [7:0].
+--!
+--! Reads wait up to timeout_in SD clocks for each block's start bit. clk_stop_out asks for the
+--! SD clock to be held low while waiting for a block the FIFO has no room for, which pauses the
+--! card until the FIFO has been drained. Writes send a block once it is all in the FIFO, then
+--! take the card's CRC status and wait (up to timeout_in again) for it to stop signalling busy.
+--!
+--! A transfer stops at the first error, after block_count blocks, or on abort_in.
+entity sd_host_dat is
+    port (
+        clk   : in std_logic;
+        reset : in std_logic;
+
+        -- cycle in which the SD clock rises/falls
+        sd_rise_in : in std_logic;
+        sd_fall_in : in std_logic;
+
+        read_start_in  : in std_logic;
+        write_start_in : in std_logic;
+        abort_in       : in std_logic;
+        wide_in        : in std_logic;             -- 4 bit bus
+        block_len_in   : in unsigned(9 downto 0);  -- bytes, multiple of 4
+        block_count_in : in unsigned(15 downto 0);
+        timeout_in     : in unsigned(31 downto 0); -- in SD clocks
+
+        busy_out        : out std_logic;
+        done_out        : out std_logic; -- one cycle, with the flags below
+        timeout_err_out : out std_logic;
+        crc_err_out     : out std_logic; -- bad CRC16 or end bit on a read
+        write_err_out   : out std_logic; -- the card did not accept a block
+        blocks_left_out : out unsigned(15 downto 0);
+        clk_stop_out    : out std_logic;
+
+        -- to the FIFO
+        rx_data_out  : out std_logic_vector(31 downto 0);
+        rx_valid_out : out std_logic;
+        rx_space_in  : in std_logic; -- room for a whole block
+        tx_data_in   : in std_logic_vector(31 downto 0);
+        tx_pop_out   : out std_logic;
+        tx_ready_in  : in std_logic; -- a whole block is waiting
+
+        dat_out    : out std_logic_vector(3 downto 0);
+        dat_oe_out : out std_logic_vector(3 downto 0);
+        dat_in     : in std_logic_vector(3 downto 0)
+    );
+end entity sd_host_dat;
+
+architecture rtl of sd_host_dat is
+    constant NWR : integer := 2; -- clocks before a write block start bit
+
+    type t_state is (IDLE,
+        RD_WAIT, RD_DATA, RD_CRC, RD_END,
+        WR_WAIT, WR_START, WR_DATA, WR_CRC, WR_END, WR_RELEASE, WR_STATUS, WR_BUSY,
+        DONE);
+    signal state : t_state := IDLE;
+
+    type t_crc_arr is array (0 to 3) of std_logic_vector(15 downto 0);
+    signal crc : t_crc_arr := (others => (others => '0'));
+
+    signal wide        : std_logic             := '0';
+    signal lines       : std_logic_vector(3 downto 0);
+    signal blocks_left : unsigned(15 downto 0) := (others => '0');
+    signal count       : unsigned(31 downto 0) := (others => '0'); -- clocks left in this phase
+    signal sr          : std_logic_vector(31 downto 0) := (others => '1');
+    signal sr_bits     : integer range 0 to 32 := 0;
+    signal status      : std_logic_vector(2 downto 0) := (others => '0');
+
+    --! shift one bit MSB first through the CRC16 (CCITT, x^16 + x^12 + x^5 + 1)
+    function crc16_bit(c : std_logic_vector(15 downto 0); b : std_logic) return std_logic_vector is
+        variable r : std_logic_vector(15 downto 0) := c(14 downto 0) & '0';
+    begin
+        if (c(15) xor b) = '1' then
+            r := r xor x"1021";
+        end if;
+        return r;
+    end function;
+
+    --! between the order bytes go over the bus (first in [31:24]) and memory order (first in [7:0])
+    function swap_bytes(w : std_logic_vector(31 downto 0)) return std_logic_vector is
+    begin
+        return w(7 downto 0) & w(15 downto 8) & w(23 downto 16) & w(31 downto 24);
+    end function;
+
+    --! clocks per block, each carries 4 bits on a wide bus or 1 on a narrow one
+    function data_clocks(len : unsigned(9 downto 0); wide : std_logic) return unsigned is
+    begin
+        if wide = '1' then
+            return resize(len & '0', 32);
+        end if;
+        return resize(len & "000", 32);
+    end function;
+begin
+
+    busy_out        <= '0' when state = IDLE and done_out = '0' else '1'; -- see sd_host_cmd
+    blocks_left_out <= blocks_left;
+    lines           <= "1111" when wide = '1' else "0001";
+
+    -- pause the card rather than overflow the FIFO
+    clk_stop_out <= '1' when state = RD_WAIT and rx_space_in = '0' else '0';
+
+    dat_proc : process (clk) is
+        variable bits : std_logic_vector(3 downto 0);
+        variable w    : std_logic_vector(31 downto 0);
+        variable n    : integer range 0 to 32;
+    begin
+        if rising_edge(clk) then
+            done_out     <= '0';
+            rx_valid_out <= '0';
+            tx_pop_out   <= '0';
+
+            if reset = '1' or abort_in = '1' then
+                state      <= IDLE;
+                dat_out    <= (others => '1');
+                dat_oe_out <= (others => '0');
+            else
+                case state is
+                    when IDLE =>
+                        timeout_err_out <= '0';
+                        crc_err_out     <= '0';
+                        write_err_out   <= '0';
+                        wide            <= wide_in;
+                        count           <= timeout_in;
+                        -- blocks_left is only loaded on a start, so that it reads back how many
+                        -- blocks were not transferred
+                        if block_count_in /= 0 then
+                            if read_start_in = '1' then
+                                blocks_left <= block_count_in;
+                                state       <= RD_WAIT;
+                            elsif write_start_in = '1' then
+                                blocks_left <= block_count_in;
+                                count       <= to_unsigned(NWR, 32);
+                                state       <= WR_WAIT;
+                            end if;
+                        end if;
+
+                    ----------------------------------------------------------------
+                    -- read
+                    ----------------------------------------------------------------
+                    when RD_WAIT =>
+                        if sd_rise_in = '1' then
+                            if dat_in(0) = '0' then
+                                crc     <= (others => (others => '0'));
+                                count   <= data_clocks(block_len_in, wide) - 1;
+                                sr_bits <= 0;
+                                state   <= RD_DATA;
+                            elsif count = 0 then
+                                timeout_err_out <= '1';
+                                state           <= DONE;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when RD_DATA =>
+                        if sd_rise_in = '1' then
+                            for i in 0 to 3 loop
+                                if lines(i) = '1' then
+                                    crc(i) <= crc16_bit(crc(i), dat_in(i));
+                                end if;
+                            end loop;
+                            if wide = '1' then
+                                w := sr(27 downto 0) & dat_in;
+                                n := sr_bits + 4;
+                            else
+                                w := sr(30 downto 0) & dat_in(0);
+                                n := sr_bits + 1;
+                            end if;
+                            sr <= w;
+                            if n = 32 then
+                                rx_data_out  <= swap_bytes(w);
+                                rx_valid_out <= '1';
+                                n            := 0;
+                            end if;
+                            sr_bits <= n;
+                            if count = 0 then
+                                count <= to_unsigned(15, 32);
+                                state <= RD_CRC;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when RD_CRC =>
+                        if sd_rise_in = '1' then
+                            for i in 0 to 3 loop
+                                if lines(i) = '1' then
+                                    if dat_in(i) /= crc(i)(15) then
+                                        crc_err_out <= '1';
+                                    end if;
+                                    crc(i) <= crc(i)(14 downto 0) & '0';
+                                end if;
+                            end loop;
+                            if count = 0 then
+                                state <= RD_END;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when RD_END =>
+                        if sd_rise_in = '1' then
+                            blocks_left <= blocks_left - 1;
+                            count       <= timeout_in;
+                            if (dat_in and lines) /= lines then
+                                crc_err_out <= '1';
+                                state       <= DONE;
+                            elsif crc_err_out = '1' or blocks_left = 1 then
+                                state <= DONE;
+                            else
+                                state <= RD_WAIT;
+                            end if;
+                        end if;
+
+                    ----------------------------------------------------------------
+                    -- write
+                    ----------------------------------------------------------------
+                    when WR_WAIT =>
+                        -- at least Nwr clocks after the response or the last block's busy
+                        if sd_rise_in = '1' and count /= 0 then
+                            count <= count - 1;
+                        end if;
+                        if count = 0 and tx_ready_in = '1' then
+                            state <= WR_START;
+                        end if;
+
+                    when WR_START =>
+                        if sd_fall_in = '1' then
+                            dat_out    <= "0000";
+                            dat_oe_out <= lines;
+                            crc        <= (others => (others => '0'));
+                            count      <= data_clocks(block_len_in, wide) - 1;
+                            sr_bits    <= 0;
+                            state      <= WR_DATA;
+                        end if;
+
+                    when WR_DATA =>
+                        if sd_fall_in = '1' then
+                            if sr_bits = 0 then
+                                w := swap_bytes(tx_data_in);
+                                n := 32;
+                                tx_pop_out <= '1';
+                            else
+                                w := sr;
+                                n := sr_bits;
+                            end if;
+                            if wide = '1' then
+                                bits := w(31 downto 28);
+                                sr      <= w(27 downto 0) & "1111";
+                                sr_bits <= n - 4;
+                            else
+                                bits := "111" & w(31);
+                                sr      <= w(30 downto 0) & '1';
+                                sr_bits <= n - 1;
+                            end if;
+                            dat_out <= bits;
+                            for i in 0 to 3 loop
+                                if lines(i) = '1' then
+                                    crc(i) <= crc16_bit(crc(i), bits(i));
+                                end if;
+                            end loop;
+                            if count = 0 then
+                                count <= to_unsigned(15, 32);
+                                state <= WR_CRC;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when WR_CRC =>
+                        if sd_fall_in = '1' then
+                            for i in 0 to 3 loop
+                                dat_out(i) <= crc(i)(15);
+                                crc(i)     <= crc(i)(14 downto 0) & '0';
+                            end loop;
+                            if count = 0 then
+                                state <= WR_END;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when WR_END =>
+                        if sd_fall_in = '1' then
+                            dat_out <= "1111";
+                            state   <= WR_RELEASE;
+                        end if;
+
+                    when WR_RELEASE =>
+                        if sd_fall_in = '1' then
+                            dat_oe_out <= "0000";
+                            count      <= timeout_in;
+                            sr_bits    <= 0;
+                            state      <= WR_STATUS;
+                        end if;
+
+                    when WR_STATUS =>
+                        -- CRC status on DAT0: start bit, 3 status bits ("010" accepted), end bit
+                        if sd_rise_in = '1' then
+                            if sr_bits = 0 then
+                                if dat_in(0) = '0' then
+                                    sr_bits <= 1;
+                                elsif count = 0 then
+                                    timeout_err_out <= '1';
+                                    state           <= DONE;
+                                else
+                                    count <= count - 1;
+                                end if;
+                            elsif sr_bits < 4 then
+                                status  <= status(1 downto 0) & dat_in(0);
+                                sr_bits <= sr_bits + 1;
+                            else
+                                -- end bit, then DAT0 is held low while the card is busy. Give it
+                                -- a couple of clocks to get started
+                                count   <= timeout_in;
+                                sr_bits <= 2;
+                                if status /= "010" then
+                                    write_err_out <= '1';
+                                    state         <= DONE;
+                                else
+                                    state <= WR_BUSY;
+                                end if;
+                            end if;
+                        end if;
+
+                    when WR_BUSY =>
+                        if sd_rise_in = '1' and sr_bits /= 0 then
+                            sr_bits <= sr_bits - 1;
+                        elsif sd_rise_in = '1' then
+                            if dat_in(0) = '1' then
+                                blocks_left <= blocks_left - 1;
+                                count       <= to_unsigned(NWR, 32);
+                                if blocks_left = 1 then
+                                    state <= DONE;
+                                else
+                                    state <= WR_WAIT;
+                                end if;
+                            elsif count = 0 then
+                                timeout_err_out <= '1';
+                                state           <= DONE;
+                            else
+                                count <= count - 1;
+                            end if;
+                        end if;
+
+                    when DONE =>
+                        done_out <= '1';
+                        state    <= IDLE;
+                end case;
+            end if;
+        end if;
+    end process;
+
+end architecture;
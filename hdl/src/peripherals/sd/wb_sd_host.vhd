@@ -0,0 +1,576 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! SD card host controller for the native SD bus (CLK, CMD and 1 or 4 DAT lines)
+--!
+--! The SD clock is wb_clk / (2 * (DIV + 1)), so up to half the SoC clock. The card starts at
+--! 400KHz or less, and the driver switches to 25MHz (default speed) or, after CMD6, 50MHz (high
+--! speed) as far as the SoC clock allows. With a 4 bit bus that moves 4x as many bits per clock
+--! as wb_spi, which tops out at the same SCK.
+--!
+--! A command is sent by writing ARG, then CMD. If CMD has DATA set, BLOCK_COUNT blocks of
+--! BLOCK_LEN bytes go through a G_FIFO_WORDS FIFO, which is emptied/filled either through the
+--! FIFO register or, with CTRL.DMA set, by the Wishbone master port to/from DMA_ADDR. Reads
+--! start waiting for data as the command goes out, writes once the response has come back. If
+--! the FIFO has no room for the next block of a read, the SD clock is stopped until it has.
+--!
+--! Multi block transfers (CMD18/CMD25) need CMD12 from software once DATA_BUSY has cleared. To
+--! stream a read into buffers that are not known up front, send CMD18 for more blocks than are
+--! needed without CTRL.DMA, then hand each block to the DMA with DMA_ADDR and DMA_WORDS as it is
+--! wanted. The SD clock stops while the FIFO is full, so the card waits. ABORT, then CMD12, ends
+--! the stream.
+--!
+--! The pins want pull-ups on CMD and DAT, the outputs are meant for IOBUFs (x_out, x_oe_out).
+entity wb_sd_host is
+    generic (
+        G_FIFO_WORDS  : integer := 256; --! room for 2 blocks of 512B, so a read can stream
+        G_BURST_WORDS : integer := 8
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        -- register slave port
+        wb_mosi_in  : in t_wb_mosi;
+        wb_miso_out : out t_wb_miso;
+
+        -- DMA master port
+        wb_mosi_out : out t_wb_mosi;
+        wb_miso_in  : in t_wb_miso;
+
+        sd_clk_out    : out std_logic;
+        sd_cmd_out    : out std_logic;
+        sd_cmd_oe_out : out std_logic;
+        sd_cmd_in     : in std_logic;
+        sd_dat_out    : out std_logic_vector(3 downto 0);
+        sd_dat_oe_out : out std_logic_vector(3 downto 0);
+        sd_dat_in     : in std_logic_vector(3 downto 0)
+    );
+end entity wb_sd_host;
+
+architecture rtl of wb_sd_host is
+    -- Register Map
+    -- x00: ARG          (RW) command argument
+    -- x04: CMD          (RW) writing sends the command (ignored while CMD_BUSY)
+    -- [5:0]    INDEX
+    -- [9:8]    RESP        0: none, 1: 48 bit (R1, R6, R7), 2: 48 bit without CRC7/index (R3),
+    --                      3: 136 bit (R2)
+    -- [10]     BUSY        wait for the card to release DAT0 after the response (R1b)
+    -- [11]     DATA        transfer BLOCK_COUNT blocks with this command (ignored while DATA_BUSY)
+    -- [12]     WRITE       the data goes to the card
+    -- x08: STATUS
+    -- [0]      CMD_BUSY    (RO)
+    -- [1]      DATA_BUSY   (RO) blocks still to transfer, or data still to go to/from DMA_ADDR
+    -- [2]      DMA_BUSY    (RO)
+    -- [8]      CMD_TIMEOUT (R/W1C) no response
+    -- [9]      CMD_CRC     (R/W1C) response CRC7 or end bit bad
+    -- [10]     CMD_INDEX   (R/W1C) response for a different command
+    -- [11]     DATA_TIMEOUT(R/W1C) no read data, write CRC status or end of busy
+    -- [12]     DATA_CRC    (R/W1C) read block CRC16 or end bit bad
+    -- [13]     WRITE_ERR   (R/W1C) the card did not accept a write block
+    -- [14]     DMA_ERR     (R/W1C) bus error on the DMA port, the transfer was abandoned
+    -- x0C: RESP0        (RO) card status of a 48 bit response, [31:0] of an R2
+    -- x10: RESP1        (RO) R2 [63:32]
+    -- x14: RESP2        (RO) R2 [95:64]
+    -- x18: RESP3        (RO) R2 [127:96]
+    -- x1C: CLK          (RW)
+    -- [15:0]   DIV         SD clock is wb_clk / (2 * (DIV + 1))
+    -- [16]     EN          run the SD clock
+    -- x20: CTRL         (RW)
+    -- [0]      WIDE        4 bit data bus (after ACMD6)
+    -- [1]      DMA         move data through the master port rather than the FIFO register
+    -- [31]     ABORT       (WO) stop the data transfer and empty the FIFO
+    -- x24: BLOCK_COUNT  (RW) [15:0] blocks for the next data command. Reads back the blocks left
+    -- x28: BLOCK_LEN    (RW) [9:0] bytes per block, multiple of 4, up to half the FIFO
+    -- x2C: DMA_ADDR     (RW) word aligned address for the next DMA, reads back the next address to
+    --                        be accessed. Only written while the DMA is idle
+    -- x30: DATA_TIMEOUT (RW) SD clocks to wait for a read block, write CRC status or end of busy
+    -- x34: FIFO         (RW) PIO data, reads return 0 when empty and writes are dropped when full
+    -- x38: FIFO_COUNT   (RO) words in the FIFO
+    -- x3C: DMA_WORDS    (WO) [23:0] start the DMA on this many words, in the direction of the data
+    --                        command in progress (one sent without CTRL.DMA). Ignored while DMA_BUSY
+
+    constant RESET_DIV     : unsigned(15 downto 0) := x"00FF";
+    constant RESET_TIMEOUT : unsigned(31 downto 0) := x"0010_0000";
+
+    -- registers
+    signal arg          : std_logic_vector(31 downto 0) := (others => '0');
+    signal cmd_reg      : std_logic_vector(12 downto 0) := (others => '0');
+    signal clk_div      : unsigned(15 downto 0) := RESET_DIV;
+    signal clk_en       : std_logic := '0';
+    signal wide         : std_logic := '0';
+    signal dma_en       : std_logic := '0';
+    signal block_count  : unsigned(15 downto 0) := to_unsigned(1, 16);
+    signal block_len    : unsigned(9 downto 0)  := to_unsigned(512, 10);
+    signal data_timeout : unsigned(31 downto 0) := RESET_TIMEOUT;
+    signal flags        : std_logic_vector(14 downto 8) := (others => '0');
+    signal flags_clear  : std_logic_vector(14 downto 8) := (others => '0');
+    signal flags_set    : std_logic_vector(14 downto 8);
+
+    -- SD clock
+    signal sd_clk    : std_logic := '0';
+    signal clk_count : unsigned(15 downto 0) := (others => '0');
+    signal sd_rise   : std_logic;
+    signal sd_fall   : std_logic;
+    signal clk_stop  : std_logic;
+
+    signal cmd_in : std_logic;
+    signal dat_in : std_logic_vector(3 downto 0);
+
+    -- CMD line
+    signal cmd_start     : std_logic := '0';
+    signal cmd_busy      : std_logic;
+    signal cmd_done      : std_logic;
+    signal cmd_timeout   : std_logic;
+    signal cmd_crc_err   : std_logic;
+    signal cmd_index_err : std_logic;
+    signal resp          : std_logic_vector(127 downto 0);
+
+    -- DAT lines
+    signal read_start     : std_logic := '0';
+    signal write_start    : std_logic := '0';
+    signal write_pending  : std_logic := '0'; -- waiting for the command response
+    signal data_write     : std_logic := '0'; -- direction of the current/last transfer
+    signal abort          : std_logic := '0';
+    signal dat_busy       : std_logic;
+    signal dat_done       : std_logic;
+    signal dat_timeout    : std_logic;
+    signal dat_crc_err    : std_logic;
+    signal dat_write_err  : std_logic;
+    signal blocks_left    : unsigned(15 downto 0);
+    signal rx_data        : std_logic_vector(31 downto 0);
+    signal rx_valid       : std_logic;
+    signal rx_space       : std_logic;
+    signal tx_pop         : std_logic;
+    signal tx_ready       : std_logic;
+    signal data_busy      : std_logic;
+    signal block_words    : integer range 0 to 256;
+
+    -- FIFO
+    type t_fifo is array (0 to G_FIFO_WORDS - 1) of std_logic_vector(31 downto 0);
+    signal fifo       : t_fifo;
+    signal fifo_rd    : integer range 0 to G_FIFO_WORDS - 1 := 0;
+    signal fifo_wr    : integer range 0 to G_FIFO_WORDS - 1 := 0;
+    signal fifo_count : integer range 0 to G_FIFO_WORDS     := 0;
+    signal fifo_head  : std_logic_vector(31 downto 0);
+    signal fifo_push  : std_logic;
+    signal fifo_pop   : std_logic;
+    signal fifo_wdata : std_logic_vector(31 downto 0);
+    signal fifo_clear : std_logic := '0';
+    signal pio_push   : std_logic;
+    signal pio_pop    : std_logic;
+
+    -- DMA
+    type t_dma_state is (DMA_IDLE, DMA_BURST);
+    signal dma_state     : t_dma_state := DMA_IDLE;
+    signal dma_addr      : unsigned(31 downto 0) := (others => '0');
+    signal dma_left      : unsigned(23 downto 0) := (others => '0'); -- words
+    signal dma_start     : std_logic := '0';
+    signal dma_kick      : std_logic := '0';
+    signal dma_words     : unsigned(23 downto 0) := (others => '0');
+    signal dma_busy      : std_logic;
+    signal dma_err       : std_logic := '0';
+    signal dma_push      : std_logic;
+    signal dma_pop       : std_logic;
+    signal burst_len     : integer range 0 to G_BURST_WORDS := 0;
+    signal req_count     : integer range 0 to G_BURST_WORDS := 0;
+    signal ack_count     : integer range 0 to G_BURST_WORDS := 0;
+    signal wb_cyc        : std_logic := '0';
+    signal wb_stb        : std_logic := '0';
+
+    signal reg_stb : std_logic;
+    signal reg_adr : std_logic_vector(7 downto 0);
+begin
+    assert G_FIFO_WORDS >= 256 report "wb_sd_host: G_FIFO_WORDS must hold two 512B blocks" severity failure;
+
+    cmd_in <= to_x01(sd_cmd_in);
+    dat_in <= to_x01(sd_dat_in);
+
+    ---------------------------------------------------------------------------
+    -- SD clock: rises and falls on the wb_clk edges after sd_rise/sd_fall. Stopped (low) while
+    -- disabled or clk_stop is set
+    ---------------------------------------------------------------------------
+    sd_rise <= '1' when clk_count = 0 and sd_clk = '0' and clk_en = '1' and clk_stop = '0' else '0';
+    sd_fall <= '1' when clk_count = 0 and sd_clk = '1' else '0';
+    sd_clk_out <= sd_clk;
+
+    clk_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                sd_clk    <= '0';
+                clk_count <= (others => '0');
+            elsif sd_rise = '1' or sd_fall = '1' then
+                sd_clk    <= not sd_clk;
+                clk_count <= clk_div;
+            elsif clk_count /= 0 then
+                clk_count <= clk_count - 1;
+            end if;
+        end if;
+    end process;
+
+    ---------------------------------------------------------------------------
+    -- registers
+    ---------------------------------------------------------------------------
+    wb_miso_out.stall <= '0';
+    reg_stb           <= wb_mosi_in.stb; -- assume CYC asserted by master for STB to be high
+    reg_adr           <= wb_mosi_in.adr(7 downto 0);
+
+    -- the FIFO register moves data in the same cycle, so back to back accesses see the next word
+    pio_pop  <= '1' when reg_stb = '1' and wb_mosi_in.we = '0' and reg_adr = x"34" and fifo_count /= 0 else '0';
+    pio_push <= '1' when reg_stb = '1' and wb_mosi_in.we = '1' and reg_adr = x"34" and fifo_count /= G_FIFO_WORDS else '0';
+
+    block_words <= to_integer(block_len(9 downto 2));
+    dma_busy    <= '1' when dma_start = '1' or dma_kick = '1' or dma_left /= 0 or dma_state /= DMA_IDLE else '0';
+    data_busy   <= '1' when dat_busy = '1' or read_start = '1' or write_start = '1' or write_pending = '1'
+                   or dma_busy = '1' else '0';
+
+    wb_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                wb_miso_out.ack <= '0';
+                wb_miso_out.err <= '0';
+                wb_miso_out.rty <= '0';
+                arg             <= (others => '0');
+                cmd_reg         <= (others => '0');
+                clk_div         <= RESET_DIV;
+                clk_en          <= '0';
+                wide            <= '0';
+                dma_en          <= '0';
+                block_count     <= to_unsigned(1, 16);
+                block_len       <= to_unsigned(512, 10);
+                data_timeout    <= RESET_TIMEOUT;
+                cmd_start       <= '0';
+                read_start      <= '0';
+                dma_start       <= '0';
+                dma_kick        <= '0';
+                data_write      <= '0';
+                flags_clear     <= (others => '0');
+                abort           <= '0';
+                fifo_clear      <= '0';
+            else
+                -- defaults
+                wb_miso_out.ack  <= '0';
+                wb_miso_out.err  <= '0'; -- this slave does not generate ERR or RTY responses
+                wb_miso_out.rty  <= '0';
+                wb_miso_out.rdat <= x"DEADC0DE";
+                cmd_start        <= '0';
+                read_start       <= '0';
+                dma_start        <= '0';
+                dma_kick         <= '0';
+                flags_clear      <= (others => '0');
+                abort            <= '0';
+                fifo_clear       <= '0';
+
+                if reg_stb = '1' then
+                    -- always ACK this cycle (sync operation with 1 wait state)
+                    wb_miso_out.ack <= '1';
+                    if wb_mosi_in.we = '1' then
+                        case reg_adr is
+                            when x"00" => arg <= wb_mosi_in.wdat;
+                            when x"04" =>
+                                if cmd_busy = '0' and cmd_start = '0' then
+                                    cmd_reg   <= wb_mosi_in.wdat(12 downto 0);
+                                    cmd_start <= '1';
+                                    if wb_mosi_in.wdat(11) = '1' and data_busy = '0' then
+                                        data_write <= wb_mosi_in.wdat(12);
+                                        read_start <= not wb_mosi_in.wdat(12);
+                                        dma_start  <= dma_en;
+                                        fifo_clear <= '1';
+                                    end if;
+                                end if;
+                            when x"08" => flags_clear <= wb_mosi_in.wdat(14 downto 8);
+                            when x"1C" =>
+                                clk_div <= unsigned(wb_mosi_in.wdat(15 downto 0));
+                                clk_en  <= wb_mosi_in.wdat(16);
+                            when x"20" =>
+                                wide   <= wb_mosi_in.wdat(0);
+                                dma_en <= wb_mosi_in.wdat(1);
+                                if wb_mosi_in.wdat(31) = '1' then
+                                    abort      <= '1';
+                                    fifo_clear <= '1';
+                                end if;
+                            when x"24" =>
+                                if data_busy = '0' then
+                                    block_count <= unsigned(wb_mosi_in.wdat(15 downto 0));
+                                end if;
+                            when x"28" =>
+                                if data_busy = '0' then
+                                    block_len <= unsigned(wb_mosi_in.wdat(9 downto 2)) & "00";
+                                end if;
+                            when x"30" => data_timeout <= unsigned(wb_mosi_in.wdat);
+                            when x"3C" =>
+                                if dma_busy = '0' then
+                                    dma_words <= unsigned(wb_mosi_in.wdat(23 downto 0));
+                                    dma_kick  <= '1';
+                                end if;
+                            when others => null;
+                        end case;
+                    else
+                        case reg_adr is
+                            when x"00" => wb_miso_out.rdat <= arg;
+                            when x"04" => wb_miso_out.rdat <= (31 downto 13 => '0') & cmd_reg;
+                            when x"08" =>
+                                wb_miso_out.rdat              <= (others => '0');
+                                wb_miso_out.rdat(0)           <= cmd_busy or cmd_start;
+                                wb_miso_out.rdat(1)           <= data_busy;
+                                wb_miso_out.rdat(2)           <= dma_busy;
+                                wb_miso_out.rdat(14 downto 8) <= flags;
+                            when x"0C" => wb_miso_out.rdat <= resp(31 downto 0);
+                            when x"10" => wb_miso_out.rdat <= resp(63 downto 32);
+                            when x"14" => wb_miso_out.rdat <= resp(95 downto 64);
+                            when x"18" => wb_miso_out.rdat <= resp(127 downto 96);
+                            when x"1C" => wb_miso_out.rdat <= (31 downto 17 => '0') & clk_en & std_logic_vector(clk_div);
+                            when x"20" => wb_miso_out.rdat <= (31 downto 2 => '0') & dma_en & wide;
+                            when x"24" =>
+                                if data_busy = '1' then
+                                    wb_miso_out.rdat <= x"0000" & std_logic_vector(blocks_left);
+                                else
+                                    wb_miso_out.rdat <= x"0000" & std_logic_vector(block_count);
+                                end if;
+                            when x"28" => wb_miso_out.rdat <= (31 downto 10 => '0') & std_logic_vector(block_len);
+                            when x"2C" => wb_miso_out.rdat <= std_logic_vector(dma_addr);
+                            when x"30" => wb_miso_out.rdat <= std_logic_vector(data_timeout);
+                            when x"34" =>
+                                if fifo_count /= 0 then
+                                    wb_miso_out.rdat <= fifo_head;
+                                else
+                                    wb_miso_out.rdat <= (others => '0');
+                                end if;
+                            when x"38" => wb_miso_out.rdat <= uint2slv(fifo_count);
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- sticky status flags, set wins over clear
+    flags_set <= dma_err
+                 & (dat_done and dat_write_err) & (dat_done and dat_crc_err) & (dat_done and dat_timeout)
+                 & (cmd_done and cmd_index_err) & (cmd_done and cmd_crc_err) & (cmd_done and cmd_timeout);
+
+    flag_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                flags <= (others => '0');
+            else
+                flags <= (flags and not flags_clear) or flags_set;
+            end if;
+        end if;
+    end process;
+
+    -- writes start once the card has answered the command, and not at all if it didn't
+    write_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            write_start <= '0';
+            if wb_reset = '1' or abort = '1' then
+                write_pending <= '0';
+            elsif cmd_start = '1' and data_busy = '0' and cmd_reg(12 downto 11) = "11" then
+                write_pending <= '1';
+            elsif write_pending = '1' and cmd_done = '1' then
+                write_pending <= '0';
+                write_start   <= not (cmd_timeout or cmd_crc_err or cmd_index_err);
+            end if;
+        end if;
+    end process;
+
+    sd_host_cmd_inst : entity work.sd_host_cmd
+        port map(
+            clk           => wb_clk,
+            reset         => wb_reset,
+            sd_rise_in    => sd_rise,
+            sd_fall_in    => sd_fall,
+            start_in      => cmd_start,
+            index_in      => cmd_reg(5 downto 0),
+            arg_in        => arg,
+            resp_type_in  => cmd_reg(9 downto 8),
+            busy_in       => cmd_reg(10),
+            busy_out      => cmd_busy,
+            done_out      => cmd_done,
+            timeout_out   => cmd_timeout,
+            crc_err_out   => cmd_crc_err,
+            index_err_out => cmd_index_err,
+            resp_out      => resp,
+            cmd_out       => sd_cmd_out,
+            cmd_oe_out    => sd_cmd_oe_out,
+            cmd_in        => cmd_in,
+            dat0_in       => dat_in(0)
+        );
+
+    sd_host_dat_inst : entity work.sd_host_dat
+        port map(
+            clk             => wb_clk,
+            reset           => wb_reset,
+            sd_rise_in      => sd_rise,
+            sd_fall_in      => sd_fall,
+            read_start_in   => read_start,
+            write_start_in  => write_start,
+            abort_in        => abort,
+            wide_in         => wide,
+            block_len_in    => block_len,
+            block_count_in  => block_count,
+            timeout_in      => data_timeout,
+            busy_out        => dat_busy,
+            done_out        => dat_done,
+            timeout_err_out => dat_timeout,
+            crc_err_out     => dat_crc_err,
+            write_err_out   => dat_write_err,
+            blocks_left_out => blocks_left,
+            clk_stop_out    => clk_stop,
+            rx_data_out     => rx_data,
+            rx_valid_out    => rx_valid,
+            rx_space_in     => rx_space,
+            tx_data_in      => fifo_head,
+            tx_pop_out      => tx_pop,
+            tx_ready_in     => tx_ready,
+            dat_out         => sd_dat_out,
+            dat_oe_out      => sd_dat_oe_out,
+            dat_in          => dat_in
+        );
+
+    ---------------------------------------------------------------------------
+    -- FIFO, between the DAT lines and the bus side (FIFO register or DMA)
+    ---------------------------------------------------------------------------
+    rx_space  <= '1' when G_FIFO_WORDS - fifo_count >= block_words else '0';
+    tx_ready  <= '1' when fifo_count >= block_words else '0';
+    fifo_head <= fifo(fifo_rd);
+
+    fifo_push  <= rx_valid when data_write = '0' else dma_push or pio_push;
+    fifo_pop   <= tx_pop when data_write = '1' else dma_pop or pio_pop;
+    fifo_wdata <= rx_data when data_write = '0' else
+                  wb_miso_in.rdat when dma_push = '1' else
+                  wb_mosi_in.wdat;
+
+    fifo_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' or fifo_clear = '1' then
+                fifo_rd    <= 0;
+                fifo_wr    <= 0;
+                fifo_count <= 0;
+            else
+                if fifo_push = '1' then
+                    fifo(fifo_wr) <= fifo_wdata;
+                    fifo_wr       <= (fifo_wr + 1) mod G_FIFO_WORDS;
+                end if;
+                if fifo_pop = '1' then
+                    fifo_rd <= (fifo_rd + 1) mod G_FIFO_WORDS;
+                end if;
+                if fifo_push = '1' and fifo_pop = '0' then
+                    fifo_count <= fifo_count + 1;
+                elsif fifo_push = '0' and fifo_pop = '1' then
+                    fifo_count <= fifo_count - 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    ---------------------------------------------------------------------------
+    -- DMA: bursts of up to G_BURST_WORDS between the FIFO and memory, CYC is dropped between
+    -- bursts to let other masters in
+    ---------------------------------------------------------------------------
+    wb_mosi_out.cyc  <= wb_cyc;
+    wb_mosi_out.stb  <= wb_stb;
+    wb_mosi_out.we   <= not data_write;
+    wb_mosi_out.adr  <= std_logic_vector(dma_addr(31 downto 2) + req_count) & "00";
+    wb_mosi_out.wdat <= fifo_head;
+    wb_mosi_out.sel  <= x"F";
+    wb_mosi_out.lock <= '0';
+
+    dma_pop  <= '1' when wb_stb = '1' and wb_miso_in.stall = '0' and data_write = '0' else '0';
+    dma_push <= '1' when wb_cyc = '1' and wb_miso_in.ack = '1' and data_write = '1' else '0';
+
+    dma_proc : process (wb_clk) is
+        variable n   : integer range 0 to G_BURST_WORDS;
+        variable req  : integer range 0 to G_BURST_WORDS;
+        variable stop : boolean;
+    begin
+        if rising_edge(wb_clk) then
+            dma_err <= '0';
+            if wb_reset = '1' then
+                dma_state <= DMA_IDLE;
+                wb_cyc    <= '0';
+                wb_stb    <= '0';
+                dma_left  <= (others => '0');
+            else
+                -- DMA_ADDR is only written while the DMA is idle
+                if reg_stb = '1' and wb_mosi_in.we = '1' and reg_adr = x"2C" and dma_busy = '0' then
+                    dma_addr <= unsigned(wb_mosi_in.wdat(31 downto 2)) & "00";
+                end if;
+                stop := abort = '1' or (dat_done = '1' and (dat_timeout or dat_crc_err or dat_write_err) = '1');
+                if stop then
+                    dma_left <= (others => '0'); -- a burst in progress still finishes
+                end if;
+
+                case dma_state is
+                    when DMA_IDLE =>
+                        wb_cyc    <= '0';
+                        wb_stb    <= '0';
+                        req_count <= 0;
+                        ack_count <= 0;
+                        if stop then
+                            null; -- wins over a start or kick in the same cycle
+                        elsif dma_start = '1' then
+                            dma_left <= resize(block_count * to_unsigned(block_words, 8), 24);
+                        elsif dma_kick = '1' then
+                            dma_left <= dma_words;
+                        elsif dma_left /= 0 then
+                            if dma_left < G_BURST_WORDS then
+                                n := to_integer(dma_left);
+                            else
+                                n := G_BURST_WORDS;
+                            end if;
+                            -- card to memory needs the words in the FIFO, memory to card room for them
+                            if (data_write = '0' and fifo_count >= n) or
+                               (data_write = '1' and G_FIFO_WORDS - fifo_count >= n) then
+                                burst_len <= n;
+                                wb_cyc    <= '1';
+                                wb_stb    <= '1';
+                                dma_state <= DMA_BURST;
+                            end if;
+                        end if;
+
+                    when DMA_BURST =>
+                        if wb_stb = '1' and wb_miso_in.stall = '0' then
+                            req       := req_count + 1;
+                            req_count <= req;
+                            if req = burst_len then
+                                wb_stb <= '0';
+                            end if;
+                        end if;
+                        if wb_miso_in.ack = '1' then
+                            ack_count <= ack_count + 1;
+                            if ack_count = burst_len - 1 then
+                                wb_cyc    <= '0';
+                                wb_stb    <= '0';
+                                dma_addr  <= dma_addr + to_unsigned(burst_len * 4, 32);
+                                req_count <= 0;
+                                if dma_left >= burst_len and not stop then
+                                    dma_left <= dma_left - burst_len;
+                                end if;
+                                dma_state <= DMA_IDLE;
+                            end if;
+                        end if;
+                        if wb_miso_in.err = '1' then
+                            wb_cyc    <= '0';
+                            wb_stb    <= '0';
+                            req_count <= 0;
+                            dma_err   <= '1';
+                            dma_left  <= (others => '0');
+                            dma_state <= DMA_IDLE;
+                        end if;
+                end case;
+            end if;
+        end if;
+    end process;
+
+end architecture;
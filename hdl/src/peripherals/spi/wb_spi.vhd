@@ -31,7 +31,12 @@ entity wb_spi is
         sck_out  : out std_logic;
         cs_n_out : out std_logic;
         mosi_out : out std_logic;
-        miso_in  : in std_logic
+        miso_in  : in std_logic;
+
+        -- every byte transferred, for wb_crc to snoop
+        tx_byte_out    : out std_logic_vector(7 downto 0);
+        rx_byte_out    : out std_logic_vector(7 downto 0);
+        byte_valid_out : out std_logic
     );
 end entity wb_spi;
 architecture rtl of wb_spi is
@@ -69,6 +74,10 @@ begin
 
     cs_n_out <= chip_selectn;
 
+    tx_byte_out    <= spi_byte_to_write;
+    rx_byte_out    <= spi_byte_read;
+    byte_valid_out <= spi_done_strb;
+
     -- wishbone slave logic
     wb_proc : process (wb_clk) is
     begin
@@ -8,7 +8,8 @@ use work.joe_common_pkg.all;
 -- TODO: make all registers byte-accessible
 entity wb_timer is
     generic (
-        G_NUM_TIMERS : integer := 1 -- only one supported for now
+        G_NUM_TIMERS : integer := 1; -- only one supported for now
+        G_NUM_CMP    : integer := 4  -- mtime compare channels (up to 8)
     );
     port (
         wb_clk   : in std_logic;
@@ -18,7 +19,8 @@ entity wb_timer is
         wb_miso_out : out t_wb_miso;
 
         pwm_out             : out std_logic;
-        timer_interrupt_out : out std_logic_vector(G_NUM_TIMERS - 1 downto 0)
+        timer_interrupt_out : out std_logic_vector(G_NUM_TIMERS - 1 downto 0);
+        cmp_interrupt_out   : out std_logic_vector(G_NUM_CMP - 1 downto 0)
     );
 end entity wb_timer;
 
@@ -34,6 +36,21 @@ architecture rtl of wb_timer is
     -- [16]     Timer Overflow
     -- x8: Timer Threshold Register (32b)
     -- xC: PWM Threshold Register (32b)
+    -- x10: Control Set (WO) bits written as 1 are set in x4 (writing [8] clears the overflow)
+    -- x14: Control Clear (WO) bits written as 1 are cleared in x4
+    --
+    -- 64 bit free running mtime, counts every clock from reset
+    -- x20: MTIME_LO (RW) reading also latches MTIME_HI, writes are held until MTIME_HI is written
+    -- x24: MTIME_HI (RW) reads the upper half latched by the last MTIME_LO read, writing loads both halves
+    -- x28: CMP_STATUS  (RW) [n] mtime has reached compare channel n, W1C
+    -- x2C: CMP_IEN     (RW) [n] interrupt enable for compare channel n
+    -- x30: CMP_IEN_SET (WO) bits written as 1 are set in CMP_IEN
+    -- x34: CMP_IEN_CLR (WO) bits written as 1 are cleared in CMP_IEN
+    -- x40 + 8n: CMPn_LO (RW) writes are held until CMPn_HI is written
+    -- x44 + 8n: CMPn_HI (RW) writing loads both halves
+    --
+    -- To read mtime without tearing, read MTIME_LO then MTIME_HI.
+    -- Compare channels reset to all ones so they never fire until programmed.
     constant G_TIMER_W : integer := 32;
 
     signal new_count_value_in       : std_logic_vector(G_TIMER_W - 1 downto 0); -- Reg x0 (On Write)
@@ -44,15 +61,29 @@ architecture rtl of wb_timer is
     signal pwm_threshold_in         : std_logic_vector(G_TIMER_W - 1 downto 0); -- Reg xC (On Read/Write)
     signal pwm_thresh_valid_in      : std_logic;
 
-    signal count_enable     : std_logic; -- Reg x4 bit 0  RW
-    signal interrupt_enable : std_logic; -- Reg x4 bit 1  RW
-    signal pwm_mode_enable  : std_logic; -- Reg x4 bit 2  RW
-    signal clr_oflow_flag   : std_logic; -- Reg x4 bit 8  WO
+    signal count_enable     : std_logic := '0'; -- Reg x4 bit 0  RW
+    signal interrupt_enable : std_logic := '0'; -- Reg x4 bit 1  RW
+    signal pwm_mode_enable  : std_logic := '0'; -- Reg x4 bit 2  RW
+    signal clr_oflow_flag   : std_logic := '0'; -- Reg x4 bit 8  WO
     signal oflow_flag       : std_logic; -- Reg x4 bit 16 RO
 
+    signal mtime           : unsigned(63 downto 0)         := (others => '0');
+    signal mtime_hi_latch  : std_logic_vector(31 downto 0) := (others => '0');
+    signal mtime_lo_hold   : std_logic_vector(31 downto 0) := (others => '0');
+    signal mtime_load      : std_logic                     := '0';
+    signal mtime_load_val  : std_logic_vector(63 downto 0) := (others => '0');
+
+    signal cmp_arr         : t_slv64_arr(G_NUM_CMP - 1 downto 0)        := (others => (others => '1'));
+    signal cmp_lo_hold     : std_logic_vector(31 downto 0)              := (others => '0');
+    signal cmp_hit         : std_logic_vector(G_NUM_CMP - 1 downto 0)   := (others => '0');
+    signal cmp_status      : std_logic_vector(G_NUM_CMP - 1 downto 0)   := (others => '0');
+    signal cmp_status_clr  : std_logic_vector(G_NUM_CMP - 1 downto 0)   := (others => '0');
+    signal cmp_ien         : std_logic_vector(G_NUM_CMP - 1 downto 0)   := (others => '0');
+
 begin
 
     timer_interrupt_out(0) <= oflow_flag and interrupt_enable;
+    cmp_interrupt_out      <= cmp_status and cmp_ien;
 
     -- this slave can always respond to requests, so no stalling is required
     wb_miso_out.stall <= '0';
@@ -70,6 +101,8 @@ begin
                 interrupt_enable <= '0';
                 pwm_mode_enable  <= '0';
                 count_enable     <= '0';
+                cmp_ien          <= (others => '0');
+                cmp_arr          <= (others => (others => '1'));
             else
                 -- defaults
                 wb_miso_out.ack  <= '0';
@@ -82,35 +115,63 @@ begin
                 top_thresh_valid_in      <= '0';
                 pwm_thresh_valid_in      <= '0';
                 clr_oflow_flag           <= '0';
+                mtime_load               <= '0';
+                cmp_status_clr           <= (others => '0');
 
                 if wb_mosi_in.stb = '1' and wb_miso_out.stall = '0' then -- assume CYC asserted by master for STB to be high
                     -- always ACK this cycle (sync operation with 1 wait state)
                     wb_miso_out.ack <= '1';
                     if wb_mosi_in.we = '1' then
                         -- write logic
-                        case(wb_mosi_in.adr(3 downto 0)) is
-                            when x"0" => -- Count Register
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => -- Count Register
                             new_count_value_in       <= wb_mosi_in.wdat(G_TIMER_W - 1 downto 0);
                             new_count_value_valid_in <= '1';
-                            when x"4" => -- Control and Status register
+                            when x"04" => -- Control and Status register
                             count_enable     <= wb_mosi_in.wdat(0);
                             interrupt_enable <= wb_mosi_in.wdat(1);
                             pwm_mode_enable  <= wb_mosi_in.wdat(2);
                             clr_oflow_flag   <= wb_mosi_in.wdat(8);
 
-                            when x"8" => -- Top Threshold
+                            when x"08" => -- Top Threshold
                             count_top_threshold_in <= wb_mosi_in.wdat(G_TIMER_W - 1 downto 0);
                             top_thresh_valid_in    <= '1';
-                            when x"C" => -- PWM Threshold
+                            when x"0C" => -- PWM Threshold
                             pwm_threshold_in    <= wb_mosi_in.wdat(G_TIMER_W - 1 downto 0);
                             pwm_thresh_valid_in <= '1';
-                            when others => null;
+                            when x"10" => -- Control Set
+                            count_enable     <= count_enable or wb_mosi_in.wdat(0);
+                            interrupt_enable <= interrupt_enable or wb_mosi_in.wdat(1);
+                            pwm_mode_enable  <= pwm_mode_enable or wb_mosi_in.wdat(2);
+                            clr_oflow_flag   <= wb_mosi_in.wdat(8);
+                            when x"14" => -- Control Clear
+                            count_enable     <= count_enable and not wb_mosi_in.wdat(0);
+                            interrupt_enable <= interrupt_enable and not wb_mosi_in.wdat(1);
+                            pwm_mode_enable  <= pwm_mode_enable and not wb_mosi_in.wdat(2);
+
+                            when x"20" => mtime_lo_hold <= wb_mosi_in.wdat;
+                            when x"24" =>
+                            mtime_load_val <= wb_mosi_in.wdat & mtime_lo_hold;
+                            mtime_load     <= '1';
+                            when x"28" => cmp_status_clr <= wb_mosi_in.wdat(G_NUM_CMP - 1 downto 0);
+                            when x"2C" => cmp_ien        <= wb_mosi_in.wdat(G_NUM_CMP - 1 downto 0);
+                            when x"30" => cmp_ien        <= cmp_ien or wb_mosi_in.wdat(G_NUM_CMP - 1 downto 0);
+                            when x"34" => cmp_ien        <= cmp_ien and not wb_mosi_in.wdat(G_NUM_CMP - 1 downto 0);
+                            when others =>
+                            -- compare channels
+                            if wb_mosi_in.adr(7 downto 6) = b"01" and slv2uint(wb_mosi_in.adr(5 downto 3)) < G_NUM_CMP then
+                                if wb_mosi_in.adr(2) = '0' then
+                                    cmp_lo_hold <= wb_mosi_in.wdat;
+                                else
+                                    cmp_arr(slv2uint(wb_mosi_in.adr(5 downto 3))) <= wb_mosi_in.wdat & cmp_lo_hold;
+                                end if;
+                            end if;
                         end case;
                     else
                         -- read logic
-                        case(wb_mosi_in.adr(3 downto 0)) is
-                            when x"0" => wb_miso_out.rdat <= count_value_out;
-                            when x"4" =>
+                        case(wb_mosi_in.adr(7 downto 0)) is
+                            when x"00" => wb_miso_out.rdat <= count_value_out;
+                            when x"04" =>
 
                             wb_miso_out.rdat     <= (others => '0'); -- default, overwrite with below ctl/status bits
                             wb_miso_out.rdat(0)  <= count_enable;
@@ -118,9 +179,26 @@ begin
                             wb_miso_out.rdat(2)  <= pwm_mode_enable;
                             wb_miso_out.rdat(16) <= oflow_flag;
 
-                            when x"8"   => wb_miso_out.rdat <= count_top_threshold_in;
-                            when x"C"   => wb_miso_out.rdat <= pwm_threshold_in;
-                            when others => null;
+                            when x"08"  => wb_miso_out.rdat <= count_top_threshold_in;
+                            when x"0C"  => wb_miso_out.rdat <= pwm_threshold_in;
+                            when x"20"  =>
+                            wb_miso_out.rdat <= std_logic_vector(mtime(31 downto 0));
+                            mtime_hi_latch   <= std_logic_vector(mtime(63 downto 32));
+                            when x"24" => wb_miso_out.rdat <= mtime_hi_latch;
+                            when x"28" =>
+                            wb_miso_out.rdat                            <= (others => '0');
+                            wb_miso_out.rdat(G_NUM_CMP - 1 downto 0)    <= cmp_status;
+                            when x"2C" =>
+                            wb_miso_out.rdat                            <= (others => '0');
+                            wb_miso_out.rdat(G_NUM_CMP - 1 downto 0)    <= cmp_ien;
+                            when others =>
+                            if wb_mosi_in.adr(7 downto 6) = b"01" and slv2uint(wb_mosi_in.adr(5 downto 3)) < G_NUM_CMP then
+                                if wb_mosi_in.adr(2) = '0' then
+                                    wb_miso_out.rdat <= cmp_arr(slv2uint(wb_mosi_in.adr(5 downto 3)))(31 downto 0);
+                                else
+                                    wb_miso_out.rdat <= cmp_arr(slv2uint(wb_mosi_in.adr(5 downto 3)))(63 downto 32);
+                                end if;
+                            end if;
                         end case;
 
                     end if;
@@ -129,6 +207,31 @@ begin
             end if; -- end clk'd
         end if;
     end process;
+
+    -- free running 64 bit time base and compare channels
+    mtime_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                mtime      <= (others => '0');
+                cmp_hit    <= (others => '0');
+                cmp_status <= (others => '0');
+            else
+                if mtime_load = '1' then
+                    mtime <= unsigned(mtime_load_val);
+                else
+                    mtime <= mtime + 1;
+                end if;
+
+                -- registered compare, flags are sticky until cleared
+                for i in 0 to G_NUM_CMP - 1 loop
+                    cmp_hit(i) <= '1' when mtime >= unsigned(cmp_arr(i)) else '0';
+                end loop;
+                cmp_status <= (cmp_status and not cmp_status_clr) or cmp_hit;
+            end if;
+        end if;
+    end process;
+
     timer_inst : entity work.timer
         generic map(
             G_TIMER_W     => 32,
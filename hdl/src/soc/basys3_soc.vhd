@@ -4,6 +4,7 @@ use ieee.numeric_std.all;
 
 use work.wb_pkg.all;
 use work.joe_common_pkg.all;
+use work.wb_addr_map_pkg.all; -- generated from tools/gen_wb_ic/basys3.json (make platform)
 
 -- fpca/hdl/sim
 -- fpca/software/build/*.hex
@@ -17,7 +18,11 @@ entity basys3_soc is
         G_SOC_FREQ           : integer := 50_000_000;
         G_MEM_CTRL_CLK_FREQ_KHZ : integer := 100_000;
         G_DEFAULT_BAUD       : integer := 9600;
-        G_INCLUDE_JTAG_DEBUG : boolean := false
+        G_INCLUDE_JTAG_DEBUG : boolean := false;
+        G_WB_CROSSBAR        : boolean := false; -- 2xN crossbar + dual-port main memory instead of arbiter + interconnect (JTAG shares the data master)
+        G_WB_PIPELINED       : boolean := false; -- shared bus only: wb_pipelined_interconnect (several accesses in flight) instead of wb_interconnect
+        G_INCLUDE_DMA        : boolean := true;  -- mem-to-mem DMA at 0x8000_0000, shares the CPU data port
+        G_INCLUDE_SD_HOST    : boolean := false  -- native SD bus controller at 0xA000_0000, DMA shares the CPU data port
     );
     port (
         clk   : in std_logic;
@@ -47,6 +52,15 @@ entity basys3_soc is
         spi_mosi_out : out std_logic;
         spi_csn_out   : out std_logic;
 
+        -- native SD bus (G_INCLUDE_SD_HOST), to IOBUFs with pull-ups
+        sd_clk_out    : out std_logic;
+        sd_cmd_out    : out std_logic;
+        sd_cmd_oe_out : out std_logic;
+        sd_cmd_in     : in std_logic := '1';
+        sd_dat_out    : out std_logic_vector(3 downto 0);
+        sd_dat_oe_out : out std_logic_vector(3 downto 0);
+        sd_dat_in     : in std_logic_vector(3 downto 0) := "1111";
+
         -- QSPI PSRAM
         psram_clk  : out std_logic;
         psram_cs_n : out std_logic;
@@ -69,7 +83,7 @@ architecture rtl of basys3_soc is
 
     constant G_PC_RESET_ADDR : unsigned(31 downto 0) := x"F000_0000"; -- always reset into bootloader
 
-    constant G_NUM_SLAVES : integer := 16; -- max 16
+    constant G_NUM_SLAVES : integer := C_WB_NUM_SLAVES; -- max 16
 
     -- for GPIO register bank
     constant G_NUM_RW_REGS : integer := 4;
@@ -79,15 +93,32 @@ architecture rtl of basys3_soc is
     signal if_wb_miso         : t_wb_miso;
     signal mem_wb_mosi        : t_wb_mosi;
     signal mem_wb_miso        : t_wb_miso;
+    signal data_wb_mosi       : t_wb_mosi; -- CPU data port, or CPU data + DMA
+    signal data_wb_miso       : t_wb_miso;
+    signal dma_wb_mosi        : t_wb_mosi;
+    signal dma_wb_miso        : t_wb_miso;
+    signal sd_dma_wb_mosi     : t_wb_mosi;
+    signal sd_dma_wb_miso     : t_wb_miso;
+    signal bus_dma_wb_mosi    : t_wb_mosi; -- wb_dma, or wb_dma + wb_sd_host
+    signal bus_dma_wb_miso    : t_wb_miso;
+    signal spi_tx_byte        : std_logic_vector(7 downto 0);
+    signal spi_rx_byte        : std_logic_vector(7 downto 0);
+    signal spi_byte_valid     : std_logic;
     signal wb_master_sel_mosi : t_wb_mosi;
     signal wb_master_sel_miso : t_wb_miso;
     signal jtag_wb_mosi       : t_wb_mosi;
     signal jtag_wb_miso       : t_wb_miso;
     signal wb_cpu_sel_mosi    : t_wb_mosi;
     signal wb_cpu_sel_miso    : t_wb_miso;
+    signal xbar_data_wb_mosi  : t_wb_mosi; -- crossbar data master, CPU data + DMA (+ JTAG)
+    signal xbar_data_wb_miso  : t_wb_miso;
 
     signal wb_slave_mosi_arr : t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
     signal wb_slave_miso_arr : t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0);
+    -- second slave ports (crossbar only, main memory is the only dual-port slave)
+    constant C_DUAL_PORT_SLAVES : std_logic_vector(15 downto 0) := x"0001";
+    signal wb_slave_b_mosi_arr : t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
+    signal wb_slave_b_miso_arr : t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0) := (others => C_WB_MISO_INIT);
 
     -- Wishbone to framebuffer
     signal text_display_wb_mosi_out : t_wb_mosi;
@@ -98,6 +129,10 @@ architecture rtl of basys3_soc is
 
     signal monitor_write_cmd_stb  : std_logic;
     signal monitor_read_cmd_stb  : std_logic;
+    -- crossbar: one monitor per master
+    signal monitor_if_read_cmd_stb    : std_logic;
+    signal monitor_data_write_cmd_stb : std_logic;
+    signal monitor_data_read_cmd_stb  : std_logic;
 
     attribute mark_debug                    : boolean;
 --    attribute mark_debug of rw_regs_out     : signal is true;
@@ -138,93 +173,268 @@ begin
             mem_wb_miso_in  => mem_wb_miso
         );
 
-    -- 2:1 arbiter
-    wb_arbiter_inst : entity work.wb_arbiter
-        generic map(
-            G_ARBITER => "priority"
-        )
-        port map(
-            wb_clk                 => clk,
-            wb_reset               => reset,
-            wb_master_0_mosi_in    => if_wb_mosi,
-            wb_master_0_miso_out   => if_wb_miso,
-            wb_master_1_mosi_in    => mem_wb_mosi,
-            wb_master_1_miso_out   => mem_wb_miso,
-            wb_master_sel_mosi_out => wb_cpu_sel_mosi,
-            wb_master_sel_miso_in  => wb_cpu_sel_miso
-        );
-    gen_jtag_false : if G_INCLUDE_JTAG_DEBUG = false generate
-        wb_master_sel_mosi <= wb_cpu_sel_mosi;
-        wb_cpu_sel_miso    <= wb_master_sel_miso;
+    -- the SD host's DMA goes ahead of wb_dma's, as a slow FIFO drain stops the SD clock
+    gen_sd_dma_false : if G_INCLUDE_SD_HOST = false generate
+        bus_dma_wb_mosi <= dma_wb_mosi;
+        dma_wb_miso     <= bus_dma_wb_miso;
     end generate;
 
-    gen_jtag_true : if G_INCLUDE_JTAG_DEBUG = true generate
-        --        -- wraps a Xilinx JTAG-AXI master
-        --        jtag_wb_master_inst : jtag_wb_master
-        --        generic map(G_ILA => true)
-        --        port map(
-        --            clk         => clk,
-        --            reset       => reset,
-        --            wb_mosi_out => jtag_wb_mosi,
-        --            wb_miso_in  => jtag_wb_miso
-        --        );
-        --        -- 2:1 arbiter to choose between CPU and JTAG access
-        --        wb_debug_arbiter_inst : entity work.wb_arbiter
-        --            generic map(
-        --                G_ARBITER => "simple" -- most recently used
-        --            )
-        --            port map(
-        --                wb_clk                 => clk,
-        --                wb_reset               => reset,
-        --                wb_master_0_mosi_in    => wb_cpu_sel_mosi,
-        --                wb_master_0_miso_out   => wb_cpu_sel_miso,
-        --                wb_master_1_mosi_in    => jtag_wb_mosi,
-        --                wb_master_1_miso_out   => jtag_wb_miso,
-        --                wb_master_sel_mosi_out => wb_master_sel_mosi,
-        --                wb_master_sel_miso_in  => wb_master_sel_miso
-        --            );
+    gen_sd_dma_true : if G_INCLUDE_SD_HOST = true generate
+        wb_sd_dma_arbiter_inst : entity work.wb_arbiter
+            generic map(
+                G_ARBITER => "priority"
+            )
+            port map(
+                wb_clk                 => clk,
+                wb_reset               => reset,
+                wb_master_0_mosi_in    => sd_dma_wb_mosi,
+                wb_master_0_miso_out   => sd_dma_wb_miso,
+                wb_master_1_mosi_in    => dma_wb_mosi,
+                wb_master_1_miso_out   => dma_wb_miso,
+                wb_master_sel_mosi_out => bus_dma_wb_mosi,
+                wb_master_sel_miso_in  => bus_dma_wb_miso
+            );
+    end generate;
 
+    -- the DMA masters share the CPU data port, the CPU keeps priority between DMA bursts
+    gen_dma_false : if G_INCLUDE_DMA = false and G_INCLUDE_SD_HOST = false generate
+        data_wb_mosi <= mem_wb_mosi;
+        mem_wb_miso  <= data_wb_miso;
     end generate;
 
-    wb_address_monitor_inst : entity work.wb_address_monitor
-      generic map (
-        G_ADDR => x"0000_0000"
-      )
-      port map (
-        wb_clk => clk,
-        wb_mosi => wb_master_sel_mosi,
-        wb_miso => wb_master_sel_miso,
-        write_cmd_stb => monitor_write_cmd_stb,
-        read_cmd_stb => monitor_read_cmd_stb
-      );
-
-    -- 1:N interconnect
-    wb_interconnect_inst : entity work.wb_interconnect
-        generic map(
-            G_NUM_SLAVES => G_NUM_SLAVES
-        )
-        port map(
-            wb_clk                => clk,
-            wb_reset              => reset,
-            wb_master_mosi_in     => wb_master_sel_mosi,
-            wb_master_miso_out    => wb_master_sel_miso,
-            wb_slave_mosi_arr_out => wb_slave_mosi_arr,
-            wb_slave_miso_arr_in  => wb_slave_miso_arr
-        );
+    gen_dma_true : if G_INCLUDE_DMA = true or G_INCLUDE_SD_HOST = true generate
+        wb_dma_arbiter_inst : entity work.wb_arbiter
+            generic map(
+                G_ARBITER => "priority"
+            )
+            port map(
+                wb_clk                 => clk,
+                wb_reset               => reset,
+                wb_master_0_mosi_in    => mem_wb_mosi,
+                wb_master_0_miso_out   => mem_wb_miso,
+                wb_master_1_mosi_in    => bus_dma_wb_mosi,
+                wb_master_1_miso_out   => bus_dma_wb_miso,
+                wb_master_sel_mosi_out => data_wb_mosi,
+                wb_master_sel_miso_in  => data_wb_miso
+            );
+    end generate;
+
+    gen_shared_bus : if not G_WB_CROSSBAR generate
+        -- 2:1 arbiter
+        wb_arbiter_inst : entity work.wb_arbiter
+            generic map(
+                G_ARBITER => "priority"
+            )
+            port map(
+                wb_clk                 => clk,
+                wb_reset               => reset,
+                wb_master_0_mosi_in    => if_wb_mosi,
+                wb_master_0_miso_out   => if_wb_miso,
+                wb_master_1_mosi_in    => data_wb_mosi,
+                wb_master_1_miso_out   => data_wb_miso,
+                wb_master_sel_mosi_out => wb_cpu_sel_mosi,
+                wb_master_sel_miso_in  => wb_cpu_sel_miso
+            );
+        gen_jtag_false : if G_INCLUDE_JTAG_DEBUG = false generate
+            wb_master_sel_mosi <= wb_cpu_sel_mosi;
+            wb_cpu_sel_miso    <= wb_master_sel_miso;
+        end generate;
+
+        gen_jtag_true : if G_INCLUDE_JTAG_DEBUG = true generate
+            --        -- wraps a Xilinx JTAG-AXI master
+            --        jtag_wb_master_inst : jtag_wb_master
+            --        generic map(G_ILA => true)
+            --        port map(
+            --            clk         => clk,
+            --            reset       => reset,
+            --            wb_mosi_out => jtag_wb_mosi,
+            --            wb_miso_in  => jtag_wb_miso
+            --        );
+            --        -- 2:1 arbiter to choose between CPU and JTAG access
+            --        wb_debug_arbiter_inst : entity work.wb_arbiter
+            --            generic map(
+            --                G_ARBITER => "simple" -- most recently used
+            --            )
+            --            port map(
+            --                wb_clk                 => clk,
+            --                wb_reset               => reset,
+            --                wb_master_0_mosi_in    => wb_cpu_sel_mosi,
+            --                wb_master_0_miso_out   => wb_cpu_sel_miso,
+            --                wb_master_1_mosi_in    => jtag_wb_mosi,
+            --                wb_master_1_miso_out   => jtag_wb_miso,
+            --                wb_master_sel_mosi_out => wb_master_sel_mosi,
+            --                wb_master_sel_miso_in  => wb_master_sel_miso
+            --            );
+
+        end generate;
+
+        wb_address_monitor_inst : entity work.wb_address_monitor
+          generic map (
+            G_ADDR => x"0000_0000"
+          )
+          port map (
+            wb_clk => clk,
+            wb_mosi => wb_master_sel_mosi,
+            wb_miso => wb_master_sel_miso,
+            write_cmd_stb => monitor_write_cmd_stb,
+            read_cmd_stb => monitor_read_cmd_stb
+          );
+
+        -- 1:N interconnect
+        gen_interconnect : if not G_WB_PIPELINED generate
+            wb_interconnect_inst : entity work.wb_interconnect
+                generic map(
+                    G_NUM_SLAVES => G_NUM_SLAVES,
+                    G_ADR_MASK   => C_WB_ADR_MASK,
+                    G_ADR_MATCH  => C_WB_ADR_MATCH
+                )
+                port map(
+                    wb_clk                => clk,
+                    wb_reset              => reset,
+                    wb_master_mosi_in     => wb_master_sel_mosi,
+                    wb_master_miso_out    => wb_master_sel_miso,
+                    wb_slave_mosi_arr_out => wb_slave_mosi_arr,
+                    wb_slave_miso_arr_in  => wb_slave_miso_arr
+                );
+        end generate;
+
+        gen_pipelined_interconnect : if G_WB_PIPELINED generate
+            wb_pipelined_interconnect_inst : entity work.wb_pipelined_interconnect
+                generic map(
+                    G_NUM_SLAVES      => G_NUM_SLAVES,
+                    G_MAX_OUTSTANDING => 4,
+                    G_ADR_MASK        => C_WB_ADR_MASK,
+                    G_ADR_MATCH       => C_WB_ADR_MATCH
+                )
+                port map(
+                    wb_clk                => clk,
+                    wb_reset              => reset,
+                    wb_master_mosi_in     => wb_master_sel_mosi,
+                    wb_master_miso_out    => wb_master_sel_miso,
+                    wb_slave_mosi_arr_out => wb_slave_mosi_arr,
+                    wb_slave_miso_arr_in  => wb_slave_miso_arr
+                );
+        end generate;
+    end generate;
+
+    -- IF and data masters each get their own path to any slave
+    gen_crossbar : if G_WB_CROSSBAR generate
+        -- JTAG debug access shares the data master (the crossbar has two master ports)
+        gen_xbar_jtag_false : if G_INCLUDE_JTAG_DEBUG = false generate
+            xbar_data_wb_mosi <= data_wb_mosi;
+            data_wb_miso      <= xbar_data_wb_miso;
+        end generate;
+
+        gen_xbar_jtag_true : if G_INCLUDE_JTAG_DEBUG = true generate
+            --        -- wraps a Xilinx JTAG-AXI master
+            --        jtag_wb_master_inst : jtag_wb_master
+            --        generic map(G_ILA => true)
+            --        port map(
+            --            clk         => clk,
+            --            reset       => reset,
+            --            wb_mosi_out => jtag_wb_mosi,
+            --            wb_miso_in  => jtag_wb_miso
+            --        );
+            --        -- 2:1 arbiter to choose between CPU data and JTAG access
+            --        wb_debug_arbiter_inst : entity work.wb_arbiter
+            --            generic map(
+            --                G_ARBITER => "simple" -- most recently used
+            --            )
+            --            port map(
+            --                wb_clk                 => clk,
+            --                wb_reset               => reset,
+            --                wb_master_0_mosi_in    => data_wb_mosi,
+            --                wb_master_0_miso_out   => data_wb_miso,
+            --                wb_master_1_mosi_in    => jtag_wb_mosi,
+            --                wb_master_1_miso_out   => jtag_wb_miso,
+            --                wb_master_sel_mosi_out => xbar_data_wb_mosi,
+            --                wb_master_sel_miso_in  => xbar_data_wb_miso
+            --            );
+
+        end generate;
+
+        -- there is no single bus to watch, so monitor both masters
+        wb_if_address_monitor_inst : entity work.wb_address_monitor
+          generic map (
+            G_ADDR => x"0000_0000"
+          )
+          port map (
+            wb_clk => clk,
+            wb_mosi => if_wb_mosi,
+            wb_miso => if_wb_miso,
+            write_cmd_stb => open, -- instruction fetches never write
+            read_cmd_stb => monitor_if_read_cmd_stb
+          );
+
+        wb_data_address_monitor_inst : entity work.wb_address_monitor
+          generic map (
+            G_ADDR => x"0000_0000"
+          )
+          port map (
+            wb_clk => clk,
+            wb_mosi => xbar_data_wb_mosi,
+            wb_miso => xbar_data_wb_miso,
+            write_cmd_stb => monitor_data_write_cmd_stb,
+            read_cmd_stb => monitor_data_read_cmd_stb
+          );
+
+        monitor_write_cmd_stb <= monitor_data_write_cmd_stb;
+        monitor_read_cmd_stb  <= monitor_if_read_cmd_stb or monitor_data_read_cmd_stb;
+
+        wb_crossbar_2xn_inst : entity work.wb_crossbar_2xn
+            generic map(
+                G_NUM_SLAVES       => G_NUM_SLAVES,
+                G_DUAL_PORT_SLAVES => C_DUAL_PORT_SLAVES,
+                G_ARBITER          => "priority",
+                G_ADR_MASK         => C_WB_ADR_MASK,
+                G_ADR_MATCH        => C_WB_ADR_MATCH
+            )
+            port map(
+                wb_clk                    => clk,
+                wb_reset                  => reset,
+                wb_master_mosi_arr_in(0)  => if_wb_mosi,
+                wb_master_mosi_arr_in(1)  => xbar_data_wb_mosi,
+                wb_master_miso_arr_out(0) => if_wb_miso,
+                wb_master_miso_arr_out(1) => xbar_data_wb_miso,
+                wb_slave_mosi_arr_out     => wb_slave_mosi_arr,
+                wb_slave_miso_arr_in      => wb_slave_miso_arr,
+                wb_slave_b_mosi_arr_out   => wb_slave_b_mosi_arr,
+                wb_slave_b_miso_arr_in    => wb_slave_b_miso_arr
+            );
+    end generate;
 
     --! Main memory
     --! x0000_0000 to x0FFF_FFFF
-    wb_sp_bram_inst : entity work.wb_sp_bram
-        generic map(
-            G_MEM_DEPTH_WORDS => MEM_WORDS,
-            G_INIT_FILE       => MEM_INIT_FILE
-        )
-        port map(
-            wb_clk      => clk,
-            wb_reset    => reset,
-            wb_mosi_in  => wb_slave_mosi_arr(0),
-            wb_miso_out => wb_slave_miso_arr(0)
-        );
+    gen_sp_main_mem : if not G_WB_CROSSBAR generate
+        wb_sp_bram_inst : entity work.wb_sp_bram
+            generic map(
+                G_MEM_DEPTH_WORDS => MEM_WORDS,
+                G_INIT_FILE       => MEM_INIT_FILE
+            )
+            port map(
+                wb_clk      => clk,
+                wb_reset    => reset,
+                wb_mosi_in  => wb_slave_mosi_arr(C_WB_MEM_IDX),
+                wb_miso_out => wb_slave_miso_arr(C_WB_MEM_IDX)
+            );
+    end generate;
+
+    --! port A for instruction fetch, port B for data
+    gen_dp_main_mem : if G_WB_CROSSBAR generate
+        wb_dp_bram_inst : entity work.wb_dp_bram
+            generic map(
+                G_MEM_DEPTH_WORDS => MEM_WORDS,
+                G_INIT_FILE       => MEM_INIT_FILE
+            )
+            port map(
+                wb_clk        => clk,
+                wb_reset      => reset,
+                wb_a_mosi_in  => wb_slave_mosi_arr(C_WB_MEM_IDX),
+                wb_a_miso_out => wb_slave_miso_arr(C_WB_MEM_IDX),
+                wb_b_mosi_in  => wb_slave_b_mosi_arr(C_WB_MEM_IDX),
+                wb_b_miso_out => wb_slave_b_miso_arr(C_WB_MEM_IDX)
+            );
+    end generate;
 
     --! GPIO Register Bank
     --! x1000_0000 to x1FFF_FFFF
@@ -238,8 +448,8 @@ begin
         port map(
             wb_clk      => clk,
             wb_reset    => reset,
-            wb_mosi_in  => wb_slave_mosi_arr(1),
-            wb_miso_out => wb_slave_miso_arr(1),
+            wb_mosi_in  => wb_slave_mosi_arr(C_WB_GPIO0_IDX),
+            wb_miso_out => wb_slave_miso_arr(C_WB_GPIO0_IDX),
             rw_regs_out => rw_regs_out,
             ro_regs_in  => ro_regs_in
         );
@@ -263,8 +473,8 @@ begin
         port map(
             wb_clk      => clk,
             wb_reset    => reset,
-            wb_mosi_in  => wb_slave_mosi_arr(2),
-            wb_miso_out => wb_slave_miso_arr(2),
+            wb_mosi_in  => wb_slave_mosi_arr(C_WB_UART0_IDX),
+            wb_miso_out => wb_slave_miso_arr(C_WB_UART0_IDX),
             uart_tx_out => uart_tx_out,
             uart_rx_in  => uart_rx_in
         );
@@ -277,10 +487,11 @@ begin
         port map(
             wb_clk              => clk,
             wb_reset            => reset,
-            wb_mosi_in          => wb_slave_mosi_arr(3),
-            wb_miso_out         => wb_slave_miso_arr(3),
+            wb_mosi_in          => wb_slave_mosi_arr(C_WB_TIMER0_IDX),
+            wb_miso_out         => wb_slave_miso_arr(C_WB_TIMER0_IDX),
             pwm_out             => open,
-            timer_interrupt_out => open
+            timer_interrupt_out => open,
+            cmp_interrupt_out   => open -- no interrupt controller yet, poll CMP_STATUS
         );
 
     -- 0x4000_0000 (external framebuffer, up to 256MB of address space)
@@ -298,8 +509,8 @@ begin
             vga_g     => vga_g,
             vga_b     => vga_b,
 
-            text_display_wb_mosi_in  => wb_slave_mosi_arr(4),
-            text_display_wb_miso_out => wb_slave_miso_arr(4)
+            text_display_wb_mosi_in  => wb_slave_mosi_arr(C_WB_TEXT_DISPLAY0_IDX),
+            text_display_wb_miso_out => wb_slave_miso_arr(C_WB_TEXT_DISPLAY0_IDX)
         );
 
     quad_seven_seg_driver_inst : entity work.quad_seven_seg_driver
@@ -318,12 +529,15 @@ begin
         port map(
             wb_clk      => clk,
             wb_reset    => reset,
-            wb_mosi_in  => wb_slave_mosi_arr(5),
-            wb_miso_out => wb_slave_miso_arr(5),
+            wb_mosi_in  => wb_slave_mosi_arr(C_WB_SD_SPI_IDX),
+            wb_miso_out => wb_slave_miso_arr(C_WB_SD_SPI_IDX),
             sck_out     => spi_sck_out,
             cs_n_out    => spi_csn_out,
             mosi_out    => spi_mosi_out,
-            miso_in     => spi_miso_in
+            miso_in     => spi_miso_in,
+            tx_byte_out    => spi_tx_byte,
+            rx_byte_out    => spi_rx_byte,
+            byte_valid_out => spi_byte_valid
         );
 
     -- 0x6000_0000 QSPI 8MB PSRAM controller
@@ -338,6 +552,8 @@ begin
 --        psram_cs_n => psram_cs_n,
 --        psram_sio => psram_sio
 --    );
+    -- the CPU is the only PSRAM master, wb_psram_arbiter goes in front of the controller once
+    -- there is a second one (eg. a pixel DMA)
      wb_psram_aps6404_streaming_inst : entity work.wb_psram_aps6404_streaming
          generic map (
            MEM_CTRL_CLK_FREQ_KHZ => G_MEM_CTRL_CLK_FREQ_KHZ
@@ -346,8 +562,8 @@ begin
            wb_clk => clk,
            mem_ctrl_clk => mem_ctrl_clk, -- max 168MHz
            wb_reset => reset,
-           wb_mosi_in => wb_slave_mosi_arr(6),
-           wb_miso_out => wb_slave_miso_arr(6),
+           wb_mosi_in => wb_slave_mosi_arr(C_WB_PSRAM_IDX),
+           wb_miso_out => wb_slave_miso_arr(C_WB_PSRAM_IDX),
            psram_clk => psram_clk,
            psram_cs_n => psram_cs_n,
            psram_sio => psram_sio
@@ -366,12 +582,85 @@ begin
     --          miso_in     => psram_sio(1)
     --      );
 
-    gen_unmapped : for i in 7 to 14 generate
+    -- 0x8000_0000 mem-to-mem DMA registers
+    gen_dma_regs : if G_INCLUDE_DMA = true generate
+        wb_dma_inst : entity work.wb_dma
+            generic map(
+                G_BURST_WORDS => 16
+            )
+            port map(
+                wb_clk        => clk,
+                wb_reset      => reset,
+                wb_mosi_in    => wb_slave_mosi_arr(C_WB_DMA0_IDX),
+                wb_miso_out   => wb_slave_miso_arr(C_WB_DMA0_IDX),
+                wb_mosi_out   => dma_wb_mosi,
+                wb_miso_in    => dma_wb_miso,
+                busy_out      => open,
+                interrupt_out => open -- no interrupt controller yet, poll STATUS
+            );
+    end generate;
+    gen_dma_regs_unmapped : if G_INCLUDE_DMA = false generate
+        wb_unmapped_slv_inst : entity work.wb_unmapped_slv
+            port map(
+                wb_mosi_in  => wb_slave_mosi_arr(C_WB_DMA0_IDX),
+                wb_miso_out => wb_slave_miso_arr(C_WB_DMA0_IDX)
+            );
+        dma_wb_mosi <= C_WB_MOSI_INIT;
+    end generate;
+
+    -- 0x9000_0000 CRC engine, can check SD card blocks as they are read over SPI
+    wb_crc_inst : entity work.wb_crc
+        port map(
+            wb_clk           => clk,
+            wb_reset         => reset,
+            wb_mosi_in       => wb_slave_mosi_arr(C_WB_CRC0_IDX),
+            wb_miso_out      => wb_slave_miso_arr(C_WB_CRC0_IDX),
+            snoop_tx_byte_in => spi_tx_byte,
+            snoop_rx_byte_in => spi_rx_byte,
+            snoop_valid_in   => spi_byte_valid
+        );
+
+    -- 0xA000_0000 native SD bus controller (1 or 4 bit), instead of wb_spi on the SD card pins
+    gen_sd_host : if G_INCLUDE_SD_HOST = true generate
+        wb_sd_host_inst : entity work.wb_sd_host
+            port map(
+                wb_clk        => clk,
+                wb_reset      => reset,
+                wb_mosi_in    => wb_slave_mosi_arr(C_WB_SD_HOST0_IDX),
+                wb_miso_out   => wb_slave_miso_arr(C_WB_SD_HOST0_IDX),
+                wb_mosi_out   => sd_dma_wb_mosi,
+                wb_miso_in    => sd_dma_wb_miso,
+                sd_clk_out    => sd_clk_out,
+                sd_cmd_out    => sd_cmd_out,
+                sd_cmd_oe_out => sd_cmd_oe_out,
+                sd_cmd_in     => sd_cmd_in,
+                sd_dat_out    => sd_dat_out,
+                sd_dat_oe_out => sd_dat_oe_out,
+                sd_dat_in     => sd_dat_in
+            );
+    end generate;
+    gen_sd_host_unmapped : if G_INCLUDE_SD_HOST = false generate
         wb_unmapped_slv_inst : entity work.wb_unmapped_slv
             port map(
-                wb_mosi_in  => wb_slave_mosi_arr(i),
-                wb_miso_out => wb_slave_miso_arr(i)
+                wb_mosi_in  => wb_slave_mosi_arr(C_WB_SD_HOST0_IDX),
+                wb_miso_out => wb_slave_miso_arr(C_WB_SD_HOST0_IDX)
             );
+        sd_clk_out    <= '0';
+        sd_cmd_out    <= '1';
+        sd_cmd_oe_out <= '0';
+        sd_dat_out    <= (others => '1');
+        sd_dat_oe_out <= (others => '0');
+    end generate;
+
+    -- slave ports with no segment in basys3.json
+    gen_unmapped : for i in 0 to G_NUM_SLAVES - 1 generate
+        gen_spare : if i = 7 or (i > C_WB_SD_HOST0_IDX and i < C_WB_BOOTLOADER_IDX) generate
+            wb_unmapped_slv_inst : entity work.wb_unmapped_slv
+                port map(
+                    wb_mosi_in  => wb_slave_mosi_arr(i),
+                    wb_miso_out => wb_slave_miso_arr(i)
+                );
+        end generate;
     end generate;
 
     --! Bootloader memory
@@ -384,7 +673,7 @@ begin
         port map(
             wb_clk      => clk,
             wb_reset    => reset,
-            wb_mosi_in  => wb_slave_mosi_arr(15),
-            wb_miso_out => wb_slave_miso_arr(15)
+            wb_mosi_in  => wb_slave_mosi_arr(C_WB_BOOTLOADER_IDX),
+            wb_miso_out => wb_slave_miso_arr(C_WB_BOOTLOADER_IDX)
         );
 end architecture;
\ No newline at end of file
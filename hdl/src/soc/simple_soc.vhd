@@ -37,10 +37,24 @@ entity simple_soc is
         i2c_scl_out : out std_logic;
         i2c_sda_out : out std_logic;
 
+        -- SD card (SPI mode)
+        sd_spi_sck_out  : out std_logic;
+        sd_spi_cs_n_out : out std_logic;
+        sd_spi_mosi_out : out std_logic;
+        sd_spi_miso_in  : in std_logic := '1';
+
         -- Wishbone to framebuffer
         text_display_wb_mosi_out : out t_wb_mosi;
         text_display_wb_miso_in  : in t_wb_miso;
 
+        -- Wishbone to VDMA control registers (framebuffer page flipping)
+        vdma_ctrl_wb_mosi_out : out t_wb_mosi;
+        vdma_ctrl_wb_miso_in  : in t_wb_miso;
+
+        -- Wishbone to 2D blitter registers
+        blitter_wb_mosi_out : out t_wb_mosi;
+        blitter_wb_miso_in  : in t_wb_miso;
+
         -- Wishbone to external memory (DDR3)
         ext_mem_wb_mosi_out : out t_wb_mosi;
         ext_mem_wb_miso_in  : in t_wb_miso;
@@ -244,7 +258,8 @@ begin
             wb_mosi_in          => wb_slave_mosi_arr(3),
             wb_miso_out         => wb_slave_miso_arr(3),
             pwm_out             => open,
-            timer_interrupt_out => open
+            timer_interrupt_out => open,
+            cmp_interrupt_out   => open -- no interrupt controller yet, poll CMP_STATUS
         );
 
     -- 0x4000_0000 (external framebuffer, up to 256MB of address space)
@@ -261,7 +276,34 @@ begin
             sseg_an         => sseg_an_out
         );
 
-    gen_unmapped : for i in 5 to 12 generate
+    -- 0x5000_0000 VDMA control registers (external)
+    vdma_ctrl_wb_mosi_out <= wb_slave_mosi_arr(5);
+    wb_slave_miso_arr(5)  <= vdma_ctrl_wb_miso_in;
+
+    -- 0x6000_0000 2D blitter registers (external)
+    blitter_wb_mosi_out  <= wb_slave_mosi_arr(6);
+    wb_slave_miso_arr(6) <= blitter_wb_miso_in;
+
+    -- 0x7000_0000 SPI controller for SD card
+    wb_spi_inst : entity work.wb_spi
+        generic map(
+            G_ILA => false
+        )
+        port map(
+            wb_clk         => clk,
+            wb_reset       => reset,
+            wb_mosi_in     => wb_slave_mosi_arr(7),
+            wb_miso_out    => wb_slave_miso_arr(7),
+            sck_out        => sd_spi_sck_out,
+            cs_n_out       => sd_spi_cs_n_out,
+            mosi_out       => sd_spi_mosi_out,
+            miso_in        => sd_spi_miso_in,
+            tx_byte_out    => open,
+            rx_byte_out    => open,
+            byte_valid_out => open
+        );
+
+    gen_unmapped : for i in 8 to 12 generate
         wb_unmapped_slv_inst : entity work.wb_unmapped_slv
             port map(
                 wb_mosi_in  => wb_slave_mosi_arr(i),
@@ -0,0 +1,229 @@
+----------------------------------------------------------------------------------
+-- Joseph Hindmarsh
+--
+-- Connects an AXI4 master (eg. the Xilinx JTAG-AXI master) to a wishbone bus
+-- ie: 32b AXI4 Slave to 32b Wishbone (B4 pipelined) Master
+--
+-- Each AXI4 burst (up to 256 beats) becomes one pipelined Wishbone burst: CYC is
+-- held for the whole burst and a new STB can go out every clock.
+--  * writes: W beats are passed straight through to STB, WREADY follows STALL.
+--            BRESP is SLVERR if any beat got ERR
+--  * reads:  read data is buffered in a small FIFO, and no more reads are issued
+--            than there is room for, so RREADY can be dropped at any time.
+--            RRESP is SLVERR for beats that got ERR
+--
+-- Assumes full width (32b) transfers. FIXED bursts keep the same address, INCR
+-- and WRAP bursts increment (WRAP is not wrapped, the JTAG-AXI master only
+-- issues INCR). Only one read or write burst is in progress at a time,
+-- reads take priority.
+----------------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.axi_pkg.all;
+use work.joe_common_pkg.all;
+
+entity axi4_to_wb_shim is
+    generic (
+        G_READ_FIFO_DEPTH : integer := 16 -- read beats that can be buffered
+    );
+    port (
+        clk   : in std_logic;
+        reset : in std_logic;
+
+        axi_mosi_in  : in t_axi4_mosi;
+        axi_miso_out : out t_axi4_miso;
+
+        wb_mosi_out : out t_wb_mosi;
+        wb_miso_in  : in t_wb_miso
+    );
+end entity axi4_to_wb_shim;
+
+architecture rtl of axi4_to_wb_shim is
+    type t_state is (IDLE, WRITE_BURST, WRITE_RESPONSE, READ_BURST);
+    signal state : t_state := IDLE;
+
+    signal wb_mosi : t_wb_mosi := C_WB_MOSI_INIT;
+
+    signal incr      : boolean;
+    signal next_adr  : std_logic_vector(31 downto 0); -- address of the next write beat
+    signal cmds_to_go : integer range 0 to 256; -- Wishbone requests still to be accepted
+    signal acks_to_go : integer range 0 to 256; -- Wishbone responses still to come
+    signal beats_to_go : integer range 0 to 256; -- AXI read beats still to be sent
+    signal got_err   : std_logic;
+
+    signal awready : std_logic := '0';
+    signal arready : std_logic := '0';
+    signal wready  : std_logic;
+    signal bvalid  : std_logic := '0';
+    signal bresp   : std_logic_vector(1 downto 0);
+
+    -- read data FIFO, bit 32 is the Wishbone ERR for the beat
+    type t_fifo is array (0 to G_READ_FIFO_DEPTH - 1) of std_logic_vector(32 downto 0);
+    signal fifo       : t_fifo;
+    signal rd_ptr     : integer range 0 to G_READ_FIFO_DEPTH - 1 := 0;
+    signal wr_ptr     : integer range 0 to G_READ_FIFO_DEPTH - 1 := 0;
+    signal fifo_count : integer range 0 to G_READ_FIFO_DEPTH := 0;
+    signal credits    : integer range 0 to G_READ_FIFO_DEPTH := G_READ_FIFO_DEPTH; -- FIFO slots not yet claimed by a read request
+    signal rvalid     : std_logic;
+
+begin
+
+    wb_mosi_out <= wb_mosi;
+
+    -- a new write beat can be taken whenever there is no request waiting, or it is being accepted this cycle
+    wready <= '1' when state = WRITE_BURST and cmds_to_go /= 0 and (wb_mosi.stb = '0' or wb_miso_in.stall = '0') else '0';
+    rvalid <= '1' when fifo_count /= 0 else '0';
+
+    axi_miso_out.awready <= awready;
+    axi_miso_out.arready <= arready;
+    axi_miso_out.wready  <= wready;
+    axi_miso_out.bvalid  <= bvalid;
+    axi_miso_out.bresp   <= bresp;
+    axi_miso_out.rvalid  <= rvalid;
+    axi_miso_out.rdata   <= fifo(rd_ptr)(31 downto 0);
+    axi_miso_out.rresp   <= b"10" when fifo(rd_ptr)(32) = '1' else b"00"; -- AXI_SLVERR / AXI_OKAY
+    axi_miso_out.rlast   <= '1' when beats_to_go = 1 else '0';
+
+    process (clk)
+        variable v_accepted : boolean;
+        variable v_pop      : boolean;
+        variable v_push     : boolean;
+        variable v_credits  : integer range 0 to G_READ_FIFO_DEPTH;
+        variable v_cmds     : integer range 0 to 256;
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                state       <= IDLE;
+                wb_mosi.cyc <= '0';
+                wb_mosi.stb <= '0';
+                awready     <= '0';
+                arready     <= '0';
+                bvalid      <= '0';
+                rd_ptr      <= 0;
+                wr_ptr      <= 0;
+                fifo_count  <= 0;
+                credits     <= G_READ_FIFO_DEPTH;
+                beats_to_go <= 0;
+            else
+                awready <= '0';
+                arready <= '0';
+
+                v_accepted := wb_mosi.stb = '1' and wb_miso_in.stall = '0';
+                if v_accepted then
+                    wb_mosi.stb <= '0'; -- unless there is another request to go, below
+                end if;
+
+                -- read data FIFO
+                v_push := state = READ_BURST and (wb_miso_in.ack = '1' or wb_miso_in.err = '1');
+                v_pop  := rvalid = '1' and axi_mosi_in.rready = '1';
+                if v_push then
+                    fifo(wr_ptr) <= wb_miso_in.err & wb_miso_in.rdat;
+                    wr_ptr       <= (wr_ptr + 1) mod G_READ_FIFO_DEPTH;
+                end if;
+                if v_pop then
+                    rd_ptr      <= (rd_ptr + 1) mod G_READ_FIFO_DEPTH;
+                    beats_to_go <= beats_to_go - 1;
+                end if;
+                if v_push and not v_pop then
+                    fifo_count <= fifo_count + 1;
+                elsif v_pop and not v_push then
+                    fifo_count <= fifo_count - 1;
+                end if;
+                v_credits := credits;
+                if v_pop then
+                    v_credits := v_credits + 1;
+                end if;
+
+                case state is
+                    when IDLE =>
+                        if axi_mosi_in.arvalid = '1' then
+                            arready     <= '1'; -- ACK read address
+                            wb_mosi.adr <= axi_mosi_in.araddr;
+                            incr        <= axi_mosi_in.arburst /= AXI_BURST_FIXED;
+                            cmds_to_go  <= to_integer(unsigned(axi_mosi_in.arlen)) + 1;
+                            acks_to_go  <= to_integer(unsigned(axi_mosi_in.arlen)) + 1;
+                            beats_to_go <= to_integer(unsigned(axi_mosi_in.arlen)) + 1;
+                            wb_mosi.we  <= '0';
+                            wb_mosi.sel <= x"F";
+                            wb_mosi.cyc <= '1'; -- STB follows once there is room for the data
+                            state       <= READ_BURST;
+                        elsif axi_mosi_in.awvalid = '1' then
+                            awready     <= '1'; -- ACK write address
+                            next_adr    <= axi_mosi_in.awaddr;
+                            incr        <= axi_mosi_in.awburst /= AXI_BURST_FIXED;
+                            cmds_to_go  <= to_integer(unsigned(axi_mosi_in.awlen)) + 1;
+                            acks_to_go  <= to_integer(unsigned(axi_mosi_in.awlen)) + 1;
+                            got_err     <= '0';
+                            wb_mosi.we  <= '1';
+                            wb_mosi.cyc <= '1';
+                            state       <= WRITE_BURST;
+                        end if;
+
+                    when WRITE_BURST =>
+                        if wready = '1' and axi_mosi_in.wvalid = '1' then
+                            wb_mosi.stb  <= '1';
+                            wb_mosi.adr  <= next_adr;
+                            wb_mosi.wdat <= axi_mosi_in.wdata;
+                            wb_mosi.sel  <= axi_mosi_in.wstrb;
+                            if incr then
+                                next_adr <= u_add(next_adr, x"0000_0004");
+                            end if;
+                            cmds_to_go <= cmds_to_go - 1;
+                        end if;
+                        if wb_miso_in.ack = '1' or wb_miso_in.err = '1' then
+                            got_err    <= got_err or wb_miso_in.err;
+                            acks_to_go <= acks_to_go - 1;
+                            if acks_to_go = 1 then -- final response
+                                wb_mosi.cyc <= '0';
+                                bvalid      <= '1';
+                                if got_err = '1' or wb_miso_in.err = '1' then
+                                    bresp <= b"10"; --AXI_SLVERR
+                                else
+                                    bresp <= b"00"; --AXI_OKAY
+                                end if;
+                                state <= WRITE_RESPONSE;
+                            end if;
+                        end if;
+
+                    when WRITE_RESPONSE =>
+                        if axi_mosi_in.bready = '1' then
+                            bvalid <= '0';
+                            state  <= IDLE;
+                        end if;
+
+                    when READ_BURST =>
+                        v_cmds := cmds_to_go;
+                        if v_accepted then
+                            v_cmds := v_cmds - 1;
+                            if incr then
+                                wb_mosi.adr <= u_add(wb_mosi.adr, x"0000_0004");
+                            end if;
+                        end if;
+                        -- issue (or keep issuing) requests while there is room for their data
+                        if (wb_mosi.stb = '0' or v_accepted) and v_cmds /= 0 and v_credits /= 0 then
+                            wb_mosi.stb <= '1';
+                            v_credits   := v_credits - 1;
+                        end if;
+                        cmds_to_go <= v_cmds;
+
+                        if v_push then
+                            acks_to_go <= acks_to_go - 1;
+                            if acks_to_go = 1 then -- final response
+                                wb_mosi.cyc <= '0';
+                            end if;
+                        end if;
+                        if v_pop and beats_to_go = 1 then -- final beat sent
+                            state <= IDLE;
+                        end if;
+                end case;
+                credits <= v_credits;
+            end if;
+        end if;
+    end process;
+
+    wb_mosi.lock <= '0';
+
+end architecture;
@@ -1,10 +1,11 @@
 ----------------------------------------------------------------------------------
 -- Joseph Hindmarsh Septemper 2022
 --
--- Connects a Xilinx JTAG AXI4-Lite Master to a wishbone bus
+-- Connects a Xilinx JTAG AXI4 Master to a wishbone bus
 --
--- TODOs:
---  * testbench
+-- The JTAG-AXI master (debug_jtag block design) is set up for AXI4 so that
+-- tools/wb_jtag.tcl can move up to 256 words per JTAG transaction, which
+-- axi4_to_wb_shim turns into pipelined Wishbone bursts.
 ----------------------------------------------------------------------------------
 
 library ieee;
@@ -12,6 +13,7 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.wb_pkg.all;
+use work.axi_pkg.all;
 
 entity jtag_wb_master is
     generic (
@@ -28,222 +30,57 @@ entity jtag_wb_master is
 end entity jtag_wb_master;
 
 architecture rtl of jtag_wb_master is
-    component jtag_axi_0
-        port (
-            aclk          : in std_logic;
-            aresetn       : in std_logic;
-            m_axi_awaddr  : out std_logic_vector(31 downto 0);
-            m_axi_awprot  : out std_logic_vector(2 downto 0);
-            m_axi_awvalid : out std_logic;
-            m_axi_awready : in std_logic;
-            m_axi_wdata   : out std_logic_vector(31 downto 0);
-            m_axi_wstrb   : out std_logic_vector(3 downto 0);
-            m_axi_wvalid  : out std_logic;
-            m_axi_wready  : in std_logic;
-            m_axi_bresp   : in std_logic_vector(1 downto 0);
-            m_axi_bvalid  : in std_logic;
-            m_axi_bready  : out std_logic;
-            m_axi_araddr  : out std_logic_vector(31 downto 0);
-            m_axi_arprot  : out std_logic_vector(2 downto 0);
-            m_axi_arvalid : out std_logic;
-            m_axi_arready : in std_logic;
-            m_axi_rdata   : in std_logic_vector(31 downto 0);
-            m_axi_rresp   : in std_logic_vector(1 downto 0);
-            m_axi_rvalid  : in std_logic;
-            m_axi_rready  : out std_logic
-        );
-    end component;
-
     signal resetn : std_logic;
 
-    signal m_axi_awaddr  : std_logic_vector(31 downto 0);
-    signal m_axi_awvalid : std_logic;
-    signal m_axi_awready : std_logic;
-    signal m_axi_wdata   : std_logic_vector(31 downto 0);
-    signal m_axi_wstrb   : std_logic_vector(3 downto 0);
-    signal m_axi_wvalid  : std_logic;
-    signal m_axi_wready  : std_logic;
-    signal m_axi_bresp   : std_logic_vector(1 downto 0);
-    signal m_axi_bvalid  : std_logic;
-    signal m_axi_bready  : std_logic;
-    signal m_axi_araddr  : std_logic_vector(31 downto 0);
-    signal m_axi_arvalid : std_logic;
-    signal m_axi_arready : std_logic;
-    signal m_axi_rdata   : std_logic_vector(31 downto 0);
-    signal m_axi_rresp   : std_logic_vector(1 downto 0);
-    signal m_axi_rvalid  : std_logic;
-    signal m_axi_rready  : std_logic;
+    signal axi_mosi : t_axi4_mosi;
+    signal axi_miso : t_axi4_miso;
 
-    type t_state is (IDLE, AXI_READ_RESPONSE, AXI_WRITE_RESPONSE, AXI_READ, AXI_GET_WDATA, AXI_WRITE);
-    signal state : t_state := IDLE;
-
-    attribute mark_debug                  : boolean;
-    attribute mark_debug of state         : signal is G_ILA;
-    attribute mark_debug of m_axi_awaddr  : signal is G_ILA;
-    attribute mark_debug of m_axi_awvalid : signal is G_ILA;
-    attribute mark_debug of m_axi_awready : signal is G_ILA;
-    attribute mark_debug of m_axi_wdata   : signal is G_ILA;
-    attribute mark_debug of m_axi_wstrb   : signal is G_ILA;
-    attribute mark_debug of m_axi_wvalid  : signal is G_ILA;
-    attribute mark_debug of m_axi_wready  : signal is G_ILA;
-    attribute mark_debug of m_axi_bresp   : signal is G_ILA;
-    attribute mark_debug of m_axi_bvalid  : signal is G_ILA;
-    attribute mark_debug of m_axi_bready  : signal is G_ILA;
-    attribute mark_debug of m_axi_araddr  : signal is G_ILA;
-    attribute mark_debug of m_axi_arvalid : signal is G_ILA;
-    attribute mark_debug of m_axi_arready : signal is G_ILA;
-    attribute mark_debug of m_axi_rdata   : signal is G_ILA;
-    attribute mark_debug of m_axi_rresp   : signal is G_ILA;
-    attribute mark_debug of m_axi_rvalid  : signal is G_ILA;
-    attribute mark_debug of m_axi_rready  : signal is G_ILA;
+    attribute mark_debug             : boolean;
+    attribute mark_debug of axi_mosi : signal is G_ILA;
+    attribute mark_debug of axi_miso : signal is G_ILA;
 begin
-    -- AXI handshaking: Master can assert VALID at any time, we can deassert READY whenever we want (possible to depend on VALID)
     resetn <= not reset;
-    -- assume the AXI JTAG/TCL script only sends one command at a time (and never simultaneous read/write!)
-    process (clk)
-    begin
-        if rising_edge(clk) then
-            if reset = '1' then
-                state         <= IDLE;
-                m_axi_arready <= '0';
-                m_axi_awready <= '0';
-                m_axi_wready  <= '0';
-                m_axi_rvalid  <= '0';
-                m_axi_bvalid  <= '0';
-            else
-                case(state) is
-
-                    when IDLE => -- prioritise READ
---                    m_axi_arready <= '1';
---                    m_axi_awready <= '1';
---                    if m_axi_arvalid = '1' and m_axi_arready = '1' then
-                    if m_axi_arvalid = '1' then
-                        state           <= AXI_READ;
-                        m_axi_arready   <= '1'; --ACK read address
-                        wb_mosi_out.adr <= m_axi_araddr;
-                        wb_mosi_out.cyc <= '1'; -- issue WB transaction
-                        wb_mosi_out.stb <= '1';
-                        wb_mosi_out.we  <= '0';
---                    elsif m_axi_awvalid = '1' and m_axi_awready = '1' then
-                    elsif m_axi_awvalid = '1' then
-                        state           <= AXI_GET_WDATA;
-                        m_axi_awready   <= '1'; --ACK write address
-                        wb_mosi_out.adr <= m_axi_awaddr;
-                    end if;
 
-                    when AXI_READ =>               -- wait for WB to be accepted
-                    m_axi_arready   <= '0';
-                    if wb_miso_in.stall = '0' then -- WB accept transaction
-                        wb_mosi_out.stb <= '0';
-                    end if;
-                    if wb_miso_in.ack = '1' then
-                        wb_mosi_out.cyc <= '0'; -- end WB transaction
-                        m_axi_rvalid    <= '1'; -- start read response handshake
-                        m_axi_rdata     <= wb_miso_in.rdat;
-                        m_axi_rresp     <= b"00"; --AXI_OKAY
-                        state           <= AXI_READ_RESPONSE;
-                    end if;
-                    if wb_miso_in.err = '1' then
-                        wb_mosi_out.cyc <= '0'; -- end WB transaction
-                        m_axi_rvalid    <= '1'; -- start read response handshake
-                        m_axi_rdata     <= wb_miso_in.rdat;
-                        m_axi_rresp     <= b"10"; --AXI_SLVERR
-                        state           <= AXI_READ_RESPONSE;
-                    end if;
-                    when AXI_READ_RESPONSE => -- wait for AXI read response to be accepted
-                    if m_axi_rready = '1' then
-                        m_axi_rvalid <= '0';
-                        state        <= IDLE;
-                    end if;
-
-                    when AXI_GET_WDATA =>
-                    m_axi_awready   <= '0'; 
-                    if m_axi_wvalid = '1' then
-                        state            <= AXI_WRITE;
-                        m_axi_wready     <= '1'; --ACK wdata
-                        wb_mosi_out.wdat <= m_axi_wdata;
-                        wb_mosi_out.sel  <= m_axi_wstrb;
-                        wb_mosi_out.cyc  <= '1'; -- issue WB transaction
-                        wb_mosi_out.stb  <= '1';
-                        wb_mosi_out.we   <= '1';
-                    end if;
-
-                    when AXI_WRITE =>
-                    m_axi_wready     <= '0';
-                    if wb_miso_in.stall = '0' then -- wait for WB to be accepted
-                        wb_mosi_out.stb <= '0';
-                    end if;
-                    if wb_miso_in.ack = '1' then
-                        wb_mosi_out.cyc <= '0';   -- end WB transaction
-                        m_axi_bvalid    <= '1';   -- start write response handshake
-                        m_axi_bresp     <= b"00"; --AXI_OKAY
-                        state           <= AXI_WRITE_RESPONSE;
-                    end if;
-                    if wb_miso_in.err = '1' then
-                        wb_mosi_out.cyc <= '0';   -- end WB transaction
-                        m_axi_bvalid    <= '1';   -- start write response handshake
-                        m_axi_bresp     <= b"10"; --AXI_SLVERR
-                        state           <= AXI_WRITE_RESPONSE;
-                    end if;
-
-                    when AXI_WRITE_RESPONSE => -- wait for AXI read response to be accepted
-                    if m_axi_bready = '1' then
-                        m_axi_bvalid <= '0';
-                        state        <= IDLE;
-                    end if;
-                end case;
-            end if;
-        end if;
-    end process;
-    -- read and write queue is 1 transaction (each)
+    axi4_to_wb_shim_inst : entity work.axi4_to_wb_shim
+        port map(
+            clk          => clk,
+            reset        => reset,
+            axi_mosi_in  => axi_mosi,
+            axi_miso_out => axi_miso,
+            wb_mosi_out  => wb_mosi_out,
+            wb_miso_in   => wb_miso_in
+        );
 
-    
---    jtag_axi_0_inst : jtag_axi_0
---    port map(
---        aclk          => clk,
---        aresetn       => resetn,
---        m_axi_awaddr  => m_axi_awaddr,
---        m_axi_awprot  => open,
---        m_axi_awvalid => m_axi_awvalid,
---        m_axi_awready => m_axi_awready,
---        m_axi_wdata   => m_axi_wdata,
---        m_axi_wstrb   => m_axi_wstrb,
---        m_axi_wvalid  => m_axi_wvalid,
---        m_axi_wready  => m_axi_wready,
---        m_axi_bresp   => m_axi_bresp,
---        m_axi_bvalid  => m_axi_bvalid,
---        m_axi_bready  => m_axi_bready,
---        m_axi_araddr  => m_axi_araddr,
---        m_axi_arprot  => open,
---        m_axi_arvalid => m_axi_arvalid,
---        m_axi_arready => m_axi_arready,
---        m_axi_rdata   => m_axi_rdata,
---        m_axi_rresp   => m_axi_rresp,
---        m_axi_rvalid  => m_axi_rvalid,
---        m_axi_rready  => m_axi_rready
---    );    
     debug_jtag_bd_inst : entity work.debug_jtag_wrapper
     port map(
         aclk          => clk,
         aresetn       => resetn,
-        M_AXI_awaddr  => m_axi_awaddr,
-        M_AXI_awprot  => open,
-        M_AXI_awvalid => m_axi_awvalid,
-        M_AXI_awready => m_axi_awready,
-        M_AXI_wdata   => m_axi_wdata,
-        M_AXI_wstrb   => m_axi_wstrb,
-        M_AXI_wvalid  => m_axi_wvalid,
-        M_AXI_wready  => m_axi_wready,
-        M_AXI_bresp   => m_axi_bresp,
-        M_AXI_bvalid  => m_axi_bvalid,
-        M_AXI_bready  => m_axi_bready,
-        M_AXI_araddr  => m_axi_araddr,
-        M_AXI_arprot  => open,
-        M_AXI_arvalid => m_axi_arvalid,
-        M_AXI_arready => m_axi_arready,
-        M_AXI_rdata   => m_axi_rdata,
-        M_AXI_rresp   => m_axi_rresp,
-        M_AXI_rvalid  => m_axi_rvalid,
-        M_AXI_rready  => m_axi_rready
+        M_AXI_awaddr  => axi_mosi.awaddr,
+        M_AXI_awburst => axi_mosi.awburst,
+        M_AXI_awlen   => axi_mosi.awlen,
+        M_AXI_awprot  => axi_mosi.awprot,
+        M_AXI_awsize  => axi_mosi.awsize,
+        M_AXI_awvalid => axi_mosi.awvalid,
+        M_AXI_awready => axi_miso.awready,
+        M_AXI_wdata   => axi_mosi.wdata,
+        M_AXI_wlast   => axi_mosi.wlast,
+        M_AXI_wstrb   => axi_mosi.wstrb,
+        M_AXI_wvalid  => axi_mosi.wvalid,
+        M_AXI_wready  => axi_miso.wready,
+        M_AXI_bresp   => axi_miso.bresp,
+        M_AXI_bvalid  => axi_miso.bvalid,
+        M_AXI_bready  => axi_mosi.bready,
+        M_AXI_araddr  => axi_mosi.araddr,
+        M_AXI_arburst => axi_mosi.arburst,
+        M_AXI_arlen   => axi_mosi.arlen,
+        M_AXI_arprot  => axi_mosi.arprot,
+        M_AXI_arsize  => axi_mosi.arsize,
+        M_AXI_arvalid => axi_mosi.arvalid,
+        M_AXI_arready => axi_miso.arready,
+        M_AXI_rdata   => axi_miso.rdata,
+        M_AXI_rlast   => axi_miso.rlast,
+        M_AXI_rresp   => axi_miso.rresp,
+        M_AXI_rvalid  => axi_miso.rvalid,
+        M_AXI_rready  => axi_mosi.rready
     );
-end architecture;
\ No newline at end of file
+end architecture;
@@ -0,0 +1,268 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! 2:N Wishbone B4 crossbar
+--!
+--! Replaces wb_arbiter + wb_interconnect for the CPU's instruction fetch (master 0) and data
+--! (master 1) buses. Each slave has its own 2:1 arbitration, so both masters can access
+--! different slaves in the same cycle (eg. IF reading BRAM while data accesses PSRAM).
+--!
+--! Address map as wb_interconnect: adr[31:28] selects one of up to 16 slaves, or
+--! G_ADR_MASK/G_ADR_MATCH from the gen_wb_ic package do. Unmapped addresses respond with ERR
+--! (one cycle later).
+--!
+--! Slaves flagged in G_DUAL_PORT_SLAVES (eg. wb_dp_bram) are not arbitrated: master 0 always
+--! uses the slave's A port (wb_slave_mosi_arr_out) and master 1 its B port
+--! (wb_slave_b_mosi_arr_out). The B ports of all other slaves are unused.
+--!
+--! Each master may have up to G_MAX_OUTSTANDING pipelined requests in flight to one slave.
+--! A master only moves on to a different slave once all its responses have returned, and
+--! keeps ownership of a shared slave until then, so responses are always in order.
+--!
+--! G_ARBITER (when both masters want the same free slave)
+--! "simple"    : the last master to use the slave keeps it
+--! "priority"  : master 0 wins
+entity wb_crossbar_2xn is
+    generic (
+        G_NUM_SLAVES       : integer := 16; -- max 16, 256 MBytes address space per slave
+        G_MAX_OUTSTANDING  : integer := 4;
+        G_DUAL_PORT_SLAVES : std_logic_vector(15 downto 0) := x"0000";
+        G_ARBITER          : string := "priority"; -- "simple" or "priority" only
+        G_ADR_MASK         : t_slv32_arr := (1 to 0 => x"0000_0000"); -- empty: use adr[31:28]
+        G_ADR_MATCH        : t_slv32_arr := (1 to 0 => x"0000_0000")
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        -- masters in (slave ports)
+        wb_master_mosi_arr_in  : in t_wb_mosi_arr(1 downto 0);
+        wb_master_miso_arr_out : out t_wb_miso_arr(1 downto 0);
+
+        -- Slave Wishbone buses out
+        wb_slave_mosi_arr_out : out t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
+        wb_slave_miso_arr_in  : in t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0);
+
+        -- second port of dual-port slaves (master 1 only)
+        wb_slave_b_mosi_arr_out : out t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
+        wb_slave_b_miso_arr_in  : in t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0)
+    );
+end entity wb_crossbar_2xn;
+
+architecture rtl of wb_crossbar_2xn is
+    constant C_UNMAPPED : integer := G_NUM_SLAVES; -- internal "slave" that returns ERR
+
+    subtype t_slave_idx is integer range 0 to G_NUM_SLAVES;
+    subtype t_master_idx is integer range 0 to 1;
+
+    type t_slave_idx_arr is array (0 to 1) of t_slave_idx;
+    type t_count_arr is array (0 to 1) of integer range 0 to G_MAX_OUTSTANDING;
+    type t_master_idx_arr is array (0 to G_NUM_SLAVES - 1) of t_master_idx;
+
+    function decode (adr : std_logic_vector(31 downto 0)) return t_slave_idx is
+    begin
+        if G_ADR_MASK'length = 0 then
+            if slv2uint(adr(31 downto 28)) < G_NUM_SLAVES then
+                return slv2uint(adr(31 downto 28));
+            end if;
+        else
+            -- first match wins, as in wb_interconnect
+            for i in 0 to G_NUM_SLAVES - 1 loop
+                if (adr and G_ADR_MASK(G_ADR_MASK'low + i)) = G_ADR_MATCH(G_ADR_MATCH'low + i) then
+                    return i;
+                end if;
+            end loop;
+        end if;
+        return C_UNMAPPED;
+    end function;
+
+    function is_dual (s : integer) return boolean is
+    begin
+        return s < G_NUM_SLAVES and G_DUAL_PORT_SLAVES(s) = '1';
+    end function;
+
+    -- per master
+    signal dec          : t_slave_idx_arr;
+    signal req          : std_logic_vector(1 downto 0);
+    signal issue_ok     : std_logic_vector(1 downto 0);
+    signal accept       : std_logic_vector(1 downto 0);
+    signal rsp_valid    : std_logic_vector(1 downto 0);
+    signal unmapped_err : std_logic_vector(1 downto 0) := (others => '0');
+    signal active_slave : t_slave_idx_arr := (others => C_UNMAPPED);
+    signal outstanding  : t_count_arr := (others => 0);
+
+    -- per (shared) slave
+    signal owner       : t_master_idx_arr := (others => 0);
+    signal grant       : t_master_idx_arr;
+    signal grant_valid : std_logic_vector(G_NUM_SLAVES - 1 downto 0);
+begin
+
+    gen_master_req : for m in 0 to 1 generate
+        dec(m) <= decode(wb_master_mosi_arr_in(m).adr);
+        req(m) <= wb_master_mosi_arr_in(m).cyc and wb_master_mosi_arr_in(m).stb;
+
+        issue_ok(m) <= '1' when outstanding(m) = 0 else
+                       '1' when dec(m) = active_slave(m) and outstanding(m) < G_MAX_OUTSTANDING else
+                       '0';
+    end generate;
+
+    --! Per-slave arbitration. The owner keeps a slave while it has responses outstanding there
+    grant_proc : process (all)
+        variable o     : t_master_idx;
+        variable wants : std_logic_vector(1 downto 0);
+        variable busy  : std_logic_vector(1 downto 0);
+    begin
+        for s in 0 to G_NUM_SLAVES - 1 loop
+            for m in 0 to 1 loop
+                wants(m) := '0';
+                busy(m)  := '0';
+                if req(m) = '1' and issue_ok(m) = '1' and dec(m) = s then
+                    wants(m) := '1';
+                end if;
+                if outstanding(m) /= 0 and active_slave(m) = s then
+                    busy(m) := '1';
+                end if;
+            end loop;
+
+            o := owner(s);
+            grant(s)       <= o;
+            grant_valid(s) <= '1';
+            if is_dual(s) then
+                grant_valid(s) <= '0'; -- not arbitrated
+            elsif busy(o) = '1' then
+                null;
+            elsif G_ARBITER = "priority" and wants(0) = '1' then
+                grant(s) <= 0;
+            elsif wants(o) = '1' then
+                null;
+            elsif wants(1 - o) = '1' then
+                grant(s) <= 1 - o;
+            else
+                grant_valid(s) <= '0';
+            end if;
+        end loop;
+    end process;
+
+    accept_proc : process (all)
+        variable s : t_slave_idx;
+    begin
+        for m in 0 to 1 loop
+            s := dec(m);
+            accept(m) <= '0';
+            if req(m) = '1' and issue_ok(m) = '1' then
+                if s = C_UNMAPPED then
+                    accept(m) <= '1';
+                elsif is_dual(s) then
+                    if m = 0 then
+                        accept(m) <= not wb_slave_miso_arr_in(s).stall;
+                    else
+                        accept(m) <= not wb_slave_b_miso_arr_in(s).stall;
+                    end if;
+                elsif grant_valid(s) = '1' and grant(s) = m then
+                    accept(m) <= not wb_slave_miso_arr_in(s).stall;
+                end if;
+            end if;
+        end loop;
+    end process;
+
+    slave_mux : process (all)
+        variable m : t_master_idx;
+    begin
+        for s in 0 to G_NUM_SLAVES - 1 loop
+            wb_slave_mosi_arr_out(s)   <= C_WB_MOSI_INIT;
+            wb_slave_b_mosi_arr_out(s) <= C_WB_MOSI_INIT;
+
+            if is_dual(s) then
+                wb_slave_mosi_arr_out(s)   <= wb_master_mosi_arr_in(0);
+                wb_slave_b_mosi_arr_out(s) <= wb_master_mosi_arr_in(1);
+                wb_slave_mosi_arr_out(s).stb   <= '0';
+                wb_slave_b_mosi_arr_out(s).stb <= '0';
+                if dec(0) = s then
+                    wb_slave_mosi_arr_out(s).stb <= req(0) and issue_ok(0);
+                end if;
+                if dec(1) = s then
+                    wb_slave_b_mosi_arr_out(s).stb <= req(1) and issue_ok(1);
+                end if;
+            elsif grant_valid(s) = '1' then
+                m := grant(s);
+                wb_slave_mosi_arr_out(s)     <= wb_master_mosi_arr_in(m);
+                wb_slave_mosi_arr_out(s).stb <= '0';
+                if dec(m) = s then
+                    wb_slave_mosi_arr_out(s).stb <= req(m) and issue_ok(m);
+                end if;
+            end if;
+        end loop;
+    end process;
+
+    reply_mux : process (all)
+        variable s   : t_slave_idx;
+        variable rsp : t_wb_miso;
+    begin
+        for m in 0 to 1 loop
+            -- with nothing outstanding, only the slave being accepted this cycle can respond
+            if outstanding(m) /= 0 then
+                s := active_slave(m);
+            else
+                s := dec(m);
+            end if;
+
+            rsp := (rdat => x"DEC0DEFF", stall => '0', ack => '0', err => '0', rty => '0'); -- "decode death"
+            if outstanding(m) /= 0 or accept(m) = '1' then
+                if s = C_UNMAPPED then
+                    rsp.err := unmapped_err(m);
+                elsif is_dual(s) and m = 1 then
+                    rsp := wb_slave_b_miso_arr_in(s);
+                else
+                    rsp := wb_slave_miso_arr_in(s);
+                end if;
+            end if;
+            rsp_valid(m) <= rsp.ack or rsp.err or rsp.rty;
+
+            rsp.stall := req(m) and not accept(m);
+            wb_master_miso_arr_out(m) <= rsp;
+        end loop;
+    end process;
+
+    track_proc : process (wb_clk)
+    begin
+        if rising_edge(wb_clk) then
+            for m in 0 to 1 loop
+                if wb_reset = '1' or wb_master_mosi_arr_in(m).cyc = '0' then
+                    -- dropping CYC ends the bus cycle, any outstanding responses are abandoned
+                    outstanding(m)  <= 0;
+                    unmapped_err(m) <= '0';
+                else
+                    if accept(m) = '1' and rsp_valid(m) = '0' then
+                        outstanding(m) <= outstanding(m) + 1;
+                    elsif accept(m) = '0' and rsp_valid(m) = '1' then
+                        outstanding(m) <= outstanding(m) - 1;
+                    end if;
+
+                    if accept(m) = '1' then
+                        active_slave(m) <= dec(m);
+                    end if;
+
+                    -- unmapped accesses get their ERR one cycle later, like a registered slave
+                    if accept(m) = '1' and dec(m) = C_UNMAPPED then
+                        unmapped_err(m) <= '1';
+                    else
+                        unmapped_err(m) <= '0';
+                    end if;
+                end if;
+            end loop;
+
+            for s in 0 to G_NUM_SLAVES - 1 loop
+                if wb_reset = '1' then
+                    owner(s) <= 0;
+                elsif grant_valid(s) = '1' then
+                    owner(s) <= grant(s);
+                end if;
+            end loop;
+        end if;
+    end process;
+
+end architecture;
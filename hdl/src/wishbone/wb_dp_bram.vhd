@@ -0,0 +1,104 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! True dual-port version of wb_sp_bram
+--! Two independent wishbone B4 slave ports sharing one memory, so e.g. instruction fetch
+--! and data accesses can both hit program memory in the same cycle.
+--!
+--! - Synchronous read, so adds 1 wait state on each port (1 ACK per cycle when pipelined)
+--! - 32 bit port width, 8 bit granularity
+--! - Both ports on the same clock. Writing the same address from both ports in the same
+--!   cycle is undefined (as for the underlying BRAM primitive)
+--!
+--! Xilinx 7-series BRAMs are true dual-port, GOWIN 512x32 BRAMs are not (use 1024x16 or narrower)
+entity wb_dp_bram is
+    generic (
+        G_MEM_DEPTH_WORDS : integer := 512; --! Must be a power of 2
+        G_INIT_FILE : string  := ""
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        wb_a_mosi_in  : in t_wb_mosi;
+        wb_a_miso_out : out t_wb_miso;
+
+        wb_b_mosi_in  : in t_wb_mosi;
+        wb_b_miso_out : out t_wb_miso
+    );
+end entity;
+
+architecture rtl of wb_dp_bram is
+
+    constant C_WORD_ADR_W : integer := clog2(G_MEM_DEPTH_WORDS);
+
+    -- slice off the word address from the Wishbone BYTE address
+    constant C_WORD_ADR_H : integer := C_WORD_ADR_W+2-1;
+    constant C_WORD_ADR_L : integer := 2;
+
+    -- shared variable so both ports can write (standard TDP BRAM inference template)
+    shared variable mem32 : t_slv32_arr(0 to G_MEM_DEPTH_WORDS - 1) := init_mem32(G_INIT_FILE, G_MEM_DEPTH_WORDS);
+
+begin
+    -- both ports can always respond to requests, so no stalling is required
+    wb_a_miso_out.stall <= '0';
+    wb_b_miso_out.stall <= '0';
+
+    --! unsupported
+    wb_a_miso_out.err <= '0';
+    wb_a_miso_out.rty <= '0';
+    wb_b_miso_out.err <= '0';
+    wb_b_miso_out.rty <= '0';
+
+    --! Add our 1 cycle wait state for reads
+    wb_ack_proc : process (wb_clk) is
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' then
+                wb_a_miso_out.ack <= '0';
+                wb_b_miso_out.ack <= '0';
+            else
+                wb_a_miso_out.ack <= wb_a_mosi_in.stb;
+                wb_b_miso_out.ack <= wb_b_mosi_in.stb;
+            end if;
+        end if;
+    end process;
+
+    port_a_proc : process (wb_clk) is
+        variable adr : integer range 0 to G_MEM_DEPTH_WORDS - 1;
+    begin
+        if rising_edge(wb_clk) then
+            if wb_a_mosi_in.stb = '1' then
+                adr := slv2uint(wb_a_mosi_in.adr(C_WORD_ADR_H downto C_WORD_ADR_L));
+                for i in 0 to 3 loop
+                    if wb_a_mosi_in.sel(i) = '1' and wb_a_mosi_in.we = '1' then
+                        mem32(adr)(8 * (i + 1) - 1 downto 8 * i) := wb_a_mosi_in.wdat(8 * (i + 1) - 1 downto 8 * i);
+                    end if;
+                end loop;
+                -- write-first: a write returns the new data on rdat
+                wb_a_miso_out.rdat <= mem32(adr);
+            end if;
+        end if;
+    end process;
+
+    port_b_proc : process (wb_clk) is
+        variable adr : integer range 0 to G_MEM_DEPTH_WORDS - 1;
+    begin
+        if rising_edge(wb_clk) then
+            if wb_b_mosi_in.stb = '1' then
+                adr := slv2uint(wb_b_mosi_in.adr(C_WORD_ADR_H downto C_WORD_ADR_L));
+                for i in 0 to 3 loop
+                    if wb_b_mosi_in.sel(i) = '1' and wb_b_mosi_in.we = '1' then
+                        mem32(adr)(8 * (i + 1) - 1 downto 8 * i) := wb_b_mosi_in.wdat(8 * (i + 1) - 1 downto 8 * i);
+                    end if;
+                end loop;
+                wb_b_miso_out.rdat <= mem32(adr);
+            end if;
+        end if;
+    end process;
+
+end architecture;
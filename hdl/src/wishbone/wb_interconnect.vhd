@@ -6,12 +6,15 @@ use work.wb_pkg.all;
 use work.joe_common_pkg.all;
 --! Simple 1:N Wishbone Interconnect controlling access to a shared Wishbone bus 
 --!
+--! By default adr[31:28] selects the slave (256 MBytes each). Passing G_ADR_MASK/G_ADR_MATCH
+--! (eg. C_WB_ADR_MASK/C_WB_ADR_MATCH from a package generated by tools/gen_wb_ic) instead
+--! selects slave i when (adr and G_ADR_MASK(i)) = G_ADR_MATCH(i), so slaves can have
+--! arbitrary power-of-2 sized regions and only the masked bits are compared.
 entity wb_interconnect is
     generic (
-        G_NUM_SLAVES : integer := 16 -- max 16, 256 MBytes address space per slave
-        -- Select the width of segment used for address decoding
-        -- G_ADR_MAP_H : integer := 31;
-        -- G_ADR_MAP_L: integer := 28
+        G_NUM_SLAVES : integer := 16; -- max 16
+        G_ADR_MASK   : t_slv32_arr := (1 to 0 => x"0000_0000"); -- empty: use adr[31:28]
+        G_ADR_MATCH  : t_slv32_arr := (1 to 0 => x"0000_0000")
     );
     port (
         wb_clk   : in std_logic;
@@ -61,12 +64,22 @@ begin
         -- default to all 0's, then override 1 bit
         slave_sel <= (others => '0');
         
-        int_slave := slv2uint(adr_decode);
-        for i in 0 to G_NUM_SLAVES-1 loop
-            if int_slave = i then
-                slave_sel(i) <= '1';
-            end if;
-        end loop;
+        if G_ADR_MASK'length = 0 then
+            int_slave := slv2uint(adr_decode);
+            for i in 0 to G_NUM_SLAVES-1 loop
+                if int_slave = i then
+                    slave_sel(i) <= '1';
+                end if;
+            end loop;
+        else
+            -- first match wins, so overlapping (sparse) decodes stay one-hot
+            for i in G_NUM_SLAVES-1 downto 0 loop
+                if (wb_master_mosi_in.adr and G_ADR_MASK(G_ADR_MASK'low + i)) = G_ADR_MATCH(G_ADR_MATCH'low + i) then
+                    slave_sel <= (others => '0');
+                    slave_sel(i) <= '1';
+                end if;
+            end loop;
+        end if;
 
     end process addr_decode;
 
@@ -0,0 +1,181 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.wb_pkg.all;
+use work.joe_common_pkg.all;
+
+--! Pipelined 1:N Wishbone B4 Interconnect
+--!
+--! Same address map as wb_interconnect (adr[31:28] selects one of up to 16 slaves, or
+--! G_ADR_MASK/G_ADR_MATCH from the gen_wb_ic package; unmapped addresses respond with ERR),
+--! but allows up to G_MAX_OUTSTANDING requests to be in flight
+--! so slaves like wb_sp_bram can return one ACK per cycle during a pipelined burst.
+--!
+--! Responses are kept in order by only letting the master switch to a different slave once
+--! all responses from the current slave have returned. Read data/ACK/ERR/RTY are routed from
+--! the slave that owns the outstanding requests, not from the address currently on the bus.
+--!
+--! G_REGISTER_DECODE adds a register slice on the request path so the address decode is
+--! registered (+1 cycle latency, still 1 transfer per cycle). STALL back to the master is
+--! still combinational from the selected slave.
+--!
+--! Slaves may ACK in the same cycle they accept a request or any cycle afterwards.
+entity wb_pipelined_interconnect is
+    generic (
+        G_NUM_SLAVES      : integer := 16; -- max 16, 256 MBytes address space per slave
+        G_MAX_OUTSTANDING : integer := 4;
+        G_REGISTER_DECODE : boolean := false;
+        G_ADR_MASK        : t_slv32_arr := (1 to 0 => x"0000_0000"); -- empty: use adr[31:28]
+        G_ADR_MATCH       : t_slv32_arr := (1 to 0 => x"0000_0000")
+    );
+    port (
+        wb_clk   : in std_logic;
+        wb_reset : in std_logic;
+
+        -- master in (slave port)
+        wb_master_mosi_in  : in t_wb_mosi;
+        wb_master_miso_out : out t_wb_miso;
+
+        -- Slave Wishbone buses out
+        wb_slave_mosi_arr_out : out t_wb_mosi_arr(G_NUM_SLAVES - 1 downto 0);
+        wb_slave_miso_arr_in  : in t_wb_miso_arr(G_NUM_SLAVES - 1 downto 0)
+    );
+end entity wb_pipelined_interconnect;
+
+architecture rtl of wb_pipelined_interconnect is
+    constant C_UNMAPPED : integer := G_NUM_SLAVES; -- internal "slave" that returns ERR
+
+    subtype t_slave_idx is integer range 0 to G_NUM_SLAVES;
+
+    function decode (adr : std_logic_vector(31 downto 0)) return t_slave_idx is
+    begin
+        if G_ADR_MASK'length = 0 then
+            if slv2uint(adr(31 downto 28)) < G_NUM_SLAVES then
+                return slv2uint(adr(31 downto 28));
+            end if;
+        else
+            -- first match wins, as in wb_interconnect
+            for i in 0 to G_NUM_SLAVES - 1 loop
+                if (adr and G_ADR_MASK(G_ADR_MASK'low + i)) = G_ADR_MATCH(G_ADR_MATCH'low + i) then
+                    return i;
+                end if;
+            end loop;
+        end if;
+        return C_UNMAPPED;
+    end function;
+
+    -- request stage (either straight from the master or from the register slice)
+    signal req_mosi  : t_wb_mosi := C_WB_MOSI_INIT;
+    signal req_slave : t_slave_idx := C_UNMAPPED;
+    signal req_valid : std_logic;
+
+    signal issue_ok     : std_logic; -- in-order rule and outstanding limit allow this request
+    signal target_stall : std_logic;
+    signal accept       : std_logic;
+
+    -- response tracking
+    signal active_slave : t_slave_idx := C_UNMAPPED;
+    signal outstanding  : integer range 0 to G_MAX_OUTSTANDING := 0;
+    signal rsp_slave    : t_slave_idx;
+    signal rsp_valid    : std_logic;
+    signal unmapped_err : std_logic := '0';
+begin
+
+    gen_reg_slice : if G_REGISTER_DECODE generate
+        reg_slice_proc : process (wb_clk)
+        begin
+            if rising_edge(wb_clk) then
+                if wb_reset = '1' then
+                    req_mosi  <= C_WB_MOSI_INIT;
+                    req_slave <= C_UNMAPPED;
+                elsif req_valid = '0' or accept = '1' then
+                    req_mosi  <= wb_master_mosi_in;
+                    req_slave <= decode(wb_master_mosi_in.adr);
+                else
+                    -- holding a stalled request, but still follow CYC
+                    req_mosi.cyc <= wb_master_mosi_in.cyc;
+                end if;
+            end if;
+        end process;
+    else generate
+        req_mosi  <= wb_master_mosi_in;
+        req_slave <= decode(wb_master_mosi_in.adr);
+    end generate;
+
+    req_valid <= req_mosi.cyc and req_mosi.stb;
+
+    issue_ok <= '1' when outstanding = 0 else
+                '1' when req_slave = active_slave and outstanding < G_MAX_OUTSTANDING else
+                '0';
+
+    target_stall <= '0' when req_slave = C_UNMAPPED else wb_slave_miso_arr_in(req_slave).stall;
+
+    accept <= req_valid and issue_ok and not target_stall;
+
+    slave_out : for i in 0 to G_NUM_SLAVES - 1 generate
+        wb_slave_mosi_arr_out(i).cyc  <= req_mosi.cyc;
+        wb_slave_mosi_arr_out(i).stb  <= req_valid and issue_ok when req_slave = i else '0';
+        wb_slave_mosi_arr_out(i).adr  <= req_mosi.adr;
+        wb_slave_mosi_arr_out(i).wdat <= req_mosi.wdat;
+        wb_slave_mosi_arr_out(i).we   <= req_mosi.we;
+        wb_slave_mosi_arr_out(i).sel  <= req_mosi.sel;
+        wb_slave_mosi_arr_out(i).lock <= req_mosi.lock;
+    end generate;
+
+    -- with nothing outstanding, only the slave being accepted this cycle can respond
+    rsp_slave <= active_slave when outstanding /= 0 else req_slave;
+
+    reply_mux : process (all)
+    begin
+        wb_master_miso_out.ack   <= '0';
+        wb_master_miso_out.err   <= '0';
+        wb_master_miso_out.rty   <= '0';
+        wb_master_miso_out.rdat  <= x"DEC0DEFF"; -- "decode death"
+        -- (the register slice can take a new request whenever it is empty or draining)
+        wb_master_miso_out.stall <= req_valid and not accept;
+        rsp_valid <= '0';
+
+        if outstanding /= 0 or accept = '1' then
+            if rsp_slave = C_UNMAPPED then
+                wb_master_miso_out.err <= unmapped_err;
+                rsp_valid <= unmapped_err;
+            else
+                wb_master_miso_out.ack  <= wb_slave_miso_arr_in(rsp_slave).ack;
+                wb_master_miso_out.err  <= wb_slave_miso_arr_in(rsp_slave).err;
+                wb_master_miso_out.rty  <= wb_slave_miso_arr_in(rsp_slave).rty;
+                wb_master_miso_out.rdat <= wb_slave_miso_arr_in(rsp_slave).rdat;
+                rsp_valid <= wb_slave_miso_arr_in(rsp_slave).ack or wb_slave_miso_arr_in(rsp_slave).err or wb_slave_miso_arr_in(rsp_slave).rty;
+            end if;
+        end if;
+    end process reply_mux;
+
+    track_proc : process (wb_clk)
+    begin
+        if rising_edge(wb_clk) then
+            if wb_reset = '1' or req_mosi.cyc = '0' then
+                -- dropping CYC ends the bus cycle, any outstanding responses are abandoned
+                outstanding  <= 0;
+                unmapped_err <= '0';
+            else
+                if accept = '1' and rsp_valid = '0' then
+                    outstanding <= outstanding + 1;
+                elsif accept = '0' and rsp_valid = '1' then
+                    outstanding <= outstanding - 1;
+                end if;
+
+                if accept = '1' then
+                    active_slave <= req_slave;
+                end if;
+
+                -- unmapped accesses get their ERR one cycle later, like a registered slave
+                if accept = '1' and req_slave = C_UNMAPPED then
+                    unmapped_err <= '1';
+                else
+                    unmapped_err <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture;
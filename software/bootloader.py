@@ -7,6 +7,7 @@ import sys
 import serial
 import array
 import time
+import zlib
 
 
 # ASCII hex file of the new program
@@ -54,6 +55,10 @@ def send_bin_file(bin_file, uart):
                     print(".", end="", flush=True)
                     count = 0
             print(f"sent {lenfile} bytes! (max size {PROG_MEM_MAX})")
+            # a bootloader built with PLATFORM_HAS_CRC (basys3) shows the low 16 bits of the CRC32 on the
+            # seven segment display once the upload stops
+            crc = zlib.crc32(contents)
+            print(f"CRC32 0x{crc:08x}, check the display shows {crc & 0xffff:04X}")
             print(f"{PROG_MEM_MAX - lenfile} bytes remaining for the heap/stack")
             if lenfile + RESERVED_STACK_HEAP_SPACE > PROG_MEM_MAX:
                 print(f"Warning: Program may be too large! Does not meet reserved space of {RESERVED_STACK_HEAP_SPACE} bytes")
@@ -24,6 +24,19 @@
 #define SSEG (*((volatile unsigned long *)0x10000004))
 #define GPIO_SW (*((volatile unsigned long *)0x10000104))
 
+// wb_crc (see crc.h), basys3_soc only: build with -DPLATFORM_HAS_CRC (PLATFORM_DEFINES in the makefile)
+#ifdef PLATFORM_HAS_CRC
+#define CRC_DATA_B (*((volatile unsigned char *)0x90000000))
+#define CRC_CTRL (*((volatile unsigned long *)0x90000004))
+#define CRC_POLY (*((volatile unsigned long *)0x90000008))
+#define CRC_INIT (*((volatile unsigned long *)0x9000000C))
+#define CRC_XOR_OUT (*((volatile unsigned long *)0x90000010))
+#define CRC_RESULT (*((volatile unsigned long *)0x90000014))
+#define CRC_CTRL_CRC32 (32 | 0x100 | 0x200) // width 32, reflected in and out
+// polls of an empty UART before the upload is taken to have finished, about 1ms at 50MHz
+#define UPLOAD_IDLE_POLLS 5000
+#endif
+
 #define MAIN_RAM_LEN 8192 * 4   // bytes
 
 int get_bit(int reg, int bitnum)
@@ -46,6 +59,23 @@ unsigned char uart_get_char(void){
     return UART_RX_BYTE;
 }
 
+#ifdef PLATFORM_HAS_CRC
+// as uart_get_char, but if nothing arrives for a while shows the CRC of everything received so far
+// on the seven segment display (once per pause, so there's no extra bus read per byte)
+unsigned char uart_get_char_crc(void){
+    int idle = 0;
+    while(UART_RX_VALID == 0){
+        if (idle < UPLOAD_IDLE_POLLS){
+            idle++;
+        } else if (idle == UPLOAD_IDLE_POLLS){
+            SSEG = CRC_RESULT;
+            idle++;
+        }
+    }
+    return UART_RX_BYTE;
+}
+#endif
+
 void main(void)
 {
 
@@ -66,13 +96,21 @@ void main(void)
 
     // wipe the old memory contents (32bits at a time)
     volatile unsigned int *wipe_ptr = 0;
-    for (int i; i < MAIN_RAM_LEN/4; i++)
-    // for (int i=0; i < 100; i++)
+    for (int i = 0; i < MAIN_RAM_LEN/4; i++)
     {
         *wipe_ptr = 0x0000000;  // fill with NO-OPs
         wipe_ptr++;  // adr+4
     }
     GPIO_LED = 0x1;
+
+#ifdef PLATFORM_HAS_CRC
+    // CRC32 (same as zlib) of everything received, so the upload can be checked against bootloader.py
+    CRC_CTRL = CRC_CTRL_CRC32;
+    CRC_POLY = 0x04C11DB7;
+    CRC_XOR_OUT = 0xFFFFFFFF;
+    CRC_INIT = 0xFFFFFFFF;
+#endif
+
     // tell PC that we are ready
     uart_put_char(XON);
     char gotc;
@@ -98,7 +136,12 @@ void main(void)
     while (1) {
         *mem = gotc;    // store it to memory
         mem++;          // increase memory address by 1 byte
+#ifdef PLATFORM_HAS_CRC
+        CRC_DATA_B = gotc;
+        gotc = uart_get_char_crc(); // get next byte, the CRC is shown once the upload stops (no length is sent)
+#else
         gotc = uart_get_char(); // get next byte
+#endif
     };
     GPIO_LED = 0x3;
 }
\ No newline at end of file
@@ -1,6 +1,17 @@
-
-#include "terminal.h"
+#include "console.h"
 #include "text_display.h"
+#include "cpu.h"
+#include "numfmt.h"
+
+/*
+ *  Primary console, for printf_()
+
+    putchar_() only appends to a buffer. Whole spans of it go to the terminal (where runs of
+    printable chars are copied into the row in one go) and the UART, and the terminal is only
+    copied to the screen as the flush policy allows. Each refresh only rewrites the rows that
+    changed or scrolled, as far as their text goes, rather than all 2400 cells. With the default
+    per-line policy every row still scrolls each line: console_set_flush() saves the rest.
+ */
 
 // global variables to statically allocate
 
@@ -8,6 +19,20 @@
 // make static to limit to just in this file
 static t_terminal t; // allocate space for a terminal object
 static char t_buf[TEXT_W * (TEXT_H)]; // also allocate space for the terminal buffer
+static unsigned short t_row_len[TEXT_H];
+static unsigned char t_row_dirty[TEXT_H];
+
+// output not yet written to the terminal
+static char out_buf[CONSOLE_BUF_LEN];
+static unsigned int out_len;
+
+static int flush_policy;
+static struct timer *flush_timer;
+static u64 flush_cycles; // CONSOLE_FLUSH_TIMED interval
+static u64 last_refresh;  // mtime
+static int dirty;         // terminal changed since the last refresh
+
+static struct uart *out_uart;
 
 // set up the primary console (using return value is optional)
 t_terminal* console_init(){
@@ -16,29 +41,107 @@ t_terminal* console_init(){
     t.x = 0;
     t.y = 0;
     t.buf = t_buf;
+    t.row_len = t_row_len;
+    t.row_dirty = t_row_dirty;
+    terminal_clear(&t);
     t.line_at_top = 1;
+    out_len = 0;
+    flush_policy = CONSOLE_FLUSH_LINE;
+    flush_timer = 0;
+    out_uart = 0;
+    dirty = 0;
     return &t;
 }
 
+void console_set_flush(int policy, struct timer *timer, u32 ms){
+    console_flush();
+    flush_policy = policy;
+    flush_timer = timer;
+    flush_cycles = (u64)ms * (REFCLK / 1000);
+    if (timer){
+        last_refresh = timer_get_mtime(timer);
+    }
+}
+
+void console_set_uart(struct uart *uart){
+    out_uart = uart;
+}
+
+// hand the buffer on to the terminal and UART
+static void write_out(){
+    if (!out_len){
+        return;
+    }
+    terminal_write_span(&t, out_buf, out_len);
+    if (out_uart){
+        uart_write(out_uart, out_buf, out_len);
+    }
+    out_len = 0;
+    dirty = 1;
+}
+
+void console_flush(){
+    write_out();
+    if (dirty){
+        text_update_from_terminal(&t);
+        dirty = 0;
+    }
+    if (flush_timer){
+        last_refresh = timer_get_mtime(flush_timer);
+    }
+}
+
+void console_poll(){
+    if (flush_policy == CONSOLE_FLUSH_TIMED && (out_len || dirty) &&
+        timer_get_mtime(flush_timer) - last_refresh >= flush_cycles){
+        console_flush();
+    }
+}
+
 // write a char to the output console (used by printf_() function)
 void putchar_(char c){
-    terminal_write_char(&t, c);
-    // terminal_write_string(t, &c);
-    if (c=='\n'){
-        text_refresh_from_terminal(&t); // flush to screen only after every newline to improve performance
+    out_buf[out_len++] = c;
+    if (out_len == CONSOLE_BUF_LEN){
+        write_out();
+    }
+    if (c == '\n' || c == '\r'){
+        // a finished line, or the cursor back to the start of one
+        if (flush_policy == CONSOLE_FLUSH_LINE){
+            console_flush();
+        } else {
+            console_poll();
+        }
     }
-    if (c=='\r'){
-        text_refresh_from_terminal(&t); // flush to screen also when returning cursor to start of line
+}
+
+void console_write(const char *s, u32 len){
+    for (u32 i = 0; i < len; i++){
+        putchar_(s[i]);
     }
 }
 
+void console_put_u32(u32 val){
+    char buf[NUMFMT_DEC_MAX];
+    console_write(buf, fmt_u32(buf, val));
+}
+
+void console_put_s32(s32 val){
+    char buf[NUMFMT_DEC_MAX];
+    console_write(buf, fmt_s32(buf, val));
+}
+
+void console_put_hex(u32 val, u32 digits){
+    char buf[2 + NUMFMT_HEX_MAX] = "0x";
+    console_write(buf, 2 + fmt_hex(&buf[2], val, digits, 0));
+}
+
 // clear terminal buffer and console
 void cls(){
-    for (int i = 0; i < (TEXT_W * TEXT_H);i++){
-        t.buf[i] = 0;
-    }
+    write_out(); // the UART still gets it
+    terminal_clear(&t);
     t.x = 0;
     t.y = 0;
     t.line_at_top = 1;
     text_refresh_from_terminal(&t);
-}
\ No newline at end of file
+    dirty = 0;
+}
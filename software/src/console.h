@@ -2,9 +2,38 @@
 #define _CONSOLE_H_
 
 #include "terminal.h"
+#include "timer.h"
+#include "uart.h"
+
+// when buffered output goes to the screen, for console_set_flush().
+// A refresh only writes the rows that changed or scrolled, up to the end of their text, so the
+// default costs about (screen rows x line length) cells per line. Refreshing less often with
+// CONSOLE_FLUSH_TIMED or CONSOLE_FLUSH_EXPLICIT saves the rest, with console_poll()/console_flush()
+// wherever the output has to be on screen
+#define CONSOLE_FLUSH_LINE 0     // at every \n and \r (the default)
+#define CONSOLE_FLUSH_TIMED 1    // at a \n or \r, if it has been `ms` since the last refresh
+#define CONSOLE_FLUSH_EXPLICIT 2 // only with console_flush()
+
+// putchar_() output is buffered and handed on this many chars at a time at most
+#define CONSOLE_BUF_LEN 128
 
 t_terminal* console_init();
 void putchar_(char c);  // for printf support
 void cls();
 
-#endif // _CONSOLE_H_
\ No newline at end of file
+// timer is only used by CONSOLE_FLUSH_TIMED (mtime), and may be NULL otherwise
+void console_set_flush(int policy, struct timer *timer, u32 ms);
+// copy the output to a UART as well (NULL to stop)
+void console_set_uart(struct uart *uart);
+// buffered output to the terminal (and UART), then refresh the screen
+void console_flush();
+// for CONSOLE_FLUSH_TIMED: flush once `ms` has passed, so the last lines are not left waiting
+void console_poll();
+
+// output without going through printf_(), a span at a time
+void console_write(const char *s, u32 len);
+void console_put_u32(u32 val);
+void console_put_s32(s32 val);
+void console_put_hex(u32 val, u32 digits); // "0x" then `digits` digits, 0 for as many as needed
+
+#endif // _CONSOLE_H_
@@ -0,0 +1,58 @@
+#include "crc.h"
+
+/*
+ *  Hardware CRC engine (wb_crc)
+
+    Processes one byte per clock, and stalls the bus until a write has been processed,
+    so crc_result() can be read straight after the last crc_update().
+ */
+
+const struct crc_config crc7_sd = {7, 0x09, 0, 0, 0};
+const struct crc_config crc16_xmodem = {16, 0x1021, 0, 0, 0};
+const struct crc_config crc32_zlib = {32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, _BV(CRC_CTRL_REFLECT_IN_BIT) | _BV(CRC_CTRL_REFLECT_OUT_BIT)};
+
+static u32 crc_ctrl;
+
+void crc_setup(const struct crc_config *cfg){
+    crc_ctrl = (cfg->width & CRC_CTRL_WIDTH_MASK) | cfg->reflect;
+    write_u32(CRC_CTRL, crc_ctrl);
+    write_u32(CRC_POLY, cfg->poly);
+    write_u32(CRC_XOR_OUT, cfg->xor_out);
+    write_u32(CRC_INIT, cfg->init); // last, so the restart uses the new width
+}
+
+void crc_restart(void){
+    write_u32(CRC_RESULT, 0);
+}
+
+void crc_update(const void *buf, size_t len){
+    const u8 *b = buf;
+    while (len && ((u32)b & 0x3)){
+        write_u8(CRC_DATA, *b++);
+        len--;
+    }
+    // little endian, so the lowest byte lane is the first byte in memory
+    const u32 *w = (const u32 *)b;
+    for (; len >= 4; len -= 4){
+        write_u32(CRC_DATA, *w++);
+    }
+    b = (const u8 *)w;
+    while (len--){
+        write_u8(CRC_DATA, *b++);
+    }
+}
+
+u32 crc_result(void){
+    return read_u32(CRC_RESULT);
+}
+
+void crc_snoop(u32 snoop){
+    crc_ctrl = (crc_ctrl & ~(_BV(CRC_CTRL_SNOOP_RX_BIT) | _BV(CRC_CTRL_SNOOP_TX_BIT))) | snoop;
+    write_u32(CRC_CTRL, crc_ctrl);
+}
+
+u32 crc_calc(const struct crc_config *cfg, const void *buf, size_t len){
+    crc_setup(cfg);
+    crc_update(buf, len);
+    return crc_result();
+}
@@ -0,0 +1,50 @@
+#ifndef _CRC_H_
+#define _CRC_H_
+
+#include <stddef.h>
+
+#include "utils.h"
+#include "platform.h"
+
+// wb_crc registers
+#define CRC_DATA    (PLATFORM_CRC0_BASE + 0x00) // bytes to add, reads return the result
+#define CRC_CTRL    (PLATFORM_CRC0_BASE + 0x04)
+#define CRC_POLY    (PLATFORM_CRC0_BASE + 0x08)
+#define CRC_INIT    (PLATFORM_CRC0_BASE + 0x0C) // writing restarts the CRC
+#define CRC_XOR_OUT (PLATFORM_CRC0_BASE + 0x10)
+#define CRC_RESULT  (PLATFORM_CRC0_BASE + 0x14) // writing restarts the CRC
+#define CRC_COUNT   (PLATFORM_CRC0_BASE + 0x18)
+
+#define CRC_CTRL_WIDTH_MASK 0x3F
+#define CRC_CTRL_REFLECT_IN_BIT 8
+#define CRC_CTRL_REFLECT_OUT_BIT 9
+#define CRC_CTRL_SNOOP_RX_BIT 12 // add every byte received by the SD card SPI controller
+#define CRC_CTRL_SNOOP_TX_BIT 13 // add every byte sent by the SD card SPI controller
+
+struct crc_config
+{
+    u32 width;  // bits
+    u32 poly;   // normal (MSB first) form
+    u32 init;
+    u32 xor_out;
+    u32 reflect; // _BV(CRC_CTRL_REFLECT_IN_BIT) | _BV(CRC_CTRL_REFLECT_OUT_BIT)
+};
+
+extern const struct crc_config crc7_sd;      // SD card commands
+extern const struct crc_config crc16_xmodem; // SD card data blocks
+extern const struct crc_config crc32_zlib;   // zlib/Ethernet/PNG
+
+// load a CRC config and restart, with snooping off
+void crc_setup(const struct crc_config *cfg);
+void crc_restart(void);
+// add len bytes from buf, whole words at a time where possible
+void crc_update(const void *buf, size_t len);
+u32 crc_result(void);
+// add bytes transferred by the SD card SPI controller, snoop is CRC_CTRL_SNOOP_RX_BIT and/or
+// CRC_CTRL_SNOOP_TX_BIT as a _BV() mask, or 0 to stop
+void crc_snoop(u32 snoop);
+
+// one shot helper, eg. crc_calc(&crc32_zlib, buf, len)
+u32 crc_calc(const struct crc_config *cfg, const void *buf, size_t len);
+
+#endif // _CRC_H_
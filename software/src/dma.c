@@ -0,0 +1,171 @@
+#include "dma.h"
+#include "printf.h"
+
+/*
+ *  Memory to memory DMA (wb_dma)
+
+    Each burst of up to 16 words takes ~2 cycles per word to read and write with a BRAM at each end,
+    against ~17 cycles per word for a CPU load/store loop, plus ~10 register writes to set up.
+    Word aligned copies only: unaligned heads and tails are done by the CPU.
+ */
+
+u32 dma_cpu_threshold = DMA_CPU_THRESHOLD;
+
+int dma_busy(void){
+    return get_bit(read_u32(DMA_STATUS), DMA_STATUS_BUSY_BIT);
+}
+
+int dma_wait(void){
+    u32 status;
+    do {
+        status = read_u32(DMA_STATUS);
+    } while (get_bit(status, DMA_STATUS_BUSY_BIT));
+    if (get_bit(status, DMA_STATUS_ERR_BIT)){
+        write_u32(DMA_STATUS, _BV(DMA_STATUS_ERR_BIT) | _BV(DMA_STATUS_IRQ_BIT)); // W1C
+        return -1;
+    }
+    return 0;
+}
+
+static void dma_start(u32 dst, u32 src, u32 len, u32 rows, u32 stride, u32 fill, u32 ctrl){
+    dma_wait();
+    write_u32(DMA_SRC, src);
+    write_u32(DMA_DST, dst);
+    write_u32(DMA_LEN, len);
+    write_u32(DMA_ROWS, rows);
+    write_u32(DMA_STRIDE, stride);
+    write_u32(DMA_FILL, fill);
+    write_u32(DMA_NEXT, 0);
+    write_u32(DMA_CTRL, ctrl | _BV(DMA_CTRL_START_BIT));
+}
+
+void dma_copy_async(u32 dst, u32 src, u32 len){
+    dma_start(dst, src, len, 1, 0, 0, 0);
+}
+
+void dma_fill_async(u32 dst, u32 fill, u32 len){
+    dma_start(dst, 0, len, 1, 0, fill, _BV(DMA_CTRL_FILL_BIT));
+}
+
+void dma_copy_2d_async(u32 dst, u32 src, u32 len, u32 rows, u16 dst_stride, u16 src_stride){
+    dma_start(dst, src, len, rows, ((u32)src_stride << 16) | dst_stride, 0, 0);
+}
+
+void dma_fill_2d_async(u32 dst, u32 fill, u32 len, u32 rows, u16 dst_stride){
+    dma_start(dst, 0, len, rows, dst_stride, fill, _BV(DMA_CTRL_FILL_BIT));
+}
+
+void dma_start_chain(struct dma_desc *first){
+    dma_wait();
+    write_u32(DMA_DESC_ADDR, (u32)first);
+}
+
+static void cpu_memcpy(u8 *d, const u8 *s, size_t len){
+    if ((((u32)d | (u32)s) & 0x3) == 0){
+        u32 *dw = (u32 *)d;
+        const u32 *sw = (const u32 *)s;
+        for (; len >= 4; len -= 4){
+            *dw++ = *sw++;
+        }
+        d = (u8 *)dw;
+        s = (const u8 *)sw;
+    }
+    while (len--){
+        *d++ = *s++;
+    }
+}
+
+static void cpu_memset(u8 *d, u32 fill, size_t len){
+    if (((u32)d & 0x3) == 0){
+        u32 *dw = (u32 *)d;
+        for (; len >= 4; len -= 4){
+            *dw++ = fill;
+        }
+        d = (u8 *)dw;
+    }
+    while (len--){
+        *d++ = (u8)fill;
+    }
+}
+
+void *dma_memcpy(void *dst, const void *src, size_t len){
+    u8 *d = dst;
+    const u8 *s = src;
+
+    // the DMA can only copy whole words, so both ends must line up
+    if (!DMA_PRESENT || len < dma_cpu_threshold || len < 8 || (((u32)d ^ (u32)s) & 0x3)){
+        cpu_memcpy(d, s, len);
+        return dst;
+    }
+    // head bytes up to a word boundary
+    while ((u32)d & 0x3){
+        *d++ = *s++;
+        len--;
+    }
+    u32 words = len & ~0x3;
+    dma_copy_async((u32)d, (u32)s, words);
+    // tail bytes while the DMA runs, they don't overlap
+    cpu_memcpy(d + words, s + words, len - words);
+    dma_wait();
+    return dst;
+}
+
+void *dma_memset(void *dst, int c, size_t len){
+    u8 *d = dst;
+    u32 fill = (u8)c;
+    fill |= fill << 8;
+    fill |= fill << 16;
+
+    if (!DMA_PRESENT || len < dma_cpu_threshold || len < 8){
+        cpu_memset(d, fill, len);
+        return dst;
+    }
+    while ((u32)d & 0x3){
+        *d++ = (u8)c;
+        len--;
+    }
+    u32 words = len & ~0x3;
+    dma_fill_async((u32)d, fill, words);
+    cpu_memset(d + words, fill, len - words);
+    dma_wait();
+    return dst;
+}
+
+#define DMA_BENCH_MAX 2048
+
+u32 dma_benchmark(struct timer *timer){
+    static u32 bench_src[DMA_BENCH_MAX / 4];
+    static u32 bench_dst[DMA_BENCH_MAX / 4];
+    u32 crossover = 0;
+
+    timer_stop(timer);
+    timer_set_threshold(timer, 0xFFFFFFFF);
+
+    printf_("DMA benchmark (cycles)\n");
+    printf_("%6s %8s %8s\n", "bytes", "cpu", "dma");
+    for (u32 len = 4; len <= DMA_BENCH_MAX; len <<= 1){
+        // CPU
+        dma_cpu_threshold = 0xFFFFFFFF;
+        timer_set_time(timer, 0);
+        timer_start(timer);
+        dma_memcpy(bench_dst, bench_src, len);
+        timer_stop(timer);
+        u32 cpu_cycles = timer_get_time(timer);
+
+        // DMA, including the setup and completion overhead
+        dma_cpu_threshold = 0;
+        timer_set_time(timer, 0);
+        timer_start(timer);
+        dma_memcpy(bench_dst, bench_src, len);
+        timer_stop(timer);
+        u32 dma_cycles = timer_get_time(timer);
+
+        printf_("%6u %8u %8u\n", len, cpu_cycles, dma_cycles);
+        if (crossover == 0 && dma_cycles < cpu_cycles){
+            crossover = len;
+        }
+    }
+    dma_cpu_threshold = crossover ? crossover : DMA_BENCH_MAX;
+    printf_("DMA used from %u bytes\n", dma_cpu_threshold);
+    return dma_cpu_threshold;
+}
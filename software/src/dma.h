@@ -0,0 +1,81 @@
+#ifndef _DMA_H_
+#define _DMA_H_
+
+#include <stddef.h>
+
+#include "utils.h"
+#include "platform.h"
+#include "timer.h"
+
+// wb_dma registers
+#define DMA_SRC        (PLATFORM_DMA0_BASE + 0x00)
+#define DMA_DST        (PLATFORM_DMA0_BASE + 0x04)
+#define DMA_LEN        (PLATFORM_DMA0_BASE + 0x08) // bytes per row
+#define DMA_ROWS       (PLATFORM_DMA0_BASE + 0x0C)
+#define DMA_STRIDE     (PLATFORM_DMA0_BASE + 0x10) // [31:16] source, [15:0] destination
+#define DMA_FILL       (PLATFORM_DMA0_BASE + 0x14)
+#define DMA_NEXT       (PLATFORM_DMA0_BASE + 0x18)
+#define DMA_CTRL       (PLATFORM_DMA0_BASE + 0x1C)
+#define DMA_STATUS     (PLATFORM_DMA0_BASE + 0x20)
+#define DMA_DESC_ADDR  (PLATFORM_DMA0_BASE + 0x24)
+#define DMA_DONE_COUNT (PLATFORM_DMA0_BASE + 0x28)
+
+#define DMA_CTRL_FILL_BIT 0
+#define DMA_CTRL_IRQ_BIT 1
+#define DMA_CTRL_START_BIT 31
+#define DMA_STATUS_BUSY_BIT 0
+#define DMA_STATUS_IRQ_BIT 1
+#define DMA_STATUS_ERR_BIT 2
+
+// wb_dma is optional (basys3_soc G_INCLUDE_DMA, simple_soc has none) and touching it when it isn't
+// there is a bus error, so dma_memcpy/dma_memset only use it when built with -DPLATFORM_HAS_DMA
+// (PLATFORM_DEFINES in the makefile) and are plain CPU loops otherwise
+#ifdef PLATFORM_HAS_DMA
+#define DMA_PRESENT 1
+#else
+#define DMA_PRESENT 0
+#endif
+
+// Transfers shorter than this (in bytes) are done by the CPU, as setting up the DMA costs more
+// than it saves. Measure it with dma_benchmark()
+#define DMA_CPU_THRESHOLD 64
+
+// Descriptor for chained transfers, same layout as the DMA registers. Must be word aligned
+struct dma_desc
+{
+    u32 src;
+    u32 dst;
+    u32 len;    // bytes per row, multiple of 4
+    u32 rows;   // 0 is treated as 1
+    u32 stride; // [31:16] source, [15:0] destination
+    u32 fill;
+    struct dma_desc *next; // NULL ends the chain
+    u32 ctrl;   // _BV(DMA_CTRL_FILL_BIT), _BV(DMA_CTRL_IRQ_BIT)
+};
+
+// CPU fallback below this size, updated by dma_benchmark()
+extern u32 dma_cpu_threshold;
+
+int dma_busy(void);
+// wait for the DMA to go idle, returns 0 on success or -1 if a transfer failed (clears the error)
+int dma_wait(void);
+
+// drop-in replacements for memcpy/memset. Source and destination must have the same alignment
+// within a word for the DMA to be used, anything else falls back to the CPU
+void *dma_memcpy(void *dst, const void *src, size_t len);
+void *dma_memset(void *dst, int c, size_t len);
+
+// start a transfer without waiting for it to finish. Addresses and len must be word aligned
+void dma_copy_async(u32 dst, u32 src, u32 len);
+void dma_fill_async(u32 dst, u32 fill, u32 len);
+// rows of len bytes, each stride bytes apart (eg. a rectangle in a framebuffer)
+void dma_copy_2d_async(u32 dst, u32 src, u32 len, u32 rows, u16 dst_stride, u16 src_stride);
+void dma_fill_2d_async(u32 dst, u32 fill, u32 len, u32 rows, u16 dst_stride);
+// run a chain of descriptors held in memory
+void dma_start_chain(struct dma_desc *first);
+
+// time CPU and DMA copies of increasing size using `timer`, print a table and set
+// dma_cpu_threshold to the smallest size the DMA wins at. Returns the new threshold
+u32 dma_benchmark(struct timer *timer);
+
+#endif // _DMA_H_
@@ -1,17 +1,18 @@
 #ifndef _GPIO_H_
 #define _GPIO_H_
 
+#include "platform.h"
 
 // 32 bit references
 // IE: get the contents (deference) of this 32 bit memory address
-#define GPIO_LED (*((volatile unsigned long *)0x10000000))
-#define Q_SSEG (*((volatile unsigned long *)0x10000004))
-#define Q_SSEG_LOWER (*((volatile unsigned char *)0x10000004))
-#define Q_SSEG_UPPER (*((volatile unsigned char *)0x10000005))
-#define GPIO_BTN (*((volatile unsigned long *)0x10000100))
-#define GPIO_SW (*((volatile unsigned long *)0x10000104))
-#define GPIO_SOC_FREQ (*((volatile unsigned long *)0x10000108))
-#define GPIO_SOC_MEM (*((volatile unsigned long *)0x1000010C))
+#define GPIO_LED (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x000)))
+#define Q_SSEG (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x004)))
+#define Q_SSEG_LOWER (*((volatile unsigned char *)(PLATFORM_GPIO0_BASE + 0x004)))
+#define Q_SSEG_UPPER (*((volatile unsigned char *)(PLATFORM_GPIO0_BASE + 0x005)))
+#define GPIO_BTN (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x100)))
+#define GPIO_SW (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x104)))
+#define GPIO_SOC_FREQ (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x108)))
+#define GPIO_SOC_MEM (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x10C)))
 
 
 #endif // _GPIO_H_
\ No newline at end of file
@@ -0,0 +1,482 @@
+/*
+ *  Hosted benchmark harness (make hosted)
+
+    Runs the real firmware libraries against the device models and times their hot paths. Each
+    benchmark runs at size n and 4n: anything taking much more than 4x as long has gone
+    superlinear, which is what this is here to catch (absolute times depend on the PC).
+    Results are also checked, so a fast but broken change fails too.
+
+    usage: bench [name filter]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "platform.h"
+#include "utils.h"
+#include "terminal.h"
+#include "console.h"
+#include "timer.h"
+#include "cpu.h"
+#include "text_display.h"
+#include "printf.h"
+#include "ff.h"
+#include "file_stream.h"
+#include "pixel_display.h"
+#include "image_load.h"
+
+#include "hosted_platform.h"
+#include "sd_card_model.h"
+#include "fat_image.h"
+
+#define SCALE 4
+#define SCALE_LIMIT (2 * SCALE) // allowed growth in run time for SCALE times the work
+#define REPEATS 3
+
+#define SD_SECTORS 16384 // 8MB
+#define DATA_BIN_BYTES (256 * 1024)
+#define LINES_TXT_LINES 4096
+#define IMAGE_FILE_BYTES (64 * 1024) // largest test image file
+
+struct bench
+{
+    const char *name;
+    const char *unit;
+    u32 n; // work at the smaller size
+    void (*run)(u32 n);
+    int sd; // needs the SD card image mounted
+};
+
+static int failures;
+
+static void check(int ok, const char *what){
+    if (!ok){
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Number formatting
+ */
+static void bench_u32_to_string(u32 n){
+    static u8 buf[12];
+    u32 val = 1;
+    for (u32 i = 0; i < n; i++){
+        u32_to_string(val, buf, sizeof(buf));
+        val = val * 2654435761u + 1;
+    }
+}
+
+static void bench_u32_to_hstring(u32 n){
+    static u8 buf[11];
+    u32 val = 1;
+    for (u32 i = 0; i < n; i++){
+        u32_to_hstring(val, buf, sizeof(buf));
+        val = val * 2654435761u + 1;
+    }
+}
+
+static void check_number_formatting(void){
+    u8 buf[12];
+    char expected[12];
+    const u32 vals[] = {0, 1, 9, 10, 473589345, 4294967295u};
+    for (unsigned i = 0; i < sizeof(vals) / sizeof(vals[0]); i++){
+        u32_to_string(vals[i], buf, sizeof(buf));
+        snprintf(expected, sizeof(expected), "%11u", vals[i]);
+        check(strcmp((char *)buf, expected) == 0, "u32_to_string");
+    }
+    u8 hbuf[11];
+    u32_to_hstring(0xC0FFEE42, hbuf, sizeof(hbuf));
+    check(memcmp(hbuf, "0xC0FFEE42", 10) == 0, "u32_to_hstring");
+}
+
+/*
+ * Terminal and console
+ */
+static void bench_terminal_write(u32 n){
+    static t_terminal *t;
+    if (!t){
+        t = terminal_create(TEXT_W, TEXT_H);
+        terminal_clear(t);
+    }
+    const char *text = "The quick brown fox jumps over the lazy dog. ";
+    u32 len = strlen(text);
+    for (u32 i = 0; i < n; i += len){
+        terminal_write_string(t, (char *)text);
+    }
+}
+
+// console lines with putchar_, each newline copies the terminal to the text display
+static void bench_console_putchar(u32 n){
+    const char *line = "console flush benchmark line\n";
+    for (u32 i = 0; i < n; i++){
+        for (const char *c = line; *c; c++){
+            putchar_(*c);
+        }
+    }
+}
+
+static void bench_console_printf(u32 n){
+    for (u32 i = 0; i < n; i++){
+        printf_("%d\n", i);
+    }
+}
+
+// the same, with the screen refreshed once per screenful instead of once per line
+static void bench_console_printf_batched(u32 n){
+    console_set_flush(CONSOLE_FLUSH_EXPLICIT, NULL, 0);
+    for (u32 i = 0; i < n; i++){
+        printf_("%d\n", i);
+        if (i % TEXT_H == TEXT_H - 1){
+            console_flush();
+        }
+    }
+    console_set_flush(CONSOLE_FLUSH_LINE, NULL, 0);
+}
+
+static void bench_text_refresh(u32 n){
+    t_terminal *t = console_init();
+    for (u32 i = 0; i < n; i++){
+        text_refresh_from_terminal(t);
+    }
+}
+
+// row of the text display as a string
+static void text_row(int row, char *buf){
+    volatile unsigned long *cells = (volatile unsigned long *)PLATFORM_TEXT_DISPLAY0_BASE;
+    for (int x = 0; x < TEXT_W; x++){
+        char c = cells[row * TEXT_W + x] & 0xFF;
+        buf[x] = c ? c : ' ';
+    }
+    buf[TEXT_W] = '\0';
+}
+
+static int text_find(const char *s){
+    char row[TEXT_W + 1];
+    for (int y = 0; y < TEXT_H; y++){
+        text_row(y, row);
+        if (strstr(row, s)){
+            return y;
+        }
+    }
+    return -1;
+}
+
+static void check_console(void){
+    t_terminal *t = console_init();
+    cls();
+    printf_("first line\n");
+    printf_("value %d 0x%x\n", 1234, 0xBEEF);
+    int first = text_find("first line");
+    int second = text_find("value 1234 0xbeef");
+    check(first >= 0 && second == first + 1, "console output reaches the text display");
+
+    // nothing reaches the screen until the flush
+    console_set_flush(CONSOLE_FLUSH_EXPLICIT, NULL, 0);
+    printf_("held back\n");
+    check(text_find("held back") < 0, "CONSOLE_FLUSH_EXPLICIT waits for console_flush()");
+    console_flush();
+    check(text_find("held back") == text_find("value 1234 0xbeef") + 1, "console_flush()");
+    console_write("put ", 4);
+    console_put_s32(-42);
+    console_write(" ", 1);
+    console_put_hex(0xBEEF, 0);
+    console_write("\n", 1);
+    console_flush();
+    check(text_find("put -42 0xbeef") >= 0, "console_put_s32, console_put_hex");
+
+    // mtime is plain memory in the hosted build, so time only passes when it is written
+    static struct timer timer;
+    timer_init(&timer, (volatile void *)PLATFORM_TIMER0_BASE);
+    timer_set_mtime(&timer, 0);
+    console_set_flush(CONSOLE_FLUSH_TIMED, &timer, 10);
+    printf_("after 10ms\n");
+    console_poll();
+    check(text_find("after 10ms") < 0, "CONSOLE_FLUSH_TIMED waits");
+    timer_set_mtime(&timer, 10 * (REFCLK / 1000));
+    console_poll();
+    check(text_find("after 10ms") >= 0, "CONSOLE_FLUSH_TIMED refreshes once the time is up");
+    console_set_flush(CONSOLE_FLUSH_LINE, NULL, 0);
+
+    // per-line updates skip rows and stop short, but end up the same as a full refresh
+    static const char dots[] = "................................................................";
+    printf_("a longer line that gets overwritten\rshort\n");
+    for (int i = 0; i < TEXT_H + 3; i++){
+        console_write(dots, (i * 23) % (sizeof(dots) - 1));
+        printf_("%d\n", i);
+    }
+    volatile unsigned long *cells = (volatile unsigned long *)PLATFORM_TEXT_DISPLAY0_BASE;
+    int same = 1;
+    for (int y = 0; y < TEXT_H; y++){
+        const char *src = &t->buf[((t->line_at_top + y) % TEXT_H) * TEXT_W];
+        for (int x = 0; x < TEXT_W; x++){
+            same &= (cells[y * TEXT_W + x] & 0xFF) == (u8)src[x];
+        }
+    }
+    check(same, "text_update_from_terminal leaves the screen matching the terminal");
+
+    // spans end up the same as a char at a time: wrapping, \r, \n and a NUL
+    static t_terminal *a, *b;
+    if (!a){
+        a = terminal_create(TEXT_W, TEXT_H);
+        b = terminal_create(TEXT_W, TEXT_H);
+    }
+    terminal_clear(a);
+    terminal_clear(b);
+    char text[3 * TEXT_W];
+    memset(text, 'x', sizeof(text));
+    memcpy(text, "ab\rc\n", 5);
+    text[TEXT_W + 7] = '\0';
+    text[2 * TEXT_W + 1] = '\n';
+    for (u32 i = 0; i < sizeof(text); i++){
+        terminal_write_char(a, text[i]);
+    }
+    terminal_write_span(b, text, 17);
+    terminal_write_span(b, &text[17], sizeof(text) - 17);
+    check(memcmp(a->buf, b->buf, TEXT_W * TEXT_H) == 0 && a->x == b->x && a->y == b->y &&
+          a->line_at_top == b->line_at_top, "terminal_write_span");
+}
+
+/*
+ * SD card (mmc.c) and FatFs
+ */
+static FATFS fs;
+static FIL file;
+static u8 file_buf[DATA_BIN_BYTES];
+static u8 *data_bin;
+
+static void bench_f_read(u32 n){
+    UINT got;
+    f_open(&file, "DATA.BIN", FA_READ);
+    f_read(&file, file_buf, n * 1024, &got);
+    f_close(&file);
+    check(got == n * 1024 && memcmp(file_buf, data_bin, got) == 0, "f_read data");
+}
+
+static void bench_file_stream(u32 n){
+    static struct file_stream stream;
+    u32 got;
+    f_open(&file, "DATA.BIN", FA_READ);
+    file_stream_open(&stream, &file);
+    file_stream_read(&stream, file_buf, n * 2, &got);
+    f_close(&file);
+    check(got == n * 1024 && memcmp(file_buf, data_bin, got) == 0, "file_stream data");
+}
+
+static void bench_f_gets(u32 n){
+    static char line[64];
+    char expected[64];
+    f_open(&file, "LINES.TXT", FA_READ);
+    for (u32 i = 0; i < n; i++){
+        if (!f_gets(line, sizeof(line), &file)){
+            check(0, "f_gets hit EOF early");
+            break;
+        }
+        if (i == n - 1){
+            snprintf(expected, sizeof(expected), "line %u of the text file\n", i);
+            check(strcmp(line, expected) == 0, "f_gets data");
+        }
+    }
+    f_close(&file);
+}
+
+/*
+ * Images from the SD card (image_load.c) into the framebuffer
+ */
+static u32 test_pixel(u32 x, u32 y){
+    return (((x * 7 + y * 13) & 0xFF) << 16) | (((x * 3) & 0xFF) << 8) | ((y * 5) & 0xFF);
+}
+
+static void put_u32(u8 *p, u32 val){
+    for (int i = 0; i < 4; i++){
+        p[i] = val >> (8 * i);
+    }
+}
+
+// w*h BMP of test_pixel() at 24 or 32 bpp, stored bottom line first unless top_down. Returns the file size
+static u32 make_bmp(u8 *buf, u32 w, u32 h, u32 bpp, int top_down){
+    u32 offset = bpp == 32 ? 56 : BMP_HEADER_BYTES; // 32bpp pixel data has to be word aligned
+    u32 stride = bpp == 32 ? w * 4 : (w * 3 + 3) & ~3;
+    u32 size = offset + h * stride;
+    memset(buf, 0, size);
+    buf[0] = 'B';
+    buf[1] = 'M';
+    put_u32(&buf[2], size);
+    put_u32(&buf[10], offset);
+    put_u32(&buf[14], 40); // BITMAPINFOHEADER
+    put_u32(&buf[18], w);
+    put_u32(&buf[22], top_down ? -(s32)h : (s32)h);
+    buf[26] = 1; // planes
+    buf[28] = bpp;
+    for (u32 y = 0; y < h; y++){
+        u8 *p = &buf[offset + (top_down ? y : h - 1 - y) * stride];
+        for (u32 x = 0; x < w; x++, p += bpp / 8){
+            u32 c = test_pixel(x, y);
+            p[0] = c;
+            p[1] = c >> 8;
+            p[2] = c >> 16;
+        }
+    }
+    return size;
+}
+
+// w*h xRGB of test_pixel(), lines stride bytes apart
+static u32 make_raw(u8 *buf, u32 w, u32 h, u32 stride){
+    memset(buf, 0, h * stride);
+    for (u32 y = 0; y < h; y++){
+        for (u32 x = 0; x < w; x++){
+            put_u32(&buf[y * stride + x * 4], test_pixel(x, y));
+        }
+    }
+    return h * stride;
+}
+
+static int image_add_files(struct fat_image *img){
+    u8 *buf = malloc(IMAGE_FILE_BYTES);
+    int err = fat_image_add_file(img, "IMG24.BMP", buf, make_bmp(buf, 199, 60, 24, 0)) ||
+              fat_image_add_file(img, "IMG32.BMP", buf, make_bmp(buf, 16, 9, 32, 1)) ||
+              fat_image_add_file(img, "LINES.RAW", buf, make_raw(buf, 640, 8, 4096)) ||
+              fat_image_add_file(img, "RECT.RAW", buf, make_raw(buf, 20, 6, 128));
+    free(buf);
+    return err;
+}
+
+// the back buffer has test_pixel() in the w*h rectangle at x, y
+static int image_shown(u32 x, u32 y, u32 w, u32 h){
+    for (u32 j = 0; j < h; j++){
+        for (u32 i = 0; i < w; i++){
+            if ((read_u32(pixel_address_calc(x + i, y + j)) & 0xFFFFFF) != test_pixel(i, j)){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static FRESULT image_load(const char *name, u32 x, u32 y, u32 raw_w, u32 raw_h, u32 raw_stride){
+    FRESULT res = f_open(&file, name, FA_READ);
+    if (res == FR_OK){
+        res = raw_w ? image_load_raw(&file, x, y, raw_w, raw_h, raw_stride) : image_load_bmp(&file, x, y);
+        f_close(&file);
+    }
+    return res;
+}
+
+static void check_image_load(void){
+    pixel_display_init();
+    blit_fill(0, 0, pixels_x, pixels_y, COL_BLACK);
+    check(image_load("IMG24.BMP", 5, 3, 0, 0, 0) == FR_OK && image_shown(5, 3, 199, 60),
+          "image_load_bmp 24bpp, bottom up with padded lines, over several batches");
+    check(image_load("IMG32.BMP", 100, 50, 0, 0, 0) == FR_OK && image_shown(100, 50, 16, 9),
+          "image_load_bmp 32bpp, top down");
+    check(image_load("LINES.RAW", 0, 200, 640, 8, 4096) == FR_OK && image_shown(0, 200, 640, 8),
+          "image_load_raw straight into the back buffer");
+    check(image_load("RECT.RAW", 300, 300, 20, 6, 128) == FR_OK && image_shown(300, 300, 20, 6),
+          "image_load_raw through the staging area");
+    check(read_u32(pixel_address_calc(4, 3)) == COL_BLACK && read_u32(pixel_address_calc(204, 3)) == COL_BLACK &&
+          read_u32(pixel_address_calc(5, 63)) == COL_BLACK, "image_load_bmp stays inside its rectangle");
+    check(image_load("IMG24.BMP", 500, 0, 0, 0, 0) == FR_INVALID_PARAMETER, "image_load_bmp rejects an image that doesn't fit");
+    check(image_load("LINES.TXT", 0, 0, 0, 0, 0) == FR_INVALID_PARAMETER, "image_load_bmp rejects a file that isn't a BMP");
+}
+
+static int setup_sd_card(void){
+    static struct sd_card card;
+    static struct fat_image img;
+    u8 *image = malloc(SD_SECTORS * 512);
+    data_bin = malloc(DATA_BIN_BYTES);
+    for (u32 i = 0; i < DATA_BIN_BYTES; i++){
+        data_bin[i] = i * 7 + (i >> 9);
+    }
+    char *lines = malloc(LINES_TXT_LINES * 32);
+    u32 lines_len = 0;
+    for (u32 i = 0; i < LINES_TXT_LINES; i++){
+        lines_len += sprintf(&lines[lines_len], "line %u of the text file\n", i);
+    }
+
+    if (fat_image_format(&img, image, SD_SECTORS, 1) ||
+        fat_image_add_file(&img, "DATA.BIN", data_bin, DATA_BIN_BYTES) ||
+        fat_image_add_file(&img, "LINES.TXT", lines, lines_len) || image_add_files(&img)){
+        return -1;
+    }
+    free(lines);
+    sd_card_init(&card, image, SD_SECTORS);
+    sd_card_attach(&card);
+    return f_mount(&fs, "", 1);
+}
+
+/*
+ * Runner
+ */
+static const struct bench benches[] = {
+    {"u32_to_string", "call", 20000, bench_u32_to_string},
+    {"u32_to_hstring", "call", 20000, bench_u32_to_hstring},
+    {"terminal_write_string", "char", 20000, bench_terminal_write},
+    {"text_refresh", "refresh", 50, bench_text_refresh},
+    {"console putchar_", "line", 50, bench_console_putchar},
+    {"console printf_(\"%d\\n\")", "line", 50, bench_console_printf},
+    {"console printf_ batched", "line", 50, bench_console_printf_batched},
+    {"f_read DATA.BIN", "KB", 16, bench_f_read, 1},
+    {"file_stream DATA.BIN", "KB", 16, bench_file_stream, 1},
+    {"f_gets LINES.TXT", "line", 256, bench_f_gets, 1},
+};
+
+// best of REPEATS, in ns
+static double time_run(const struct bench *b, u32 n, u64 *bus_ops){
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++){
+        u64 ops = hosted_bus_reads + hosted_bus_writes;
+        double start = now_ns();
+        b->run(n);
+        double t = now_ns() - start;
+        if (r == 0 || t < best){
+            best = t;
+        }
+        *bus_ops = hosted_bus_reads + hosted_bus_writes - ops;
+    }
+    return best;
+}
+
+int main(int argc, char **argv){
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    hosted_init();
+    console_init();
+    cls();
+
+    check_number_formatting();
+    check_console();
+    int fr = setup_sd_card();
+    check(fr == FR_OK, "mount the SD card image");
+    if (fr == FR_OK){
+        check_image_load();
+    }
+
+    printf("%-26s %12s %12s %8s\n", "benchmark", "ns/unit", "bus ops/unit", "scaling");
+    for (unsigned i = 0; i < sizeof(benches) / sizeof(benches[0]); i++){
+        const struct bench *b = &benches[i];
+        if (!strstr(b->name, filter) || (b->sd && fr != FR_OK)){
+            continue;
+        }
+        u64 ops_small, ops_large;
+        double small = time_run(b, b->n, &ops_small);
+        double large = time_run(b, b->n * SCALE, &ops_large);
+        double scaling = large / small;
+        printf("%-26s %12.1f %12.1f %7.2fx  (per %s, n=%u)\n", b->name, large / (b->n * SCALE),
+               (double)ops_large / (b->n * SCALE), scaling, b->unit, b->n * SCALE);
+        if (scaling > SCALE_LIMIT){
+            printf("FAIL: %s takes %.1fx as long for %dx the work\n", b->name, scaling, SCALE);
+            failures++;
+        }
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+#include "fat_image.h"
+
+#include <string.h>
+
+#define SECTOR 512
+#define RESERVED_SECTORS 1
+#define NUM_FATS 2
+#define ROOT_ENTRIES 512
+#define ROOT_SECTORS (ROOT_ENTRIES * 32 / SECTOR)
+
+static void put_u16(u8 *p, u16 val){
+    p[0] = val;
+    p[1] = val >> 8;
+}
+
+static void put_u32(u8 *p, u32 val){
+    put_u16(p, val);
+    put_u16(p + 2, val >> 16);
+}
+
+static void set_fat(struct fat_image *img, u32 cluster, u16 val){
+    for (int f = 0; f < NUM_FATS; f++){
+        put_u16(&img->data[(img->fat_start + f * img->fat_sectors) * SECTOR + cluster * 2], val);
+    }
+}
+
+int fat_image_format(struct fat_image *img, u8 *data, u32 sectors, u32 sectors_per_cluster){
+    memset(img, 0, sizeof(*img));
+    img->data = data;
+    img->sectors = sectors;
+    img->sectors_per_cluster = sectors_per_cluster;
+
+    // the FAT has to cover the clusters left over once it is allocated
+    u32 fat_sectors = 1;
+    u32 clusters;
+    while (1){
+        clusters = (sectors - RESERVED_SECTORS - NUM_FATS * fat_sectors - ROOT_SECTORS) / sectors_per_cluster;
+        u32 needed = ((clusters + 2) * 2 + SECTOR - 1) / SECTOR;
+        if (needed <= fat_sectors){
+            break;
+        }
+        fat_sectors = needed;
+    }
+    if (clusters < 4086 || clusters > 65524){
+        return -1;
+    }
+    img->fat_start = RESERVED_SECTORS;
+    img->fat_sectors = fat_sectors;
+    img->root_start = img->fat_start + NUM_FATS * fat_sectors;
+    img->data_start = img->root_start + ROOT_SECTORS;
+    img->clusters = clusters;
+    img->next_cluster = 2;
+
+    memset(data, 0, img->data_start * SECTOR);
+    u8 *bs = data;
+    bs[0] = 0xEB; bs[1] = 0x3C; bs[2] = 0x90;
+    memcpy(&bs[3], "MSDOS5.0", 8);
+    put_u16(&bs[11], SECTOR);
+    bs[13] = sectors_per_cluster;
+    put_u16(&bs[14], RESERVED_SECTORS);
+    bs[16] = NUM_FATS;
+    put_u16(&bs[17], ROOT_ENTRIES);
+    if (sectors < 0x10000){
+        put_u16(&bs[19], sectors);
+    } else {
+        put_u32(&bs[32], sectors);
+    }
+    bs[21] = 0xF8; // fixed disk
+    put_u16(&bs[22], fat_sectors);
+    put_u16(&bs[24], 63);
+    put_u16(&bs[26], 255);
+    bs[36] = 0x80;
+    bs[38] = 0x29;
+    put_u32(&bs[39], 0x46504341); // volume serial
+    memcpy(&bs[43], "NO NAME    ", 11);
+    memcpy(&bs[54], "FAT16   ", 8);
+    bs[510] = 0x55;
+    bs[511] = 0xAA;
+
+    set_fat(img, 0, 0xFFF8);
+    set_fat(img, 1, 0xFFFF);
+    return 0;
+}
+
+int fat_image_add_file(struct fat_image *img, const char *name, const void *contents, u32 len){
+    u32 cluster_bytes = img->sectors_per_cluster * SECTOR;
+    u32 n = (len + cluster_bytes - 1) / cluster_bytes;
+    if (img->root_entries >= ROOT_ENTRIES || img->next_cluster + n > img->clusters + 2){
+        return -1;
+    }
+
+    // 8.3 name, space padded
+    u8 *entry = &img->data[img->root_start * SECTOR + img->root_entries * 32];
+    memset(entry, ' ', 11);
+    const char *dot = strchr(name, '.');
+    for (int i = 0; i < 8 && name[i] && &name[i] != dot; i++){
+        entry[i] = (name[i] >= 'a' && name[i] <= 'z') ? name[i] - 32 : name[i];
+    }
+    for (int i = 0; dot && i < 3 && dot[1 + i]; i++){
+        entry[8 + i] = (dot[1 + i] >= 'a' && dot[1 + i] <= 'z') ? dot[1 + i] - 32 : dot[1 + i];
+    }
+    entry[11] = 0x20; // archive
+    put_u16(&entry[24], ((2022 - 1980) << 9) | (1 << 5) | 1); // 2022-01-01, as FF_NORTC_*
+    put_u16(&entry[26], n ? img->next_cluster : 0);
+    put_u32(&entry[28], len);
+    img->root_entries++;
+
+    for (u32 i = 0; i < n; i++){
+        u32 c = img->next_cluster + i;
+        set_fat(img, c, i == n - 1 ? 0xFFFF : c + 1);
+    }
+    u8 *dst = &img->data[(img->data_start + (img->next_cluster - 2) * img->sectors_per_cluster) * SECTOR];
+    memcpy(dst, contents, len);
+    memset(dst + len, 0, n * cluster_bytes - len);
+    img->next_cluster += n;
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef _FAT_IMAGE_H_
+#define _FAT_IMAGE_H_
+/*
+ *  Builds a FAT16 volume (no partition table) in memory, for the SD card model
+
+    Files go in the root directory, each in contiguous clusters.
+ */
+
+#include "utils.h"
+
+struct fat_image
+{
+    u8 *data;
+    u32 sectors;
+    u32 sectors_per_cluster;
+    u32 fat_start;
+    u32 fat_sectors;
+    u32 root_start;
+    u32 data_start;
+    u32 clusters;
+    u32 next_cluster;
+    u32 root_entries;
+};
+
+// format `sectors` * 512 bytes at data. Returns 0, or -1 if that gives too few or too many
+// clusters for FAT16 (4086 to 65524)
+int fat_image_format(struct fat_image *img, u8 *data, u32 sectors, u32 sectors_per_cluster);
+// add a file to the root directory, name is 8.3 (eg "DATA.BIN"). Returns 0, or -1 if full
+int fat_image_add_file(struct fat_image *img, const char *name, const void *contents, u32 len);
+
+#endif // _FAT_IMAGE_H_
@@ -0,0 +1,264 @@
+/*
+ *  Number formatting benchmark (make fmt_bench)
+
+    numfmt against the divide-per-digit code it replaced, built at -O0 and -O2. The PC divides
+    in hardware, so the old code is also run with its / and % going through a shift-and-subtract
+    divide like libgcc's __udivsi3/__umodsi3, which is what RV32I runs. Times are in TSC cycles
+    per call: the ratios are what carry over to the target, not the absolute numbers.
+
+    Results are checked against snprintf first.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "utils.h"
+#include "numfmt.h"
+
+#define CALLS 200000
+#define REPEATS 5
+
+static int failures;
+
+static void check(int ok, const char *what){
+    if (!ok){
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/*
+ * The old code, from utils.c
+ */
+// libgcc's RV32I division: one shift and compare per quotient bit
+static u32 soft_udivmod(u32 num, u32 den, u32 *rem){
+    u32 bit = 1;
+    u32 quot = 0;
+    while (den < num && bit && !(den & 0x80000000)){
+        den <<= 1;
+        bit <<= 1;
+    }
+    while (bit){
+        if (num >= den){
+            num -= den;
+            quot |= bit;
+        }
+        bit >>= 1;
+        den >>= 1;
+    }
+    *rem = num;
+    return quot;
+}
+
+static u32 __attribute__((noinline)) soft_udiv(u32 a, u32 b){
+    u32 rem;
+    return soft_udivmod(a, b, &rem);
+}
+
+static u32 __attribute__((noinline)) soft_umod(u32 a, u32 b){
+    u32 rem;
+    soft_udivmod(a, b, &rem);
+    return rem;
+}
+
+static void old_u32_to_string(u32 data, u8 *buf, u8 buf_len){
+    u32 digit_pos = 0;
+    for (u32 i = 0; i < buf_len; i++){
+        buf[i] = ' ';
+    }
+    buf[buf_len - 1] = '\0';
+    while (data != 0 && digit_pos < buf_len - 1u){
+        buf[buf_len - 2 - digit_pos] = (data % 10) + 48;
+        data = data / 10;
+        digit_pos++;
+    }
+}
+
+static void old_u32_to_string_rv32i(u32 data, u8 *buf, u8 buf_len){
+    u32 digit_pos = 0;
+    for (u32 i = 0; i < buf_len; i++){
+        buf[i] = ' ';
+    }
+    buf[buf_len - 1] = '\0';
+    while (data != 0 && digit_pos < buf_len - 1u){
+        buf[buf_len - 2 - digit_pos] = soft_umod(data, 10) + 48;
+        data = soft_udiv(data, 10);
+        digit_pos++;
+    }
+}
+
+static char old_nibble_to_hex_char(u8 nibble){
+    nibble = nibble & 0xF;
+    if (nibble > 9){
+        return nibble + 55;
+    }
+    return nibble + 48;
+}
+
+static void old_u32_to_hstring(u32 data, u8 *buf, u8 buf_len){
+    u8 i;
+    for (i = 0; i < buf_len - 1; i++){
+        buf[i] = '\0';
+    }
+    buf[0] = '0';
+    buf[1] = 'x';
+    const u8 start = 2;
+    const u8 chars = 8;
+    for (i = 0; i < chars; i++){
+        u32 mask = 0xF << (i * 4);
+        u8 nibble = (data & mask) >> (i * 4);
+        buf[start + chars - 1 - i] = old_nibble_to_hex_char(nibble);
+    }
+}
+
+/*
+ * Benchmarks, each formats CALLS values
+ */
+static u8 out[16];
+
+static u32 next_val(u32 val){
+    return val * 2654435761u + 1; // all magnitudes, mostly 9 and 10 digits
+}
+
+static void run_old_dec(void){
+    u32 val = 1;
+    for (u32 i = 0; i < CALLS; i++, val = next_val(val)){
+        old_u32_to_string(val, out, 12);
+    }
+}
+
+static void run_old_dec_rv32i(void){
+    u32 val = 1;
+    for (u32 i = 0; i < CALLS; i++, val = next_val(val)){
+        old_u32_to_string_rv32i(val, out, 12);
+    }
+}
+
+static void run_new_dec(void){
+    u32 val = 1;
+    for (u32 i = 0; i < CALLS; i++, val = next_val(val)){
+        u32_to_string(val, out, 12);
+    }
+}
+
+static void run_fmt_u32(void){
+    u32 val = 1;
+    for (u32 i = 0; i < CALLS; i++, val = next_val(val)){
+        fmt_u32((char *)out, val);
+    }
+}
+
+static void run_small_old_rv32i(void){
+    for (u32 i = 0; i < CALLS; i++){
+        old_u32_to_string_rv32i(i & 0x3FF, out, 12);
+    }
+}
+
+static void run_small_fmt_u32(void){
+    for (u32 i = 0; i < CALLS; i++){
+        fmt_u32((char *)out, i & 0x3FF);
+    }
+}
+
+static void run_old_hex(void){
+    u32 val = 1;
+    for (u32 i = 0; i < CALLS; i++, val = next_val(val)){
+        old_u32_to_hstring(val, out, 11);
+    }
+}
+
+static void run_new_hex(void){
+    u32 val = 1;
+    for (u32 i = 0; i < CALLS; i++, val = next_val(val)){
+        u32_to_hstring(val, out, 11);
+    }
+}
+
+struct bench
+{
+    const char *name;
+    void (*run)(void);
+};
+
+static const struct bench benches[] = {
+    {"u32_to_string, old", run_old_dec},
+    {"u32_to_string, old, RV32I div", run_old_dec_rv32i},
+    {"u32_to_string", run_new_dec},
+    {"fmt_u32", run_fmt_u32},
+    {"0-1023, old, RV32I div", run_small_old_rv32i},
+    {"0-1023, fmt_u32", run_small_fmt_u32},
+    {"u32_to_hstring, old", run_old_hex},
+    {"u32_to_hstring", run_new_hex},
+};
+
+// best of REPEATS, in TSC cycles per call
+static double cycles(const struct bench *b){
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++){
+        u64 start = __rdtsc();
+        b->run();
+        double t = (double)(__rdtsc() - start) / CALLS;
+        if (r == 0 || t < best){
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void check_formatting(void){
+    char buf[32];
+    char expected[32];
+    const u32 vals[] = {0, 1, 9, 10, 99, 100, 473589345, 999999999, 1000000000, 4294967295u};
+    for (unsigned i = 0; i < sizeof(vals) / sizeof(vals[0]); i++){
+        u32 n = fmt_u32(buf, vals[i]);
+        snprintf(expected, sizeof(expected), "%u", vals[i]);
+        check(n == strlen(expected) && memcmp(buf, expected, n) == 0, "fmt_u32");
+
+        u32_to_string(vals[i], (u8 *)buf, 12);
+        snprintf(expected, sizeof(expected), "%11u", vals[i]);
+        check(strcmp(buf, expected) == 0, "u32_to_string");
+
+        n = fmt_hex(buf, vals[i], 0, 0);
+        snprintf(expected, sizeof(expected), "%x", vals[i]);
+        check(n == strlen(expected) && memcmp(buf, expected, n) == 0, "fmt_hex");
+
+        u32_to_hstring(vals[i], (u8 *)buf, 11);
+        snprintf(expected, sizeof(expected), "0x%08X", vals[i]);
+        check(strcmp(buf, expected) == 0, "u32_to_hstring");
+    }
+    const s32 svals[] = {0, -1, 42, -2147483647 - 1, 2147483647};
+    for (unsigned i = 0; i < sizeof(svals) / sizeof(svals[0]); i++){
+        u32 n = fmt_s32(buf, svals[i]);
+        snprintf(expected, sizeof(expected), "%d", (int)svals[i]);
+        check(n == strlen(expected) && memcmp(buf, expected, n) == 0, "fmt_s32");
+    }
+    u32 n = fmt_u32_width(buf, 42, 6, '0');
+    check(n == 6 && memcmp(buf, "000042", 6) == 0, "fmt_u32_width");
+    n = fmt_hex(buf, 0x12345, 4, 1);
+    check(n == 4 && memcmp(buf, "2345", 4) == 0, "fmt_hex with fewer digits");
+
+    // divu10 over the edges of every decade, and a spread of the rest
+    for (u32 p = 1; p <= 1000000000; p *= 10){
+        for (u32 v = p - 20; v != p + 20; v++){
+            u32 rem;
+            check(divu10(v, &rem) == v / 10 && rem == v % 10, "divu10");
+        }
+    }
+    for (u32 i = 0, v = 1; i < 1000000; i++, v = next_val(v)){
+        u32 rem;
+        if (divu10(v, &rem) != v / 10 || rem != v % 10){
+            check(0, "divu10");
+            break;
+        }
+    }
+}
+
+int main(void){
+    check_formatting();
+    printf("%-32s %14s\n", "number formatting (" OPT ")", "cycles/call");
+    for (unsigned i = 0; i < sizeof(benches) / sizeof(benches[0]); i++){
+        printf("%-32s %14.1f\n", benches[i].name, cycles(&benches[i]));
+    }
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
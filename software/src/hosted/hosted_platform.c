@@ -0,0 +1,678 @@
+#include "hosted_platform.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "platform.h"
+#include "utils.h"
+#include "gpio.h"
+#include "dma.h"
+#include "crc.h"
+#include "sd_host.h"
+#include "pixel_display.h"
+
+/*
+ *  Hosted platform layer: the bus, plus models of the peripherals that need to act on an access
+
+    DMA:    transfers (and descriptor chains) complete as soon as they are started
+    CRC:    bit-serial version of wb_crc, including snooping the SD SPI controller
+    SD SPI: wb_spi, exchanging bytes with the attached hosted_spi_device
+    SD host: wb_sd_host, a block at a time with the attached hosted_sd_device. Data moves as soon
+            as the FIFO and DMA allow, so the busy bits are never seen set
+    Blitter: axi3_blitter, each command completes when CMD is written. GLYPH has no font, so
+            only counts
+ */
+
+uint8_t hosted_bus[PLATFORM_HOSTED_WINDOWS * HOSTED_WINDOW_SIZE] __attribute__((aligned(HOSTED_WINDOW_SIZE)));
+uint8_t hosted_ddr[HOSTED_DDR_SIZE] __attribute__((aligned(4096)));
+
+uint64_t hosted_bus_reads;
+uint64_t hosted_bus_writes;
+uint64_t hosted_spi_bytes;
+uint64_t hosted_spi_clocks;
+uint64_t hosted_sd_clocks;
+
+#define WINDOW(base) (((base) - HOSTED_WINDOW_BASE(0)) / HOSTED_WINDOW_SIZE)
+
+struct hosted_model
+{
+    u32 (*read)(u32 offset, int bytes);
+    void (*write)(u32 offset, u32 data, int bytes);
+};
+
+static const struct hosted_model *models[PLATFORM_HOSTED_WINDOWS];
+
+// from the linker, the first byte of the binary
+extern char __executable_start;
+
+void *hosted_ptr(u32 addr){
+    if (addr < (uintptr_t)&__executable_start || addr >= (uintptr_t)sbrk(0)){
+        fprintf(stderr, "hosted: address 0x%08x is not host addressable, keep buffers used by "
+                        "device models static or on the heap\n", addr);
+        abort();
+    }
+    return (void *)(uintptr_t)addr;
+}
+
+/*
+ * wb_crc
+ */
+static struct
+{
+    u32 ctrl;
+    u32 poly;
+    u32 init;
+    u32 xor_out;
+    u32 crc;
+    u32 count;
+} crc;
+
+static u32 crc_mask(void){
+    u32 width = crc.ctrl & CRC_CTRL_WIDTH_MASK;
+    return (width == 0 || width >= 32) ? 0xFFFFFFFF : ((u32)1 << width) - 1;
+}
+
+static u32 reverse_bits(u32 val, int bits){
+    u32 r = 0;
+    for (int i = 0; i < bits; i++){
+        r = (r << 1) | ((val >> i) & 1);
+    }
+    return r;
+}
+
+static void crc_add_byte(u8 b){
+    u32 mask = crc_mask();
+    u32 top = (mask >> 1) + 1; // MSB of the CRC
+    if (get_bit(crc.ctrl, CRC_CTRL_REFLECT_IN_BIT)){
+        b = reverse_bits(b, 8);
+    }
+    for (int i = 7; i >= 0; i--){
+        u32 feedback = ((crc.crc & top) != 0) ^ ((b >> i) & 1);
+        crc.crc = (crc.crc << 1) & mask;
+        if (feedback){
+            crc.crc ^= crc.poly & mask;
+        }
+    }
+    crc.count++;
+}
+
+static u32 crc_model_result(void){
+    u32 mask = crc_mask();
+    u32 r = crc.crc;
+    if (get_bit(crc.ctrl, CRC_CTRL_REFLECT_OUT_BIT)){
+        r = reverse_bits(r, __builtin_popcount(mask));
+    }
+    return (r ^ crc.xor_out) & mask;
+}
+
+static void crc_model_restart(void){
+    crc.crc = crc.init & crc_mask();
+    crc.count = 0;
+}
+
+static u32 crc_model_read(u32 offset, int bytes){
+    switch (offset & ~0x3){
+    case CRC_DATA - PLATFORM_CRC0_BASE:
+    case CRC_RESULT - PLATFORM_CRC0_BASE: return crc_model_result();
+    case CRC_CTRL - PLATFORM_CRC0_BASE: return crc.ctrl;
+    case CRC_POLY - PLATFORM_CRC0_BASE: return crc.poly;
+    case CRC_INIT - PLATFORM_CRC0_BASE: return crc.init;
+    case CRC_XOR_OUT - PLATFORM_CRC0_BASE: return crc.xor_out;
+    case CRC_COUNT - PLATFORM_CRC0_BASE: return crc.count;
+    }
+    return 0;
+}
+
+static void crc_model_write(u32 offset, u32 data, int bytes){
+    switch (offset & ~0x3){
+    case CRC_DATA - PLATFORM_CRC0_BASE:
+        // byte lanes in address order, so a word is processed in memory order
+        for (int i = 0; i < bytes; i++){
+            crc_add_byte(data >> (8 * i));
+        }
+        break;
+    case CRC_CTRL - PLATFORM_CRC0_BASE: crc.ctrl = data; break;
+    case CRC_POLY - PLATFORM_CRC0_BASE: crc.poly = data; break;
+    case CRC_INIT - PLATFORM_CRC0_BASE: crc.init = data; crc_model_restart(); break;
+    case CRC_XOR_OUT - PLATFORM_CRC0_BASE: crc.xor_out = data; break;
+    case CRC_RESULT - PLATFORM_CRC0_BASE: crc_model_restart(); break;
+    }
+}
+
+static const struct hosted_model crc_model = {crc_model_read, crc_model_write};
+
+/*
+ * wb_dma
+ */
+#define DMA_REG(addr) (((addr) - PLATFORM_DMA0_BASE) / 4)
+#define DMA_NUM_REGS 11 // up to DMA_DONE_COUNT
+
+static u32 dma_regs[DMA_NUM_REGS];
+
+static void dma_run(u32 src, u32 dst, u32 len, u32 rows, u32 stride, u32 fill, u32 ctrl){
+    len &= ~0x3;
+    rows &= 0xFFFF;
+    if (rows == 0){
+        rows = 1;
+    }
+    for (u32 r = 0; r < rows; r++){
+        if (len){
+            u32 *d = hosted_ptr(dst);
+            if (get_bit(ctrl, DMA_CTRL_FILL_BIT)){
+                for (u32 i = 0; i < len / 4; i++){
+                    d[i] = fill;
+                }
+            } else {
+                memmove(d, hosted_ptr(src), len);
+            }
+        }
+        dst += stride & 0xFFFF;
+        src += stride >> 16;
+    }
+    if (get_bit(ctrl, DMA_CTRL_IRQ_BIT)){
+        dma_regs[DMA_REG(DMA_STATUS)] |= _BV(DMA_STATUS_IRQ_BIT);
+    }
+    dma_regs[DMA_REG(DMA_DONE_COUNT)]++;
+}
+
+static u32 dma_model_read(u32 offset, int bytes){
+    return offset / 4 < sizeof(dma_regs) / 4 ? dma_regs[offset / 4] : 0;
+}
+
+static void dma_model_write(u32 offset, u32 data, int bytes){
+    u32 *r = dma_regs;
+    switch (offset & ~0x3){
+    case DMA_CTRL - PLATFORM_DMA0_BASE:
+        r[DMA_REG(DMA_CTRL)] = data & ~_BV(DMA_CTRL_START_BIT);
+        if (get_bit(data, DMA_CTRL_START_BIT)){
+            dma_run(r[DMA_REG(DMA_SRC)], r[DMA_REG(DMA_DST)], r[DMA_REG(DMA_LEN)], r[DMA_REG(DMA_ROWS)],
+                    r[DMA_REG(DMA_STRIDE)], r[DMA_REG(DMA_FILL)], data);
+        }
+        break;
+    case DMA_STATUS - PLATFORM_DMA0_BASE:
+        r[DMA_REG(DMA_STATUS)] &= ~data; // W1C
+        break;
+    case DMA_DESC_ADDR - PLATFORM_DMA0_BASE:
+        r[DMA_REG(DMA_DESC_ADDR)] = data;
+        // descriptors use the host layout of struct dma_desc
+        for (struct dma_desc *d = hosted_ptr(data); d; d = d->next){
+            dma_run(d->src, d->dst, d->len, d->rows, d->stride, d->fill, d->ctrl);
+        }
+        break;
+    case DMA_DONE_COUNT - PLATFORM_DMA0_BASE:
+        break; // read only
+    default:
+        if (offset / 4 < sizeof(dma_regs) / 4){
+            r[offset / 4] = data;
+        }
+    }
+}
+
+static const struct hosted_model dma_model = {dma_model_read, dma_model_write};
+
+/*
+ * wb_spi, for the SD card
+ */
+#define SPI_DATA 0x0
+#define SPI_CSN 0x4
+#define SPI_THROTTLE 0x8
+
+static struct
+{
+    u32 csn;
+    u32 throttle;
+    const struct hosted_spi_device *dev;
+} spi;
+
+void hosted_spi_attach(const struct hosted_spi_device *dev){
+    spi.dev = dev;
+}
+
+static u8 spi_transfer(u8 tx){
+    u8 rx = 0xFF;
+    if (spi.dev && !spi.csn){
+        rx = spi.dev->exchange(spi.dev->ctx, tx);
+    }
+    hosted_spi_bytes++;
+    hosted_spi_clocks += 16 * (spi.throttle + 1);
+    if (get_bit(crc.ctrl, CRC_CTRL_SNOOP_RX_BIT)){
+        crc_add_byte(rx);
+    }
+    if (get_bit(crc.ctrl, CRC_CTRL_SNOOP_TX_BIT)){
+        crc_add_byte(tx);
+    }
+    return rx;
+}
+
+static u32 spi_model_read(u32 offset, int bytes){
+    switch (offset & ~0x3){
+    case SPI_DATA: return spi_transfer(0xFF);
+    case SPI_CSN: return spi.csn;
+    case SPI_THROTTLE: return spi.throttle;
+    }
+    return 0xDEADC0DE;
+}
+
+static void spi_model_write(u32 offset, u32 data, int bytes){
+    switch (offset & ~0x3){
+    case SPI_DATA:
+        spi_transfer(data);
+        break;
+    case SPI_CSN:
+        spi.csn = data & 1;
+        if (spi.dev && spi.dev->select){
+            spi.dev->select(spi.dev->ctx, spi.csn);
+        }
+        break;
+    case SPI_THROTTLE:
+        spi.throttle = data & 0xFF;
+        break;
+    }
+}
+
+static const struct hosted_model spi_model = {spi_model_read, spi_model_write};
+
+/*
+ * wb_sd_host
+ */
+#define SDH_FIFO_WORDS 256
+#define SDH_REG(addr) ((addr) - PLATFORM_SD_HOST0_BASE)
+
+static struct
+{
+    u32 arg;
+    u32 clk;
+    u32 ctrl;
+    u32 block_count;
+    u32 block_len;
+    u32 dma_addr;
+    u32 timeout;
+    u32 flags;
+    u32 resp[4];
+
+    u32 fifo[SDH_FIFO_WORDS];
+    u32 fifo_rd;
+    u32 fifo_count;
+
+    int write;       // direction of the current/last transfer
+    int reading;     // blocks still to come from the card
+    int writing;     // blocks still to go to the card
+    u32 blocks_left;
+    u32 dma_left;    // words
+    const struct hosted_sd_device *dev;
+} sdh;
+
+void hosted_sd_attach(const struct hosted_sd_device *dev){
+    sdh.dev = dev;
+}
+
+static void sdh_clocks(u64 sd_clocks){
+    hosted_sd_clocks += sd_clocks * 2 * ((sdh.clk & SD_HOST_CLK_DIV_MASK) + 1);
+}
+
+// SD clocks until ns have passed
+static u64 sdh_ns_to_clocks(u32 ns){
+    u64 period = 2 * ((sdh.clk & SD_HOST_CLK_DIV_MASK) + 1);
+    return ((u64)ns * REFCLK / 1000000000 + period - 1) / period;
+}
+
+static void sdh_push(u32 w){
+    sdh.fifo[(sdh.fifo_rd + sdh.fifo_count++) % SDH_FIFO_WORDS] = w;
+}
+
+static u32 sdh_pop(void){
+    u32 w = sdh.fifo[sdh.fifo_rd];
+    sdh.fifo_rd = (sdh.fifo_rd + 1) % SDH_FIFO_WORDS;
+    sdh.fifo_count--;
+    return w;
+}
+
+static void sdh_data_error(int bit){
+    sdh.flags |= _BV(bit);
+    sdh.reading = 0;
+    sdh.writing = 0;
+    sdh.dma_left = 0;
+}
+
+// one block from the card into the FIFO
+static void sdh_read_block(void){
+    u8 block[512];
+    u32 len = sdh.block_len & 0x3FC;
+    int wide = get_bit(sdh.ctrl, SD_HOST_CTRL_WIDE_BIT);
+    u32 wait_ns = 0;
+    int r = sdh.dev ? sdh.dev->read(sdh.dev->ctx, block, len, wide, &wait_ns) : -1;
+    u64 wait = sdh_ns_to_clocks(wait_ns);
+    if (r < 0 || wait > sdh.timeout){
+        sdh_clocks(sdh.timeout);
+        sdh_data_error(SD_HOST_STATUS_DATA_TIMEOUT_BIT);
+        return;
+    }
+    sdh_clocks(wait + 2 + 16 + len * 8 / (wide ? 4 : 1)); // start, data, CRC16, end
+    for (u32 i = 0; i < len; i += 4){
+        sdh_push(block[i] | (block[i + 1] << 8) | (block[i + 2] << 16) | ((u32)block[i + 3] << 24));
+    }
+    if (r){
+        sdh_data_error(SD_HOST_STATUS_DATA_CRC_BIT);
+        return;
+    }
+    if (--sdh.blocks_left == 0){
+        sdh.reading = 0;
+    }
+}
+
+// one block from the FIFO to the card
+static void sdh_write_block(void){
+    u8 block[512];
+    u32 len = sdh.block_len & 0x3FC;
+    int wide = get_bit(sdh.ctrl, SD_HOST_CTRL_WIDE_BIT);
+    for (u32 i = 0; i < len; i += 4){
+        u32 w = sdh_pop();
+        block[i] = w;
+        block[i + 1] = w >> 8;
+        block[i + 2] = w >> 16;
+        block[i + 3] = w >> 24;
+    }
+    u32 busy_ns = 0;
+    int r = sdh.dev ? sdh.dev->write(sdh.dev->ctx, block, len, wide, &busy_ns) : -1;
+    sdh_clocks(2 + 2 + 16 + len * 8 / (wide ? 4 : 1) + 7); // Nwr, start/end, data, CRC16, CRC status
+    if (r){
+        sdh_data_error(SD_HOST_STATUS_WRITE_ERR_BIT);
+        return;
+    }
+    u64 busy = sdh_ns_to_clocks(busy_ns);
+    if (busy > sdh.timeout){
+        sdh_clocks(sdh.timeout);
+        sdh_data_error(SD_HOST_STATUS_DATA_TIMEOUT_BIT);
+        return;
+    }
+    sdh_clocks(busy);
+    if (--sdh.blocks_left == 0){
+        sdh.writing = 0;
+    }
+}
+
+// move data between the card, FIFO and memory until it is blocked
+static void sdh_run(void){
+    u32 block_words = (sdh.block_len & 0x3FC) / 4;
+    for (;;){
+        int progress = 0;
+        if (sdh.dma_left && !sdh.write && sdh.fifo_count){
+            u32 *d = hosted_ptr(sdh.dma_addr);
+            for (; sdh.dma_left && sdh.fifo_count; sdh.dma_left--, sdh.dma_addr += 4){
+                *d++ = sdh_pop();
+            }
+            progress = 1;
+        }
+        if (sdh.dma_left && sdh.write && sdh.fifo_count < SDH_FIFO_WORDS){
+            u32 *s = hosted_ptr(sdh.dma_addr);
+            for (; sdh.dma_left && sdh.fifo_count < SDH_FIFO_WORDS; sdh.dma_left--, sdh.dma_addr += 4){
+                sdh_push(*s++);
+            }
+            progress = 1;
+        }
+        if (sdh.reading && SDH_FIFO_WORDS - sdh.fifo_count >= block_words){
+            sdh_read_block();
+            progress = 1;
+        }
+        if (sdh.writing && sdh.fifo_count >= block_words){
+            sdh_write_block();
+            progress = 1;
+        }
+        if (!progress){
+            return;
+        }
+    }
+}
+
+static void sdh_command(u32 cmd){
+    u8 index = cmd & 0x3F;
+    u32 resp_type = cmd & (3 << SD_HOST_CMD_RESP_SHIFT);
+    int data = get_bit(cmd, SD_HOST_CMD_DATA_BIT) && !(sdh.reading || sdh.writing || sdh.dma_left);
+    u32 busy_ns = 0;
+    int words = sdh.dev ? sdh.dev->command(sdh.dev->ctx, index, sdh.arg, sdh.resp, &busy_ns) : -1;
+
+    if (data){
+        sdh.write = get_bit(cmd, SD_HOST_CMD_WRITE_BIT);
+        sdh.fifo_rd = 0;
+        sdh.fifo_count = 0;
+        sdh.blocks_left = sdh.block_count & 0xFFFF;
+        sdh.reading = !sdh.write && sdh.blocks_left; // reads start with the command
+        sdh.dma_left = get_bit(sdh.ctrl, SD_HOST_CTRL_DMA_BIT) ? sdh.blocks_left * (sdh.block_len & 0x3FC) / 4 : 0;
+    }
+    sdh_clocks(48 + 8);
+    if (resp_type == SD_HOST_RESP_NONE){
+        // nothing to wait for
+    } else if (words < 0){
+        sdh_clocks(64);
+        sdh.flags |= _BV(SD_HOST_STATUS_CMD_TIMEOUT_BIT);
+    } else {
+        sdh_clocks(2 + (resp_type == SD_HOST_RESP_R2 ? 136 : 48));
+        if (get_bit(cmd, SD_HOST_CMD_BUSY_BIT)){
+            sdh_clocks(sdh_ns_to_clocks(busy_ns));
+        }
+        if (data && sdh.write){
+            sdh.writing = sdh.blocks_left != 0; // writes once the card has answered
+        }
+    }
+    if (data){
+        sdh_run();
+    }
+}
+
+static u32 sdh_model_read(u32 offset, int bytes){
+    switch (offset & ~0x3){
+    case SDH_REG(SD_HOST_ARG): return sdh.arg;
+    case SDH_REG(SD_HOST_STATUS):
+        return sdh.flags | ((sdh.reading || sdh.writing || sdh.dma_left) << SD_HOST_STATUS_DATA_BUSY_BIT) |
+               ((sdh.dma_left != 0) << SD_HOST_STATUS_DMA_BUSY_BIT);
+    case SDH_REG(SD_HOST_RESP0) + 0x0: return sdh.resp[0];
+    case SDH_REG(SD_HOST_RESP0) + 0x4: return sdh.resp[1];
+    case SDH_REG(SD_HOST_RESP0) + 0x8: return sdh.resp[2];
+    case SDH_REG(SD_HOST_RESP0) + 0xC: return sdh.resp[3];
+    case SDH_REG(SD_HOST_CLK): return sdh.clk;
+    case SDH_REG(SD_HOST_CTRL): return sdh.ctrl;
+    case SDH_REG(SD_HOST_BLOCK_COUNT): return (sdh.reading || sdh.writing) ? sdh.blocks_left : sdh.block_count;
+    case SDH_REG(SD_HOST_BLOCK_LEN): return sdh.block_len;
+    case SDH_REG(SD_HOST_DMA_ADDR): return sdh.dma_addr;
+    case SDH_REG(SD_HOST_DATA_TIMEOUT): return sdh.timeout;
+    case SDH_REG(SD_HOST_FIFO):
+        if (sdh.fifo_count == 0){
+            return 0;
+        } else {
+            u32 w = sdh_pop();
+            sdh_run();
+            return w;
+        }
+    case SDH_REG(SD_HOST_FIFO_COUNT): return sdh.fifo_count;
+    }
+    return 0xDEADC0DE;
+}
+
+static void sdh_model_write(u32 offset, u32 data, int bytes){
+    switch (offset & ~0x3){
+    case SDH_REG(SD_HOST_ARG): sdh.arg = data; break;
+    case SDH_REG(SD_HOST_CMD): sdh_command(data); break;
+    case SDH_REG(SD_HOST_STATUS): sdh.flags &= ~(data & 0x7F00); break; // W1C
+    case SDH_REG(SD_HOST_CLK): sdh.clk = data & 0x1FFFF; break;
+    case SDH_REG(SD_HOST_CTRL):
+        sdh.ctrl = data & 0x3;
+        if (get_bit(data, SD_HOST_CTRL_ABORT_BIT)){
+            sdh.reading = 0;
+            sdh.writing = 0;
+            sdh.dma_left = 0;
+            sdh.fifo_count = 0;
+        }
+        break;
+    case SDH_REG(SD_HOST_BLOCK_COUNT):
+        if (!(sdh.reading || sdh.writing || sdh.dma_left)){
+            sdh.block_count = data & 0xFFFF;
+        }
+        break;
+    case SDH_REG(SD_HOST_BLOCK_LEN):
+        if (!(sdh.reading || sdh.writing || sdh.dma_left)){
+            sdh.block_len = data & 0x3FF;
+        }
+        break;
+    case SDH_REG(SD_HOST_DMA_ADDR):
+        if (!sdh.dma_left){
+            sdh.dma_addr = data & ~0x3;
+        }
+        break;
+    case SDH_REG(SD_HOST_DATA_TIMEOUT): sdh.timeout = data; break;
+    case SDH_REG(SD_HOST_FIFO):
+        if (sdh.fifo_count < SDH_FIFO_WORDS){
+            sdh_push(data);
+            sdh_run();
+        }
+        break;
+    case SDH_REG(SD_HOST_DMA_WORDS):
+        if (!sdh.dma_left){
+            sdh.dma_left = data & 0xFFFFFF;
+            sdh_run();
+        }
+        break;
+    }
+}
+
+static const struct hosted_model sdh_model = {sdh_model_read, sdh_model_write};
+
+/*
+ * axi3_blitter
+ */
+#define BLIT_REG(addr) (((addr) - BLIT_BASE_ADDR) / 4)
+#define BLIT_NUM_REGS 9 // up to BLIT_DONE_COUNT
+
+static u32 blit_regs[BLIT_NUM_REGS];
+
+static void blit_run(u32 cmd){
+    u32 *r = blit_regs;
+    u32 op = cmd & 0x3;
+    int flip = get_bit(cmd, BLIT_CMD_FLIP_BIT);
+    u32 dst = r[BLIT_REG(BLIT_DST)];
+    u32 src = r[BLIT_REG(BLIT_SRC)];
+    u32 w = r[BLIT_REG(BLIT_SIZE)] & 0xFFFF;
+    u32 h = r[BLIT_REG(BLIT_SIZE)] >> 16;
+    u32 dst_stride = r[BLIT_REG(BLIT_STRIDE)] & 0xFFFF;
+    u32 src_stride = r[BLIT_REG(BLIT_STRIDE)] >> 16;
+
+    r[BLIT_REG(BLIT_DONE_COUNT)]++;
+    if (op == BLIT_OP_GLYPH){
+        return;
+    }
+    // COPY goes bottom to top when moving down, so overlapping scrolls work (not with FLIP)
+    int up = op == BLIT_OP_COPY && !flip && dst > src;
+    for (u32 i = 0; i < h; i++){
+        u32 line = up ? h - 1 - i : i;
+        u32 *d = hosted_ptr(dst + (flip ? h - 1 - line : line) * dst_stride);
+        if (op == BLIT_OP_FILL){
+            for (u32 x = 0; x < w; x++){
+                d[x] = r[BLIT_REG(BLIT_FG)];
+            }
+        } else if (op == BLIT_OP_COPY){
+            memmove(d, hosted_ptr(src + line * src_stride), w * 4);
+        } else { // RGB24
+            const u8 *s = hosted_ptr(src + line * src_stride);
+            for (u32 x = 0; x < w; x++, s += 3){
+                d[x] = (s[2] << 16) | (s[1] << 8) | s[0];
+            }
+        }
+    }
+}
+
+static u32 blit_model_read(u32 offset, int bytes){
+    switch (offset & ~0x3){
+    case BLIT_STATUS - BLIT_BASE_ADDR: return blit_regs[BLIT_REG(BLIT_STATUS)]; // never BUSY
+    case BLIT_CMD - BLIT_BASE_ADDR: return 0;                                  // write only
+    }
+    return offset / 4 < BLIT_NUM_REGS ? blit_regs[offset / 4] : 0xDEADC0DE;
+}
+
+static void blit_model_write(u32 offset, u32 data, int bytes){
+    switch (offset & ~0x3){
+    case BLIT_CMD - BLIT_BASE_ADDR: blit_run(data); break;
+    case BLIT_STATUS - BLIT_BASE_ADDR: blit_regs[BLIT_REG(BLIT_STATUS)] &= ~(data & _BV(BLIT_STATUS_ERR_BIT)); break; // W1C
+    case BLIT_DONE_COUNT - BLIT_BASE_ADDR: break; // read only
+    default:
+        if (offset / 4 < BLIT_NUM_REGS){
+            blit_regs[offset / 4] = data;
+        }
+    }
+}
+
+static const struct hosted_model blit_model = {blit_model_read, blit_model_write};
+
+/*
+ * Bus
+ */
+void hosted_init(void){
+    // keep large allocations on the heap (brk) rather than mmap, so they stay below 4GB
+    mallopt(M_MMAP_MAX, 0);
+
+    memset(hosted_bus, 0, sizeof(hosted_bus));
+    memset(models, 0, sizeof(models));
+    memset(&crc, 0, sizeof(crc));
+    memset(dma_regs, 0, sizeof(dma_regs));
+    spi.csn = 1;
+    spi.throttle = 0;
+    memset(&sdh, 0, sizeof(sdh));
+    sdh.clk = 0xFF;
+    sdh.block_count = 1;
+    sdh.block_len = 512;
+    sdh.timeout = 0x100000;
+    memset(blit_regs, 0, sizeof(blit_regs));
+    blit_regs[BLIT_REG(BLIT_STRIDE)] = 0x10001000; // 4KB lines
+
+    models[WINDOW(PLATFORM_CRC0_BASE)] = &crc_model;
+    models[WINDOW(PLATFORM_DMA0_BASE)] = &dma_model;
+    models[WINDOW(PLATFORM_SD_SPI_BASE)] = &spi_model;
+    models[WINDOW(PLATFORM_SD_HOST0_BASE)] = &sdh_model;
+    models[WINDOW(HOSTED_BLIT_BASE)] = &blit_model;
+
+    // read only registers that are plain memory here
+    ((volatile u32 *)PLATFORM_UART0_BASE)[1] = 1; // TX_IDLE
+    GPIO_SOC_FREQ = REFCLK;
+}
+
+static const struct hosted_model *find_model(u32 addr, u32 *offset){
+    u32 bus_offset = addr - (u32)HOSTED_WINDOW_BASE(0);
+    if (bus_offset >= sizeof(hosted_bus)){
+        return NULL;
+    }
+    *offset = bus_offset % HOSTED_WINDOW_SIZE;
+    return models[bus_offset / HOSTED_WINDOW_SIZE];
+}
+
+u32 hosted_read(u32 addr, int bytes){
+    u32 offset;
+    const struct hosted_model *m = find_model(addr, &offset);
+    if (m){
+        hosted_bus_reads++;
+        return m->read(offset, bytes);
+    }
+    void *p = hosted_ptr(addr);
+    switch (bytes){
+    case 1: return *(volatile u8 *)p;
+    case 2: return *(volatile u16 *)p;
+    default: return *(volatile u32 *)p;
+    }
+}
+
+void hosted_write(u32 addr, u32 data, int bytes){
+    u32 offset;
+    const struct hosted_model *m = find_model(addr, &offset);
+    if (m){
+        hosted_bus_writes++;
+        m->write(offset, data, bytes);
+        return;
+    }
+    void *p = hosted_ptr(addr);
+    switch (bytes){
+    case 1: *(volatile u8 *)p = data; break;
+    case 2: *(volatile u16 *)p = data; break;
+    default: *(volatile u32 *)p = data; break;
+    }
+}
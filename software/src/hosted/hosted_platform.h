@@ -0,0 +1,89 @@
+#ifndef _HOSTED_PLATFORM_H_
+#define _HOSTED_PLATFORM_H_
+/*
+ *  Hosted platform layer (make hosted)
+
+    Lets the firmware libraries run on the PC. Every segment in platform.h becomes a
+    HOSTED_WINDOW_SIZE window in one static array, so peripheral addresses still fit in a u32.
+    Windows with a device model (DMA, CRC, SD SPI, SD host) route read_u32() etc to it, everything
+    else (GPIO, UART, timer, text display, memories) is plain memory.
+
+    Device models can only see accesses made through the utils.h accessors. Pointer-style
+    registers (`module->registers[n]`, GPIO_LED) land in the window memory without side effects.
+
+    The DMA model is given u32 addresses, so the binary is linked -no-pie and buffers handed to it
+    must be static or on the heap (the stack is above 4GB). It aborts on anything else.
+ */
+
+#include <stdint.h>
+
+#define HOSTED_WINDOW_SIZE 0x10000
+
+extern uint8_t hosted_bus[];
+
+#define HOSTED_WINDOW_BASE(n) ((uintptr_t)&hosted_bus[(n) * HOSTED_WINDOW_SIZE])
+
+// reset the bus and attach the device models, call before anything else
+void hosted_init(void);
+
+// bus accesses of 1, 2 or 4 bytes, used by the utils.h accessors
+uint32_t hosted_read(uint32_t addr, int bytes);
+void hosted_write(uint32_t addr, uint32_t data, int bytes);
+
+// bus accesses made through the accessors (model windows only), for benchmarks
+extern uint64_t hosted_bus_reads;
+extern uint64_t hosted_bus_writes;
+
+// host pointer for an address given to a device model (eg. DMA source), aborts if not host addressable
+void *hosted_ptr(uint32_t addr);
+
+/*
+ * PYNQ display (pixel_display.h), in windows the basys3 map leaves free
+ */
+#define HOSTED_VDMA_CTRL_BASE HOSTED_WINDOW_BASE(11) // plain memory: buffer 0 in front, no flip pending
+#define HOSTED_BLIT_BASE HOSTED_WINDOW_BASE(12)      // axi3_blitter model
+#define HOSTED_DDR_SIZE (3 * 0x00800000)             // both framebuffers and the image staging area
+
+// the PYNQ's DDR3
+extern uint8_t hosted_ddr[];
+
+/*
+ * SPI devices (on the SD SPI controller)
+ */
+struct hosted_spi_device
+{
+    // one byte exchanged with chip select low, returns the byte sent back
+    uint8_t (*exchange)(void *ctx, uint8_t mosi);
+    // chip select changed, cs_n = 1 when deselected
+    void (*select)(void *ctx, int cs_n);
+    void *ctx;
+};
+
+// attach a device to the SD SPI controller (NULL to remove), MISO floats high without one
+void hosted_spi_attach(const struct hosted_spi_device *dev);
+// bytes transferred and estimated SPI bus clocks (SCK period is 2 * (throttle + 1) clocks)
+extern uint64_t hosted_spi_bytes;
+extern uint64_t hosted_spi_clocks;
+
+/*
+ * SD cards on the native SD bus (wb_sd_host)
+ */
+struct hosted_sd_device
+{
+    // a command, fills resp (1 word, or 4 for R2 with [0] the lowest) and returns how many words,
+    // or -1 for no response. busy_ns is how long DAT0 is held low after it
+    int (*command)(void *ctx, uint8_t index, uint32_t arg, uint32_t *resp, uint32_t *busy_ns);
+    // the next read data block, sent wait_ns from now on 1 or 4 lines. Returns 0, 1 if it goes
+    // out with a bad CRC16, or -1 if the card has nothing to send
+    int (*read)(void *ctx, uint8_t *buf, uint32_t len, int wide, uint32_t *wait_ns);
+    // a write data block, returns 0 if accepted (then busy for busy_ns) or -1 if not
+    int (*write)(void *ctx, const uint8_t *buf, uint32_t len, int wide, uint32_t *busy_ns);
+    void *ctx;
+};
+
+// attach a card to the SD host controller (NULL to remove), commands time out without one
+void hosted_sd_attach(const struct hosted_sd_device *dev);
+// estimated SoC clocks spent on the native SD bus (an SD clock is 2 * (DIV + 1) of them)
+extern uint64_t hosted_sd_clocks;
+
+#endif // _HOSTED_PLATFORM_H_
@@ -0,0 +1,536 @@
+#include "sd_card_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mmc_device.h"
+
+// R1 bits, and the OCR bits set by this card (voltage window, CCS, and busy/ready)
+#define OCR_VOLTAGE 0x00FF8000
+#define OCR_CCS 0x40000000
+#define OCR_READY 0x80000000
+
+// queue entries above a byte: send 0xFF (data not ready) or 0x00 (busy) until wait_until_ns
+#define Q_NAC 0x100
+#define Q_BUSY 0x101
+
+static u16 crc16_xmodem(const u8 *buf, u32 len){
+    u16 crc = 0;
+    for (u32 i = 0; i < len; i++){
+        crc ^= (u16)buf[i] << 8;
+        for (int b = 0; b < 8; b++){
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static u8 crc7(const u8 *buf, u32 len){
+    u8 crc = 0;
+    for (u32 i = 0; i < len; i++){
+        for (int b = 7; b >= 0; b--){
+            int feedback = ((crc >> 6) ^ (buf[i] >> b)) & 1;
+            crc = (crc << 1) & 0x7F;
+            if (feedback){
+                crc ^= 0x09;
+            }
+        }
+    }
+    return crc;
+}
+
+static void queue_byte(struct sd_card *card, u16 b){
+    if (card->out_len < SD_MODEL_QUEUE){
+        card->out[card->out_len++] = b;
+    }
+}
+
+static void queue_clear(struct sd_card *card){
+    card->out_head = 0;
+    card->out_len = 0;
+}
+
+// a wait marker, the card sends at least one byte of it even if the time has already passed
+static void queue_wait(struct sd_card *card, u16 marker, u32 us){
+    card->wait_until_ns = card->now_ns + (u64)us * 1000;
+    queue_byte(card, marker);
+}
+
+static void queue_block(struct sd_card *card, u32 sector, u32 nac_us){
+    queue_wait(card, Q_NAC, nac_us);
+    if (sector == card->read_error_sector){
+        queue_byte(card, SD_ERROR_TOKEN_ECC);
+        card->streaming = 0; // the card stops sending, the host still has to send CMD12
+        return;
+    }
+    u8 *data = &card->image[sector * SD_BYTES_PER_BLOCK];
+    u16 crc = crc16_xmodem(data, SD_BYTES_PER_BLOCK);
+    card->blocks_read++;
+    if (card->crc_error_every && card->blocks_read % card->crc_error_every == 0){
+        crc = ~crc;
+        card->crc_errors_injected++;
+    }
+    queue_byte(card, START_BLOCK);
+    for (int i = 0; i < SD_BYTES_PER_BLOCK; i++){
+        queue_byte(card, data[i]);
+    }
+    queue_byte(card, crc >> 8);
+    queue_byte(card, crc & 0xFF);
+}
+
+static void queue_u32(struct sd_card *card, u32 val){
+    queue_byte(card, val >> 24);
+    queue_byte(card, (val >> 16) & 0xFF);
+    queue_byte(card, (val >> 8) & 0xFF);
+    queue_byte(card, val & 0xFF);
+}
+
+static void execute(struct sd_card *card){
+    u8 index = card->cmd[0] & 0x3F;
+    u32 arg = ((u32)card->cmd[1] << 24) | ((u32)card->cmd[2] << 16) | ((u32)card->cmd[3] << 8) | card->cmd[4];
+    int app = card->app_cmd;
+    card->app_cmd = 0;
+    card->commands++;
+
+    queue_clear(card);
+    queue_byte(card, 0xFF); // Ncr
+    u8 r1 = card->idle ? R1_IDLE : R1_VALUE_READY;
+
+    // CMD0 and CMD8 are always CRC checked, everything else only with CRC on
+    if ((card->check_crc || index == 0 || index == 8) && (card->cmd[5] >> 1) != crc7(card->cmd, 5)){
+        queue_byte(card, r1 | R1_CRC_ERR);
+        return;
+    }
+    if (app && index == 41){ // ACMD41
+        if (!card->init_started){
+            card->init_started = 1;
+            card->ready_ns = card->now_ns + (u64)card->init_us * 1000;
+        }
+        if (card->now_ns >= card->ready_ns){
+            card->idle = 0;
+        }
+        queue_byte(card, card->idle ? R1_IDLE : R1_VALUE_READY);
+        return;
+    }
+    switch (index){
+    case 0:
+        card->idle = 1;
+        card->init_started = 0;
+        card->streaming = 0;
+        card->writing = 0;
+        queue_byte(card, R1_IDLE);
+        break;
+    case 8:
+        queue_byte(card, r1);
+        queue_u32(card, arg & 0xFFF); // voltage accepted and check pattern
+        break;
+    case 12:
+        card->streaming = 0;
+        queue_clear(card);
+        queue_byte(card, 0xFF); // stuff byte
+        queue_byte(card, r1);
+        queue_wait(card, Q_BUSY, card->busy_us);
+        break;
+    case 13: // R2, no card status errors to report
+        queue_byte(card, r1);
+        queue_byte(card, 0x00);
+        break;
+    case 17:
+    case 18:
+    case 24:
+    case 25:
+        if (card->idle){
+            queue_byte(card, r1 | R1_ILLEGAL_CMD_ERR);
+            break;
+        }
+        if (arg >= card->sectors){
+            queue_byte(card, r1 | R1_ADDR_ERR);
+            break;
+        }
+        queue_byte(card, r1);
+        if (index == 17){
+            queue_block(card, arg, card->nac_us);
+        } else if (index == 18){
+            card->streaming = 1;
+            card->next_sector = arg;
+            card->stream_blocks = 0;
+        } else {
+            card->writing = index;
+            card->write_len = -1;
+            card->write_sector = arg;
+        }
+        break;
+    case 55:
+        card->app_cmd = 1;
+        queue_byte(card, r1);
+        break;
+    case 58:
+        queue_byte(card, r1);
+        queue_u32(card, OCR_VOLTAGE | OCR_CCS | (card->idle ? 0 : OCR_READY));
+        break;
+    case 59:
+        card->check_crc = arg & 1;
+        queue_byte(card, r1);
+        break;
+    default:
+        queue_byte(card, r1 | R1_ILLEGAL_CMD_ERR);
+    }
+}
+
+// a whole data block (and its CRC) received for CMD24/25
+static void write_block(struct sd_card *card){
+    u16 crc = ((u16)card->write_buf[512] << 8) | card->write_buf[513];
+    u8 response = SD_DATA_ACCEPTED;
+    if (card->check_crc && crc != crc16_xmodem(card->write_buf, 512)){
+        response = SD_DATA_CRC_ERR;
+    } else if (card->write_protect || card->write_sector >= card->sectors){
+        response = SD_DATA_WRITE_ERR;
+    } else {
+        memcpy(&card->image[card->write_sector * SD_BYTES_PER_BLOCK], card->write_buf, 512);
+        card->write_sector++;
+        card->blocks_written++;
+    }
+    queue_clear(card);
+    queue_byte(card, 0xE0 | response);
+    queue_wait(card, Q_BUSY, card->write_busy_us);
+    if (card->writing == 24 || response != SD_DATA_ACCEPTED){
+        card->writing = 0;
+    }
+    card->write_len = -1;
+}
+
+// returns 1 if the byte was part of a write
+static int write_input(struct sd_card *card, u8 mosi){
+    if (card->write_len >= 0){
+        card->write_buf[card->write_len++] = mosi;
+        if (card->write_len == sizeof(card->write_buf)){
+            write_block(card);
+        }
+        return 1;
+    }
+    if ((card->writing == 24 && mosi == START_BLOCK) || (card->writing == 25 && mosi == MULTIWRITE_START_BLOCK)){
+        card->write_len = 0;
+        return 1;
+    }
+    if (card->writing == 25 && mosi == STOP_TRAN_TOKEN){
+        card->writing = 0;
+        queue_clear(card);
+        queue_byte(card, 0xFF); // Nbr
+        queue_wait(card, Q_BUSY, card->busy_us);
+        return 1;
+    }
+    return mosi == 0xFF; // anything else is a command, which ends the write
+}
+
+u8 sd_card_output(struct sd_card *card){
+    if (card->out_head == card->out_len){
+        queue_clear(card);
+        if (card->streaming && card->next_sector < card->sectors){
+            queue_block(card, card->next_sector++, card->stream_blocks++ ? card->stream_nac_us : card->nac_us);
+        }
+    }
+    if (card->out_head == card->out_len){
+        return 0xFF;
+    }
+    u16 b = card->out[card->out_head];
+    if (b == Q_NAC || b == Q_BUSY){
+        if (card->now_ns >= card->wait_until_ns){
+            card->out_head++;
+        }
+        if (b == Q_NAC){
+            card->nac_bytes++;
+            return 0xFF;
+        }
+        card->busy_bytes++;
+        return 0x00;
+    }
+    card->out_head++;
+    return b;
+}
+
+void sd_card_input(struct sd_card *card, u8 mosi){
+    if (card->writing && card->cmd_len == 0 && write_input(card, mosi)){
+        return;
+    }
+    // commands start with 0b01, anything else between commands is ignored
+    if (card->cmd_len > 0 || (mosi & 0xC0) == 0x40){
+        card->writing = 0;
+        card->cmd[card->cmd_len++] = mosi;
+        if (card->cmd_len == 6){
+            card->cmd_len = 0;
+            execute(card);
+        }
+    }
+}
+
+void sd_card_select(struct sd_card *card, int cs_n){
+    if (cs_n){
+        // a busy card finishes in the background
+        card->cmd_len = 0;
+        card->streaming = 0;
+        card->writing = 0;
+        queue_clear(card);
+    }
+}
+
+void sd_card_init(struct sd_card *card, u8 *image, u32 sectors){
+    memset(card, 0, sizeof(*card));
+    card->image = image;
+    card->sectors = sectors;
+    card->idle = 1;
+    card->nac_us = SD_MODEL_NAC_US;
+    card->stream_nac_us = SD_MODEL_STREAM_NAC_US;
+    card->busy_us = SD_MODEL_BUSY_US;
+    card->write_busy_us = SD_MODEL_WRITE_BUSY_US;
+    card->init_us = SD_MODEL_INIT_US;
+    card->read_error_sector = SD_MODEL_NO_SECTOR;
+}
+
+int sd_card_load(struct sd_card *card, const char *path){
+    FILE *f = fopen(path, "rb");
+    if (!f){
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    u8 *image = malloc(len > 0 ? len : 1);
+    if (len <= 0 || len % SD_BYTES_PER_BLOCK || fread(image, 1, len, f) != (size_t)len){
+        free(image);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    sd_card_init(card, image, len / SD_BYTES_PER_BLOCK);
+    return 0;
+}
+
+int sd_card_save(const struct sd_card *card, const char *path){
+    FILE *f = fopen(path, "wb");
+    if (!f){
+        return -1;
+    }
+    size_t len = (size_t)card->sectors * SD_BYTES_PER_BLOCK;
+    int ok = fwrite(card->image, 1, len, f) == len;
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+/*
+ * Native SD bus
+ */
+#define NATIVE_RCA 0x1234
+// card status: current state (stby/tran) and ready for data
+#define CS_STATE_STBY (3 << 9)
+#define CS_STATE_TRAN (4 << 9)
+#define CS_READY_FOR_DATA 0x100
+#define CS_APP_CMD 0x20
+#define CS_ILLEGAL_CMD 0x00400000
+#define CS_OUT_OF_RANGE 0x80000000
+
+static const u32 native_cid[4] = {0x2A01014A, 0x43418000, 0x44534650, 0x03534453}; // [0] lowest
+
+static u32 native_status(struct sd_card *card){
+    if (card->idle){
+        return 0;
+    }
+    return card->selected ? CS_STATE_TRAN | CS_READY_FOR_DATA : CS_STATE_STBY | CS_READY_FOR_DATA;
+}
+
+int sd_card_native_command(struct sd_card *card, u8 index, u32 arg, u32 *resp, u32 *busy_ns){
+    int app = card->app_cmd;
+    card->app_cmd = 0;
+    card->commands++;
+    *busy_ns = 0;
+    resp[0] = native_status(card);
+
+    if (app && index == 41){ // ACMD41, R3
+        if (!card->init_started){
+            card->init_started = 1;
+            card->ready_ns = card->now_ns + (u64)card->init_us * 1000;
+        }
+        if (card->now_ns >= card->ready_ns){
+            card->idle = 0;
+        }
+        resp[0] = 0x00FF8000 | 0x40000000 | (card->idle ? 0 : 0x80000000);
+        return 1;
+    }
+    if (app && index == 6){ // ACMD6
+        card->wide = (arg & 3) == 2;
+        resp[0] |= CS_APP_CMD;
+        return 1;
+    }
+    switch (index){
+    case 0:
+        card->idle = 1;
+        card->init_started = 0;
+        card->streaming = 0;
+        card->writing = 0;
+        card->selected = 0;
+        card->wide = 0;
+        card->high_speed = 0;
+        card->switch_pending = 0;
+        return 0;
+    case 2: // R2, CID
+        if (card->idle){
+            return -1;
+        }
+        memcpy(resp, native_cid, sizeof(native_cid));
+        return 4;
+    case 3: // R6, new RCA
+        if (card->idle){
+            return -1;
+        }
+        card->rca = NATIVE_RCA;
+        resp[0] = ((u32)card->rca << 16) | (native_status(card) & 0x1F00);
+        return 1;
+    case 6: // switch function, the status comes as a 64 byte data block
+        if (!card->selected){
+            return -1;
+        }
+        card->switch_pending = 1;
+        if (arg & 0x80000000){
+            card->high_speed = (arg & 0xF) == 1;
+        }
+        return 1;
+    case 7:
+        card->selected = (arg >> 16) == card->rca && card->rca;
+        *busy_ns = card->busy_us * 1000;
+        return card->selected ? 1 : -1; // deselected cards don't answer
+    case 8:
+        resp[0] = arg & 0xFFF;
+        return 1;
+    case 12:
+        card->streaming = 0;
+        card->writing = 0;
+        *busy_ns = card->busy_us * 1000;
+        return 1;
+    case 13:
+        return 1;
+    case 17:
+    case 18:
+    case 24:
+    case 25:
+        if (!card->selected){
+            return -1;
+        }
+        if (arg >= card->sectors){
+            resp[0] |= CS_OUT_OF_RANGE;
+            return 1;
+        }
+        if (index == 17 || index == 18){
+            card->streaming = index;
+            card->next_sector = arg;
+            card->stream_blocks = 0;
+        } else {
+            card->writing = index;
+            card->write_sector = arg;
+        }
+        return 1;
+    case 55:
+        card->app_cmd = 1;
+        resp[0] |= CS_APP_CMD;
+        return 1;
+    }
+    return -1;
+}
+
+int sd_card_native_read(struct sd_card *card, u8 *buf, u32 len, int wide, u32 *wait_ns){
+    *wait_ns = card->nac_us * 1000;
+    if (card->switch_pending){
+        // function group 1 supports default and high speed, and is set to one of them
+        card->switch_pending = 0;
+        memset(buf, 0, len);
+        if (len > 16){
+            buf[13] = 0x03;
+            buf[16] = card->high_speed ? 0x01 : 0x00;
+        }
+        return wide == card->wide ? 0 : 1;
+    }
+    if (!card->streaming || card->next_sector >= card->sectors){
+        return -1;
+    }
+    u32 sector = card->next_sector++;
+    if (card->stream_blocks++){
+        *wait_ns = card->stream_nac_us * 1000;
+    }
+    if (card->streaming == 17){
+        card->streaming = 0;
+    }
+    if (sector == card->read_error_sector){
+        card->streaming = 0; // the card stops sending, the host still has to send CMD12
+        return -1;
+    }
+    memcpy(buf, &card->image[sector * SD_BYTES_PER_BLOCK], len);
+    card->blocks_read++;
+    if (card->crc_error_every && card->blocks_read % card->crc_error_every == 0){
+        card->crc_errors_injected++;
+        return 1;
+    }
+    return wide == card->wide ? 0 : 1; // the wrong bus width garbles the data
+}
+
+int sd_card_native_write(struct sd_card *card, const u8 *buf, u32 len, int wide, u32 *busy_ns){
+    *busy_ns = 0;
+    if (!card->writing || wide != card->wide || len != SD_BYTES_PER_BLOCK){
+        return -1;
+    }
+    if (card->write_protect || card->write_sector >= card->sectors){
+        card->writing = 0;
+        return -1;
+    }
+    memcpy(&card->image[card->write_sector * SD_BYTES_PER_BLOCK], buf, len);
+    card->write_sector++;
+    card->blocks_written++;
+    if (card->writing == 24){
+        card->writing = 0;
+    }
+    *busy_ns = card->write_busy_us * 1000;
+    return 0;
+}
+
+#ifdef PLATFORM_HOSTED
+// the card's time is the SoC clocks spent on either bus
+static void hosted_now(struct sd_card *card){
+    card->now_ns = (hosted_spi_clocks + hosted_sd_clocks) * 1000000000ull / REFCLK;
+}
+
+static u8 hosted_exchange(void *ctx, u8 mosi){
+    struct sd_card *card = ctx;
+    hosted_now(card);
+    u8 miso = sd_card_output(card);
+    sd_card_input(card, mosi);
+    return miso;
+}
+
+static void hosted_select(void *ctx, int cs_n){
+    sd_card_select(ctx, cs_n);
+}
+
+static int hosted_sd_command(void *ctx, u8 index, u32 arg, u32 *resp, u32 *busy_ns){
+    hosted_now(ctx);
+    return sd_card_native_command(ctx, index, arg, resp, busy_ns);
+}
+
+static int hosted_sd_read(void *ctx, u8 *buf, u32 len, int wide, u32 *wait_ns){
+    hosted_now(ctx);
+    return sd_card_native_read(ctx, buf, len, wide, wait_ns);
+}
+
+static int hosted_sd_write(void *ctx, const u8 *buf, u32 len, int wide, u32 *busy_ns){
+    hosted_now(ctx);
+    return sd_card_native_write(ctx, buf, len, wide, busy_ns);
+}
+
+void sd_card_attach(struct sd_card *card){
+    card->spi.exchange = hosted_exchange;
+    card->spi.select = hosted_select;
+    card->spi.ctx = card;
+    hosted_spi_attach(&card->spi);
+    card->native.command = hosted_sd_command;
+    card->native.read = hosted_sd_read;
+    card->native.write = hosted_sd_write;
+    card->native.ctx = card;
+    hosted_sd_attach(&card->native);
+}
+#endif
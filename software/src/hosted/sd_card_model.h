@@ -0,0 +1,135 @@
+#ifndef _SD_CARD_MODEL_H_
+#define _SD_CARD_MODEL_H_
+/*
+ *  SD card (SDHC, SPI mode) backed by a memory image, for the hosted SPI controller and the
+ *  GHDL testbenches (hdl/sim/tb_helpers/sim_sd_card_vhpi.c)
+
+    Answers CMD0/8/55/ACMD41/58 to get through initialisation, CMD17/18/12 reads, CMD24/25
+    writes, CMD13 and CMD59. Responses come one byte (Ncr) after the command.
+
+    The same card can be driven over the native SD bus instead (sd_card_native_*), a command or
+    a data block at a time. That adds CMD2/3/7, ACMD6 (bus width) and CMD6 (high speed), and
+    sends no response to commands it does not know, like a real card.
+
+    Cycle-approximate: the card keeps time in now_ns, which whoever drives it advances (the
+    hosted adapter from the SPI clocks transferred, the GHDL bridge from simulation time). Data
+    arrives nac_us after a read command or the previous block, and writes and CMD12 hold the
+    card busy for write_busy_us / busy_us, so the number of polling bytes mmc.c sees depends on
+    the SCK rate like it would on a real card. Later blocks of a CMD18 follow after the shorter
+    stream_nac_us, as cards read ahead. ACMD41 reports ready init_us after the first one.
+
+    Error injection, all off after sd_card_init():
+        crc_error_every     corrupt the CRC16 of every Nth block read
+        read_error_sector   reads of this sector get a data error token instead of data
+        write_protect       writes are rejected with a write error data response
+        check_crc           reject commands with a bad CRC7 (R1_CRC_ERR) and data blocks with a
+                            bad CRC16, as after CMD59 with CRC on
+ */
+
+#include "utils.h"
+#include "hosted_platform.h"
+
+#define SD_MODEL_QUEUE 1024
+#define SD_MODEL_NO_SECTOR 0xFFFFFFFF
+
+// default latencies, in the range of a real SDHC card
+#define SD_MODEL_NAC_US 100
+#define SD_MODEL_STREAM_NAC_US 10
+#define SD_MODEL_BUSY_US 10
+#define SD_MODEL_WRITE_BUSY_US 500
+#define SD_MODEL_INIT_US 5000
+
+// data error tokens (read) and data responses (write)
+#define SD_ERROR_TOKEN_ECC 0x04
+#define SD_DATA_ACCEPTED 0x05
+#define SD_DATA_CRC_ERR 0x0B
+#define SD_DATA_WRITE_ERR 0x0D
+
+struct sd_card
+{
+    u8 *image;
+    u32 sectors;
+
+    // timing, see above
+    u64 now_ns;
+    u32 nac_us;
+    u32 stream_nac_us;
+    u32 busy_us;
+    u32 write_busy_us;
+    u32 init_us;
+
+    // error injection
+    u32 crc_error_every;
+    u32 read_error_sector;
+    int write_protect;
+    int check_crc;
+
+    // command being received
+    u8 cmd[6];
+    int cmd_len;
+    int idle;     // in idle state until ACMD41
+    int app_cmd;  // last command was CMD55
+    int init_started;
+    u64 ready_ns; // when ACMD41 stops reporting idle
+    int streaming; // CMD18 in progress
+    u32 next_sector;
+    u32 stream_blocks; // sent so far in this CMD18
+
+    // write in progress (CMD24/25)
+    int writing;      // 0, 24 or 25
+    int write_len;    // bytes received after the data token, -1 while waiting for it
+    u32 write_sector;
+    u8 write_buf[512 + 2];
+
+    // bytes to send back, plus the wait markers below
+    u16 out[SD_MODEL_QUEUE];
+    int out_head;
+    int out_len;
+    u64 wait_until_ns; // for the marker at the head of the queue
+
+    // statistics
+    u32 commands;
+    u32 blocks_read;
+    u32 blocks_written;
+    u32 crc_errors_injected;
+    u32 nac_bytes;  // 0xFF sent while data was not ready
+    u32 busy_bytes; // 0x00 sent while busy
+
+    // native bus
+    u16 rca;
+    int selected;   // CMD7
+    int wide;       // ACMD6 set a 4 bit bus
+    int high_speed;
+    int switch_pending; // CMD6 status block to send
+
+    struct hosted_spi_device spi;
+    struct hosted_sd_device native;
+};
+
+// image is `sectors` * 512 bytes, with the default latencies and no errors
+void sd_card_init(struct sd_card *card, u8 *image, u32 sectors);
+// sd_card_init() on a copy of an image file, which has to be a whole number of sectors.
+// Returns 0, or -1 if it could not be read
+int sd_card_load(struct sd_card *card, const char *path);
+// write the image back out (eg. after a test wrote to it). Returns 0, or -1 on error
+int sd_card_save(const struct sd_card *card, const char *path);
+
+// one SPI byte with chip select low: the byte the card sends, then the byte it receives.
+// Split so a simulator can ask for MISO before the MOSI bits have arrived
+u8 sd_card_output(struct sd_card *card);
+void sd_card_input(struct sd_card *card, u8 mosi);
+// chip select changed, cs_n = 1 when deselected
+void sd_card_select(struct sd_card *card, int cs_n);
+
+// native SD bus: a command, the next read block and a write block. See struct hosted_sd_device
+int sd_card_native_command(struct sd_card *card, u8 index, u32 arg, u32 *resp, u32 *busy_ns);
+int sd_card_native_read(struct sd_card *card, u8 *buf, u32 len, int wide, u32 *wait_ns);
+int sd_card_native_write(struct sd_card *card, const u8 *buf, u32 len, int wide, u32 *busy_ns);
+
+#ifdef PLATFORM_HOSTED
+// connect to the hosted SD SPI and SD host controllers, the card's time follows the clocks they
+// have spent (hosted_spi_clocks + hosted_sd_clocks)
+void sd_card_attach(struct sd_card *card);
+#endif
+
+#endif // _SD_CARD_MODEL_H_
@@ -0,0 +1,258 @@
+/*
+ *  SD card read throughput sweep (make sd_sweep)
+
+    Runs mmc.c against the cycle-approximate SD card model, over a grid of SCK throttle settings
+    and read strategies, and reports the estimated throughput at the SoC clock (REFCLK), without
+    and with mmc.c's read-ahead. Use it to pick SD_SPI_THROTTLE_RUN, block counts, buffer sizes
+    and SD_READ_AHEAD_SECTORS before trying them on the board.
+
+    Time is the SPI clocks transferred (which include the polling bytes for the card's latencies)
+    plus a guess at the CPU cycles around each bus access. Only accesses to the model windows (SPI
+    and CRC) are counted, so the console output mmc.c makes on every block is not included.
+
+    Then compares the buses (SPI, and wb_sd_host's 1 and 4 bit native bus) at their fastest clock,
+    where time on the native bus is the SD clocks its model counts instead. Finishes with the error
+    injection cases, to show which ones mmc.c notices on each bus.
+
+    usage: sd_sweep [nac_us] [cpu cycles per bus access]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "platform.h"
+#include "utils.h"
+#include "console.h"
+#include "spi.h"
+#include "sd_host.h"
+#include "ff.h"
+#include "diskio.h"
+#include "file_stream.h"
+#include "mmc_device.h"
+
+#include "hosted_platform.h"
+#include "sd_card_model.h"
+#include "fat_image.h"
+
+#define SD_SECTORS 16384 // 8MB
+#define DATA_BIN_BYTES (512 * 1024)
+#define SWEEP_BYTES (128 * 1024) // read per strategy
+
+struct strategy
+{
+    const char *name;
+    int file;    // 1: through f_read, in chunks of `size` bytes. 2: file_stream_read
+    u32 size;    // sectors per disk_read or file_stream_read, or bytes per f_read
+};
+
+static const struct strategy strategies[] = {
+    {"disk_read x1 (CMD17)", 0, 1},
+    {"disk_read x2 (CMD18)", 0, 2},
+    {"disk_read x8 (CMD18)", 0, 8},
+    {"disk_read x32 (CMD18)", 0, 32},
+    {"disk_read x128 (CMD18)", 0, 128},
+    {"f_read 64B", 1, 64},
+    {"f_read 512B", 1, 512},
+    {"f_read 4KB", 1, 4096},
+    {"f_read 32KB", 1, 32768},
+    {"file_stream x8", 2, 8},
+    {"file_stream x64", 2, 64},
+};
+
+static const u8 throttles[] = {0, 1, 3, 7};
+
+static const struct
+{
+    const char *name;
+    u8 bus;
+} buses[] = {
+    {"SPI", SD_BUS_SPI},
+    {"native 1 bit", SD_BUS_1BIT},
+    {"native 4 bit", SD_BUS_4BIT},
+};
+
+static struct sd_card card;
+static struct fat_image img;
+static struct spi sd_spi;
+static FATFS fs;
+static FIL file;
+static struct file_stream stream;
+static u8 *data_bin;
+static u8 *buf;
+
+static u32 cycles_per_access = 20;
+static int failures;
+
+static void setup(u32 nac_us){
+    u8 *image = malloc(SD_SECTORS * 512);
+    data_bin = malloc(DATA_BIN_BYTES);
+    buf = malloc(SWEEP_BYTES);
+    for (u32 i = 0; i < DATA_BIN_BYTES; i++){
+        data_bin[i] = i * 7 + (i >> 9);
+    }
+    if (fat_image_format(&img, image, SD_SECTORS, 2) ||
+        fat_image_add_file(&img, "DATA.BIN", data_bin, DATA_BIN_BYTES)){
+        printf("could not build the SD card image\n");
+        exit(1);
+    }
+    sd_card_init(&card, image, SD_SECTORS);
+    card.nac_us = nac_us;
+    sd_card_attach(&card);
+    spi_init(&sd_spi, (volatile void *)PLATFORM_SD_SPI_BASE);
+}
+
+// DATA.BIN is the first file, so it starts at the first data sector
+static int run_strategy(const struct strategy *s){
+    u32 sector = img.data_start;
+    if (!s->file){
+        for (u32 done = 0; done < SWEEP_BYTES; done += s->size * 512){
+            if (disk_read(0, &buf[done], sector + done / 512, s->size) != RES_OK){
+                return -1;
+            }
+        }
+        return 0;
+    }
+    UINT got;
+    if (f_open(&file, "DATA.BIN", FA_READ) != FR_OK){
+        return -1;
+    }
+    if (s->file == 2){
+        u32 bytes;
+        if (file_stream_open(&stream, &file) != FR_OK){
+            return -1;
+        }
+        for (u32 done = 0; done < SWEEP_BYTES; done += s->size * 512){
+            if (file_stream_read(&stream, &buf[done], s->size, &bytes) != FR_OK || bytes != s->size * 512){
+                return -1;
+            }
+        }
+        return f_close(&file) == FR_OK ? 0 : -1;
+    }
+    for (u32 done = 0; done < SWEEP_BYTES; done += s->size){
+        if (f_read(&file, &buf[done], s->size, &got) != FR_OK || got != s->size){
+            f_close(&file);
+            return -1;
+        }
+    }
+    return f_close(&file) == FR_OK ? 0 : -1;
+}
+
+// KB/s for one strategy, or a negative number if it read the wrong data
+static double measure(const struct strategy *s, u8 throttle, u32 read_ahead, u32 *nac_bytes, u64 *bus_ops){
+    // start each run cold, mounting also resets the throttle to SD_SPI_THROTTLE_RUN
+    f_mount(&fs, "", 1);
+    spi_set_throttle(&sd_spi, throttle);
+    sd_set_read_ahead(read_ahead);
+
+    u64 clocks = hosted_spi_clocks + hosted_sd_clocks;
+    u64 ops = hosted_bus_reads + hosted_bus_writes;
+    u32 nac = card.nac_bytes;
+    int err = run_strategy(s);
+    sd_read_ahead_stop(); // the CMD12 of an open stream is part of the cost
+    clocks = hosted_spi_clocks + hosted_sd_clocks - clocks;
+    *bus_ops = hosted_bus_reads + hosted_bus_writes - ops;
+    *nac_bytes = card.nac_bytes - nac;
+
+    if (err || memcmp(buf, data_bin, SWEEP_BYTES) != 0){
+        printf("FAIL: %s at throttle %u, read-ahead %u read the wrong data\n", s->name, throttle, read_ahead);
+        failures++;
+        return -1;
+    }
+    return SWEEP_BYTES / 1024 / ((double)(clocks + *bus_ops * cycles_per_access) / REFCLK);
+}
+
+static void sweep(void){
+    printf("%-24s %8s %10s %10s %10s %10s %10s %8s\n", "strategy", "throttle", "SCK kHz", "Nac bytes", "bus ops", "KB/s",
+           "read-ahead", "RA hits");
+    for (unsigned t = 0; t < sizeof(throttles); t++){
+        for (unsigned i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++){
+            const struct strategy *s = &strategies[i];
+            u32 nac, nac_ra;
+            u64 ops, ops_ra;
+            struct sd_read_ahead_stats before, after;
+
+            double kbs = measure(s, throttles[t], 0, &nac, &ops);
+            sd_get_read_ahead_stats(&before);
+            double kbs_ra = measure(s, throttles[t], SD_READ_AHEAD_SECTORS, &nac_ra, &ops_ra);
+            sd_get_read_ahead_stats(&after);
+            printf("%-24s %8u %10u %10u %10llu %10.1f %10.1f %8u\n", s->name, throttles[t],
+                   REFCLK / (2 * (throttles[t] + 1)) / 1000, nac, (unsigned long long)ops, kbs, kbs_ra, after.hits - before.hits);
+        }
+    }
+}
+
+// the strategies over each bus at its fastest clock (the throttle only applies to SPI)
+static void bus_compare(void){
+    static const unsigned picks[] = {0, 2, 4, 7, 10}; // x1, x8, x128, f_read 4KB, file_stream x64
+    double spi_kbs[sizeof(picks) / sizeof(picks[0])];
+
+    printf("\n%-24s %-14s %10s %10s %10s %8s\n", "strategy", "bus", "SD kHz", "bus ops", "KB/s", "vs SPI");
+    for (unsigned b = 0; b < sizeof(buses) / sizeof(buses[0]); b++){
+        sd_set_bus(buses[b].bus);
+        for (unsigned i = 0; i < sizeof(picks) / sizeof(picks[0]); i++){
+            const struct strategy *s = &strategies[picks[i]];
+            u32 nac;
+            u64 ops;
+            double kbs = measure(s, 0, SD_READ_AHEAD_SECTORS, &nac, &ops);
+            u32 khz = buses[b].bus == SD_BUS_SPI ? REFCLK / 2 / 1000 :
+                      REFCLK / (2 * ((read_u32(SD_HOST_CLK) & SD_HOST_CLK_DIV_MASK) + 1)) / 1000;
+            if (b == 0){
+                spi_kbs[i] = kbs;
+            }
+            printf("%-24s %-14s %10u %10llu %10.1f %7.1fx\n", s->name, buses[b].name, khz, (unsigned long long)ops,
+                   kbs, kbs / spi_kbs[i]);
+        }
+    }
+    sd_set_bus(SD_BUS_DEFAULT);
+}
+
+// read `sectors` blocks one at a time, returns how many disk_read reported as failed
+static u32 read_errors(u32 sectors){
+    u32 errors = 0;
+    for (u32 i = 0; i < sectors; i++){
+        if (disk_read(0, buf, img.data_start + i, 1) != RES_OK){
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static void error_injection(u8 bus, const char *name){
+    printf("\nerror injection, %s (64 single block reads)\n", name);
+    sd_set_bus(bus);
+    f_mount(&fs, "", 1);
+    sd_set_read_ahead(0);
+
+    card.crc_error_every = 5;
+    u32 injected = card.crc_errors_injected;
+    u32 errors = read_errors(64);
+    printf("%-40s %u injected, %u reported\n", "data CRC16 corrupted every 5th block", card.crc_errors_injected - injected, errors);
+    card.crc_error_every = 0;
+
+    card.read_error_sector = img.data_start + 10;
+    errors = read_errors(64);
+    printf("%-40s 1 injected, %u reported\n", "data error for one sector", errors);
+    card.read_error_sector = SD_MODEL_NO_SECTOR;
+    sd_set_bus(SD_BUS_DEFAULT);
+}
+
+int main(int argc, char **argv){
+    u32 nac_us = argc > 1 ? strtoul(argv[1], NULL, 0) : SD_MODEL_NAC_US;
+    if (argc > 2){
+        cycles_per_access = strtoul(argv[2], NULL, 0);
+    }
+
+    hosted_init();
+    console_init();
+    setup(nac_us);
+    printf("REFCLK %u Hz, Nac %u us, %u CPU cycles per bus access, %u KB per strategy\n\n", REFCLK, nac_us,
+           cycles_per_access, SWEEP_BYTES / 1024);
+
+    sweep();
+    bus_compare();
+    for (unsigned b = 0; b < sizeof(buses) / sizeof(buses[0]); b++){
+        error_injection(buses[b].bus, buses[b].name);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+#include "image_load.h"
+
+static struct file_stream image_file_stream;
+
+static u32 bmp_u32(const u8 *p){
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+// read `offset` + h lines of `stride` bytes of the file into buf, blitting each line at x, y
+// (y is the top line, also for flipped images) with cmd as they arrive
+static FRESULT image_stream(FIL *fp, u8 *buf, u32 offset, u32 stride, u32 x, u32 y, u32 w, u32 h, u32 cmd){
+    u32 end = offset + h * stride;
+    if (end > f_size(fp)){
+        return FR_INVALID_PARAMETER; // truncated
+    }
+    if (cmd != IMAGE_NO_BLIT && end > IMAGE_STAGING_SIZE){
+        return FR_NOT_ENOUGH_CORE;
+    }
+    struct file_stream *s = &image_file_stream;
+    FRESULT res = file_stream_open(s, fp);
+    if (res == FR_OK){
+        res = file_stream_start(s, buf, (end + SD_BYTES_PER_BLOCK - 1) / SD_BYTES_PER_BLOCK);
+    }
+    if (res != FR_OK){
+        return res;
+    }
+
+    u32 done = 0; // lines handed to the blitter
+    int left;
+    do {
+        left = file_stream_poll(s);
+        if (left < 0 || cmd == IMAGE_NO_BLIT || (left % IMAGE_BATCH_SECTORS && left)){
+            continue;
+        }
+        u32 got = s->buf - buf;
+        u32 lines = got < offset ? 0 : (got - offset) / stride;
+        lines = lines < h ? lines : h;
+        if (lines > done){
+            u32 n = lines - done;
+            u32 dst_y = get_bit(cmd, BLIT_CMD_FLIP_BIT) ? y + h - lines : y + done;
+            blit_image(x, dst_y, (u32)buf + offset + done * stride, stride, w, n, cmd);
+            done = lines;
+        }
+    } while (left > 0);
+
+    blit_wait();
+    return left < 0 ? s->error : FR_OK;
+}
+
+// draw a 24bpp or 32bpp uncompressed BMP (opened with f_open()) with its top left corner at x, y
+// of the back buffer. Returns FR_INVALID_PARAMETER for other formats or if it doesn't fit
+FRESULT image_load_bmp(FIL *fp, u32 x, u32 y){
+    u8 hdr[BMP_HEADER_BYTES];
+    UINT got;
+    FRESULT res = f_read(fp, hdr, sizeof(hdr), &got);
+    if (res != FR_OK){
+        return res;
+    }
+    if (got != sizeof(hdr) || hdr[0] != 'B' || hdr[1] != 'M'){
+        return FR_INVALID_PARAMETER;
+    }
+    u32 offset = bmp_u32(&hdr[10]);
+    s32 width = bmp_u32(&hdr[18]);
+    s32 height = bmp_u32(&hdr[22]);
+    u32 bpp = hdr[28] | (hdr[29] << 8);
+    u32 compression = bmp_u32(&hdr[30]);
+
+    u32 w = width;
+    u32 h = height < 0 ? -height : height;
+    u32 cmd = height < 0 ? 0 : _BV(BLIT_CMD_FLIP_BIT);
+    u32 stride;
+    if (bpp == 24 && compression == BMP_BI_RGB){
+        cmd |= BLIT_OP_RGB24;
+        stride = (w * 3 + 3) & ~3;
+    } else if (bpp == 32 && (compression == BMP_BI_RGB || compression == BMP_BI_BITFIELDS) && offset % 4 == 0){
+        cmd |= BLIT_OP_COPY; // assumes the usual xRGB masks for BI_BITFIELDS
+        stride = w * 4;
+    } else {
+        return FR_INVALID_PARAMETER;
+    }
+    if (width <= 0 || x + w > pixels_x || y + h > pixels_y){
+        return FR_INVALID_PARAMETER;
+    }
+    return image_stream(fp, (u8 *)(uintptr_t)IMAGE_STAGING_ADDR, offset, stride, x, y, w, h, cmd);
+}
+
+// draw a headerless w*h xRGB image, lines `stride` bytes apart (a multiple of 4)
+FRESULT image_load_raw(FIL *fp, u32 x, u32 y, u32 w, u32 h, u32 stride){
+    if (x + w > pixels_x || y + h > pixels_y || stride % 4){
+        return FR_INVALID_PARAMETER;
+    }
+    if (x == 0 && stride == (1u << pixel_line_shift)){
+        blit_wait(); // nothing else drawing under the read
+        return image_stream(fp, (u8 *)(uintptr_t)pixel_address_calc(0, y), 0, stride, x, y, w, h, IMAGE_NO_BLIT);
+    }
+    return image_stream(fp, (u8 *)(uintptr_t)IMAGE_STAGING_ADDR, 0, stride, x, y, w, h, BLIT_OP_COPY);
+}
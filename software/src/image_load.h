@@ -0,0 +1,44 @@
+#ifndef _IMAGE_LOAD_H_
+#define _IMAGE_LOAD_H_
+/*
+ *  Images from the SD card into the back buffer (PYNQ framebuffer)
+
+    The file is streamed with file_stream, so each contiguous run of its clusters is one CMD18,
+    and the blitter converts the pixels behind the read, a batch of whole lines at a time:
+    - 24bpp BMP: read into a staging area in DDR after the two framebuffers, then RGB24 blits
+      expand the packed B, G, R lines (padded to 4 bytes) to xRGB. BMPs are stored bottom line
+      first unless the height is negative, CMD.FLIP turns them the right way up.
+    - 32bpp BMP: the same with COPY, only if the pixel data is word aligned in the file
+    - raw xRGB: `stride` bytes per line, top line first. With the framebuffer's own stride
+      (4KB at 640x480) and x = 0 the file is read straight into the back buffer, nothing to copy
+
+    The card is read over SPI: simple_soc has wb_spi at 0x7000_0000 with the card on Pmod JA
+    (a Pmod MicroSD), build the firmware after make platform BOARD=pynq_z2 so mmc.c finds it there.
+    The staging area holds the whole image, so the reads never wait for the blitter. A 640x480
+    BMP is 900KB, 1800 sectors, and the load takes as long as the card takes to read them: about
+    1.5s over SPI (make sd_sweep). make hosted runs the loader against the device models.
+    Pixels go to the back buffer (on screen until the first flip), call pixel_flip() to show them.
+ */
+
+#include "pixel_display.h"
+#include "file_stream.h"
+#include "mmc_device.h"
+
+#define IMAGE_STAGING_ADDR (FRAMEBUF_BASE_ADDR + 2 * FRAMEBUF_SIZE)
+#define IMAGE_STAGING_SIZE FRAMEBUF_SIZE
+// sectors read between handing the lines that have arrived to the blitter
+#define IMAGE_BATCH_SECTORS 16
+// image_stream() cmd for a file read straight into the back buffer
+#define IMAGE_NO_BLIT 0xFFFFFFFF
+
+#define BMP_HEADER_BYTES 54 // BITMAPFILEHEADER + BITMAPINFOHEADER
+#define BMP_BI_RGB 0
+#define BMP_BI_BITFIELDS 3
+
+// draw a 24bpp or 32bpp uncompressed BMP (opened with f_open()) with its top left corner at x, y
+// of the back buffer. Returns FR_INVALID_PARAMETER for other formats or if it doesn't fit
+FRESULT image_load_bmp(FIL *fp, u32 x, u32 y);
+// draw a headerless w*h xRGB image, lines `stride` bytes apart (a multiple of 4)
+FRESULT image_load_raw(FIL *fp, u32 x, u32 y, u32 w, u32 h, u32 stride);
+
+#endif // _IMAGE_LOAD_H_
@@ -0,0 +1,128 @@
+#include "file_stream.h"
+
+#include "mmc_device.h"
+#include "diskio.h"
+
+#if !FF_USE_FASTSEEK
+#error "file_stream needs FF_USE_FASTSEEK in ffconf.h"
+#endif
+
+FRESULT file_stream_open(struct file_stream *s, FIL *fp){
+    s->file = fp;
+    s->sector = 0;
+    s->sectors = (f_size(fp) + SD_BYTES_PER_BLOCK - 1) / SD_BYTES_PER_BLOCK;
+    s->pending = 0;
+    s->run_left = 0;
+    s->error = FR_OK;
+
+    s->clmt[0] = FILE_STREAM_CLMT_LEN;
+    fp->cltbl = s->clmt;
+    FRESULT res = f_lseek(fp, CREATE_LINKMAP);
+    if (res != FR_OK){
+        fp->cltbl = 0;
+    }
+    return res;
+}
+
+FRESULT file_stream_seek(struct file_stream *s, u32 sector){
+    if (s->pending){
+        return FR_DENIED;
+    }
+    s->sector = sector < s->sectors ? sector : s->sectors;
+    return FR_OK;
+}
+
+// card sector for a sector of the file, and how many follow it contiguously
+static int locate(struct file_stream *s, u32 sector, u32 *lba, u32 *run){
+    FATFS *fs = s->file->obj.fs;
+    u32 cluster = sector / fs->csize;
+    u32 offset = sector % fs->csize;
+
+    // the map is (length, first cluster) for each fragment, with contiguous clusters merged
+    for (DWORD *frag = &s->clmt[1]; frag[0]; frag += 2){
+        if (cluster < frag[0]){
+            *lba = fs->database + (frag[1] + cluster - 2) * fs->csize + offset;
+            *run = (frag[0] - cluster) * fs->csize - offset;
+            return 0;
+        }
+        cluster -= frag[0];
+    }
+    return -1;
+}
+
+FRESULT file_stream_start(struct file_stream *s, void *buf, u32 sectors){
+    if (s->pending){
+        return FR_DENIED;
+    }
+    if (disk_status(s->file->obj.fs->pdrv) & STA_NOINIT){
+        return FR_NOT_READY;
+    }
+    u32 left = s->sectors - s->sector;
+    s->buf = buf;
+    s->pending = sectors < left ? sectors : left;
+    s->error = FR_OK;
+    return FR_OK;
+}
+
+static void stream_error(struct file_stream *s, FRESULT res){
+    if (s->run_left){
+        sd_read_multi_stop();
+        s->run_left = 0;
+    }
+    s->pending = 0;
+    s->error = res;
+}
+
+int file_stream_poll(struct file_stream *s){
+    if (s->error != FR_OK){
+        return -1;
+    }
+    if (!s->pending){
+        return 0;
+    }
+    if (!s->run_left){
+        u32 lba, run;
+        if (locate(s, s->sector, &lba, &run) != 0){
+            stream_error(s, FR_INT_ERR);
+            return -1;
+        }
+        if (sd_read_multi_start(lba) != R1_VALUE_READY){
+            sd_read_multi_stop();
+            stream_error(s, FR_DISK_ERR);
+            return -1;
+        }
+        s->run_left = run < s->pending ? run : s->pending;
+    }
+    if (sd_read_multi_next(s->buf) != 0){
+        stream_error(s, FR_DISK_ERR);
+        return -1;
+    }
+    s->buf += SD_BYTES_PER_BLOCK;
+    s->sector++;
+    s->pending--;
+    if (--s->run_left == 0){
+        sd_read_multi_stop();
+    }
+    return s->pending;
+}
+
+FRESULT file_stream_read(struct file_stream *s, void *buf, u32 sectors, u32 *bytes_read){
+    u32 start = s->sector;
+    *bytes_read = 0;
+    FRESULT res = file_stream_start(s, buf, sectors);
+    if (res != FR_OK){
+        return res;
+    }
+    int left;
+    while ((left = file_stream_poll(s)) > 0){
+    }
+    if (left < 0){
+        return s->error;
+    }
+    u32 end = s->sector * SD_BYTES_PER_BLOCK;
+    if (end > f_size(s->file)){
+        end = f_size(s->file);
+    }
+    *bytes_read = end - start * SD_BYTES_PER_BLOCK;
+    return FR_OK;
+}
@@ -0,0 +1,53 @@
+#ifndef _FILE_STREAM_H_
+#define _FILE_STREAM_H_
+/*
+ *  Streaming file reads, from the SD card straight into the caller's buffer
+
+    For large assets (images, fonts, overlays). f_read() goes a cluster at a time and through
+    the FatFs sector window for anything unaligned. This finds the file's contiguous runs of
+    clusters from a fast-seek cluster link map and reads each run with one CMD18, so a file
+    that is not fragmented streams at the card's sequential speed.
+
+    Reads are whole sectors, so buffers are a multiple of 512B. The stream keeps its own
+    position and does not move the FIL's, f_lseek() before going back to f_read() on the same
+    file. The map is also used by f_read()/f_lseek() on the FIL while the stream is in use.
+
+    file_stream_start() and file_stream_poll() split a read up a sector at a time, so the CPU
+    (which is the one clocking the SPI bus) can do other work between sectors.
+ */
+
+#include "ff.h"
+#include "utils.h"
+
+// cluster link map length, 2 per fragment plus 2: enough for 15 fragments
+#define FILE_STREAM_CLMT_LEN 32
+
+struct file_stream
+{
+    FIL *file;
+    DWORD clmt[FILE_STREAM_CLMT_LEN];
+    u32 sector;  // next sector of the file
+    u32 sectors; // sectors in the file
+
+    // read in progress
+    u8 *buf;
+    u32 pending;  // sectors still to read
+    u32 run_left; // sectors left in the open CMD18, 0 if there isn't one
+    FRESULT error;
+};
+
+// set up a stream on a file opened with f_open(). Returns FR_NOT_ENOUGH_CORE if it is too
+// fragmented for the cluster link map
+FRESULT file_stream_open(struct file_stream *s, FIL *fp);
+// move to a sector of the file
+FRESULT file_stream_seek(struct file_stream *s, u32 sector);
+// read up to `sectors` sectors into buf, *bytes_read stops at the end of the file
+FRESULT file_stream_read(struct file_stream *s, void *buf, u32 sectors, u32 *bytes_read);
+
+// start reading the next `sectors` sectors into buf, then call file_stream_poll() until it
+// returns 0 (done) or -1 (error, in s->error)
+FRESULT file_stream_start(struct file_stream *s, void *buf, u32 sectors);
+// read one sector, returns the number still to read
+int file_stream_poll(struct file_stream *s);
+
+#endif // _FILE_STREAM_H_
@@ -1,11 +1,19 @@
 
 #include "mmc_device.h"
 #include "platform.h"
+#include "dma.h"
 #include "spi.h"
+#include "sd_host.h"
 #include "utils.h"
 
 #include "printf.h"
 
+#include <string.h>
+
+#if SD_HW_CRC
+#include "crc.h"
+#endif
+
 // #include "timer.h"
 #include "ff.h"    // for typedefs
 #include "diskio.h"
@@ -46,11 +54,46 @@
 #define CMD12_ARG 0x00000000
 #define CMD12_CRC 0x00  // not required
 
+// native bus only
+#define CMD2 2      // All Send CID
+#define CMD3 3      // Send Relative Address
+#define CMD6 6      // Switch Function
+#define CMD6_HS_ARG 0x80FFFFF1 // switch function group 1 to high speed
+#define CMD7 7      // Select Card
+#define ACMD6 6     // Set Bus Width
+#define ACMD6_4BIT 0x2
+#define ACMD41_NATIVE_ARG (ACMD41_ARG | 0x00FF8000) // the voltage window is not optional here
+#define OCR_READY 0x80000000
+#define CARD_STATUS_ERRORS 0xFFF80000 // out of range to CC error
+
 
 static struct spi sd_spi;
+static u8 sd_bus = SD_BUS_DEFAULT;
+static u8 sd_bus_active = SD_BUS_SPI; // the bus the card was initialised on
+static u16 sd_rca;
+static u32 sd_bounce[SD_BYTES_PER_BLOCK / 4]; // for buffers the native DMA can't take
 
 static DSTATUS SD_DISK_STATUS = STA_NOINIT;
-
+static u32 sd_data_crc_errors = 0; // blocks received with a bad CRC16
+static u32 sd_data_token_errors = 0; // error tokens, or no token at all
+
+// Read-ahead: disk_read() leaves its CMD18 running, so a read that carries on from where the
+// last one stopped needs no command or Nac wait. Once reads are sequential, the ring is kept
+// topped up to sd_read_ahead sectors past the last one, for FatFs's sector at a time reads to
+// hit. A read anywhere else stops the stream (CMD12) and starts a new one.
+//
+// The ring holds the ra_count sectors before ra_next (the sector the card sends next), each in
+// slot (sector % SD_READ_AHEAD_MAX)
+static u8 ra_ring[SD_READ_AHEAD_MAX][SD_BYTES_PER_BLOCK] __attribute__((aligned(4)));
+static u32 sd_read_ahead = SD_READ_AHEAD_SECTORS;
+static int ra_open = 0;     // CMD18 in progress
+static u32 ra_next = 0;
+static u32 ra_count = 0;
+static u32 ra_last_end = 0; // sector after the last disk_read()
+static struct sd_read_ahead_stats ra_stats;
+
+static DSTATUS native_initialize();
+static u8 native_read_blocks(u8 *buf, u32 sector, u32 count);
 
 
 // Intitialise disk "pdrv" (only disk 0 is supported for now)
@@ -60,6 +103,12 @@ DSTATUS disk_initialize (BYTE pdrv){
         return STA_NODISK;
     }
     printf_("\nStarting Disk Initialisation...\n");
+    ra_open = 0;
+    ra_count = 0;
+    if (sd_bus != SD_BUS_SPI){
+        return native_initialize();
+    }
+    sd_bus_active = SD_BUS_SPI;
     spi_init(&sd_spi, (volatile void *)PLATFORM_SD_SPI_BASE);
     printf_("Setting SD SPI Speed to ~200KHz\n");
     spi_set_throttle(&sd_spi, SD_SPI_THROTTLE_INIT); // set speed to 200KHz for SD card initialisation
@@ -107,40 +156,101 @@ DRESULT disk_read (BYTE pdrv, BYTE* buff, LBA_t sector, UINT count){
     if (SD_DISK_STATUS & STA_NOINIT){
         return RES_NOTRDY;
     }
+    if (sd_read_ahead){
+        return sd_read_ahead_read(buff, sector, count);
+    }
+    u32 errors = sd_data_crc_errors + sd_data_token_errors;
     if (count == 1){
         sd_read_single_block(buff, sector);
     } else {
         sd_read_multi_block(buff, sector, count);
     }
+    if (sd_data_crc_errors + sd_data_token_errors != errors){
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+// read through the read-ahead stream, see above
+int sd_read_ahead_read(u8 *buf, u32 sector, u32 count){
+    int sequential = sector == ra_last_end;
+    ra_last_end = sector + count;
+
+    for (; count; count--, sector++, buf += SD_BYTES_PER_BLOCK){
+        if (sector < ra_next && sector >= ra_next - ra_count){
+            dma_memcpy(buf, ra_ring[sector % SD_READ_AHEAD_MAX], SD_BYTES_PER_BLOCK); // whole sectors, worth the DMA
+            ra_stats.hits++;
+            continue;
+        }
+        if (!ra_open || sector != ra_next){
+            u8 res = sd_read_multi_start(sector); // stops the old stream
+            if (res != R1_VALUE_READY){
+                sd_print_r1(res);
+                sd_read_multi_stop();
+                return RES_ERROR;
+            }
+            ra_open = 1;
+            ra_next = sector;
+            ra_stats.streams++;
+        }
+        // straight into the caller's buffer, which leaves nothing in the ring
+        ra_count = 0;
+        ra_next++;
+        ra_stats.misses++;
+        if (sd_read_multi_next(buf) != 0){
+            sd_read_ahead_stop();
+            return RES_ERROR;
+        }
+    }
+
+    if (sequential && ra_open){
+        // top up to sd_read_ahead sectors past this read, the ring is only as big as that
+        while (ra_next - ra_last_end < sd_read_ahead){
+            if (sd_read_multi_next(ra_ring[ra_next % SD_READ_AHEAD_MAX]) != 0){
+                sd_read_ahead_stop(); // not this read's problem, the next one will try again
+                break;
+            }
+            ra_next++;
+            ra_count = ra_count < SD_READ_AHEAD_MAX ? ra_count + 1 : SD_READ_AHEAD_MAX;
+            ra_stats.prefetched++;
+        }
+    }
     return RES_OK;
 }
 
+// stop the read-ahead stream, if there is one
+void sd_read_ahead_stop(){
+    if (ra_open){
+        ra_open = 0;
+        sd_read_multi_stop();
+    }
+    ra_count = 0;
+}
+
+// sectors to prefetch, 0 to turn read-ahead off (up to SD_READ_AHEAD_MAX)
+void sd_set_read_ahead(u32 sectors){
+    sd_read_ahead_stop();
+    sd_read_ahead = sectors < SD_READ_AHEAD_MAX ? sectors : SD_READ_AHEAD_MAX;
+}
+
+void sd_get_read_ahead_stats(struct sd_read_ahead_stats *stats){
+    *stats = ra_stats;
+}
+
 u8 sd_read_single_block(u8 *buf, u32 sector){
     // TODO accept token as pointer arg so we can check it
     printf_("Reading block %i...\n", sector);
+    sd_read_ahead_stop();
+    if (sd_bus_active != SD_BUS_SPI){
+        return native_read_blocks(buf, sector, 1);
+    }
     sd_spi_start();
     sd_command(CMD17, sector, CMD17_CRC);   // single block read
     u8 res = sd_response_r1();
     sd_print_r1(res);
 
-    u8 token;
-    // poll until data start token received, TODO add ~100ms timeout
-    while((token = spi_read_byte(&sd_spi)) == 0xff){
-        // printf_("spi read byte: 0x%x\n", token);
-        // if(i > 8) break; // timeout and return 0xFF
-    }
-    printf_("token: 0x%x\n", token);
-    // printf_("data:\n", token);
-    if (token == START_BLOCK){
-        //read 512B data block
-        for (u16 i = 0; i < SD_BYTES_PER_BLOCK;i++){
-            buf[i] = spi_read_byte(&sd_spi);
-            // printf_("0x%x ", buf[i]);
-        }
-        // printf_("Data Done\n");
-        //read and bin 2-byte CRC
-        spi_read_byte(&sd_spi);
-        spi_read_byte(&sd_spi);
+    if (sd_wait_data_token() == START_BLOCK){
+        sd_read_data_block(buf);
     }
 
     sd_spi_stop();
@@ -149,47 +259,148 @@ u8 sd_read_single_block(u8 *buf, u32 sector){
 
 u8 sd_read_multi_block(u8 *buf, u32 sector, u32 count){
     printf_("Reading %i blocks starting from %i...\n", count, sector);
+    if (sd_bus_active != SD_BUS_SPI && ((u32)buf & 0x3) == 0){
+        // all in one go with the DMA, no need to stream
+        sd_read_ahead_stop();
+        return native_read_blocks(buf, sector, count);
+    }
+    u8 res = sd_read_multi_start(sector);
+    if (res != R1_VALUE_READY){
+        sd_print_r1(res);
+        sd_read_multi_stop();
+        return res;
+    }
+    // read each block in turn
+    for (u32 j = 0; j < count; j++){
+        if (sd_read_multi_next(&buf[SD_BYTES_PER_BLOCK*j]) != 0){
+            break;
+        }
+    }
+    res = sd_read_multi_stop();
+    printf_("Done Reading %i blocks starting from %i\n", count, sector);
+    return res;
+}
+
+// Multi block read in steps, for streaming straight into the caller's buffers:
+// sd_read_multi_start(), then sd_read_multi_next() for each block, then sd_read_multi_stop()
+u8 sd_read_multi_start(u32 sector){
+    sd_read_ahead_stop();
+    if (sd_bus_active != SD_BUS_SPI){
+        return sd_host_stream_start(CMD18, sector) ? R1_MSB : R1_VALUE_READY;
+    }
     sd_spi_start();
     sd_command(CMD18, sector, CMD18_CRC);   // multi block read
-    u8 res = sd_response_r1();
-    sd_print_r1(res);
-
-    u8 token;
+    return sd_response_r1();
+}
 
-    // read each block in turn
-    for (u32 j = 0; j < count; j++){
-        // poll until data start token received, TODO add ~100ms timeout
-        while((token = spi_read_byte(&sd_spi)) == 0xff){
-            // printf_("spi read byte: 0x%x\n", token);
-            // if(i > 8) break; // timeout and return 0xFF
+// Returns 0, or -1 if the card sent an error token (or none) or the CRC16 did not match
+int sd_read_multi_next(u8 *buf){
+    if (sd_bus_active != SD_BUS_SPI){
+        u8 *dst = ((u32)buf & 0x3) ? (u8 *)sd_bounce : buf;
+        u32 errors = sd_host_stream_next(dst);
+        if (dst != buf){
+            dma_memcpy(buf, dst, SD_BYTES_PER_BLOCK);
         }
-        printf_("token: 0x%x\n", token);
-        // printf_("data:\n", token);
-        if (token == START_BLOCK){
-            //read 512B data block
-            for (u16 i = 0; i < SD_BYTES_PER_BLOCK;i++){
-                buf[SD_BYTES_PER_BLOCK*j + i] = spi_read_byte(&sd_spi);
-                // printf_("0x%x ", buf[i]);
-            }
-            // printf_("Data Done\n");
-            //read and bin 2-byte CRC
-            spi_read_byte(&sd_spi);
-            spi_read_byte(&sd_spi);
+        if (get_bit(errors, SD_HOST_STATUS_DATA_CRC_BIT)){
+            printf_("Data CRC Error\n");
+            sd_data_crc_errors++;
+        } else if (errors){
+            printf_("Data error: 0x%x\n", errors);
+            sd_data_token_errors++;
         }
-
+        return errors ? -1 : 0;
     }
+    if (sd_wait_data_token() != START_BLOCK){
+        return -1;
+    }
+    return sd_read_data_block(buf);
+}
 
-    // send STOP_TRANSMISSION
+// send STOP_TRANSMISSION and release the card, returns the CMD12 R1
+u8 sd_read_multi_stop(){
+    if (sd_bus_active != SD_BUS_SPI){
+        sd_host_stream_stop();
+        return sd_host_command(CMD12, CMD12_ARG, SD_HOST_RESP_R1B, NULL) ? R1_MSB : R1_VALUE_READY;
+    }
     sd_command(CMD12, CMD12_ARG, CMD12_CRC);
     spi_read_byte(&sd_spi); // Discard Stuff Byte before reading CMD12 response - see http://elm-chan.org/docs/mmc/mmc_e.html
-    res = sd_response_r1b();
-    sd_print_r1(res);
-
+    u8 res = sd_response_r1b();
     sd_spi_stop();
-    printf_("Done Reading %i blocks starting from %i\n", count, sector);
     return res;
 }
 
+// poll until the data start token (or an error token) arrives, up to ~100ms
+// Returns the token, 0xFF if there was none
+u8 sd_wait_data_token(){
+    u8 token;
+    u32 polls = 0;
+    while((token = spi_read_byte(&sd_spi)) == 0xff){
+        if (++polls > SD_DATA_TOKEN_POLLS) break;
+    }
+    if (token != START_BLOCK){
+        printf_("Data token error: 0x%x\n", token);
+        sd_data_token_errors++;
+    }
+    return token;
+}
+
+#if !SD_HW_CRC
+// software CRCs for SoCs without wb_crc (see SD_HW_CRC)
+static u8 sd_crc7(const u8 *buf, u32 len){
+    u8 crc = 0;
+    for (u32 i = 0; i < len; i++){
+        crc ^= buf[i];
+        for (u8 b = 0; b < 8; b++){
+            crc = (crc & 0x80) ? (crc << 1) ^ (0x09 << 1) : crc << 1;
+        }
+    }
+    return crc >> 1;
+}
+
+// CRC16-XMODEM a nibble at a time, so a block costs 1024 table lookups rather than 4096 shifts
+static u16 sd_crc16(const u8 *buf, u32 len){
+    static const u16 nibble[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+        0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef};
+    u16 crc = 0;
+    for (u32 i = 0; i < len; i++){
+        crc = (crc << 4) ^ nibble[(crc >> 12) ^ (buf[i] >> 4)];
+        crc = (crc << 4) ^ nibble[(crc >> 12) ^ (buf[i] & 0xF)];
+    }
+    return crc;
+}
+#endif
+
+// read a 512B data block and its CRC16, after the start token
+// Returns 0 if the CRC matched (or is not checked), -1 if not
+int sd_read_data_block(u8 *buf){
+#if SD_HW_CRC
+    // the CRC engine sees every byte as it is received, including the CRC itself,
+    // so a good block leaves a residue of 0
+    crc_setup(&crc16_xmodem);
+    crc_snoop(_BV(CRC_CTRL_SNOOP_RX_BIT));
+#endif
+    for (u16 i = 0; i < SD_BYTES_PER_BLOCK;i++){
+        buf[i] = spi_read_byte(&sd_spi);
+    }
+#if SD_HW_CRC
+    spi_read_byte(&sd_spi);
+    spi_read_byte(&sd_spi);
+    crc_snoop(0);
+    int bad = crc_result() != 0;
+#else
+    u16 crc = (u8)spi_read_byte(&sd_spi) << 8; // MSB first
+    crc |= (u8)spi_read_byte(&sd_spi);
+    int bad = crc != sd_crc16(buf, SD_BYTES_PER_BLOCK);
+#endif
+    if (bad){
+        printf_("Data CRC Error\n");
+        sd_data_crc_errors++;
+        return -1;
+    }
+    return 0;
+}
+
 // set CSn low to start a transaction
 void sd_spi_start(){
     spi_write_byte(&sd_spi, 0xff);
@@ -269,6 +480,12 @@ u8 sd_send_operating_condition(){
 }
 
 void sd_command(u8 cmd, u32 arg, u8 crc){
+#if SD_HW_CRC
+    // calculate the CRC7 as the command goes out instead of using the precalculated one
+    // (without wb_crc it is worked out in software, see sd_crc7())
+    crc_setup(&crc7_sd);
+    crc_snoop(_BV(CRC_CTRL_SNOOP_TX_BIT));
+#endif
     //transmit command
     spi_write_byte(&sd_spi, 0x40 | cmd); // set start bit (0) and transmission bit (1)
 
@@ -278,6 +495,13 @@ void sd_command(u8 cmd, u32 arg, u8 crc){
     spi_write_byte(&sd_spi, (u8)(arg>>8));
     spi_write_byte(&sd_spi, (u8)arg);
 
+#if SD_HW_CRC
+    crc_snoop(0);
+    crc = crc_result() << 1;
+#else
+    u8 msg[5] = {0x40 | cmd, (u8)(arg>>24), (u8)(arg>>16), (u8)(arg>>8), (u8)arg};
+    crc = sd_crc7(msg, sizeof(msg)) << 1;
+#endif
     //transmit crc and stop bit
     spi_write_byte(&sd_spi, crc | 0x01); // set stop bit (1)
 }
@@ -330,6 +554,126 @@ u8 sd_response_r3r7(u8 *res){
     return res[0];
 }
 
+// bus for the next disk_initialize(), one of SD_BUS_*
+void sd_set_bus(u8 bus){
+    sd_read_ahead_stop();
+    sd_bus = bus;
+    SD_DISK_STATUS = STA_NOINIT;
+}
+
+u8 sd_get_bus(){
+    return sd_bus;
+}
+
+/*
+ *  Native SD bus (wb_sd_host)
+
+    Same card, but commands go over CMD with the controller doing the CRC7s, and data over 1 or 4
+    DAT lines with a CRC16 on each, checked by the controller and moved by its DMA. Block reads
+    therefore cost the CPU a few register accesses rather than 2 bus accesses per byte.
+ */
+
+// command without data, returns 0 or the controller's error bits, or the card status errors
+static u32 native_command(u8 index, u32 arg, u32 resp_type, u32 *resp){
+    u32 r[4];
+    u32 errors = sd_host_command(index, arg, resp_type, r);
+    if (errors){
+        printf_("CMD%i error: 0x%x\n", index, errors);
+        return errors;
+    }
+    if (resp){
+        memcpy(resp, r, resp_type == SD_HOST_RESP_R2 ? sizeof(r) : sizeof(r[0]));
+    }
+    if ((resp_type == SD_HOST_RESP_R1 || resp_type == SD_HOST_RESP_R1B) && (r[0] & CARD_STATUS_ERRORS)){
+        printf_("CMD%i card status: 0x%x\n", index, r[0]);
+        return r[0] & CARD_STATUS_ERRORS;
+    }
+    return 0;
+}
+
+static u32 native_app_command(u8 index, u32 arg, u32 resp_type, u32 *resp){
+    u32 errors = native_command(CMD55, (u32)sd_rca << 16, SD_HOST_RESP_R1, NULL);
+    return errors ? errors : native_command(index, arg, resp_type, resp);
+}
+
+static DSTATUS native_initialize(){
+    u32 resp[4];
+    sd_bus_active = sd_bus;
+    sd_rca = 0;
+    sd_host_set_wide(0);
+    printf_("Setting SD clock to %iHz\n", sd_host_set_clock(SD_NATIVE_INIT_SPEED));
+    delay_ms(1); // over 74 clocks before the first command
+
+    native_command(CMD0, CMD0_ARG, SD_HOST_RESP_NONE, NULL);
+    if (native_command(CMD8, CMD8_ARG, SD_HOST_RESP_R1, resp) || (resp[0] & 0xFFF) != CMD8_ARG){
+        printf_("No SD v2 card\n");
+        return STA_NOINIT;
+    }
+    u32 tries = 0;
+    do {
+        if (native_app_command(ACMD41, ACMD41_NATIVE_ARG, SD_HOST_RESP_R3, resp) || ++tries > SD_NATIVE_INIT_TRIES){
+            printf_("Card did not finish powering up\n");
+            return STA_NOINIT;
+        }
+    } while (!(resp[0] & OCR_READY));
+    printf_("OCR: 0x%x\n", resp[0]);
+
+    // CMD3's R6 has the RCA where R1 has the error bits, so it only gets the controller's checks
+    if (native_command(CMD2, 0, SD_HOST_RESP_R2, resp) || sd_host_command(CMD3, 0, SD_HOST_RESP_R1, resp)){
+        return STA_NOINIT;
+    }
+    sd_rca = resp[0] >> 16;
+    printf_("RCA: 0x%x\n", sd_rca);
+    if (native_command(CMD7, (u32)sd_rca << 16, SD_HOST_RESP_R1B, NULL)){
+        return STA_NOINIT;
+    }
+    if (sd_bus == SD_BUS_4BIT){
+        if (native_app_command(ACMD6, ACMD6_4BIT, SD_HOST_RESP_R1, NULL)){
+            return STA_NOINIT;
+        }
+        sd_host_set_wide(1);
+        printf_("4 bit bus\n");
+    }
+
+    u32 speed = SD_NATIVE_RUN_SPEED;
+    if (REFCLK / 2 > SD_NATIVE_RUN_SPEED){
+        // only worth switching if the controller can run the clock faster than default speed
+        u8 *status = (u8 *)sd_bounce;
+        if (sd_host_read_short(CMD6, CMD6_HS_ARG, SD_HOST_RESP_R1, status, 64) == 0 && (status[16] & 0xF) == 1){
+            speed = SD_NATIVE_HS_SPEED;
+            printf_("High speed\n");
+        }
+    }
+    speed = sd_host_set_clock(speed);
+    sd_host_set_data_timeout(speed / 10); // 100ms
+    printf_("Setting SD clock to %iHz\n", speed);
+    SD_DISK_STATUS = 0;
+    printf_("Disk Initialisation Complete!\n\n");
+    return 0;
+}
+
+// known number of blocks, straight into buf with the DMA. Returns the CMD12 R1 like the SPI version
+static u8 native_read_blocks(u8 *buf, u32 sector, u32 count){
+    u8 *dst = ((u32)buf & 0x3) ? (u8 *)sd_bounce : buf; // only when count is 1
+    u32 errors = sd_host_read_blocks(count == 1 ? CMD17 : CMD18, sector, dst, count);
+    if (get_bit(errors, SD_HOST_STATUS_DATA_CRC_BIT)){
+        printf_("Data CRC Error\n");
+        sd_data_crc_errors++;
+    } else if (errors & SD_HOST_STATUS_DATA_ERR_MASK){
+        printf_("Data error: 0x%x\n", errors);
+        sd_data_token_errors++;
+    } else if (errors){
+        sd_data_token_errors++; // no data without the command
+    }
+    if (dst != buf){
+        dma_memcpy(buf, dst, SD_BYTES_PER_BLOCK);
+    }
+    if (count > 1){
+        return native_command(CMD12, CMD12_ARG, SD_HOST_RESP_R1B, NULL) ? R1_MSB : R1_VALUE_READY;
+    }
+    return errors & SD_HOST_STATUS_CMD_ERR_MASK ? R1_MSB : R1_VALUE_READY;
+}
+
 void sd_print_r1(u8 res){
     if(res & R1_MSB){
         printf_("Error: MSB=1\n"); return;
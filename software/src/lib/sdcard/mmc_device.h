@@ -17,6 +17,34 @@
 
 #define SD_BYTES_PER_BLOCK 512
 
+// read-ahead ring in sectors (2KB of RAM), and how many of them disk_read() prefetches once
+// reads are sequential (sd_set_read_ahead() changes it, 0 turns read-ahead off)
+#define SD_READ_AHEAD_MAX 4
+#define SD_READ_AHEAD_SECTORS SD_READ_AHEAD_MAX
+
+// polls for a data token before giving up, ~100ms at the run speed (8 SCKs a poll)
+#define SD_DATA_TOKEN_POLLS (SD_SPI_RUN_SPEED / 8 / 10)
+
+// use wb_crc to generate command CRC7s and check data block CRC16s as they go over SPI. Only when
+// the SoC has one (-DPLATFORM_HAS_CRC), otherwise mmc.c works them out in software
+#ifdef PLATFORM_HAS_CRC
+#define SD_HW_CRC 1
+#else
+#define SD_HW_CRC 0
+#endif
+
+// Bus to the card. SD_BUS_1BIT/4BIT use wb_sd_host (the native SD bus) rather than wb_spi, which
+// needs C_SD_NATIVE in the board wrapper. sd_set_bus() changes it for the next disk_initialize()
+#define SD_BUS_SPI 0
+#define SD_BUS_1BIT 1
+#define SD_BUS_4BIT 4
+#define SD_BUS_DEFAULT SD_BUS_SPI
+
+#define SD_NATIVE_INIT_SPEED 400000
+#define SD_NATIVE_RUN_SPEED 25000000 // default speed
+#define SD_NATIVE_HS_SPEED 50000000  // high speed, after CMD6 (if the SoC clock is over 50MHz)
+#define SD_NATIVE_INIT_TRIES 1000    // ACMD41s before giving up, ~1s at 400KHz
+
 #define R1_MSB 0x80
 #define R1_PARAM_ERR 0x40
 #define R1_ADDR_ERR 0x20
@@ -44,6 +72,14 @@
 #define MULTIWRITE_START_BLOCK 0xfc
 #define STOP_TRAN_TOKEN 0xfd    // for stopping multi-write
 
+struct sd_read_ahead_stats
+{
+    u32 hits;       // sectors served from the ring
+    u32 misses;     // sectors read from the card for the caller
+    u32 prefetched; // sectors read into the ring
+    u32 streams;    // CMD18s started
+};
+
 void sd_spi_start();
 void sd_spi_stop();
 
@@ -60,6 +96,19 @@ u8 sd_send_operating_condition();
 
 u8 sd_read_single_block(u8 *buf, u32 sector);
 u8 sd_read_multi_block(u8 *buf, u32 sector, u32 count);
+u8 sd_read_multi_start(u32 sector);
+int sd_read_multi_next(u8 *buf);
+u8 sd_read_multi_stop();
+u8 sd_wait_data_token();
+
+int sd_read_ahead_read(u8 *buf, u32 sector, u32 count); // returns a DRESULT
+void sd_read_ahead_stop();
+void sd_set_read_ahead(u32 sectors);
+void sd_get_read_ahead_stats(struct sd_read_ahead_stats *stats);
+int sd_read_data_block(u8 *buf);
+
+void sd_set_bus(u8 bus);
+u8 sd_get_bus();
 
 void sd_print_r1(u8 res);
 void sd_print_r3(u8 *res);
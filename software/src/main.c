@@ -15,6 +15,7 @@
 // #include "ssd1306_i2c.h"
 #include "spi.h"
 #include "console.h"
+#include "dma.h"
 
 #include "printf.h"
 #include "ff.h"
@@ -35,6 +36,7 @@ static struct timer timer0;
 
 #define MAIN_USE_FATFS
 // #define MAIN_USE_MEMTEST
+// #define MAIN_USE_DMA_BENCHMARK
 
 
 #define KBYTE 1024
@@ -119,6 +121,10 @@ void main(void)
 
     printf_("Hello World\n");
 
+#if defined(MAIN_USE_DMA_BENCHMARK) && DMA_PRESENT
+    dma_benchmark(&timer0); // sets the CPU/DMA crossover used by dma_memcpy/dma_memset
+#endif
+
     // Test APS6404 PSRAM pmod for correct operation
     u32 PSRAM_KBYTES = 8 * 1024;
 
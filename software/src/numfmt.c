@@ -0,0 +1,75 @@
+#include "numfmt.h"
+
+const char numfmt_hex_upper[16] = "0123456789ABCDEF";
+const char numfmt_hex_lower[16] = "0123456789abcdef";
+
+// Hacker's Delight divu10: q is n * 0.8 (binary 0.110011001100...) then / 8, which can come out
+// at most one low, so the remainder (under 20) tells us when to correct it. 20 or so ALU
+// instructions, checked against / and % for every u32
+u32 divu10(u32 n, u32 *rem){
+    u32 q = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+    u32 r = n - ((q << 3) + (q << 1)); // n - q * 10
+    u32 fix = (r + 6) >> 4;            // 1 if r > 9, without a branch
+    *rem = r - ((fix << 3) + (fix << 1));
+    return q + fix;
+}
+
+u32 fmt_u32(char *buf, u32 val){
+    // lowest digit first
+    char tmp[10];
+    u32 n = 0;
+    do {
+        u32 digit;
+        val = divu10(val, &digit);
+        tmp[n++] = '0' + digit;
+    } while (val);
+    for (u32 i = 0; i < n; i++){
+        buf[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+u32 fmt_s32(char *buf, s32 val){
+    if (val < 0){
+        buf[0] = '-';
+        return 1 + fmt_u32(&buf[1], -(u32)val);
+    }
+    return fmt_u32(buf, val);
+}
+
+u32 fmt_hex(char *buf, u32 val, u32 digits, int upper){
+    const char *table = upper ? numfmt_hex_upper : numfmt_hex_lower;
+    if (digits == 0){
+        digits = 1;
+        while (digits < NUMFMT_HEX_MAX && (val >> (4 * digits))){
+            digits++;
+        }
+    }
+    for (u32 i = digits; i > 0; i--){
+        buf[i - 1] = table[val & 0xF];
+        val >>= 4;
+    }
+    return digits;
+}
+
+u32 fmt_pad(char *buf, u32 len, u32 width, char fill){
+    if (len >= width){
+        return len;
+    }
+    u32 pad = width - len;
+    for (u32 i = len; i > 0; i--){
+        buf[pad + i - 1] = buf[i - 1];
+    }
+    for (u32 i = 0; i < pad; i++){
+        buf[i] = fill;
+    }
+    return width;
+}
+
+u32 fmt_u32_width(char *buf, u32 val, u32 width, char fill){
+    return fmt_pad(buf, fmt_u32(buf, val), width, fill);
+}
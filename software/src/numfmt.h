@@ -0,0 +1,34 @@
+#ifndef _NUMFMT_H_
+#define _NUMFMT_H_
+/*
+ *  Integer to text without dividing
+
+    RV32I has no divide instruction, so each `/ 10` or `% 10` is a libgcc call that loops over
+    the bits, and the old decimal conversion made two of them per digit. Here decimal digits
+    come from divu10(), a multiply by 0.1 made of shifts and adds, and hex digits from a table.
+
+    The fmt_ functions write the digits without a NUL and return how many they wrote.
+ */
+
+#include "utils.h"
+
+#define NUMFMT_DEC_MAX 11 // "-2147483648"
+#define NUMFMT_HEX_MAX 8
+
+extern const char numfmt_hex_upper[16];
+extern const char numfmt_hex_lower[16];
+
+// n / 10, with n % 10 in *rem
+u32 divu10(u32 n, u32 *rem);
+
+// decimal
+u32 fmt_u32(char *buf, u32 val);
+u32 fmt_s32(char *buf, s32 val);
+// `digits` hex digits (the lowest ones if val needs more), or as many as val needs if 0
+u32 fmt_hex(char *buf, u32 val, u32 digits, int upper);
+// right align the `len` chars at buf in `width`, filling on the left. Returns the new length
+u32 fmt_pad(char *buf, u32 len, u32 width, char fill);
+// fmt_u32() right aligned in `width`, eg. fill '0' for zero padding
+u32 fmt_u32_width(char *buf, u32 val, u32 width, char fill);
+
+#endif // _NUMFMT_H_
@@ -0,0 +1,179 @@
+
+#include "pixel_display.h"
+
+// temp, remove after debug done
+#include "zynq_ps_uart.h"
+
+u32 pixels_x = 640;
+u32 pixels_y = 480;
+u32 pixel_line_shift = 12;
+
+// buffer currently being drawn into (set by pixel_display_init()). Buffer 0 is scanned out from
+// reset, and is drawn into until the first flip
+static u32 pixel_back_buf_addr;
+static u8 pixel_double_buffered = 0;
+
+// point the VDMA at our two framebuffers, and draw into the one on screen until the first flip
+void pixel_display_init(void){
+    write_u32(VDMA_BUFFER0_ADDR, FRAMEBUF_CPU_TO_VDMA(FRAMEBUF0_ADDR));
+    write_u32(VDMA_BUFFER1_ADDR, FRAMEBUF_CPU_TO_VDMA(FRAMEBUF1_ADDR));
+    pixel_back_buf_addr = (read_u32(VDMA_STATUS) & (1 << VDMA_STATUS_FRONT_BIT)) ? FRAMEBUF1_ADDR : FRAMEBUF0_ADDR;
+    pixel_double_buffered = 0;
+}
+
+// change the pixel format from the next frame. Only pixel_set()/clear_screen() and the blitter assume 32bpp
+void pixel_set_format(u32 format){
+    write_u32(VDMA_CTRL, (read_u32(VDMA_CTRL) & ~VDMA_CTRL_FORMAT_MASK) | (format << VDMA_CTRL_FORMAT_BIT));
+}
+
+// bank 0 is the colour palette, bank 1 greyscale
+void palette_set(u32 bank, u32 index, u32 rgb){
+    write_u32(VDMA_PALETTE + (bank << 10) + (index << 2), rgb);
+}
+
+void palette_select(u32 bank){
+    write_u32(VDMA_CTRL, (read_u32(VDMA_CTRL) & ~(1 << VDMA_CTRL_PALETTE_BIT)) | (bank << VDMA_CTRL_PALETTE_BIT));
+}
+
+// scan-out tuning: burst_len and max_outstanding are 1-16. Bursts stop once the pixel FIFO
+// reaches fifo_high (words) and restart below fifo_low, leave burst_len * max_outstanding
+// words of headroom above fifo_high for data in flight
+void vdma_tune(u32 burst_len, u32 max_outstanding, u32 fifo_high, u32 fifo_low){
+    write_u32(VDMA_BURST, (max_outstanding << 8) | burst_len);
+    write_u32(VDMA_WATERMARK, (fifo_low << 16) | fifo_high);
+}
+
+// true if the previous frame was scanned out without any missing pixels
+int vdma_frame_ok(void){
+    return read_u32(VDMA_FRAME_UNDERFLOWS) == 0;
+}
+
+// switch resolution from the next frame, and retune the scan-out for the extra bandwidth.
+// The pixel clock switches immediately, so the current frame may be garbled on the monitor
+void pixel_set_timing(u32 timing){
+    if (timing == VDMA_TIMING_1280X720){
+        pixels_x = 1280;
+        pixels_y = 720;
+        pixel_line_shift = 13;
+        vdma_tune(16, 4, 384, 320); // 220MB/s average, leave room for 4 bursts in flight
+    } else {
+        pixels_x = 640;
+        pixels_y = 480;
+        pixel_line_shift = 12;
+        vdma_tune(16, 1, 448, 448); // reset values
+    }
+    write_u32(BLIT_STRIDE, (1 << (pixel_line_shift + 16)) | (1 << pixel_line_shift));
+    write_u32(VDMA_CTRL, (read_u32(VDMA_CTRL) & ~VDMA_CTRL_TIMING_MASK) | (timing << VDMA_CTRL_TIMING_BIT));
+}
+
+// wait until the VDMA has latched the new front buffer
+void pixel_flip_wait(void){
+    while (read_u32(VDMA_STATUS) & (1 << VDMA_STATUS_FLIP_PENDING_BIT)){}
+}
+
+// request that the back buffer is displayed from the next VSYNC, returns immediately.
+// Don't draw until pixel_flip_wait() returns, as the old front buffer is still being scanned out.
+// Waits for a flip that is still pending first, so the back buffer never changes under the VDMA.
+// The first call only starts double buffering: what was drawn is already on screen, and drawing
+// moves to the other buffer
+void pixel_flip_async(void){
+    if (!pixel_double_buffered){
+        pixel_double_buffered = 1;
+    } else {
+        pixel_flip_wait();
+        write_u32(VDMA_CTRL, read_u32(VDMA_CTRL) | (1 << VDMA_CTRL_FLIP_BIT));
+    }
+    pixel_back_buf_addr = (pixel_back_buf_addr == FRAMEBUF0_ADDR) ? FRAMEBUF1_ADDR : FRAMEBUF0_ADDR;
+}
+
+// display the back buffer (without tearing) and start drawing into the old front buffer
+void pixel_flip(void){
+    pixel_flip_async();
+    pixel_flip_wait();
+}
+
+u32 pixel_back_buffer(void){
+    return pixel_back_buf_addr;
+}
+
+void pixel_set(int x, int y, int col){
+    u32 addr = pixel_back_buf_addr + x * 4 + (y << pixel_line_shift);
+    // zynq_ps_uart_puts("addr:\r\n");
+
+    write_u32(addr, col);
+
+    // volatile unsigned long *pixel_loc = (volatile unsigned long *)addr; // cast to pointer
+    // *pixel_loc = col;
+}
+
+void pixel_set_rgb565(int x, int y, u16 col){
+    write_u16(pixel_back_buf_addr + x * 2 + (y << (pixel_line_shift - 1)), col);
+}
+
+void pixel_set_indexed(int x, int y, u8 index){
+    write_u8(pixel_back_buf_addr + x + (y << (pixel_line_shift - 2)), index);
+}
+
+// from working Zynq code
+u32 pixel_address_calc(u32 x, u32 y){
+	u32 addr = pixel_back_buf_addr + x*4 + (y << pixel_line_shift);
+	return addr;
+}
+
+// Blitter commands are queued and return straight away (the CMD write stalls if the queue is full).
+// Call blit_wait() before drawing over blitted pixels with the CPU or flipping buffers
+u32 blit_addr(u32 x, u32 y){
+    return FRAMEBUF_CPU_TO_VDMA(pixel_address_calc(x, y));
+}
+
+void blit_fill(u32 x, u32 y, u32 w, u32 h, u32 col){
+    write_u32(BLIT_DST, blit_addr(x, y));
+    write_u32(BLIT_SIZE, (h << 16) | w);
+    write_u32(BLIT_FG, col);
+    write_u32(BLIT_CMD, BLIT_OP_FILL);
+}
+
+// copy a w*h rectangle within the back buffer, eg. for scrolling (overlapping lines are handled)
+void blit_copy(u32 dst_x, u32 dst_y, u32 src_x, u32 src_y, u32 w, u32 h){
+    write_u32(BLIT_DST, blit_addr(dst_x, dst_y));
+    write_u32(BLIT_SRC, blit_addr(src_x, src_y));
+    write_u32(BLIT_SIZE, (h << 16) | w);
+    write_u32(BLIT_CMD, BLIT_OP_COPY);
+}
+
+// draw a w*h image from src_addr (a CPU address outside the back buffer, lines src_stride bytes
+// apart) with BLIT_OP_COPY for xRGB or BLIT_OP_RGB24 for packed B, G, R pixels (any src_addr and
+// stride). Add _BV(BLIT_CMD_FLIP_BIT) for bottom up images. The stride is taken with the command
+void blit_image(u32 x, u32 y, u32 src_addr, u32 src_stride, u32 w, u32 h, u32 cmd){
+    write_u32(BLIT_STRIDE, (src_stride << 16) | (1 << pixel_line_shift));
+    write_u32(BLIT_DST, blit_addr(x, y));
+    write_u32(BLIT_SRC, FRAMEBUF_CPU_TO_VDMA(src_addr));
+    write_u32(BLIT_SIZE, (h << 16) | w);
+    write_u32(BLIT_CMD, cmd);
+    write_u32(BLIT_STRIDE, (1 << (pixel_line_shift + 16)) | (1 << pixel_line_shift));
+}
+
+// draw an 8x16 character from the blitter's font
+void blit_glyph(u32 x, u32 y, char c, u32 fg_col, u32 bg_col){
+    write_u32(BLIT_DST, blit_addr(x, y));
+    write_u32(BLIT_SRC, (u8)c);
+    write_u32(BLIT_FG, fg_col);
+    write_u32(BLIT_BG, bg_col);
+    write_u32(BLIT_CMD, BLIT_OP_GLYPH);
+}
+
+void blit_string(u32 x, u32 y, char *string, u32 fg_col, u32 bg_col){
+    while (*string){
+        blit_glyph(x, y, *string++, fg_col, bg_col);
+        x += CHAR_W;
+    }
+}
+
+void blit_wait(void){
+    while (read_u32(BLIT_STATUS) & (1 << BLIT_STATUS_BUSY_BIT)){}
+}
+
+void clear_screen(void){
+    blit_fill(0, 0, pixels_x, pixels_y, COL_GREY);
+    blit_wait();
+}
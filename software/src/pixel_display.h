@@ -3,14 +3,105 @@
 
 #include "utils.h"
 
-// temp, remove after debug done
-#include "zynq_ps_uart.h"
+/*
+ *  Framebuffer, VDMA and blitter on the PYNQ-Z2 (pynq_top)
 
-#define DDR3_BASE (*((volatile unsigned long *)0xD0000000)) // upper 256MB
-#define FRAMEBUF_BASE DDR3_BASE
+    Call pixel_display_init() before drawing. In the hosted build (make hosted) DDR3 is host
+    memory, the VDMA registers are plain memory and the blitter is a model (see src/hosted).
+ */
+
+#ifdef PLATFORM_HOSTED
+#include "hosted_platform.h"
+#define DDR3_BASE_ADDR ((u32)(uintptr_t)hosted_ddr)
+#else
 #define DDR3_BASE_ADDR 0xD0000000 // upper 256MB
+#endif
+#define DDR3_BASE (*((volatile unsigned long *)DDR3_BASE_ADDR))
+#define FRAMEBUF_BASE DDR3_BASE
 #define FRAMEBUF_BASE_ADDR DDR3_BASE_ADDR
 
+// Double buffering: two 8MB framebuffers (enough for 1280x720), the CPU draws into the back buffer while the VDMA
+// scans out the front buffer. Until the first pixel_flip_async() drawing goes straight to the front buffer, so
+// code that never flips still draws on screen. The VDMA and blitter see DDR3 at 0x1000_0000 instead of 0xD000_0000
+#define FRAMEBUF_SIZE 0x00800000
+#define FRAMEBUF0_ADDR FRAMEBUF_BASE_ADDR
+#define FRAMEBUF1_ADDR (FRAMEBUF_BASE_ADDR + FRAMEBUF_SIZE)
+#ifdef PLATFORM_HOSTED
+#define FRAMEBUF_CPU_TO_VDMA(addr) (addr) // the blitter model takes CPU addresses
+#else
+#define FRAMEBUF_CPU_TO_VDMA(addr) (((addr) & 0x0FFFFFFF) | 0x10000000)
+#endif
+
+// wb_vdma_ctrl registers
+#ifdef PLATFORM_HOSTED
+#define VDMA_CTRL_BASE_ADDR HOSTED_VDMA_CTRL_BASE
+#else
+#define VDMA_CTRL_BASE_ADDR 0x50000000
+#endif
+#define VDMA_BUFFER0_ADDR (VDMA_CTRL_BASE_ADDR + 0x0)
+#define VDMA_BUFFER1_ADDR (VDMA_CTRL_BASE_ADDR + 0x4)
+#define VDMA_CTRL         (VDMA_CTRL_BASE_ADDR + 0x8)
+#define VDMA_STATUS       (VDMA_CTRL_BASE_ADDR + 0xC)
+#define VDMA_FRAME_COUNT  (VDMA_CTRL_BASE_ADDR + 0x10)
+#define VDMA_FRAME_UNDERFLOWS (VDMA_CTRL_BASE_ADDR + 0x14) // previous frame
+#define VDMA_UNDERFLOW_TOTAL  (VDMA_CTRL_BASE_ADDR + 0x18) // write to clear
+#define VDMA_FIFO_MIN_LEVEL   (VDMA_CTRL_BASE_ADDR + 0x1C) // words, previous frame
+#define VDMA_AXI_STATS        (VDMA_CTRL_BASE_ADDR + 0x20) // [31:16] max latency (dma_clk cycles), [7:0] max outstanding
+#define VDMA_WATERMARK        (VDMA_CTRL_BASE_ADDR + 0x24) // [31:16] low, [15:0] high (words)
+#define VDMA_BURST            (VDMA_CTRL_BASE_ADDR + 0x28) // [12:8] max outstanding, [4:0] burst length
+#define VDMA_PALETTE      (VDMA_CTRL_BASE_ADDR + 0x800) // 2x256 entries, 0x00RRGGBB
+
+#define VDMA_CTRL_FLIP_BIT 0
+#define VDMA_CTRL_IRQ_EN_BIT 1
+#define VDMA_CTRL_FORMAT_BIT 4
+#define VDMA_CTRL_FORMAT_MASK (0x3 << VDMA_CTRL_FORMAT_BIT)
+#define VDMA_CTRL_PALETTE_BIT 6
+#define VDMA_CTRL_TIMING_BIT 8
+#define VDMA_CTRL_TIMING_MASK (0x3 << VDMA_CTRL_TIMING_BIT)
+#define VDMA_STATUS_FRONT_BIT 0
+#define VDMA_STATUS_FLIP_PENDING_BIT 1
+#define VDMA_STATUS_FRAME_DONE_BIT 2
+// pynq_top has no interrupt controller yet, so FRAME_DONE and IRQ_EN is wired to GPIO_BTN[31]
+#define VDMA_IRQ_GPIO_BTN_BIT 31
+
+// pixel formats. Smaller formats pack pixels little endian (leftmost pixel in the LSBs) and
+// shrink the line stride to match, reducing scan-out bandwidth and framebuffer size
+#define VDMA_FORMAT_32BPP 0 // xRGB 8-8-8-8
+#define VDMA_FORMAT_16BPP 1 // RGB 5-6-5
+#define VDMA_FORMAT_8BPP  2 // palette index
+// video timings, C_VIDEO_PRESETS in graphics_pkg.vhd
+#define VDMA_TIMING_640X480  0
+#define VDMA_TIMING_1280X720 1
+
+#define RGB565(r, g, b) ((((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | ((b) >> 3))
+
+// axi3_blitter registers. The blitter is an AXI master, so uses the same addresses as the VDMA
+#ifdef PLATFORM_HOSTED
+#define BLIT_BASE_ADDR HOSTED_BLIT_BASE
+#else
+#define BLIT_BASE_ADDR 0x60000000
+#endif
+#define BLIT_DST        (BLIT_BASE_ADDR + 0x0)
+#define BLIT_SRC        (BLIT_BASE_ADDR + 0x4)
+#define BLIT_SIZE       (BLIT_BASE_ADDR + 0x8)
+#define BLIT_STRIDE     (BLIT_BASE_ADDR + 0xC)
+#define BLIT_FG         (BLIT_BASE_ADDR + 0x10)
+#define BLIT_BG         (BLIT_BASE_ADDR + 0x14)
+#define BLIT_CMD        (BLIT_BASE_ADDR + 0x18)
+#define BLIT_STATUS     (BLIT_BASE_ADDR + 0x1C)
+#define BLIT_DONE_COUNT (BLIT_BASE_ADDR + 0x20)
+
+#define BLIT_OP_FILL 0
+#define BLIT_OP_COPY 1
+#define BLIT_OP_GLYPH 2
+#define BLIT_OP_RGB24 3 // packed 24bpp (B, G, R bytes) to xRGB
+#define BLIT_CMD_FLIP_BIT 2 // write lines bottom to top
+#define BLIT_STATUS_BUSY_BIT 0
+#define BLIT_STATUS_ERR_BIT 2
+
+#define CHAR_W 8
+#define CHAR_H 16
+
 // 24 bit colour
 #define COL_BLACK   0x00000000UL
 #define COL_RED     0x00FF0000UL
@@ -22,36 +113,35 @@
 #define COL_WHITE   0x00FFFFFFUL
 #define COL_GREY    0x00808080UL
 
-#define PIXELS_X 640
-#define PIXELS_Y 480
-#define CLOG2_X_PIXELS 12
-
-void pixel_set(int x, int y, int col){
-    u32 addr = FRAMEBUF_BASE_ADDR + x * 4 + (y << CLOG2_X_PIXELS);
-    // zynq_ps_uart_puts("addr:\r\n");
-
-    write_u32(addr, col);
-
-    // volatile unsigned long *pixel_loc = (volatile unsigned long *)addr; // cast to pointer
-    // *pixel_loc = col;
-}
-
-// from working Zynq code
-u32 pixel_address_calc(u32 x, u32 y){
-	u32 addr = FRAMEBUF_BASE_ADDR + x*4 + (y << CLOG2_X_PIXELS);
-	return addr;
-}
-
-// from working Zynq code
-void clear_screen(void){
-	for(int y =0; y<PIXELS_Y;y++){
-		for(int x =0; x<PIXELS_X;x++){
-			write_u32(pixel_address_calc(x, y), COL_GREY);
-			// write_u32(pixel_address_calc(x, y), COL_BLUE);
-			// write_u32(pixel_address_calc(x, y), COL_BLACK);
-		}
-	}
-}
+// current resolution, set by pixel_set_timing(). Lines are a power of 2 bytes apart at 32bpp
+extern u32 pixels_x;
+extern u32 pixels_y;
+extern u32 pixel_line_shift;
+
+/* function prototypes */
+void pixel_display_init(void);
+void pixel_set_format(u32 format);
+void palette_set(u32 bank, u32 index, u32 rgb);
+void palette_select(u32 bank);
+void vdma_tune(u32 burst_len, u32 max_outstanding, u32 fifo_high, u32 fifo_low);
+int vdma_frame_ok(void);
+void pixel_set_timing(u32 timing);
+void pixel_flip_wait(void);
+void pixel_flip_async(void);
+void pixel_flip(void);
+u32 pixel_back_buffer(void);
+void pixel_set(int x, int y, int col);
+void pixel_set_rgb565(int x, int y, u16 col);
+void pixel_set_indexed(int x, int y, u8 index);
+u32 pixel_address_calc(u32 x, u32 y);
 
+u32 blit_addr(u32 x, u32 y);
+void blit_fill(u32 x, u32 y, u32 w, u32 h, u32 col);
+void blit_copy(u32 dst_x, u32 dst_y, u32 src_x, u32 src_y, u32 w, u32 h);
+void blit_image(u32 x, u32 y, u32 src_addr, u32 src_stride, u32 w, u32 h, u32 cmd);
+void blit_glyph(u32 x, u32 y, char c, u32 fg_col, u32 bg_col);
+void blit_string(u32 x, u32 y, char *string, u32 fg_col, u32 bg_col);
+void blit_wait(void);
+void clear_screen(void);
 
 #endif //_PIXEL_DISPLAY_H_
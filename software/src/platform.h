@@ -1,16 +1,57 @@
+// Generated by tools/gen_wb_ic/gen_address_map.py from basys3.json, do not edit
 #ifndef _PLATFORM_H_
 #define _PLATFORM_H_
 
 // System Memory Map
+#ifdef PLATFORM_HOSTED
+// host build (make hosted): each segment is a window onto a device model, see src/hosted
+#include "hosted/hosted_platform.h"
+#define PLATFORM_HOSTED_WINDOWS 16
+#define PLATFORM_MEM_BASE HOSTED_WINDOW_BASE(0)
+#define PLATFORM_MEM_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_GPIO0_BASE HOSTED_WINDOW_BASE(1)
+#define PLATFORM_GPIO0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_UART0_BASE HOSTED_WINDOW_BASE(2)
+#define PLATFORM_UART0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_TIMER0_BASE HOSTED_WINDOW_BASE(3)
+#define PLATFORM_TIMER0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_TEXT_DISPLAY0_BASE HOSTED_WINDOW_BASE(4)
+#define PLATFORM_TEXT_DISPLAY0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_SD_SPI_BASE HOSTED_WINDOW_BASE(5)
+#define PLATFORM_SD_SPI_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_PSRAM_BASE HOSTED_WINDOW_BASE(6)
+#define PLATFORM_PSRAM_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_DMA0_BASE HOSTED_WINDOW_BASE(8)
+#define PLATFORM_DMA0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_CRC0_BASE HOSTED_WINDOW_BASE(9)
+#define PLATFORM_CRC0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_SD_HOST0_BASE HOSTED_WINDOW_BASE(10)
+#define PLATFORM_SD_HOST0_SIZE HOSTED_WINDOW_SIZE
+#define PLATFORM_BOOTLOADER_BASE HOSTED_WINDOW_BASE(15)
+#define PLATFORM_BOOTLOADER_SIZE HOSTED_WINDOW_SIZE
+#else
 #define PLATFORM_MEM_BASE 0x00000000
+#define PLATFORM_MEM_SIZE 0x10000000
 #define PLATFORM_GPIO0_BASE 0x10000000
+#define PLATFORM_GPIO0_SIZE 0x10000000
 #define PLATFORM_UART0_BASE 0x20000000
+#define PLATFORM_UART0_SIZE 0x10000000
 #define PLATFORM_TIMER0_BASE 0x30000000
+#define PLATFORM_TIMER0_SIZE 0x10000000
 #define PLATFORM_TEXT_DISPLAY0_BASE 0x40000000
+#define PLATFORM_TEXT_DISPLAY0_SIZE 0x10000000
 #define PLATFORM_SD_SPI_BASE 0x50000000
+#define PLATFORM_SD_SPI_SIZE 0x10000000
 #define PLATFORM_PSRAM_BASE 0x60000000
+#define PLATFORM_PSRAM_SIZE 0x10000000
+#define PLATFORM_DMA0_BASE 0x80000000
+#define PLATFORM_DMA0_SIZE 0x10000000
+#define PLATFORM_CRC0_BASE 0x90000000
+#define PLATFORM_CRC0_SIZE 0x10000000
+#define PLATFORM_SD_HOST0_BASE 0xa0000000
+#define PLATFORM_SD_HOST0_SIZE 0x10000000
+#define PLATFORM_BOOTLOADER_BASE 0xf0000000
+#define PLATFORM_BOOTLOADER_SIZE 0x10000000
+#endif
 
-#define PLATFORM_BOOTLOADER_BASE 0xF0000000
-
-
-#endif // _PLATFORM_H_
\ No newline at end of file
+#endif // _PLATFORM_H_
@@ -0,0 +1,185 @@
+#include "sd_host.h"
+#include "cpu.h"
+
+/*
+ *  SD card host controller for the native 4 bit bus (wb_sd_host)
+
+    Commands are written to ARG/CMD and polled until CMD_BUSY clears. Data goes through the
+    controller's two block FIFO, which its DMA master port empties into (or fills from) memory,
+    so the CPU only sets up each transfer and waits for it.
+
+    Streaming reads are sent for SD_HOST_STREAM_BLOCKS blocks without CTRL.DMA, then each block is
+    handed to the DMA with DMA_ADDR/DMA_WORDS as the caller asks for it. The SD clock stops while
+    the FIFO is full, so the card can be left waiting for as long as the caller likes.
+ */
+
+#define SD_HOST_BLOCK_BYTES 512
+
+static u32 ctrl;          // shadow of CTRL, without ABORT
+static u32 stream_blocks; // handed out since sd_host_stream_start()
+
+u32 sd_host_set_clock(u32 hz){
+    if (hz == 0){
+        write_u32(SD_HOST_CLK, 0);
+        return 0;
+    }
+    u32 div = (REFCLK + 2 * hz - 1) / (2 * hz); // round down the clock, not up
+    div = div ? div - 1 : 0;
+    if (div > SD_HOST_CLK_DIV_MASK){
+        div = SD_HOST_CLK_DIV_MASK;
+    }
+    write_u32(SD_HOST_CLK, _BV(SD_HOST_CLK_EN_BIT) | div);
+    return REFCLK / (2 * (div + 1));
+}
+
+void sd_host_set_wide(int wide){
+    if (wide){
+        _SET_BIT(ctrl, SD_HOST_CTRL_WIDE_BIT);
+    } else {
+        _CLR_BIT(ctrl, SD_HOST_CTRL_WIDE_BIT);
+    }
+    write_u32(SD_HOST_CTRL, ctrl);
+}
+
+void sd_host_set_data_timeout(u32 clocks){
+    write_u32(SD_HOST_DATA_TIMEOUT, clocks);
+}
+
+static void set_dma(int dma){
+    if (dma){
+        _SET_BIT(ctrl, SD_HOST_CTRL_DMA_BIT);
+    } else {
+        _CLR_BIT(ctrl, SD_HOST_CTRL_DMA_BIT);
+    }
+    write_u32(SD_HOST_CTRL, ctrl);
+}
+
+// empty the FIFO and drop a data transfer in progress
+static void abort_data(void){
+    write_u32(SD_HOST_CTRL, ctrl | _BV(SD_HOST_CTRL_ABORT_BIT));
+}
+
+// wait for the bits in `busy` to clear or an error in `errors`, returns the errors (cleared)
+static u32 wait_status(u32 busy, u32 errors){
+    u32 status;
+    do {
+        status = read_u32(SD_HOST_STATUS);
+    } while ((status & busy) && !(status & errors));
+    status &= errors;
+    if (status){
+        write_u32(SD_HOST_STATUS, status); // W1C
+    }
+    return status;
+}
+
+static u32 send(u8 index, u32 arg, u32 flags){
+    wait_status(_BV(SD_HOST_STATUS_CMD_BUSY_BIT), 0);
+    write_u32(SD_HOST_ARG, arg);
+    write_u32(SD_HOST_CMD, flags | (index & 0x3F));
+    // the flags are set as CMD_BUSY clears, so an error can't end the wait early
+    return wait_status(_BV(SD_HOST_STATUS_CMD_BUSY_BIT), SD_HOST_STATUS_CMD_ERR_MASK);
+}
+
+u32 sd_host_command(u8 index, u32 arg, u32 resp_type, u32 *resp){
+    u32 errors = send(index, arg, resp_type);
+    if (resp && !errors){
+        int words = (resp_type & (3 << SD_HOST_CMD_RESP_SHIFT)) == SD_HOST_RESP_R2 ? 4 : 1;
+        for (int i = 0; i < words; i++){
+            resp[i] = read_u32(SD_HOST_RESP0 + 4 * i);
+        }
+    }
+    return errors;
+}
+
+// send a data command and wait for the transfer to finish
+static u32 data_command(u8 index, u32 arg, u32 flags, u32 count){
+    write_u32(SD_HOST_BLOCK_COUNT, count);
+    u32 errors = send(index, arg, SD_HOST_RESP_R1 | _BV(SD_HOST_CMD_DATA_BIT) | flags);
+    if (errors){
+        abort_data(); // the read (or the DMA, for a write) has already started
+        return errors;
+    }
+    return wait_status(_BV(SD_HOST_STATUS_DATA_BUSY_BIT), SD_HOST_STATUS_DATA_ERR_MASK);
+}
+
+u32 sd_host_read_blocks(u8 index, u32 arg, void *buf, u32 count){
+    set_dma(1);
+    write_u32(SD_HOST_BLOCK_LEN, SD_HOST_BLOCK_BYTES);
+    write_u32(SD_HOST_DMA_ADDR, (u32)buf);
+    u32 errors = data_command(index, arg, 0, count);
+    if (errors){
+        abort_data(); // a DMA error leaves the card sending
+    }
+    return errors;
+}
+
+u32 sd_host_write_blocks(u8 index, u32 arg, const void *buf, u32 count){
+    set_dma(1);
+    write_u32(SD_HOST_BLOCK_LEN, SD_HOST_BLOCK_BYTES);
+    write_u32(SD_HOST_DMA_ADDR, (u32)buf);
+    u32 errors = data_command(index, arg, _BV(SD_HOST_CMD_WRITE_BIT), count);
+    if (errors){
+        abort_data();
+    }
+    return errors;
+}
+
+u32 sd_host_read_short(u8 index, u32 arg, u32 resp_type, void *buf, u32 len){
+    set_dma(0);
+    write_u32(SD_HOST_BLOCK_LEN, len);
+    write_u32(SD_HOST_BLOCK_COUNT, 1);
+    u32 errors = send(index, arg, resp_type | _BV(SD_HOST_CMD_DATA_BIT));
+    if (!errors){
+        errors = wait_status(_BV(SD_HOST_STATUS_DATA_BUSY_BIT), SD_HOST_STATUS_DATA_ERR_MASK);
+    }
+    if (!errors){
+        u8 *b = buf;
+        for (u32 i = 0; i < len; i += 4){
+            u32 w = read_u32(SD_HOST_FIFO); // first byte in [7:0]
+            b[i] = w;
+            b[i + 1] = w >> 8;
+            b[i + 2] = w >> 16;
+            b[i + 3] = w >> 24;
+        }
+    }
+    abort_data();
+    write_u32(SD_HOST_BLOCK_LEN, SD_HOST_BLOCK_BYTES);
+    return errors;
+}
+
+u32 sd_host_stream_start(u8 index, u32 arg){
+    set_dma(0);
+    write_u32(SD_HOST_BLOCK_LEN, SD_HOST_BLOCK_BYTES);
+    write_u32(SD_HOST_BLOCK_COUNT, SD_HOST_STREAM_BLOCKS);
+    stream_blocks = 0;
+    u32 errors = send(index, arg, SD_HOST_RESP_R1 | _BV(SD_HOST_CMD_DATA_BIT));
+    if (errors){
+        abort_data();
+    }
+    return errors;
+}
+
+u32 sd_host_stream_next(void *buf){
+    write_u32(SD_HOST_DMA_ADDR, (u32)buf);
+    write_u32(SD_HOST_DMA_WORDS, SD_HOST_BLOCK_BYTES / 4);
+    stream_blocks++;
+    u32 errors = wait_status(_BV(SD_HOST_STATUS_DMA_BUSY_BIT), SD_HOST_STATUS_DATA_ERR_MASK);
+    // the data is in, the CRC16 comes after it: wait for the block to be counted
+    u32 status;
+    while (!errors){
+        status = read_u32(SD_HOST_STATUS);
+        errors = status & SD_HOST_STATUS_DATA_ERR_MASK;
+        if (!get_bit(status, SD_HOST_STATUS_DATA_BUSY_BIT) ||
+            read_u32(SD_HOST_BLOCK_COUNT) <= SD_HOST_STREAM_BLOCKS - stream_blocks){
+            break;
+        }
+    }
+    if (errors){
+        write_u32(SD_HOST_STATUS, errors);
+    }
+    return errors;
+}
+
+void sd_host_stream_stop(void){
+    abort_data();
+}
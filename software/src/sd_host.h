@@ -0,0 +1,84 @@
+#ifndef _SD_HOST_H_
+#define _SD_HOST_H_
+
+#include "utils.h"
+#include "platform.h"
+
+// wb_sd_host registers
+#define SD_HOST_ARG          (PLATFORM_SD_HOST0_BASE + 0x00)
+#define SD_HOST_CMD          (PLATFORM_SD_HOST0_BASE + 0x04)
+#define SD_HOST_STATUS       (PLATFORM_SD_HOST0_BASE + 0x08)
+#define SD_HOST_RESP0        (PLATFORM_SD_HOST0_BASE + 0x0C) // RESP1-3 follow
+#define SD_HOST_CLK          (PLATFORM_SD_HOST0_BASE + 0x1C)
+#define SD_HOST_CTRL         (PLATFORM_SD_HOST0_BASE + 0x20)
+#define SD_HOST_BLOCK_COUNT  (PLATFORM_SD_HOST0_BASE + 0x24)
+#define SD_HOST_BLOCK_LEN    (PLATFORM_SD_HOST0_BASE + 0x28)
+#define SD_HOST_DMA_ADDR     (PLATFORM_SD_HOST0_BASE + 0x2C)
+#define SD_HOST_DATA_TIMEOUT (PLATFORM_SD_HOST0_BASE + 0x30)
+#define SD_HOST_FIFO         (PLATFORM_SD_HOST0_BASE + 0x34)
+#define SD_HOST_FIFO_COUNT   (PLATFORM_SD_HOST0_BASE + 0x38)
+#define SD_HOST_DMA_WORDS    (PLATFORM_SD_HOST0_BASE + 0x3C)
+
+#define SD_HOST_CMD_RESP_SHIFT 8
+#define SD_HOST_CMD_BUSY_BIT 10
+#define SD_HOST_CMD_DATA_BIT 11
+#define SD_HOST_CMD_WRITE_BIT 12
+
+#define SD_HOST_STATUS_CMD_BUSY_BIT 0
+#define SD_HOST_STATUS_DATA_BUSY_BIT 1
+#define SD_HOST_STATUS_DMA_BUSY_BIT 2
+#define SD_HOST_STATUS_CMD_TIMEOUT_BIT 8
+#define SD_HOST_STATUS_CMD_CRC_BIT 9
+#define SD_HOST_STATUS_CMD_INDEX_BIT 10
+#define SD_HOST_STATUS_DATA_TIMEOUT_BIT 11
+#define SD_HOST_STATUS_DATA_CRC_BIT 12
+#define SD_HOST_STATUS_WRITE_ERR_BIT 13
+#define SD_HOST_STATUS_DMA_ERR_BIT 14
+#define SD_HOST_STATUS_CMD_ERR_MASK 0x0700
+#define SD_HOST_STATUS_DATA_ERR_MASK 0x7800
+
+#define SD_HOST_CLK_DIV_MASK 0xFFFF
+#define SD_HOST_CLK_EN_BIT 16
+
+#define SD_HOST_CTRL_WIDE_BIT 0
+#define SD_HOST_CTRL_DMA_BIT 1
+#define SD_HOST_CTRL_ABORT_BIT 31
+
+// response types, for the flags of sd_host_command()
+#define SD_HOST_RESP_NONE (0 << SD_HOST_CMD_RESP_SHIFT)
+#define SD_HOST_RESP_R1 (1 << SD_HOST_CMD_RESP_SHIFT) // also R6 and R7
+#define SD_HOST_RESP_R1B (SD_HOST_RESP_R1 | _BV(SD_HOST_CMD_BUSY_BIT))
+#define SD_HOST_RESP_R3 (2 << SD_HOST_CMD_RESP_SHIFT) // no CRC7 or index to check
+#define SD_HOST_RESP_R2 (3 << SD_HOST_CMD_RESP_SHIFT)
+
+// the streaming read asks for this many blocks, and is stopped long before they run out
+#define SD_HOST_STREAM_BLOCKS 0xFFFF
+
+// SD clock of `hz` or the fastest below it (half the SoC clock at most), 0 stops it.
+// Returns the clock actually set
+u32 sd_host_set_clock(u32 hz);
+// 4 bit bus, once the card has been switched with ACMD6
+void sd_host_set_wide(int wide);
+// SD clocks to wait for read data, a write's CRC status or the card to stop being busy
+void sd_host_set_data_timeout(u32 clocks);
+
+// send a command without data and wait for the response (and busy, for R1b). resp gets 1 word
+// (card status, OCR, ...) or the 4 words of an R2 ([0] is the lowest), and may be NULL.
+// Returns 0, or the SD_HOST_STATUS error bits (cleared)
+u32 sd_host_command(u8 index, u32 arg, u32 resp_type, u32 *resp);
+
+// blocks of 512B to/from buf (word aligned, in memory the DMA can reach) with a command that moves
+// data (CMD17/18, CMD24/25). Returns 0 or the error bits. A multi block command still needs CMD12
+u32 sd_host_read_blocks(u8 index, u32 arg, void *buf, u32 count);
+u32 sd_host_write_blocks(u8 index, u32 arg, const void *buf, u32 count);
+// one data block of `len` bytes (a multiple of 4, up to 512) through the FIFO register, for
+// register reads like CMD6 and ACMD51
+u32 sd_host_read_short(u8 index, u32 arg, u32 resp_type, void *buf, u32 len);
+
+// open ended read (CMD18): start it, then hand each block to a buffer as it is wanted. The card
+// is paused while the FIFO is full. Stop with sd_host_stream_stop(), then send CMD12
+u32 sd_host_stream_start(u8 index, u32 arg);
+u32 sd_host_stream_next(void *buf); // 0 once the block has arrived with a good CRC16
+void sd_host_stream_stop(void);
+
+#endif // _SD_HOST_H_
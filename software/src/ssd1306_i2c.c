@@ -1,6 +1,7 @@
 
 
 #include "ssd1306_i2c.h"
+#include "platform.h"
 #include "utils.h"
 #include "uart.h"
 #include "terminal.h"
@@ -8,8 +9,8 @@
 #include "ssd1306_font.h"
 
 // using bit-bang GPIO I2C at approx 100KHz (SSD1306 supports up to 400KHz)
-#define I2C_SCL (*((volatile unsigned long *)0x10000008))
-#define I2C_SDA (*((volatile unsigned long *)0x1000000C))
+#define I2C_SCL (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x008)))
+#define I2C_SDA (*((volatile unsigned long *)(PLATFORM_GPIO0_BASE + 0x00C)))
 
 #define SSD1306_WIDTH_CHARS 16
 #define SSD1306_HEIGHT_CHARS 4
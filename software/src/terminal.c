@@ -1,7 +1,9 @@
 
 
 #include "terminal.h"
+#include "dma.h"
 #include <stdlib.h>
+#include <string.h>
 
 /*
  * Private funcs
@@ -24,6 +26,15 @@ inline int clamp_cursor_y(t_terminal *t)
 int wrap_cursor(t_terminal *t)
 {
 }
+// row `y` has been written up to (not including) x = `end`
+static void mark_row(t_terminal *t, unsigned int y, unsigned int end)
+{
+    if (end > t->row_len[y])
+    {
+        t->row_len[y] = end;
+    }
+    t->row_dirty[y] = 1;
+}
 
 /*
  * Public funcs
@@ -45,6 +56,14 @@ t_terminal *terminal_create(unsigned int w, unsigned int h)
     term->x = 0;
     term->y = 0;
     term->line_at_top = 1; // text is entered on the bottom visible line, so start of visible area is one more (wraps round)
+    // the buffer isn't cleared yet, so any cell may be set
+    term->row_len = malloc(h * sizeof(unsigned short));
+    term->row_dirty = malloc(h * sizeof(unsigned char));
+    for (unsigned int y = 0; y < h; y++)
+    {
+        term->row_len[y] = w;
+        term->row_dirty[y] = 1;
+    }
     return term;
 }
 
@@ -54,6 +73,8 @@ void terminal_destroy(t_terminal *t)
     // free the memory allocated to the terminal buffer
     free(t->buf);
     t->buf = NULL;
+    free(t->row_len);
+    free(t->row_dirty);
     // free the memory used by the struct itself
     free(t);
     t = NULL;
@@ -62,11 +83,9 @@ void terminal_destroy(t_terminal *t)
 // zero the terminal char buffer
 void terminal_clear(t_terminal *t)
 {
-    int buflen = t->w * t->h;
-    for (int i = 0; i < buflen; i++)
-    {
-        t->buf[i] = 0;
-    }
+    dma_memset(t->buf, 0, t->w * t->h);
+    memset(t->row_len, 0, t->h * sizeof(unsigned short));
+    memset(t->row_dirty, 1, t->h);
 }
 
 // Increase the cursor x, wrapping onto the next line if necessary
@@ -102,6 +121,7 @@ void terminal_write_raw_char(t_terminal *t, char c, char auto_adv)
 {
     int index = (t->y * t->w) + t->x;
     t->buf[index] = c;
+    mark_row(t, t->y, t->x + 1);
     if (auto_adv && c) // if auto-advance and not null char
     {
         terminal_advance_cursor(t);
@@ -155,14 +175,41 @@ void terminal_write_string(t_terminal *t, char *s)
     } while (c != '\0');
 }
 
+// write `len` chars to the terminal (interpret \r and \n as control chars)
+void terminal_write_span(t_terminal *t, const char *s, unsigned int len)
+{
+    const char *end = s + len;
+    while (s < end)
+    {
+        // chars terminal_write_char() would just write, up to the end of the row
+        unsigned int room = t->w - t->x;
+        unsigned int n = 0;
+        while (s + n < end && n < room && s[n] != '\n' && s[n] != '\r' && s[n] != '\0')
+        {
+            n++;
+        }
+        if (n)
+        {
+            memcpy(&t->buf[(t->y * t->w) + t->x], s, n);
+            mark_row(t, t->y, t->x + n);
+            s += n;
+            t->x += n - 1;
+            terminal_advance_cursor(t); // past the last one, wrapping at the end of the row
+        }
+        else
+        {
+            terminal_write_char(t, *s++);
+        }
+    }
+}
+
 void terminal_scroll_one_line(t_terminal *t)
 {
     // clear the line that's about to wrap round
     unsigned int start_loc = t->line_at_top * t->w;
-    for (int i = 0; i < t->w; i++)
-    {
-        t->buf[start_loc+i] = 0;
-    }
+    dma_memset(&t->buf[start_loc], 0, t->w);
+    t->row_len[t->line_at_top] = 0;
+    t->row_dirty[t->line_at_top] = 1;
 
     // move the pointer to the top of the screen
     t->line_at_top++;
@@ -18,6 +18,9 @@ typedef struct
     unsigned int x;      // cursor x
     unsigned int y;      // cursor y
     unsigned int line_at_top; // line in buffer that is the currently top of the display
+    // per buffer row, so a display can refresh just the rows that changed
+    unsigned short *row_len;  // cells that may be non-zero (written since the row was cleared)
+    unsigned char *row_dirty; // written or cleared since the display last cleared the flag
 } t_terminal;
 
 /*
@@ -29,7 +32,7 @@ typedef struct
 t_terminal* terminal_create(unsigned int w, unsigned int h);
 // free all memory used by terminal
 void terminal_destroy(t_terminal *t);
-// zero the terminal char buffer
+// zero the terminal char buffer (and mark every row dirty)
 void terminal_clear(t_terminal *t);
 
 /*
@@ -52,5 +55,8 @@ void terminal_write_char(t_terminal *t, char c);
 void terminal_write_raw_string(t_terminal *t, char *s);
 // write a string to the terminal (interpret \r and \n as control chars)
 void terminal_write_string(t_terminal *t, char *s);
+// write `len` chars to the terminal (interpret \r and \n as control chars). Runs of other chars
+// are copied into the row in one go, with one cursor update per run
+void terminal_write_span(t_terminal *t, const char *s, unsigned int len);
 
 #endif // _TERMINAL_H_
\ No newline at end of file
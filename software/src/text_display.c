@@ -1,8 +1,12 @@
 #include "text_display.h"
 
+// what each screen row shows, for text_update_from_terminal()
+static const char *shown_row[TEXT_H];    // the terminal row copied there (NULL: not known)
+static unsigned short shown_len[TEXT_H]; // cells that may be non-zero
+
 
 void text_set(int x, int y, char charcode, char fg_col, char bg_col){
-    volatile unsigned long *text_display = (volatile unsigned long *)0x40000000; // cast to pointer
+    volatile unsigned long *text_display = (volatile unsigned long *)PLATFORM_TEXT_DISPLAY0_BASE; // cast to pointer
     unsigned long newval = (fg_col << 12) + (bg_col << 8) + charcode;
     text_display[(y * TEXT_W) + x] = newval;
 }
@@ -24,20 +28,43 @@ void text_fill(int x1, int y1, int x2, int y2, char col){
     }
 }
 
-// copy text from a buffer to the screen (monochrome)
+// copy text from a buffer to the screen (monochrome), every cell
+// (use after drawing over the screen with text_set() and friends)
 void text_refresh_from_terminal(t_terminal *t){
-    unsigned int mem_row = t->line_at_top;
-    // for each row of text
     for (int row = 0; row < TEXT_H; row++){
+        shown_row[row] = 0;
+        shown_len[row] = TEXT_W;
+    }
+    text_update_from_terminal(t);
+}
 
-
-        // write each character to the display
-        for (int col = 0; col < TEXT_W; col++){
-            text_set(col, row, t->buf[(mem_row * TEXT_W) + col], WHITE, RED);
+// copy the rows of a buffer that have changed or scrolled to the screen (monochrome).
+// Rows are only written as far as the longer of the old and new text, the rest is blank either way.
+// The cells are written in order through one pointer, as text_set()'s y * TEXT_W is a libgcc
+// multiply per char on RV32I
+void text_update_from_terminal(t_terminal *t){
+    volatile unsigned long *row_cells = (volatile unsigned long *)PLATFORM_TEXT_DISPLAY0_BASE;
+    const unsigned long colour = (WHITE << 12) + (RED << 8);
+    unsigned int line = t->line_at_top;
+    // for each row of text
+    for (int row = 0; row < TEXT_H; row++){
+        const char *src = &t->buf[line * TEXT_W];
+        if (src != shown_row[row] || t->row_dirty[line]){
+            unsigned int len = t->row_len[line];
+            unsigned int n = len > shown_len[row] ? len : shown_len[row];
+            volatile unsigned long *cell = row_cells;
+            // write each character to the display
+            for (unsigned int col = 0; col < n; col++){
+                *cell++ = colour + src[col];
+            }
+            shown_row[row] = src;
+            shown_len[row] = len;
+            t->row_dirty[line] = 0;
         }
-        mem_row++;
-        if (mem_row >= t->h){
-            mem_row = 0;
+        row_cells += TEXT_W;
+        line++;
+        if (line >= t->h){
+            line = 0;
         }
     }
 }
\ No newline at end of file
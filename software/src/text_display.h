@@ -3,6 +3,7 @@
 #define _TEXT_DISPLAY_H_
 
 #include "terminal.h"
+#include "platform.h"
 /* this support library lets us display characters on the screen (640x480)
 //
 // TODOs:
@@ -37,12 +38,13 @@
 // #define TEXT_BASE_ADDR 0x40000000
 
 /* global variables */
-#define TEXT_BASE (*((volatile unsigned long *)0x40000000))
+#define TEXT_BASE (*((volatile unsigned long *)PLATFORM_TEXT_DISPLAY0_BASE))
 
 /* function prototypes */
 void text_set(int x, int y, char charcode, char fg_col, char bg_col);
 void text_string(int x, int y, char *string, unsigned int length, char fg_col, char bg_col);
 void text_fill(int x1, int y1, int x2, int y2, char col);
 void text_refresh_from_terminal(t_terminal *t);
+void text_update_from_terminal(t_terminal *t);
 
 #endif  //_TEXT_DISPLAY_H_
\ No newline at end of file
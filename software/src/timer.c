@@ -13,11 +13,29 @@
         [16]     Timer Overflow
         x8: Timer Threshold Register (32b)
         xC: PWM Threshold Register (32b)
+        x10: Control Set (bits written as 1 are set in x4, [8] clears the overflow)
+        x14: Control Clear (bits written as 1 are cleared in x4)
+
+        x20: MTIME_LO, reading latches MTIME_HI
+        x24: MTIME_HI, writing loads both halves
+        x28: CMP_STATUS (W1C)
+        x2C: CMP_IEN, x30: CMP_IEN_SET, x34: CMP_IEN_CLR
+        x40 + 8n: CMPn_LO, x44 + 8n: CMPn_HI (writing HI loads both halves)
  */
 #define TIMER_REG_COUNT 0
 #define TIMER_REG_CTRL 1
 #define TIMER_REG_TOP 2
 #define TIMER_REG_PWM 3
+#define TIMER_REG_CTRL_SET 4
+#define TIMER_REG_CTRL_CLR 5
+#define TIMER_REG_MTIME_LO 8
+#define TIMER_REG_MTIME_HI 9
+#define TIMER_REG_CMP_STATUS 10
+#define TIMER_REG_CMP_IEN 11
+#define TIMER_REG_CMP_IEN_SET 12
+#define TIMER_REG_CMP_IEN_CLR 13
+#define TIMER_REG_CMP_LO(n) (16 + 2 * (n))
+#define TIMER_REG_CMP_HI(n) (17 + 2 * (n))
 
 // initialise a timer struct with the base address so we can access the registers offset from a base address
 void timer_init(struct timer *module, volatile void* base_address){
@@ -28,48 +46,38 @@ u32 timer_get_time(struct timer *module){
     return module->registers[TIMER_REG_COUNT];
 }
 
+void timer_set_time(struct timer *module, u32 val){
+    module->registers[TIMER_REG_COUNT] = val;
+}
+
 void timer_start(struct timer *module){
-    u32 tmp = module->registers[TIMER_REG_CTRL];
-    tmp |= 0x1; // set bit 0
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_SET] = 0x1; // set bit 0
 }
 
 void timer_stop(struct timer *module){
-    unsigned int tmp = module->registers[TIMER_REG_CTRL];
-    tmp &= ~0x1; // clear bit 0
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_CLR] = 0x1; // clear bit 0
 }
 
 
 void timer_enable_interrupt(struct timer *module){
-    unsigned int tmp = module->registers[TIMER_REG_CTRL];
-    tmp |= 0x2; // set bit 1
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_SET] = 0x2; // set bit 1
 }
 
 
 void timer_disable_interrupt(struct timer *module){
-    unsigned int tmp = module->registers[TIMER_REG_CTRL];
-    tmp &= ~0x2; // clear bit 1
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_CLR] = 0x2; // clear bit 1
 }
 
 void timer_enable_pwm(struct timer *module){
-    unsigned int tmp = module->registers[TIMER_REG_CTRL];
-    tmp |= 0x4; // set bit 2
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_SET] = 0x4; // set bit 2
 }
 
 void timer_disable_pwm(struct timer *module){
-    unsigned int tmp = module->registers[TIMER_REG_CTRL];
-    tmp &= ~0x4; // clear bit 2
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_CLR] = 0x4; // clear bit 2
 }
 
 void timer_clear_oflow_flag(struct timer *module){
-    unsigned int tmp = module->registers[TIMER_REG_CTRL];
-    tmp &= ~(0x1 << 8); // clear bit 8
-    module->registers[TIMER_REG_CTRL] = tmp;
+    module->registers[TIMER_REG_CTRL_SET] = (0x1 << 8); // bit 8 clears the overflow flag
 }
 
 int timer_get_oflow_flag(struct timer *module){
@@ -91,4 +99,53 @@ void timer_set_pwm_threshold(struct timer *module, u32 val){
 
 u32 timer_get_pwm_threshold(struct timer *module){
     return module->registers[TIMER_REG_PWM];
-}
\ No newline at end of file
+}
+
+u64 timer_get_mtime(struct timer *module){
+    u32 lo = module->registers[TIMER_REG_MTIME_LO]; // latches the upper half
+    u32 hi = module->registers[TIMER_REG_MTIME_HI];
+    return ((u64)hi << 32) | lo;
+}
+
+void timer_set_mtime(struct timer *module, u64 val){
+    module->registers[TIMER_REG_MTIME_LO] = (u32)val;
+    module->registers[TIMER_REG_MTIME_HI] = (u32)(val >> 32);
+}
+
+void timer_set_compare(struct timer *module, int ch, u64 val){
+    module->registers[TIMER_REG_CMP_LO(ch)] = (u32)val;
+    module->registers[TIMER_REG_CMP_HI(ch)] = (u32)(val >> 32);
+}
+
+u64 timer_get_compare(struct timer *module, int ch){
+    u32 lo = module->registers[TIMER_REG_CMP_LO(ch)];
+    u32 hi = module->registers[TIMER_REG_CMP_HI(ch)];
+    return ((u64)hi << 32) | lo;
+}
+
+u32 timer_get_compare_flags(struct timer *module){
+    return module->registers[TIMER_REG_CMP_STATUS];
+}
+
+void timer_clear_compare_flags(struct timer *module, u32 mask){
+    module->registers[TIMER_REG_CMP_STATUS] = mask; // W1C
+}
+
+void timer_enable_compare_interrupt(struct timer *module, int ch){
+    module->registers[TIMER_REG_CMP_IEN_SET] = _BV(ch);
+}
+
+void timer_disable_compare_interrupt(struct timer *module, int ch){
+    module->registers[TIMER_REG_CMP_IEN_CLR] = _BV(ch);
+}
+
+void timer_set_timeout(struct timer *module, int ch, u32 cycles){
+    timer_set_compare(module, ch, timer_get_mtime(module) + cycles);
+    // the flag may still be set from the last timeout. The new compare value has taken effect by now,
+    // so this only loses the timeout if `cycles` is shorter than these few bus accesses
+    timer_clear_compare_flags(module, _BV(ch));
+}
+
+int timer_timeout_expired(struct timer *module, int ch){
+    return get_bit(module->registers[TIMER_REG_CMP_STATUS], ch);
+}
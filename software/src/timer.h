@@ -11,6 +11,7 @@ struct timer
 void timer_init(struct timer *module, volatile void *base_address);
 
 u32 timer_get_time(struct timer *module);
+void timer_set_time(struct timer *module, u32 val);
 
 void timer_start(struct timer *module);
 void timer_stop(struct timer *module);
@@ -27,4 +28,22 @@ u32 timer_get_threshold(struct timer *module);
 void timer_set_pwm_threshold(struct timer *module, u32 val);
 u32 timer_get_pwm_threshold(struct timer *module);
 
+// 64 bit free running mtime, counts every clock from reset
+#define TIMER_NUM_CMP 4
+
+u64 timer_get_mtime(struct timer *module);
+void timer_set_mtime(struct timer *module, u64 val);
+
+// compare channel `ch` flags (and interrupts if enabled) once mtime >= val
+void timer_set_compare(struct timer *module, int ch, u64 val);
+u64 timer_get_compare(struct timer *module, int ch);
+u32 timer_get_compare_flags(struct timer *module);
+void timer_clear_compare_flags(struct timer *module, u32 mask);
+void timer_enable_compare_interrupt(struct timer *module, int ch);
+void timer_disable_compare_interrupt(struct timer *module, int ch);
+
+// timeouts on a compare channel: start one `cycles` from now, then poll for it expiring
+void timer_set_timeout(struct timer *module, int ch, u32 cycles);
+int timer_timeout_expired(struct timer *module, int ch);
+
 #endif // _TIMER_H_
\ No newline at end of file
@@ -60,6 +60,18 @@ void uart_put_char(struct uart *module, char c)
     module->registers[UART_REG_TX_BYTE] = c;
 }
 
+// prints `len` chars to the UART
+void uart_write(struct uart *module, const char *buf, u32 len)
+{
+    for (u32 i = 0; i < len; i++)
+    {
+        while (module->registers[UART_REG_TX_IDLE] == 0)
+        {
+        }
+        module->registers[UART_REG_TX_BYTE] = buf[i];
+    }
+}
+
 // sends the lowest byte of an int to the UART
 void uart_put_byte(struct uart *module, s32 b)
 {
@@ -17,6 +17,7 @@ char uart_get_char(struct uart *module);
 void uart_puts(struct uart *module, char *s);
 void uart_put_char(struct uart *module, char c);
 void uart_put_byte(struct uart *module, s32 c); // so we can avoid casting
+void uart_write(struct uart *module, const char *buf, u32 len); // as is, no \r added
 u32 uart_get_32u(struct uart *module);
 s32 uart_get_32i(struct uart *module);
 
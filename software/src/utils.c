@@ -1,5 +1,6 @@
 
 #include "utils.h"
+#include "numfmt.h"
 
 int get_bit(int reg, int bitnum)
 {
@@ -60,38 +61,22 @@ u16 u16_from_u8s(u8 *buf){
 /// @brief  Converts a u32 to a fixed length hex string
 /// @param data u32 to convert
 /// @param buf pointer to character buffer
-/// @param buf_len length of character buffer
+/// @param buf_len length of character buffer (11 for "0x" and 8 digits with a NUL)
 void u32_to_hstring(u32 data, u8 *buf, u8 buf_len){
-
-    // psuedocode:
-
-    // fill with null chars (end of string)
-    u8 i;
-    for (i = 0; i < buf_len - 1; i++)
-    {
-        buf[i] = '\0';
+    if (buf_len < 10){
+        return;
     }
     // Add "0x" prefix
     buf[0] = '0';
     buf[1] = 'x';
-    const u8 start = 2;
-    const u8 chars = 8; // bits/4
-    // for each 4 bits, convert to hex char
-    for (i = 0; i < chars; i++)
-    {
-        u32 mask = 0xF << (i * 4);
-        u8 nibble = (data & mask) >> (i * 4);
-        buf[start+chars-1-i] = nibble_to_hex_char(nibble);
+    fmt_hex((char *)&buf[2], data, 8, 1);
+    if (buf_len > 10){
+        buf[10] = '\0';
     }
 }
 
 char nibble_to_hex_char(u8 nibble){
-    nibble = nibble & 0xF;  // select bottom 4 bits only
-    if (nibble > 9) {   // A (65) to F (70)
-        return nibble + 55;
-    }
-    // 0 (48) to 9 (57)
-    return nibble + 48;
+    return numfmt_hex_upper[nibble & 0xF];  // select bottom 4 bits only
 }
 
 /// @brief Converts a u32 to a fixed length decimal string (right-aligned)
@@ -100,10 +85,6 @@ char nibble_to_hex_char(u8 nibble){
 /// @param buf_len length of character buffer
 void u32_to_string(u32 data, u8* buf, u8 buf_len){
     // max value of u32 = 4,294,967,295
-    u32 digit_val;
-    u32 digit;
-    u32 next_place_val = 10;
-    u32 place_val = 1;
     u32 digit_pos = 0;
     // fill the buf with spaces
     for (u32 i = 0; i < buf_len; i++){
@@ -111,14 +92,11 @@ void u32_to_string(u32 data, u8* buf, u8 buf_len){
     }
 
     buf[buf_len - 1] = '\0'; // end the string
-    while(data != 0){
-        digit_val = data % next_place_val;   // get the value in that place (eg 40)
-        data = data - digit_val;        // subtract this from the value left to convert
-        digit = digit_val / place_val;  // get the digit in that place
-        buf[buf_len - 2 - digit_pos] = digit + 48;  // convert to ASCII
-        // move to next place
-        place_val *= 10;
-        next_place_val *= 10;
+    // lowest digit first, with divu10() as RV32I has no divide instruction. 0 is a digit too
+    do {
+        u32 digit;
+        data = divu10(data, &digit);
+        buf[buf_len - 2 - digit_pos] = '0' + digit;  // convert to ASCII
         digit_pos++;
-    }
-}
\ No newline at end of file
+    } while (data != 0 && digit_pos < buf_len - 1u);
+}
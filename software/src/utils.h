@@ -10,6 +10,7 @@
 #define _CLR_BIT(reg, n) (reg) = (reg) & ~_BV((n))
 
 // Define type shorthands based on stdint.h
+typedef uint64_t u64;
 typedef uint32_t u32;
 typedef uint16_t u16;
 typedef uint8_t u8;
@@ -29,6 +30,17 @@ char get_bit_char(char reg, int bitnum);
 // only builds if defined as "static"
 // use "volatile" to force LOAD/STORE usage
 
+#ifdef PLATFORM_HOSTED
+// host build: accesses go to the device models in src/hosted
+#include "hosted/hosted_platform.h"
+
+static inline void write_u32(u32 addr, u32 data){ hosted_write(addr, data, 4); }
+static inline void write_u16(u32 addr, u16 data){ hosted_write(addr, data, 2); }
+static inline void write_u8(u32 addr, u8 data){ hosted_write(addr, data, 1); }
+static inline u32 read_u32(u32 addr){ return hosted_read(addr, 4); }
+static inline u16 read_u16(u32 addr){ return hosted_read(addr, 2); }
+static inline u8 read_u8(u32 addr){ return hosted_read(addr, 1); }
+#else
 static inline void write_u32(u32 addr, u32 data){
     // create pointer to addr
     volatile u32 *ptr = (u32*)addr;
@@ -51,6 +63,7 @@ static inline u16 read_u16(u32 addr){
 static inline u8 read_u8(u32 addr){
     return *(volatile u8*)addr;
 }
+#endif
 
 // alignment safe way of reading u32 from a byte array
 u32 u32_from_u8s(u8 *buf);
@@ -59,6 +72,7 @@ u32 u32_from_u8s(u8 *buf);
 u16 u16_from_u8s(u8 *buf);
 
 void u32_to_hstring(u32 data, u8 *buf, u8 buf_len);
+void u32_to_string(u32 data, u8 *buf, u8 buf_len);
 char nibble_to_hex_char(u8 nibble);
 
 #endif // _DELAY_H_
\ No newline at end of file
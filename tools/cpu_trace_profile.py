@@ -0,0 +1,233 @@
+"""Profile firmware from a cpu_top instruction trace (hdl/sim/tb_helpers/sim_cpu_trace.vhd)
+
+    python cpu_trace_profile.py sim_cpu_trace.bin software/build/main.elf
+    python cpu_trace_profile.py sim_cpu_trace.bin software/build/main.elf --lines 40 --json profile.json
+
+Reports, per function and per source line, how many instructions were executed and how
+many clocks they took, plus an estimated call graph (calls are JAL/JALR that write ra,
+returns are "ret"; tail calls are counted against the caller).
+
+Symbols and DWARF line tables are read with readelf, which works on RISC-V ELFs even when
+it is the host's own binutils. Build the firmware with -g (the default CFLAGS already do).
+"""
+
+import argparse
+import json
+import re
+import shutil
+import subprocess
+import sys
+from collections import Counter, defaultdict
+from pathlib import Path
+
+import numpy as np
+
+MAGIC = b"CPUTRC"
+HEADER_LEN = 8
+RECORD = np.dtype([("pc", "<u4"), ("instr", "<u4"), ("mem_addr", "<u4"), ("cycles", "<u4")])
+
+OPCODE_JAL = 0x6F
+OPCODE_JALR = 0x67
+REG_RA = 1
+REG_T0 = 5  # alternate link register
+
+UNKNOWN = "??"
+
+
+def find_readelf(name):
+    if name:
+        return name
+    for candidate in ("riscv32-unknown-elf-readelf", "riscv64-unknown-elf-readelf", "readelf"):
+        if shutil.which(candidate):
+            return candidate
+    sys.exit("readelf not found, pass --readelf")
+
+
+def read_trace(path):
+    data = Path(path).read_bytes()
+    if data[:len(MAGIC)] != MAGIC:
+        sys.exit(f"{path} is not a CPU trace")
+    body = data[HEADER_LEN:]
+    body = body[:len(body) - len(body) % RECORD.itemsize]  # drop a partly written record
+    return np.frombuffer(body, dtype=RECORD)
+
+
+def read_functions(readelf, elf):
+    """Returns (sorted start addresses, ends, names) of the function symbols"""
+    out = subprocess.run([readelf, "-sW", str(elf)], capture_output=True, text=True, check=True).stdout
+    funcs = {}
+    for line in out.splitlines():
+        parts = line.split()
+        # Num: Value Size Type Bind Vis Ndx Name
+        if len(parts) >= 8 and parts[3] == "FUNC" and parts[6] != "UND":
+            addr = int(parts[1], 16)
+            size = int(parts[2], 0)
+            # prefer the global name if a local alias shares the address
+            if addr not in funcs or parts[4] == "GLOBAL":
+                funcs[addr] = (max(size, 1), parts[7])
+    starts = np.array(sorted(funcs), dtype=np.uint64)
+    ends = np.array([a + funcs[a][0] for a in sorted(funcs)], dtype=np.uint64)
+    names = [funcs[a][1] for a in sorted(funcs)]
+    return starts, ends, names
+
+
+# "file  line  address ...", a line of "-" marks the end of a sequence
+LINE_RE = re.compile(r"^(\S+)\s+(\d+|-)\s+(0x[0-9a-fA-F]+)")
+
+
+def read_lines(readelf, elf):
+    """Returns (sorted addresses, "file:line" names) from the DWARF line tables"""
+    out = subprocess.run([readelf, "-W", "--debug-dump=decodedline", str(elf)],
+                         capture_output=True, text=True, check=True).stdout
+    rows = {}
+    for line in out.splitlines():
+        m = LINE_RE.match(line)
+        if m:
+            addr = int(m.group(3), 16)
+            if m.group(2) != "-":
+                rows[addr] = f"{m.group(1)}:{m.group(2)}"
+            else:
+                rows.setdefault(addr, UNKNOWN)
+    addrs = sorted(rows)
+    return np.array(addrs, dtype=np.uint64), [rows[a] for a in addrs]
+
+
+def lookup(addrs, starts, ends=None):
+    """Index of the range containing each address, -1 if none"""
+    idx = np.searchsorted(starts, addrs, side="right") - 1
+    idx[idx < 0] = -1
+    if ends is not None and len(ends):
+        ok = idx >= 0
+        ok[ok] = addrs[ok] < ends[idx[ok]]
+        idx[~ok] = -1
+    return idx
+
+
+def histogram(idx, names, cycles):
+    """Instruction and cycle totals per name, unmatched addresses go to UNKNOWN"""
+    n = len(names)
+    bins = np.where(idx < 0, n, idx)
+    instrs = np.bincount(bins, minlength=n + 1)
+    clocks = np.bincount(bins, weights=cycles, minlength=n + 1)
+    table = {}
+    # several ranges can share a name (eg. a source line split by branches)
+    for i in np.nonzero(instrs)[0]:
+        row = table.setdefault(names[i] if i < n else UNKNOWN, {"instrs": 0, "cycles": 0})
+        row["instrs"] += int(instrs[i])
+        row["cycles"] += int(clocks[i])
+    return table
+
+
+def call_graph(trace, func_idx, names):
+    """Call counts per edge, and inclusive cycles per function from a shadow call stack"""
+    instr = trace["instr"]
+    opcode = instr & 0x7F
+    rd = (instr >> 7) & 0x1F
+    rs1 = (instr >> 15) & 0x1F
+    imm = instr >> 20
+    is_call = ((opcode == OPCODE_JAL) | (opcode == OPCODE_JALR)) & ((rd == REG_RA) | (rd == REG_T0))
+    is_ret = (opcode == OPCODE_JALR) & (rd == 0) & ((rs1 == REG_RA) | (rs1 == REG_T0)) & (imm == 0)
+
+    def name(i):
+        return names[i] if i >= 0 else UNKNOWN
+
+    # cycles before each instruction, so a span is start[j] - start[i]
+    start = np.concatenate(([0], np.cumsum(trace["cycles"], dtype=np.uint64)))
+    edges = Counter()
+    inclusive = defaultdict(int)
+    calls = Counter()
+    stack = []
+    last = len(trace) - 1
+    for i in np.nonzero(is_call | is_ret)[0]:
+        if is_call[i]:
+            if i == last:
+                break
+            callee = name(func_idx[i + 1])
+            edges[(name(func_idx[i]), callee)] += 1
+            calls[callee] += 1
+            stack.append((callee, i + 1))
+        elif stack:
+            callee, entered = stack.pop()
+            # recursion is only counted once, by the outermost call
+            if all(f != callee for f, _ in stack):
+                inclusive[callee] += int(start[i + 1] - start[entered])
+    # calls still running at the end of the trace
+    for depth, (callee, entered) in enumerate(stack):
+        if all(f != callee for f, _ in stack[:depth]):
+            inclusive[callee] += int(start[-1] - start[entered])
+    return edges, inclusive, calls
+
+
+def print_table(title, table, total_cycles, limit, extra=None):
+    print(f"\n{title}")
+    header = f"{'cycles':>12} {'%':>6} {'instrs':>10} {'CPI':>6}"
+    if extra:
+        header += "".join(f" {h:>12}" for h, _ in extra)
+    print(header + "  name")
+    rows = sorted(table.items(), key=lambda kv: -kv[1]["cycles"])
+    for name, row in rows[:limit]:
+        line = (f"{row['cycles']:>12} {100 * row['cycles'] / max(total_cycles, 1):>6.2f} "
+                f"{row['instrs']:>10} {row['cycles'] / row['instrs']:>6.2f}")
+        if extra:
+            line += "".join(f" {fn(name):>12}" for _, fn in extra)
+        print(line + f"  {name}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="binary trace from sim_cpu_trace")
+    parser.add_argument("elf", nargs="?", default="software/build/main.elf")
+    parser.add_argument("--readelf", help="readelf to use (default: RISC-V toolchain, then host)")
+    parser.add_argument("--functions", type=int, default=30, help="number of functions to list")
+    parser.add_argument("--lines", type=int, default=20, help="number of source lines to list")
+    parser.add_argument("--edges", type=int, default=20, help="number of call graph edges to list")
+    parser.add_argument("--json", metavar="FILE", help="also write everything to JSON")
+    args = parser.parse_args()
+
+    trace = read_trace(args.trace)
+    if len(trace) == 0:
+        sys.exit("empty trace")
+    readelf = find_readelf(args.readelf)
+    pc = trace["pc"].astype(np.uint64)
+    cycles = trace["cycles"].astype(np.float64)
+    total_cycles = int(cycles.sum())
+    print(f"{len(trace)} instructions, {total_cycles} clocks (CPI {total_cycles / len(trace):.2f})")
+
+    starts, ends, fnames = read_functions(readelf, args.elf)
+    func_idx = lookup(pc, starts, ends)
+    functions = histogram(func_idx, fnames, cycles)
+
+    line_addrs, lnames = read_lines(readelf, args.elf)
+    lines = histogram(lookup(pc, line_addrs), lnames, cycles) if lnames else {}
+
+    edges, inclusive, calls = call_graph(trace, func_idx, fnames)
+    for name, row in functions.items():
+        row["inclusive_cycles"] = inclusive.get(name, row["cycles"])
+        row["calls"] = calls.get(name, 0)
+
+    print_table("Functions (self)", functions, total_cycles, args.functions,
+                extra=[("inclusive", lambda n: functions[n]["inclusive_cycles"]),
+                       ("calls", lambda n: functions[n]["calls"])])
+    if lines:
+        print_table("Source lines", lines, total_cycles, args.lines)
+    else:
+        print("\nNo DWARF line info, build with -g for per-line figures")
+
+    print("\nCall graph (estimated)")
+    print(f"{'calls':>10}  caller -> callee")
+    for (caller, callee), n in edges.most_common(args.edges):
+        print(f"{n:>10}  {caller} -> {callee}")
+
+    if args.json:
+        Path(args.json).write_text(json.dumps({
+            "instructions": len(trace),
+            "cycles": total_cycles,
+            "functions": functions,
+            "lines": lines,
+            "call_graph": [{"caller": a, "callee": b, "calls": n} for (a, b), n in edges.most_common()],
+        }, indent=2))
+        print(f"\nwrote {args.json}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,17 +1,41 @@
+import argparse
 import json
+from pathlib import Path
 
-# TODO:
-#   - add contextual comments to C header
-#   - some kind of VHDL output for a wishbone interconnect (maybe package/function based?)
+# Generates the system address map from a single JSON description:
+#   - C platform header     (#define <PREFIX><SEG>_BASE / _SIZE, plus a PLATFORM_HOSTED variant
+#                             that points each segment at a host memory window)
+#   - VHDL decode package   (mask/match per slave for wb_interconnect + a wb_decode() function)
+#   - linker MEMORY block   (for segments with a "memory" region name)
 #
+# JSON format (see example.json):
+#   "start_address" : first address to allocate from
+#   "min_size"      : smallest segment size (eg "4K"), sizes are rounded up to a power of 2
+#   "sparse_decode" : (optional) only compare the address bits needed to tell segments apart.
+#                     Unmapped addresses then alias onto a slave instead of returning ERR
+#   "c_prefix"      : (optional) prefix for C #defines, default "PLATFORM_"
+#   "vhdl_package"  : (optional) VHDL package name, default "wb_addr_map_pkg"
+#   "segments"      : in slave index order
+#       "<name>": {"size": "64K", "base": "0x..." (optional, fixed address),
+#                  "index": 15 (optional, slave port on the interconnect, default the next free one),
+#                  "memory": "RAM" (optional linker region), "attrs": "rwx" (optional),
+#                  "memory_size": "64K" (optional, linker LENGTH if the memory is smaller than its slot)}
+#
+# Segments without a fixed base are packed densely, each naturally aligned to its own size
+# so decoding is a simple mask and compare. Slave indices not given to a segment are unmapped
+# (never selected, so accesses get ERR from the interconnect).
 
 def int2hexstr(int_in):
     """converts int to 32b hex string"""
     return f"0x{int_in:08x}"
 
+def int2vhdlhex(int_in):
+    """converts int to a 32b VHDL hex literal with a "_" separator"""
+    return f'x"{int_in >> 16:04X}_{int_in & 0xFFFF:04X}"'
+
 def hexstr2int(hexstr):
     """converts hex string to integer. Supports  "_" separator"""
-    hexstr = hexstr.strip("_")
+    hexstr = hexstr.replace("_", "")
     return int(hexstr,0)
 
 def parseSize(sizestr):
@@ -25,7 +49,7 @@ def parseSize(sizestr):
         "M": 1024 * 1024,
         "G": 1024 * 1024 * 1024,
     }
-    if sizestr[-1] in units:
+    if sizestr[-1].upper() in units:
         unit = sizestr[-1].upper()
         sizestr = sizestr[:-1]  # NB: python list slicing does not include the RHS element
         return int(sizestr) * units[unit]
@@ -34,38 +58,223 @@ def parseSize(sizestr):
     else:
         return int(sizestr)
 
-def outputCHeader(file, addr_map):
-    c_map = []
-    for seg, details in addr_map.items():
-        c_map.append(f"#define {seg.upper()}_OFFSET {int2hexstr(details['start'])}\n")
-    with open(file, "w") as fp:
-        print(c_map)
-        fp.writelines(c_map)
+def roundPow2(size):
+    """rounds up to the next power of 2 (min 4 bytes, one word)"""
+    p = 4
+    while p < size:
+        p *= 2
+    return p
 
-def main(cfg_json, c_file):
-    with open(cfg_json, "r") as fp:
-        settings = json.load(fp)
-    print(f"{settings}")
+def alignUp(addr, align):
+    return (addr + align - 1) & ~(align - 1)
+
+def log2(size):
+    return size.bit_length() - 1
 
+def fullMask(size):
+    """compare every address bit above the segment's own offset bits"""
+    return ~(size - 1) & 0xFFFFFFFF
+
+def sparseMask(name, addr_map):
+    """Picks the fewest address bits that distinguish this segment from every other segment.
+    Greedy set cover: repeatedly take the bit that separates us from the most remaining segments.
+    """
+    seg = addr_map[name]
+    lo = log2(seg["size"])
+    remaining = [other for other in addr_map.values() if other is not seg]
+    mask = 0
+    while remaining:
+        best_bit, best_cover = None, []
+        for bit in range(31, lo - 1, -1):
+            cover = [other for other in remaining
+                     if bit >= log2(other["size"]) and (seg["start"] >> bit & 1) != (other["start"] >> bit & 1)]
+            if len(cover) > len(best_cover):
+                best_bit, best_cover = bit, cover
+        if best_bit is None:
+            raise ValueError(f"Segment {name} cannot be distinguished from {[o['name'] for o in remaining]}")
+        mask |= 1 << best_bit
+        remaining = [other for other in remaining if other not in best_cover]
+    return mask
+
+def buildAddrMap(settings):
     MIN_SIZE = parseSize(settings["min_size"])
 
     START_ADDR = hexstr2int(settings["start_address"])
     current_addr = START_ADDR
 
     addr_map = {}
+    used_indices = set()
 
     for seg_name, seg_details in settings["segments"].items():
-        addr_map[seg_name] = {"start": current_addr}    # will probably need more info added here
         seg_size = parseSize(seg_details["size"])
         if seg_size < MIN_SIZE:
             seg_size = MIN_SIZE
-        current_addr += seg_size
+        seg_size = roundPow2(seg_size)
+
+        if "base" in seg_details:
+            start = hexstr2int(seg_details["base"])
+            if start % seg_size != 0:
+                raise ValueError(f"Segment {seg_name} base {int2hexstr(start)} not aligned to its size {int2hexstr(seg_size)}")
+        else:
+            start = alignUp(current_addr, seg_size)
+            current_addr = start + seg_size
+
+        if start + seg_size > 1 << 32:
+            raise ValueError(f"Segment {seg_name} does not fit in the 32-bit address space")
+
+        if "index" in seg_details:
+            index = seg_details["index"]
+            if index in used_indices:
+                raise ValueError(f"Segment {seg_name} index {index} is already used")
+        else:
+            index = 0
+            while index in used_indices:
+                index += 1
+        used_indices.add(index)
+
+        addr_map[seg_name] = {
+            "name": seg_name,
+            "index": index,
+            "start": start,
+            "size": seg_size,
+            "memory": seg_details.get("memory"),
+            "attrs": seg_details.get("attrs", "rw"),
+            "memory_size": parseSize(seg_details.get("memory_size", str(seg_size))),
+        }
+
+    # fixed and packed segments must not overlap
+    segs = sorted(addr_map.values(), key=lambda s: s["start"])
+    for a, b in zip(segs, segs[1:]):
+        if a["start"] + a["size"] > b["start"]:
+            raise ValueError(f"Segments {a['name']} and {b['name']} overlap")
+
+    for seg in addr_map.values():
+        if settings.get("sparse_decode", False):
+            seg["mask"] = sparseMask(seg["name"], addr_map)
+        else:
+            seg["mask"] = fullMask(seg["size"])
+        seg["match"] = seg["start"] & seg["mask"]
+
+    return addr_map
+
+def numSlaves(addr_map):
+    """slave ports needed, including any unmapped ones below the highest index"""
+    return max(d["index"] for d in addr_map.values()) + 1
+
+def outputCHeader(file, addr_map, prefix="PLATFORM_", src="address map"):
+    guard = f"_{Path(file).stem.upper()}_H_"
+    c_map = [
+        f"// Generated by tools/gen_wb_ic/gen_address_map.py from {src}, do not edit\n",
+        f"#ifndef {guard}\n",
+        f"#define {guard}\n",
+        "\n",
+        "// System Memory Map\n",
+        "#ifdef PLATFORM_HOSTED\n",
+        "// host build (make hosted): each segment is a window onto a device model, see src/hosted\n",
+        "#include \"hosted/hosted_platform.h\"\n",
+        f"#define {prefix}HOSTED_WINDOWS {numSlaves(addr_map)}\n",
+    ]
+    for seg, details in addr_map.items():
+        c_map.append(f"#define {prefix}{seg.upper()}_BASE HOSTED_WINDOW_BASE({details['index']})\n")
+        c_map.append(f"#define {prefix}{seg.upper()}_SIZE HOSTED_WINDOW_SIZE\n")
+    c_map.append("#else\n")
+    for seg, details in addr_map.items():
+        c_map.append(f"#define {prefix}{seg.upper()}_BASE {int2hexstr(details['start'])}\n")
+        c_map.append(f"#define {prefix}{seg.upper()}_SIZE {int2hexstr(details['size'])}\n")
+    c_map.append("#endif\n")
+    c_map.append("\n")
+    c_map.append(f"#endif // {guard}\n")
+    with open(file, "w") as fp:
+        fp.writelines(c_map)
+
+def outputVhdlPackage(file, addr_map, pkg_name="wb_addr_map_pkg", src="address map"):
+    n = numSlaves(addr_map)
+    by_index = {d["index"]: d for d in addr_map.values()}
+    lines = [
+        f"-- Generated by tools/gen_wb_ic/gen_address_map.py from {src}, do not edit\n",
+        "library ieee;\n",
+        "use ieee.std_logic_1164.all;\n",
+        "\n",
+        "use work.joe_common_pkg.all;\n",
+        "\n",
+        "--! Wishbone address map. Pass C_WB_ADR_MASK/C_WB_ADR_MATCH to wb_interconnect, a slave\n",
+        "--! is selected when (adr and MASK) = MATCH. Only the bits set in each MASK are compared,\n",
+        "--! unmapped indices never match\n",
+        f"package {pkg_name} is\n",
+        f"    constant C_WB_NUM_SLAVES : integer := {n};\n",
+        "\n",
+    ]
+    for seg, d in addr_map.items():
+        name = seg.upper()
+        lines.append(f"    -- {seg}: {int2hexstr(d['start'])} to {int2hexstr(d['start'] + d['size'] - 1)}\n")
+        lines.append(f"    constant C_WB_{name}_IDX  : integer := {d['index']};\n")
+        lines.append(f"    constant C_WB_{name}_BASE : std_logic_vector(31 downto 0) := {int2vhdlhex(d['start'])};\n")
+        lines.append(f"    constant C_WB_{name}_MASK : std_logic_vector(31 downto 0) := {int2vhdlhex(d['mask'])};\n")
+    lines.append("\n")
+    # (adr and 0) is never all 1's, so unmapped indices are never selected
+    masks = ",\n".join(f"        {i} => {int2vhdlhex(by_index[i]['mask'] if i in by_index else 0)}" for i in range(n))
+    matches = ",\n".join(f"        {i} => {int2vhdlhex(by_index[i]['match'] if i in by_index else 0xFFFFFFFF)}" for i in range(n))
+    lines.append(f"    constant C_WB_ADR_MASK : t_slv32_arr(0 to C_WB_NUM_SLAVES - 1) := (\n{masks}\n    );\n")
+    lines.append(f"    constant C_WB_ADR_MATCH : t_slv32_arr(0 to C_WB_NUM_SLAVES - 1) := (\n{matches}\n    );\n")
+    lines.append("\n")
+    lines.append("    --! returns the slave index, or C_WB_NUM_SLAVES if unmapped\n")
+    lines.append("    function wb_decode (adr : std_logic_vector(31 downto 0)) return integer;\n")
+    lines.append(f"end package {pkg_name};\n")
+    lines.append("\n")
+    lines.append(f"package body {pkg_name} is\n")
+    lines.append("    function wb_decode (adr : std_logic_vector(31 downto 0)) return integer is\n")
+    lines.append("    begin\n")
+    lines.append("        for i in 0 to C_WB_NUM_SLAVES - 1 loop\n")
+    lines.append("            if (adr and C_WB_ADR_MASK(i)) = C_WB_ADR_MATCH(i) then\n")
+    lines.append("                return i;\n")
+    lines.append("            end if;\n")
+    lines.append("        end loop;\n")
+    lines.append("        return C_WB_NUM_SLAVES;\n")
+    lines.append("    end function;\n")
+    lines.append(f"end package body {pkg_name};\n")
+    with open(file, "w") as fp:
+        fp.writelines(lines)
+
+def outputLinkerMemory(file, addr_map, src="address map"):
+    lines = [
+        f"/* Generated by tools/gen_wb_ic/gen_address_map.py from {src}, do not edit */\n",
+        "MEMORY\n",
+        "{\n",
+    ]
+    for seg, d in addr_map.items():
+        if d["memory"] is None:
+            continue
+        length = d["memory_size"]
+        length = f"{length // 1024}K" if length % 1024 == 0 else f"{length}"
+        lines.append(f"  {d['memory']} ({d['attrs']}) : ORIGIN = {int2hexstr(d['start'])}, LENGTH = {length}\n")
+    lines.append("}\n")
+    with open(file, "w") as fp:
+        fp.writelines(lines)
+
+def main(cfg_json, c_file, vhdl_file=None, ld_file=None):
+    with open(cfg_json, "r") as fp:
+        settings = json.load(fp)
+    src = Path(cfg_json).name
+
+    addr_map = buildAddrMap(settings)
 
     print(f"=== ADDR MAP ===")
-    print(f"{addr_map}")
+    for seg, d in addr_map.items():
+        print(f"{d['index']:2} {seg:20} {int2hexstr(d['start'])} size {int2hexstr(d['size'])} mask {int2hexstr(d['mask'])}")
 
-    outputCHeader(c_file, addr_map)
+    if c_file:
+        outputCHeader(c_file, addr_map, settings.get("c_prefix", "PLATFORM_"), src)
+    if vhdl_file:
+        outputVhdlPackage(vhdl_file, addr_map, settings.get("vhdl_package", "wb_addr_map_pkg"), src)
+    if ld_file:
+        outputLinkerMemory(ld_file, addr_map, src)
 
 
 if __name__ == "__main__":
-    main("example.json", "example.h")
\ No newline at end of file
+    parser = argparse.ArgumentParser(description="Generate address map outputs from a JSON description")
+    parser.add_argument("json", nargs="?", default="example.json")
+    parser.add_argument("--c", default="example.h", help="C platform header to write")
+    parser.add_argument("--vhdl", default=None, help="VHDL decode package to write")
+    parser.add_argument("--ld", default=None, help="linker MEMORY block to write")
+    args = parser.parse_args()
+    main(args.json, args.c, args.vhdl, args.ld)
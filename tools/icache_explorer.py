@@ -0,0 +1,395 @@
+"""Design-space explorer for the icache generics (hdl/src/riscv-gen2/icache.vhd)
+
+    python icache_explorer.py sim_cpu_trace.bin                       # sweep the defaults
+    python icache_explorer.py trace.txt --blocks 8,16,32 --block-sizes 16,32 --set-sizes 1,2,4
+    python icache_explorer.py spike.log --mem-latency 12 --bram-budget 8 --csv sweep.csv
+    python icache_explorer.py --write-synthetic ../hdl/sim/data/icache_trace.txt
+
+Replays an instruction fetch trace through a model of the icache as the RTL implements it
+(tag/index/offset split, 16-bit fetches that may spill into the next block, the RV32C
+shortcut, empty-way-first then LFSR replacement, whole-block Wishbone refills) and reports
+for each G_NUM_BLOCKS / G_BLOCK_SIZE / G_SET_SIZE / G_RV32C_OPT combination:
+  hit %       fetches that needed no refill
+  refill KB   bytes read over Wishbone to fill blocks
+  fetch clk   average clocks from a fetch being accepted until the icache is READY again
+  CPI         --exec-cycles + fetch clk, a rough figure for a core that waits on every fetch
+  RAMB18      18Kb block RAMs for the data array, as the RTL reads a whole block per access
+              (G_BLOCK_SIZE*8 bits wide), plus the tag/valid bits that live in fabric
+Rows marked * are Pareto optimal for CPI against RAMB18.
+
+The hit/miss/overflow counters match the RTL's hit_count, miss_count and oflow_count, which
+tb_icache checks for a few configurations (see hdl/sim/run.py). Set-associative
+replacement uses the free-running LFSRs, which the model steps once per modelled clock, so
+those results are statistically but not cycle-for-cycle the same as the RTL.
+
+Trace formats
+  - binary CPU trace from hdl/sim/tb_helpers/sim_cpu_trace.vhd ("CPUTRC")
+  - spike --log-commits style logs: "core   0: 3 0x80000000 (0x00000297) ..."
+  - text, one hex address per line with an optional hex instruction after it; without
+    the instruction every fetch is taken to be a 32-bit instruction, or with --ro-mem
+    the data sim_wb_ro_mem returns (halfword n holds n) as tb_icache sees it
+"""
+
+import argparse
+import itertools
+import json
+import re
+import sys
+from concurrent.futures import ProcessPoolExecutor
+from pathlib import Path
+
+import numpy as np
+
+CPU_TRACE_MAGIC = b"CPUTRC"
+CPU_TRACE_HEADER_LEN = 8
+CPU_TRACE_RECORD = np.dtype([("pc", "<u4"), ("instr", "<u4"), ("mem_addr", "<u4"), ("cycles", "<u4")])
+SPIKE_RE = re.compile(r"core\s+\d+:\s+(?:\d+\s+)?0x([0-9a-fA-F]+)\s+\(0x([0-9a-fA-F]+)\)")
+
+RAMB18_BITS = 18 * 1024
+RAMB18_MAX_WIDTH = 36  # simple dual port
+RAMB18_DEPTH_AT_MAX_WIDTH = 512
+
+
+def is_pow2(n):
+    return n > 0 and n & (n - 1) == 0
+
+
+def clog2(n):
+    return (n - 1).bit_length()
+
+
+def lfsr_sequence(width, tap_a, tap_b):
+    """States of one of the icache's XNOR LFSRs from its all-zero power up value, as
+    (prefix, cycle) so state k is prefix[k] or cycle[(k - len(prefix)) % len(cycle)]"""
+    mask = (1 << width) - 1
+    seen = {}
+    states = []
+    s = 0
+    while s not in seen:
+        seen[s] = len(states)
+        states.append(s)
+        fb = 1 ^ (((s >> tap_a) ^ (s >> tap_b)) & 1)
+        s = ((s << 1) | fb) & mask
+    mu = seen[s]
+    return np.array(states[:mu], dtype=np.int64), np.array(states[mu:], dtype=np.int64)
+
+
+# lfsr1: 10 bit, XNOR of bits 9 and 6. lfsr2: 11 bit, XNOR of bits 10 and 4
+LFSR1 = lfsr_sequence(10, 9, 6)
+LFSR2 = lfsr_sequence(11, 10, 4)
+
+
+def lfsr_at(seq, k):
+    prefix, cycle = seq
+    if k < len(prefix):
+        return int(prefix[k])
+    return int(cycle[(k - len(prefix)) % len(cycle)])
+
+
+class ICacheModel:
+    """One icache configuration, fed one fetch at a time"""
+
+    def __init__(self, num_blocks=16, block_size=32, set_size=1, rv32c_opt=True,
+                 mem_latency=1, issue_gap=0, lfsr_phase=0):
+        problem = config_problem(num_blocks, block_size, set_size)
+        if problem:
+            raise ValueError(problem)
+        self.num_blocks = num_blocks
+        self.block_size = block_size
+        self.set_size = set_size
+        self.rv32c_opt = rv32c_opt
+        self.num_sets = num_blocks // set_size
+        self.offset_w = clog2(block_size) - 1
+        self.index_w = clog2(self.num_sets)
+        self.tag_w = 32 - self.index_w - self.offset_w - 1
+        self.max_offset = (1 << self.offset_w) - 1
+        self.set_i_mask = set_size - 1
+        # MISS takes one clock per word plus the memory's ack latency
+        self.refill_cycles = block_size // 4 + mem_latency
+        self.issue_gap = issue_gap
+        self.tags = [None] * num_blocks  # None = invalid
+        self.cycle = lfsr_phase
+
+        # same meaning as the RTL's counters
+        self.hit_count = 0
+        self.oflow_count = 0
+        self.miss_count = 0
+        self.fetches = 0
+        self.refill_fetches = 0  # fetches that needed at least one refill
+        self.fetch_cycles = 0
+        self.random_replacements = 0
+
+    def decode(self, addr):
+        offset = (addr >> 1) & self.max_offset
+        index = (addr >> (self.offset_w + 1)) & ((1 << self.index_w) - 1)
+        tag = addr >> (self.offset_w + 1 + self.index_w)
+        return tag, index, offset
+
+    def lookup(self, tag, index):
+        base = index * self.set_size
+        return tag in self.tags[base:base + self.set_size]
+
+    def replace(self, tag, index):
+        """REPLACE state, at self.cycle: first empty block in the set, else the LFSR's pick"""
+        base = index * self.set_size
+        for i in range(base, base + self.set_size):
+            if self.tags[i] is None:
+                self.tags[i] = tag
+                return
+        if self.set_size == 1:
+            way = 0
+        else:
+            way = (lfsr_at(LFSR1, self.cycle) ^ lfsr_at(LFSR2, self.cycle)) & self.set_i_mask
+            self.random_replacements += 1
+        self.tags[base + way] = tag
+
+    def refill(self, tag, index):
+        self.miss_count += 1
+        self.cycle += 1 + self.refill_cycles  # READY/OFLOW -> MISS, then the burst
+        self.replace(tag, index)
+        self.cycle += 1  # REPLACE
+
+    def fetch(self, addr, rvc):
+        """One fetch, rvc is whether the lower halfword is a compressed instruction"""
+        start = self.cycle
+        refills = self.miss_count
+        self.fetches += 1
+        tag, index, offset = self.decode(addr)
+        cross = offset == self.max_offset
+        if self.lookup(tag, index):
+            self.cycle += 1
+            if not cross:
+                self.hit_count += 1
+        else:
+            self.refill(tag, index)
+        if cross:
+            # OFLOW
+            if self.rv32c_opt and rvc:
+                self.hit_count += 1
+                self.cycle += 1
+            else:
+                utag, uindex, _ = self.decode(addr + 2)
+                if self.lookup(utag, uindex):
+                    self.oflow_count += 1
+                    self.cycle += 1
+                else:
+                    self.refill(utag, uindex)
+        if self.miss_count != refills:
+            self.refill_fetches += 1
+        self.fetch_cycles += self.cycle - start
+        self.cycle += self.issue_gap
+
+    def bulk_hits(self, n):
+        """n fetches known to hit without crossing a block"""
+        self.fetches += n
+        self.hit_count += n
+        self.fetch_cycles += n
+        self.cycle += n * (1 + self.issue_gap)
+
+    def run(self, addrs, rvc):
+        """Replays a whole trace. A non-crossing fetch from the same block as the previous
+        non-crossing fetch must hit, so those are counted in bulk"""
+        addrs = np.asarray(addrs, dtype=np.int64)
+        rvc = np.asarray(rvc, dtype=bool)
+        line = addrs >> (self.offset_w + 1)
+        cross = ((addrs >> 1) & self.max_offset) == self.max_offset
+        sure_hit = np.zeros(len(addrs), dtype=bool)
+        sure_hit[1:] = (line[1:] == line[:-1]) & ~cross[1:] & ~cross[:-1]
+        pending = 0
+        for a, r, s in zip(addrs.tolist(), rvc.tolist(), sure_hit.tolist()):
+            if s:
+                pending += 1
+                continue
+            if pending:
+                self.bulk_hits(pending)
+                pending = 0
+            self.fetch(a, r)
+        if pending:
+            self.bulk_hits(pending)
+        return self
+
+    def ramb18(self):
+        width = self.block_size * 8
+        return -(-width // RAMB18_MAX_WIDTH) * -(-self.num_blocks // RAMB18_DEPTH_AT_MAX_WIDTH)
+
+    def results(self, exec_cycles):
+        fetches = max(self.fetches, 1)
+        fetch_clk = self.fetch_cycles / fetches
+        return {
+            "num_blocks": self.num_blocks,
+            "block_size": self.block_size,
+            "set_size": self.set_size,
+            "rv32c_opt": self.rv32c_opt,
+            "fetches": self.fetches,
+            "hit_count": self.hit_count,
+            "oflow_count": self.oflow_count,
+            "miss_count": self.miss_count,
+            "hit_rate": 1 - self.refill_fetches / fetches,
+            "refill_bytes": self.miss_count * self.block_size,
+            "fetch_cycles": fetch_clk,
+            "cpi": exec_cycles + fetch_clk,
+            "random_replacements": self.random_replacements,
+            "ramb18": self.ramb18(),
+            "data_bits": self.num_blocks * self.block_size * 8,
+            "tag_bits": self.num_blocks * (self.tag_w + 1),
+        }
+
+
+def config_problem(num_blocks, block_size, set_size):
+    """Why the RTL can't be built with these generics, or None"""
+    if not (is_pow2(num_blocks) and is_pow2(block_size) and is_pow2(set_size)):
+        return "sizes must be powers of 2 (the LFSR picks a way with a bit mask)"
+    if block_size < 4:
+        return "G_BLOCK_SIZE must be at least one 32-bit Wishbone word"
+    if set_size > num_blocks:
+        return "G_SET_SIZE is larger than G_NUM_BLOCKS"
+    return None
+
+
+def ro_mem_rvc(addrs):
+    """sim_wb_ro_mem returns halfword n at byte address 2n, so the low bits are n[1:0]"""
+    return ((np.asarray(addrs, dtype=np.int64) >> 1) & 3) != 3
+
+
+def read_trace(path, ro_mem=False):
+    """Returns (fetch addresses, is-compressed flags)"""
+    data = Path(path).read_bytes()
+    if data[:len(CPU_TRACE_MAGIC)] == CPU_TRACE_MAGIC:
+        body = data[CPU_TRACE_HEADER_LEN:]
+        body = body[:len(body) - len(body) % CPU_TRACE_RECORD.itemsize]
+        trace = np.frombuffer(body, dtype=CPU_TRACE_RECORD)
+        return trace["pc"].astype(np.int64), (trace["instr"] & 3) != 3
+
+    addrs, instrs = [], []
+    for line in data.decode(errors="replace").splitlines():
+        m = SPIKE_RE.search(line)
+        if m:
+            addrs.append(int(m.group(1), 16))
+            instrs.append(int(m.group(2), 16))
+            continue
+        fields = line.split("#")[0].split()
+        if fields:
+            addrs.append(int(fields[0], 16))
+            instrs.append(int(fields[1], 16) if len(fields) > 1 else 3)
+    addrs = np.array(addrs, dtype=np.int64) & 0xFFFF_FFFE
+    if ro_mem:
+        return addrs, ro_mem_rvc(addrs)
+    return addrs, (np.array(instrs, dtype=np.int64) & 3) != 3
+
+
+def synthetic_trace():
+    """A small program as tb_icache sees it with sim_wb_ro_mem: a loop calling a few
+    functions whose blocks conflict, with compressed and 32-bit instructions and
+    fetches that straddle blocks"""
+
+    def straight(start, length):
+        addrs = []
+        a = start
+        while a < start + length:
+            addrs.append(a)
+            a += 2 if ro_mem_rvc([a])[0] else 4
+        return addrs
+
+    main = straight(0x0000, 24)
+    funcs = [straight(0x0400, 70), straight(0x081A, 40), straight(0x1006, 52)]
+    addrs = []
+    for _ in range(4):
+        for f in funcs:
+            addrs += main + f
+    return addrs + main
+
+
+def run_one(job):
+    (num_blocks, block_size, set_size, rv32c), addrs, rvc, opts = job
+    model = ICacheModel(num_blocks, block_size, set_size, rv32c,
+                        mem_latency=opts["mem_latency"], issue_gap=opts["issue_gap"])
+    return model.run(addrs, rvc).results(opts["exec_cycles"])
+
+
+def parse_list(text, conv=int):
+    return [conv(v) for v in text.split(",") if v]
+
+
+def pareto(rows):
+    """Marks rows no other row beats on both CPI and RAMB18"""
+    for r in rows:
+        r["pareto"] = not any(
+            o is not r and o["cpi"] <= r["cpi"] and o["ramb18"] <= r["ramb18"]
+            and (o["cpi"] < r["cpi"] or o["ramb18"] < r["ramb18"])
+            for o in rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", nargs="?", help="fetch trace (see formats above)")
+    parser.add_argument("--blocks", default="8,16,32,64", help="G_NUM_BLOCKS values")
+    parser.add_argument("--block-sizes", default="16,32,64", help="G_BLOCK_SIZE values (bytes)")
+    parser.add_argument("--set-sizes", default="1,2,4", help="G_SET_SIZE values")
+    parser.add_argument("--rv32c", default="on,off", help="G_RV32C_OPT values")
+    parser.add_argument("--mem-latency", type=int, default=1,
+                        help="clocks from the first refill request to its ack (1 for sim_wb_ro_mem)")
+    parser.add_argument("--exec-cycles", type=float, default=3,
+                        help="clocks per instruction spent outside the fetch, for the CPI estimate")
+    parser.add_argument("--issue-gap", type=int, default=0,
+                        help="clocks between the icache being READY and the next fetch")
+    parser.add_argument("--ro-mem", action="store_true",
+                        help="take instructions from sim_wb_ro_mem's data, as tb_icache does")
+    parser.add_argument("--bram-budget", type=int, help="only show configurations using at most this many RAMB18")
+    parser.add_argument("--sort", default="cpi", choices=["cpi", "hit_rate", "ramb18", "refill_bytes"])
+    parser.add_argument("--top", type=int, default=40, help="number of rows to print")
+    parser.add_argument("-j", "--jobs", type=int, help="worker processes (default: all cores)")
+    parser.add_argument("--json", metavar="FILE", help="also write all results as JSON")
+    parser.add_argument("--csv", metavar="FILE", help="also write all results as CSV")
+    parser.add_argument("--write-synthetic", metavar="FILE",
+                        help="write the synthetic trace tb_icache replays and exit")
+    args = parser.parse_args()
+
+    if args.write_synthetic:
+        Path(args.write_synthetic).write_text("".join(f"{a:08x}\n" for a in synthetic_trace()))
+        print(f"wrote {args.write_synthetic}")
+        return
+    if not args.trace:
+        parser.error("a trace is needed")
+
+    addrs, rvc = read_trace(args.trace, args.ro_mem)
+    if len(addrs) == 0:
+        sys.exit(f"no fetches in {args.trace}")
+    print(f"{len(addrs)} fetches, {int(np.count_nonzero(rvc))} compressed, from {args.trace}")
+
+    rv32c = [v.strip().lower() in ("on", "1", "true") for v in args.rv32c.split(",")]
+    configs = []
+    for cfg in itertools.product(parse_list(args.blocks), parse_list(args.block_sizes),
+                                 parse_list(args.set_sizes), rv32c):
+        problem = config_problem(*cfg[:3])
+        if problem:
+            print(f"skipping {cfg[0]}x{cfg[1]}B {cfg[2]}-way: {problem}")
+        elif args.bram_budget is None or ICacheModel(*cfg).ramb18() <= args.bram_budget:
+            configs.append(cfg)
+    if not configs:
+        sys.exit("no configurations to try")
+
+    opts = {"mem_latency": args.mem_latency, "exec_cycles": args.exec_cycles, "issue_gap": args.issue_gap}
+    jobs = [(cfg, addrs, rvc, opts) for cfg in configs]
+    with ProcessPoolExecutor(max_workers=args.jobs) as pool:
+        rows = list(pool.map(run_one, jobs))
+    pareto(rows)
+    rows.sort(key=lambda r: -r[args.sort] if args.sort == "hit_rate" else r[args.sort])
+
+    print(f"\n{'blocks':>6} {'bytes':>5} {'ways':>4} {'rvc':>3} {'hit %':>7} {'refill KB':>10} "
+          f"{'fetch clk':>9} {'CPI':>6} {'RAMB18':>6} {'tag bits':>8}")
+    for r in rows[:args.top]:
+        print(f"{r['num_blocks']:>6} {r['block_size']:>5} {r['set_size']:>4} {'on' if r['rv32c_opt'] else 'off':>3} "
+              f"{100 * r['hit_rate']:>7.2f} {r['refill_bytes'] / 1024:>10.1f} {r['fetch_cycles']:>9.2f} "
+              f"{r['cpi']:>6.2f} {r['ramb18']:>6} {r['tag_bits']:>8}{' *' if r['pareto'] else ''}")
+
+    if args.json:
+        Path(args.json).write_text(json.dumps(rows, indent=2))
+        print(f"\nwrote {args.json}")
+    if args.csv:
+        keys = list(rows[0])
+        Path(args.csv).write_text("\n".join([",".join(keys)] + [",".join(str(r[k]) for k in keys) for r in rows]) + "\n")
+        print(f"wrote {args.csv}")
+
+
+if __name__ == "__main__":
+    main()
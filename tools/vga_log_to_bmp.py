@@ -1,80 +1,124 @@
-from PIL import Image
+"""Convert a binary VGA log from hdl/sim/tb_helpers/sim_vga_log.vhd into images
+
+    python vga_log_to_bmp.py sim_vga_log.bin                 # one PNG per frame
+    python vga_log_to_bmp.py sim_vga_log.bin --format bmp    # one BMP per frame
+    python vga_log_to_bmp.py sim_vga_log.bin --animate out.gif
+    python vga_log_to_bmp.py sim_vga_log.bin --show 1        # open frame 1
+
+The log is memory mapped and each line is decoded straight into a numpy array,
+so even large multi-frame logs convert in a few seconds.
+"""
 
+import argparse
+import mmap
+import sys
+from collections import Counter
+from pathlib import Path
+
+import numpy as np
+from PIL import Image
 
-infile = "sim_vga_log.txt"
-
-
-# VHDL Image Log Format
-# One line of text = one line of image
-# R G B, R G B, R G B, ...
-# VSYNC (marks next frame)
-# skip blank lines
-
-frame = -1
-x = 0
-y = 0
-
-images = []
-
-
-with open(infile, mode="r") as f:
-    for line in f:
-        line = line.strip()
-        # Handle VSYNC lines by creating a new image array
-        if line == "VSYNC":
-            print(f"Image done, {y} rows of {x} pixels")
-            # print(f"{y_count=}")
-            images.append(list())
-            # print(f"{images=}")
-            frame += 1
-            x = 0
-            y = 0
-        else:
-            # ignore blank lines
-            if len(line) > 0:
-                # remove trailing comma if present to not break line.split
-                if line[-1] == ",":
-                    line = line[:-1]
-
-                # process line
-                x = 0
-                
-                pixel_arr = line.split(",")
-                
-                if len(pixel_arr) != 1024:
-                    print(f"ERR only {len(pixel_arr)} pixels on line {y}")
-
-                for pixel in pixel_arr:
-                    pixel = pixel.strip()
-                    
-                    channels = pixel.split(" ") 
-
-                    # TODO fix this
-                    # if len(channels) != 3:
-                    #     continue
-                    
-                    if y == 0 and x > 1020:
-                        print(f"{x} {y} {channels=}")
-                    for channel in channels: # R G B
-                        # print(f"{channel=}")
-                        images[frame].append(int(channel, 16))    # assemble list of pixel data
-                    
-                    x += 1
-
-                # print(f"Line {y} done, {x_count} pixels")
-                y += 1
-        
-
-
-# print(f"DONE {images=}")
-
-# data = bytes([255, 0, 128])
-# for i in images:
-#     print(f"image {i} length = {len(images[i])}")
-print(f"image {0} length = {len(images[0])}")
-print(f"image {1} length = {len(images[1])}")
-data_arr = bytes(images[0])
-
-im=Image.frombytes("RGB", (1024, 600), data_arr, "raw", "RGB", 0, 1)
-
-im.show()
\ No newline at end of file
+# Binary log format (little endian), see sim_vga_log.vhd
+#   header: "VGALOG" u8 version u8 flags
+#   'F'                         VSYNC, starts the next frame
+#   'L' u16 n, n * RGB          raw line
+#   'R' u16 n, (u8 len, RGB)*   run length encoded line covering n pixels
+MAGIC = b"VGALOG"
+HEADER_LEN = 8
+
+RUN_DTYPE = np.dtype([("len", "u1"), ("rgb", "u1", 3)])
+
+
+def read_frames(path):
+    """Returns a list of frames, each a list of (n, 3) uint8 line arrays"""
+    with open(path, "rb") as f:
+        # left open, numpy views keep it alive until the lines have been copied out
+        mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        if mm[:len(MAGIC)] != MAGIC:
+            sys.exit(f"{path} is not a binary VGA log (re-run the simulation to regenerate it)")
+        buf = np.frombuffer(mm, dtype=np.uint8)
+        frames = [[]]
+        pos = HEADER_LEN
+        end = len(buf)
+        try:
+            while pos < end:
+                tag = buf[pos]
+                if tag == ord("F"):
+                    frames.append([])
+                    pos += 1
+                    continue
+                n = int(buf[pos + 1]) | (int(buf[pos + 2]) << 8)
+                pos += 3
+                if tag == ord("L"):
+                    if pos + 3 * n > end:
+                        break  # truncated by the simulation stopping mid-write
+                    frames[-1].append(buf[pos:pos + 3 * n].reshape(n, 3).copy())
+                    pos += 3 * n
+                elif tag == ord("R"):
+                    # runs are 4 bytes each and there are at most n of them,
+                    # find how many it takes to cover n pixels
+                    lens = buf[pos:pos + 4 * n:4].astype(np.int64)
+                    covered = np.cumsum(lens)
+                    k = int(np.searchsorted(covered, n)) + 1
+                    if k > len(lens) or pos + 4 * k > end:
+                        break  # truncated
+                    runs = buf[pos:pos + 4 * k].view(RUN_DTYPE)
+                    pos += 4 * k
+                    frames[-1].append(np.repeat(runs["rgb"], runs["len"], axis=0))
+                else:
+                    sys.exit(f"bad record 0x{tag:02x} at offset {pos - 3}")
+        except IndexError:
+            pass  # truncated final line
+    return [f for f in frames if f]
+
+
+def frame_to_array(lines, width):
+    img = np.zeros((len(lines), width, 3), dtype=np.uint8)
+    for y, line in enumerate(lines):
+        w = min(width, len(line))
+        img[y, :w] = line[:w]
+    return img
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", default="sim_vga_log.bin")
+    parser.add_argument("--out-dir", default=".", help="where to write the frames")
+    parser.add_argument("--format", default="png", choices=["png", "bmp"])
+    parser.add_argument("--animate", metavar="FILE", help="write every frame to one animated GIF/PNG instead")
+    parser.add_argument("--fps", type=float, default=10, help="frame rate for --animate")
+    parser.add_argument("--keep-partial", action="store_true",
+                        help="keep frames with an unusual number of lines (eg. the first one, before a VSYNC)")
+    parser.add_argument("--show", type=int, metavar="N", help="open frame N in the image viewer")
+    args = parser.parse_args()
+
+    frames = read_frames(args.log)
+    if not frames:
+        sys.exit(f"no pixels in {args.log}")
+
+    # the most common line length and line count are the real resolution
+    width = Counter(len(l) for f in frames for l in f).most_common(1)[0][0]
+    height = Counter(len(f) for f in frames).most_common(1)[0][0]
+    if not args.keep_partial:
+        frames = [f for f in frames if len(f) == height]
+    print(f"{len(frames)} frames of {width}x{height} in {args.log}")
+
+    images = [Image.fromarray(frame_to_array(f, width), "RGB") for f in frames]
+
+    if args.show is not None:
+        images[args.show].show()
+    elif args.animate:
+        images[0].save(args.animate, save_all=True, append_images=images[1:],
+                       duration=int(1000 / args.fps), loop=0)
+        print(f"wrote {args.animate}")
+    else:
+        out_dir = Path(args.out_dir)
+        out_dir.mkdir(parents=True, exist_ok=True)
+        stem = Path(args.log).stem
+        for i, im in enumerate(images):
+            im.save(out_dir / f"{stem}_{i:03d}.{args.format}")
+        print(f"wrote {len(images)} frames to {out_dir}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,7 @@
+puts "Adding 'write(address, value)', 'read(address)', 'load_bin(file, address)' and 'dump_bin(file, address, bytes)' commands to Vivado"
 
-puts "Adding 'write(address, value)' and 'read(address)' commands to Vivado"
+# jtag_wb_master takes AXI4 bursts of up to 256 words, and AXI bursts may not cross a 4KB boundary
+set MAX_BURST_WORDS 256
 
 proc reset {} {
     puts "Resetting hw_axi_1"
@@ -23,4 +25,74 @@ proc read {address} {
     # run_hw_axi -quiet rd_tx
     run_hw_axi rd_tx
     return 0x[get_property DATA [get_hw_axi_txn rd_tx]]
-}
\ No newline at end of file
+}
+
+# words that fit in a burst starting at byte address $addr
+proc burst_words {addr words_left} {
+    global MAX_BURST_WORDS
+    set to_4k [expr {(0x1000 - ($addr & 0xFFF)) / 4}]
+    return [expr {min($words_left, $MAX_BURST_WORDS, $to_4k)}]
+}
+
+proc report_rate {what bytes start} {
+    set secs [expr {max([clock milliseconds] - $start, 1) / 1000.0}]
+    puts [format "%s %d bytes in %.2fs (%.1f KB/s)" $what $bytes $secs [expr {$bytes / 1024.0 / $secs}]]
+}
+
+# Write a binary file to memory, eg. load_bin software/build/main.bin 0x00000000
+# Burst DATA strings are the last word first, ie. the first word is the rightmost 8 hex digits
+proc load_bin {filename address} {
+    set f [open $filename rb]
+    set bytes [chan read $f]
+    close $f
+    set len [string length $bytes]
+    # pad to whole words, little endian as the CPU sees them
+    append bytes [string repeat "\0" [expr {(4 - $len % 4) % 4}]]
+    binary scan $bytes i* words
+
+    reset_hw_axi [get_hw_axis hw_axi_1]
+    set start [clock milliseconds]
+    set addr [expr {$address}]
+    set i 0
+    set total [llength $words]
+    while {$i < $total} {
+        set n [burst_words $addr [expr {$total - $i}]]
+        set data {}
+        for {set j [expr {$i + $n - 1}]} {$j >= $i} {incr j -1} {
+            lappend data [format %08X [expr {[lindex $words $j] & 0xFFFFFFFF}]]
+        }
+        create_hw_axi_txn -quiet -force wr_tx [get_hw_axis hw_axi_1] -address [format %08X $addr] \
+            -data [join $data _] -len $n -burst INCR -type write
+        run_hw_axi -quiet wr_tx
+        incr i $n
+        incr addr [expr {4 * $n}]
+    }
+    report_rate "Loaded" $len $start
+}
+
+# Read memory into a binary file, eg. dump_bin psram.bin 0x20000000 0x10000
+proc dump_bin {filename address length} {
+    reset_hw_axi [get_hw_axis hw_axi_1]
+    set start [clock milliseconds]
+    set addr [expr {$address}]
+    set total [expr {($length + 3) / 4}]
+    set i 0
+    set bytes ""
+    while {$i < $total} {
+        set n [burst_words $addr [expr {$total - $i}]]
+        create_hw_axi_txn -quiet -force rd_tx [get_hw_axis hw_axi_1] -address [format %08X $addr] \
+            -len $n -burst INCR -type read
+        run_hw_axi -quiet rd_tx
+        set hex [string map {_ ""} [get_property DATA [get_hw_axi_txn rd_tx]]]
+        # first word is the rightmost
+        for {set j [expr {[string length $hex] - 8}]} {$j >= 0} {incr j -8} {
+            append bytes [binary format i 0x[string range $hex $j [expr {$j + 7}]]]
+        }
+        incr i $n
+        incr addr [expr {4 * $n}]
+    }
+    set f [open $filename wb]
+    puts -nonewline $f [string range $bytes 0 [expr {$length - 1}]]
+    close $f
+    report_rate "Dumped" $length $start
+}